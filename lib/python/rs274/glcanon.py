@@ -242,6 +242,30 @@ class GLCanon(Translated, ArcsToSegmentsMixin):
         self.dwells_append((self.lineno, color, self.lo[0], self.lo[1], self.lo[2], self.state.plane/10-17))
 
 
+    # the calls gcode.parse_preview() handles itself instead of the canon
+    preview_methods = ('straight_traverse', 'straight_feed', 'straight_probe',
+        'arc_feed', 'straight_arcsegments', 'rigid_tap', 'dwell',
+        'user_defined_function')
+
+    def native_preview(self):
+        # moves may be left to gcode.parse_preview() only if they would be
+        # drawn as here
+        cls = self.__class__
+        for m in self.preview_methods:
+            if getattr(cls, m).im_func is not getattr(GLCanon, m).im_func:
+                return False
+        return True
+
+    def add_preview(self, preview):
+        traverse, feed, arcfeed, dwells = preview.lists()
+        self.traverse.extend(traverse)
+        self.feed.extend(feed)
+        self.arcfeed.extend(arcfeed)
+        colors = self.colors['dwell'], self.colors['m1xx']
+        self.dwells.extend([(l, colors[kind], x, y, z, plane)
+            for l, kind, x, y, z, plane in dwells])
+        self.dwell_time += preview.dwell_time
+
     def highlight(self, lineno, geometry):
         glLineWidth(3)
         c = self.colors['selected']
@@ -1595,7 +1619,12 @@ class GlCanonDraw:
 
     def load_preview(self, f, canon, unitcode, initcode, interpname=""):
         self.set_canon(canon)
-        result, seq = gcode.parse(f, canon, unitcode, initcode, interpname)
+        if getattr(canon, "native_preview", lambda: False)():
+            result, seq, preview = gcode.parse_preview(f, canon, unitcode,
+                initcode, interpname, canon.arcdivision)
+            canon.add_preview(preview)
+        else:
+            result, seq = gcode.parse(f, canon, unitcode, initcode, interpname)
 
         if result <= gcode.MIN_ERROR:
             self.canon.progress.nextphase(1)
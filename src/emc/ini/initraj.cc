@@ -185,6 +185,17 @@ static int loadTraj(EmcIniFile *trajInifile)
             return -1;
         } 
 
+        // a jerk limit selects the S-curve velocity profile
+        double maxJerk = 0.0;
+        trajInifile->Find(&maxJerk, "MAX_JERK", "TRAJ");
+
+        if (0 != emcSetMaxJerk(maxJerk > 0.0 ? maxJerk : 0.0)) {
+            if (emc_debug & EMC_DEBUG_CONFIG) {
+                rcs_print("bad return value from emcSetMaxJerk\n");
+            }
+            return -1;
+        }
+
         double maxFeedScale = 1.0;
         trajInifile->Find(&maxFeedScale, "MAX_FEED_OVERRIDE", "DISPLAY");
 
@@ -376,8 +376,8 @@ int abort_and_switchback(void)
 }
 
 /*
-  emcmotCommandHandler() is called each main cycle to read the
-  shared memory buffer
+  emcmotCommandHandler() is called each main cycle to process the
+  commands queued on the command ring since the last cycle
   */
 int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
 {
@@ -387,8 +387,11 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
     emcmot_joint_t *joint;
     double tmp1;
     emcmot_comp_entry_t *comp_entry;
-    char issue_atspeed = 0;
+    char issue_atspeed;
     static int once = 1;
+    ringbatch_t batch;
+    const void *data;
+    ringsize_t size;
 
     check_stuff ( "before command_handler()" );
 
@@ -398,12 +401,18 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
 	once = 0;
     }
 
-    /* check for split read */
-    if (emcmotCommand->head != emcmotCommand->tail) {
-	emcmotDebug->split++;
-	return 0;			/* not really an error */
-    }
-    if (emcmotCommand->commandNum != emcmotStatus->commandNumEcho) {
+    /* the ring space is released once the whole batch is handled */
+    record_batch_read_begin(&emcmotCmdRing, &batch);
+    while (record_batch_read(&batch, &data, &size) == 0) {
+	if (size != sizeof(emcmot_command_t)) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+			    "MOTION: dropping command of size %u\n", size);
+	    continue;
+	}
+	/* the record is not aligned for the doubles in the command */
+	memcpy(emcmotCommand, data, sizeof(emcmot_command_t));
+	issue_atspeed = 0;
+
 	/* increment head count-- we'll be modifying emcmotStatus */
 	emcmotStatus->head++;
 	emcmotDebug->head++;
@@ -414,6 +423,18 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
 
 	/* clear status value by default */
 	emcmotStatus->commandStatus = EMCMOT_COMMAND_OK;
+
+	/* after a queued command failed, the moves queued behind it
+	   would run from the wrong place: drop them until user space
+	   has seen the failure */
+	if (EMCMOT_COMMAND_QUEUED(emcmotCommand->command) &&
+	    emcmotStatus->commandFailNum != emcmotCommand->commandFailAck) {
+	    rtapi_print_msg(RTAPI_MSG_DBG, "REJECTED: %d after failed %d",
+			    emcmotCommand->commandNum,
+			    emcmotStatus->commandFailNum);
+	    emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+	    goto command_rejected;
+	}
 	
 	/* ...and process command */
 
@@ -940,6 +961,7 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
             }
 	    /* append it to the emcmotDebug->tp */
 	    emcmotConfig->vtp->tpSetId(&emcmotDebug->tp, emcmotCommand->id);
+	    emcmotConfig->vtp->tpSetPlanVel(&emcmotDebug->tp, emcmotCommand->plan_vel);
 	    int res_addline = emcmotConfig->vtp->tpAddLine(&emcmotDebug->tp,
 							   emcmotCommand->pos,
 							   emcmotCommand->motion_type,
@@ -1003,6 +1025,7 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
             }
 	    /* append it to the emcmotDebug->queue */
 	    emcmotConfig->vtp->tpSetId(emcmotQueue, emcmotCommand->id);
+	    emcmotConfig->vtp->tpSetPlanVel(emcmotQueue, emcmotCommand->plan_vel);
 
 	    int res_addcircle = 
 		emcmotConfig->vtp->tpAddCircle(emcmotQueue, emcmotCommand->pos,
@@ -1036,6 +1059,70 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
 	    }
 	    break;
 
+	case EMCMOT_SET_SPLINE:
+	    /* emcmotDebug->tp up a spline move */
+	    /* requires coordinated mode, enable on, not on limits */
+	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_SPLINE");
+	    if (!GET_MOTION_COORD_FLAG() || !GET_MOTION_ENABLE_FLAG()) {
+		reportError
+		    (_("need to be enabled, in coord mode for spline move"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    } else if (!inRange(emcmotCommand->pos, emcmotCommand->id, "Spline")) {
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		abort_and_switchback(); // tpAbort(emcmotQueue);
+
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    } else if (!limits_ok()) {
+		reportError(_("can't do spline move with limits exceeded"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		abort_and_switchback(); // tpAbort(emcmotQueue);
+
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    }
+            if(emcmotStatus->atspeed_next_feed) {
+                issue_atspeed = 1;
+                emcmotStatus->atspeed_next_feed = 0;
+            }
+	    /* append it to the emcmotDebug->queue */
+	    emcmotConfig->vtp->tpSetId(emcmotQueue, emcmotCommand->id);
+	    emcmotConfig->vtp->tpSetPlanVel(emcmotQueue, emcmotCommand->plan_vel);
+
+	    int res_addspline =
+		emcmotConfig->vtp->tpAddSpline(emcmotQueue, emcmotCommand->pos,
+                            emcmotCommand->ctrl1, emcmotCommand->ctrl2,
+                            emcmotCommand->motion_type,
+                            emcmotCommand->vel, emcmotCommand->ini_maxvel,
+                            emcmotCommand->acc, emcmotStatus->enables_new,
+                            issue_atspeed, emcmotCommand->tag);
+        if (res_addspline < 0) {
+            reportError(_("can't add spline move at line %d, error code %d"),
+                    emcmotCommand->id, res_addspline);
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_BAD_EXEC;
+		abort_and_switchback(); // tpAbort(emcmotQueue);
+
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+        } else if (res_addspline != 0) {
+            //FIXME! This is a band-aid for a single issue, but there may be
+            //other consequences of non-fatal errors from AddXXX functions. We
+            //either need to fix the root cause (subtle position error after
+            //homing), or have a full restore here.
+            if (issue_atspeed) {
+                emcmotStatus->atspeed_next_feed = 1;
+            }
+        } else {
+		SET_MOTION_ERROR_FLAG(0);
+		/* set flag that indicates all joints need rehoming, if any
+		   joint is moved in joint mode, for machines with no forward
+		   kins */
+		rehomeAll = 1;
+	    }
+	    break;
+
 	case EMCMOT_SET_VEL:
 	    /* set the velocity for subsequent moves */
 	    /* can do it at any time */
@@ -1300,7 +1387,7 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
 	    if (emcmotStatus->motion_state != EMCMOT_MOTION_FREE) {
 		/* can't home unless in free mode */
 		reportError(_("must be in joint mode to home"));
-		return 0;
+		goto command_done;
 	    }
 	    if (!GET_MOTION_ENABLE_FLAG()) {
 		break;
@@ -1350,7 +1437,7 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
             
             if ((emcmotStatus->motion_state != EMCMOT_MOTION_FREE) && (emcmotStatus->motion_state != EMCMOT_MOTION_DISABLED)) {
                 reportError(_("must be in joint mode or disabled to unhome"));
-                return 0;
+                goto command_done;
             }
 
             if (joint_num < 0) {
@@ -1362,11 +1449,11 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
                     if(GET_JOINT_ACTIVE_FLAG(joint)) {
                         if (GET_JOINT_HOMING_FLAG(joint)) {
                             reportError(_("Cannot unhome while homing, joint %d"), n);
-                            return 0;
+                            goto command_done;
                         }
                         if (!GET_JOINT_INPOS_FLAG(joint)) {
                             reportError(_("Cannot unhome while moving, joint %d"), n);
-                            return 0;
+                            goto command_done;
                         }
                     }
                 }
@@ -1385,11 +1472,11 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
                 if(GET_JOINT_ACTIVE_FLAG(joint)) {
                     if (GET_JOINT_HOMING_FLAG(joint)) {
                         reportError(_("Cannot unhome while homing, joint %d"), joint_num);
-                        return 0;
+                        goto command_done;
                     }
                     if (!GET_JOINT_INPOS_FLAG(joint)) {
                         reportError(_("Cannot unhome while moving, joint %d"), joint_num);
-                        return 0;
+                        goto command_done;
                     }
                     SET_JOINT_HOMED_FLAG(joint, 0);
                 } else {
@@ -1398,7 +1485,7 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
             } else {
                 /* invalid joint number specified */
                 reportError(_("Cannot unhome invalid joint %d (max %d)"), joint_num, (num_joints-1));
-                return 0;
+                goto command_done;
             }
 
             break;
@@ -1748,6 +1835,9 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
         case EMCMOT_SET_MAX_FEED_OVERRIDE:
             emcmotConfig->maxFeedScale = emcmotCommand->maxFeedScale;
             break;
+        case EMCMOT_SET_MAX_JERK:
+            emcmotConfig->maxJerk = emcmotCommand->maxJerk;
+            break;
         case EMCMOT_SETUP_ARC_BLENDS:
             emcmotConfig->arcBlendEnable = emcmotCommand->arcBlendEnable;
             emcmotConfig->arcBlendFallbackEnable = emcmotCommand->arcBlendFallbackEnable;
@@ -1758,10 +1848,17 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
             break;
 
 	}			/* end of: command switch */
+    command_done:
 	if (emcmotStatus->commandStatus != EMCMOT_COMMAND_OK) {
 	    rtapi_print_msg(RTAPI_MSG_DBG, "ERROR: %d",
 		emcmotStatus->commandStatus);
+	    /* queued commands are not waited for, so keep track of
+	       the failure until user space catches up */
+	    if (EMCMOT_COMMAND_QUEUED(emcmotCommand->command)) {
+		emcmotStatus->commandFailNum = emcmotCommand->commandNum;
+	    }
 	}
+    command_rejected:
 	rtapi_print_msg(RTAPI_MSG_DBG, "\n");
 	/* synch tail count */
 	emcmotStatus->tail = emcmotStatus->head;
@@ -1769,7 +1866,8 @@ int emcmotCommandHandler(void *arg, const hal_funct_args_t *fa)
 	emcmotDebug->tail = emcmotDebug->head;
 
     }
-    /* end of: if-new-command */
+    /* end of: while-new-command */
+    record_batch_read_end(&batch);
 check_stuff ( "after command_handler()" );
 
     return 0;
@@ -43,6 +43,13 @@
 /* seconds to delay between comm retries */
 #define DEFAULT_EMCMOT_COMM_WAIT 0.010
 
+/* commands the ring from user space to the motion controller holds */
+#define EMCMOT_CMDRING_SLOTS 16
+/* queued moves which may be written ahead of the motion controller.
+   Each may add two segments to the TP queue (a blend arc and the move
+   itself), so together they must fit into the margin tcqFull() keeps */
+#define EMCMOT_CMDRING_INFLIGHT 8
+
 /* initial velocity, accel used for coordinated moves */
 #define DEFAULT_VELOCITY 1.0
 #define DEFAULT_ACCELERATION 10.0
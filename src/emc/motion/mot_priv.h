@@ -34,6 +34,7 @@
 /* joint data */
 #include "hal.h"
 #include "hal_priv.h"
+#include "ring.h"
 #include "../motion/motion.h"
 
 typedef struct {
@@ -296,6 +297,7 @@ extern struct emcmot_config_t *emcmotConfig;
 extern struct emcmot_debug_t *emcmotDebug;
 extern struct emcmot_internal_t *emcmotInternal;
 extern struct emcmot_error_t *emcmotError;
+extern ringbuffer_t emcmotCmdRing;
 
 extern TP_STRUCT *emcmotPrimQueue;
 extern TP_STRUCT *emcmotAltQueue;
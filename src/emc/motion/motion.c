@@ -23,7 +23,7 @@
 
 // vtable signatures
 #define VTKINS_VERSION VTKINEMATICS_VERSION1
-#define VTP_VERSION    VTTP_VERSION1
+#define VTP_VERSION    VTTP_VERSION3
 
 // Mark strings for translation, but defer translation to userspace
 #define _(s) (s)
@@ -102,8 +102,13 @@ int kinType = 0;
   emcmotCommand points to emcmotStruct->command,
   emcmotStatus points to emcmotStruct->status,
   emcmotError points to emcmotStruct->error, and
+  emcmotCmdRing is attached to emcmotStruct->cmdring.
+
+  Commands arrive through the ring; the command handler copies each
+  to emcmotStruct->command in turn while processing it.
  */
 emcmot_struct_t *emcmotStruct = 0;
+ringbuffer_t emcmotCmdRing;
 /* ptrs to either buffered copies or direct memory for
    command and status */
 struct emcmot_command_t *emcmotCommand = 0;
@@ -931,7 +936,7 @@ static int init_comm_buffers(void)
 
 
     /* allocate and initialize the shared memory structure */
-    emc_shmem_id = rtapi_shmem_new(key, mot_comp_id, sizeof(emcmot_struct_t));
+    emc_shmem_id = rtapi_shmem_new(key, mot_comp_id, EMCMOT_SHMEM_SIZE);
     if (emc_shmem_id < 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "MOTION: rtapi_shmem_new failed, returned %d\n", emc_shmem_id);
@@ -945,7 +950,7 @@ static int init_comm_buffers(void)
     }
 
     /* zero shared memory before doing anything else. */
-    memset(emcmotStruct, 0, sizeof(emcmot_struct_t));
+    memset(emcmotStruct, 0, EMCMOT_SHMEM_SIZE);
 
     /* we'll reference emcmotStruct directly */
     emcmotCommand = &emcmotStruct->command;
@@ -997,11 +1002,17 @@ static int init_comm_buffers(void)
     emcmotCommand->tail = 0;
     emcmotCommand->spindlesync = 0.0;
 
+    /* init command ring */
+    ringheader_init(&emcmotStruct->cmdring, RINGTYPE_RECORD,
+		    EMCMOT_CMDRING_SIZE, 0);
+    ringbuffer_init(&emcmotStruct->cmdring, &emcmotCmdRing);
+
     /* init status struct */
     emcmotStatus->head = 0;
     emcmotStatus->commandEcho = 0;
     emcmotStatus->commandNumEcho = 0;
     emcmotStatus->commandStatus = 0;
+    emcmotStatus->commandFailNum = 0;
 
     /* init more stuff */
 
@@ -1428,6 +1439,7 @@ static int init_shared(tp_shared_t *tps,
     tps->arcBlendTangentKinkRatio = &cfg->arcBlendTangentKinkRatio;
     tps->arcBlendFallbackEnable = &cfg->arcBlendFallbackEnable;
     tps->maxFeedScale = &cfg->maxFeedScale;
+    tps->maxJerk = &cfg->maxJerk;
 
     // from emcmotStatus
     tps->net_feed_scale = &status->net_feed_scale;
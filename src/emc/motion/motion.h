@@ -179,6 +179,8 @@ extern "C" {
     EMCMOT_SET_MAX_FEED_OVERRIDE = 62,
     EMCMOT_SETUP_ARC_BLENDS = 63,
     EMCMOT_RAPID_SCALE = 64,	          /* set scale factor for rapids */
+    EMCMOT_SET_MAX_JERK = 65,             /* jerk limit for coordinated moves */
+    EMCMOT_SET_SPLINE = 66,               /* queue up a cubic spline move */
     } cmd_code_t;
 
 /* this enum lists the possible results of a command */
@@ -191,6 +193,15 @@ extern "C" {
 	EMCMOT_COMMAND_BAD_EXEC	/* error trying to initiate */
     } cmd_status_t;
 
+/* queued commands are not waited for: user space puts them on the
+   command ring as fast as the motion controller takes them. Once one
+   of them failed, the controller rejects further queued commands until
+   user space acknowledges the failure (commandFailAck) */
+#define EMCMOT_COMMAND_QUEUED(cmd) \
+    ((cmd) == EMCMOT_SET_LINE || (cmd) == EMCMOT_SET_CIRCLE || \
+     (cmd) == EMCMOT_SET_SPLINE || (cmd) == EMCMOT_RIGID_TAP || \
+     (cmd) == EMCMOT_SET_TERM_COND)
+
 /* termination conditions for queued motions */
 #define EMCMOT_TERM_COND_STOP 1
 #define EMCMOT_TERM_COND_BLEND 2
@@ -207,12 +218,15 @@ extern "C" {
 	unsigned char head;	/* flag count for mutex detect */
 	cmd_code_t command;	/* command code (enum) */
 	int commandNum;		/* increment this for new command */
+	int commandFailAck;	/* last failed command user space has seen */
 	double motor_offset;    /* offset from joint to motor position */
 	double maxLimit;	/* pos value for position limit, output */
 	double minLimit;	/* neg value for position limit, output */
 	EmcPose pos;		/* line/circle endpt, or teleop vector */
 	PmCartesian center;	/* center for circle */
 	PmCartesian normal;	/* normal vec for circle */
+	PmCartesian ctrl1;	/* inner control points for spline */
+	PmCartesian ctrl2;
 	int turn;		/* turns for circle or which rotary to unlock for a line */
 	double vel;		/* max velocity */
         double ini_maxvel;      /* max velocity allowed by machine
@@ -220,6 +234,7 @@ extern "C" {
         int motion_type;        /* this move is because of traverse, feed, arc, or toolchange */
         double spindlesync;     /* user units per spindle revolution, 0 = no sync */
 	double acc;		/* max acceleration */
+	double plan_vel;	/* final velocity planned by task look-ahead, <0 = none */
 	double backlash;	/* amount of backlash */
 	int id;			/* id for motion */
 	int termCond;		/* termination condition */
@@ -259,6 +274,7 @@ extern "C" {
         double arcBlendRampFreq;
         double arcBlendTangentKinkRatio;
         double maxFeedScale;
+        double maxJerk;
     struct state_tag_t tag;
     } emcmot_command_t;
 
@@ -614,10 +630,11 @@ Suggestion: Split this in to an Error and a Status flag register..
 
     typedef struct emcmot_status_t {
 	unsigned char head;	/* flag count for mutex detect */
-	/* these three are updated only when a new command is handled */
+	/* these are updated only when a new command is handled */
 	cmd_code_t commandEcho;	/* echo of input command */
 	int commandNumEcho;	/* echo of input command number */
 	cmd_status_t commandStatus;	/* result of most recent command */
+	int commandFailNum;	/* number of queued command that failed */
 	/* these are config info, updated when a command changes them */
 	double feed_scale;	/* velocity scale factor for all motion but rapids */
 	double rapid_scale;	/* velocity scale factor for rapids */
@@ -773,6 +790,7 @@ Suggestion: Split this in to an Error and a Status flag register..
         double arcBlendRampFreq;
         double arcBlendTangentKinkRatio;
         double maxFeedScale;
+        double maxJerk;
     } emcmot_config_t;
 
 /*********************************
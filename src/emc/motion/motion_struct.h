@@ -14,6 +14,8 @@
 #ifndef MOTION_STRUCT_H
 #define MOTION_STRUCT_H
 
+#include "ring.h"
+
 /* big comm structure, for upper memory */
     typedef struct emcmot_struct_t {
 	struct emcmot_command_t command;	/* struct used to pass commands/data
@@ -25,7 +27,17 @@
 	struct emcmot_error_t error;	/* ring buffer for error messages */
 	struct emcmot_debug_t debug;	/* Struct used to store RT status and debug
 				   data - 2nd largest block */
+	ringheader_t cmdring;	/* record ring passing commands to the RT
+				   module, storage follows - must be last */
     } emcmot_struct_t;
 
+/* size of the command ring storage, and of the whole shared memory
+   segment including it */
+#define EMCMOT_CMDRING_SIZE \
+    (EMCMOT_CMDRING_SLOTS * record_space(sizeof(struct emcmot_command_t)))
+#define EMCMOT_SHMEM_SIZE \
+    (sizeof(emcmot_struct_t) + \
+     ring_memsize(RINGTYPE_RECORD, EMCMOT_CMDRING_SIZE, 0))
+
 
 #endif // MOTION_STRUCT_H
@@ -47,6 +47,8 @@ static emcmot_config_t *emcmotConfig = 0;
 static emcmot_debug_t *emcmotDebug = 0;
 static emcmot_error_t *emcmotError = 0;
 static emcmot_struct_t *emcmotStruct = 0;
+static ringbuffer_t emcmotCmdRing;
+static int commandFailNum = 0;	/* most recent failure acknowledged */
 
 /* usrmotIniLoad() loads params (SHMEM_KEY, COMM_TIMEOUT, COMM_WAIT)
    from named ini file */
@@ -74,6 +76,18 @@ int usrmotIniLoad(const char *filename)
     return 0;
 }
 
+/* reports and acknowledges a queued command which failed since the
+   last call. Returns its number, 0 if none failed */
+int usrmotCommandFailed(const emcmot_status_t * s)
+{
+    if (s->commandFailNum == commandFailNum) {
+	return 0;
+    }
+    commandFailNum = s->commandFailNum;
+    rcs_print("USRMOT: ERROR: queued command %d failed\n", commandFailNum);
+    return commandFailNum;
+}
+
 /* writes command from c */
 int usrmotWriteEmcmotCommand(emcmot_command_t * c)
 {
@@ -81,25 +95,60 @@ int usrmotWriteEmcmotCommand(emcmot_command_t * c)
     static int commandNum = 0;
     static unsigned char headCount = 0;
     double end;
+    int queued;
 
     if (!MOTION_ID_VALID(c->id)) {
         rcs_print("USRMOT: ERROR: invalid motion id: %d\n",c->id);
 	return EMCMOT_COMM_INVALID_MOTION_ID;
     }
-    c->head = ++headCount;
-    c->tail = c->head;
-    c->commandNum = ++commandNum;
 
     /* check for mapped mem still around */
-    if (0 == emcmotCommand) {
+    if (0 == emcmotStruct || !ringbuffer_attached(&emcmotCmdRing)) {
         rcs_print("USRMOT: ERROR: can't connect to shared memory\n");
 	return EMCMOT_COMM_ERROR_CONNECT;
     }
-    /* copy entire command structure to shared memory */
-    *emcmotCommand = *c;
-    /* poll for receipt of command */
+    queued = EMCMOT_COMMAND_QUEUED(c->command);
     /* set timeout for comm failure, now + timeout */
     end = etime() + EMCMOT_COMM_TIMEOUT;
+
+    /* back-pressure: the TP queue is not checked until a move is
+       handled, so only a few may be ahead of the motion controller */
+    while (queued) {
+	if (( usrmotReadEmcmotStatus(&s) == 0 ) &&
+	    ( commandNum - s.commandNumEcho < EMCMOT_CMDRING_INFLIGHT )) {
+	    /* the motion controller would reject this one anyway */
+	    if (usrmotCommandFailed(&s)) {
+		return EMCMOT_COMM_ERROR_COMMAND;
+	    }
+	    break;
+	}
+	if (etime() >= end) {
+	    rcs_print("USRMOT: ERROR: command timeout\n");
+	    return EMCMOT_COMM_ERROR_TIMEOUT;
+	}
+	esleep(25e-6);
+    }
+
+    c->head = ++headCount;
+    c->tail = c->head;
+    c->commandNum = ++commandNum;
+    c->commandFailAck = commandFailNum;
+
+    /* copy entire command structure to the ring */
+    while (record_write(&emcmotCmdRing, c, sizeof(emcmot_command_t)) != 0) {
+	if (etime() >= end) {
+	    rcs_print("USRMOT: ERROR: command timeout\n");
+	    return EMCMOT_COMM_ERROR_TIMEOUT;
+	}
+	esleep(25e-6);
+    }
+
+    if (queued) {
+	/* a failure is reported by usrmotCommandFailed() */
+	return EMCMOT_COMM_OK;
+    }
+
+    /* poll for receipt of command */
     /* now check to see if it got it */
     while (etime() < end) {
 	/* update status */
@@ -687,7 +736,7 @@ int usrmotInit(const char *modname)
 	return -1;
     }
     /* get shared memory block from RTAPI */
-    shmem_id = rtapi_shmem_new(SHMEM_KEY, module_id, sizeof(emcmot_struct_t));
+    shmem_id = rtapi_shmem_new(SHMEM_KEY, module_id, EMCMOT_SHMEM_SIZE);
     if (shmem_id < 0) {
 	fprintf(stderr,
 	    "usrmotintf: ERROR: could not open shared memory\n");
@@ -708,6 +757,9 @@ int usrmotInit(const char *modname)
     emcmotDebug = &(emcmotStruct->debug);
     emcmotConfig = &(emcmotStruct->config);
     emcmotError = &(emcmotStruct->error);
+    ringbuffer_init(&emcmotStruct->cmdring, &emcmotCmdRing);
+    /* failures before we attached are none of our business */
+    commandFailNum = emcmotStatus->commandFailNum;
 
     inited = 1;
 
@@ -723,6 +775,7 @@ int usrmotExit(void)
 
     emcmotStruct = 0;
     emcmotCommand = 0;
+    emcmotCmdRing.magic = 0;
     emcmotStatus = 0;
     emcmotError = 0;
 /*! \todo Another #if 0 */
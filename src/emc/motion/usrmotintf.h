@@ -72,6 +72,13 @@ extern "C" {
    Return values are as per the #defines above */
     extern int usrmotWriteEmcmotCommand(emcmot_command_t * c);
 
+/* usrmotCommandFailed() reports a queued command (see
+   EMCMOT_COMMAND_QUEUED) which failed since the last call, given the
+   status in s. The motion controller rejects further queued commands
+   until the failure was reported this way. Returns the number of the
+   failed command, 0 if there is none */
+    extern int usrmotCommandFailed(const emcmot_status_t * s);
+
 /* usrmotInit() initializes communication with the emcmot process */
     extern int usrmotInit(const char *name);
 
@@ -375,6 +375,9 @@ int emcFormat(NMLTYPE type, void *buffer, CMS * cms)
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
 	((EMC_TRAJ_CIRCULAR_MOVE *) buffer)->update(cms);
 	break;
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	((EMC_TRAJ_SPLINE_MOVE *) buffer)->update(cms);
+	break;
     case EMC_TRAJ_RIGID_TAP_TYPE:
 	((EMC_TRAJ_RIGID_TAP *) buffer)->update(cms);
         break;
@@ -709,6 +712,8 @@ const char *emc_symbol_lookup(long type)
 	return "EMC_TRAJ_RIGID_TAP";
     case EMC_TRAJ_RESUME_TYPE:
 	return "EMC_TRAJ_RESUME";
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	return "EMC_TRAJ_SPLINE_MOVE";
     case EMC_TRAJ_SET_ACCELERATION_TYPE:
 	return "EMC_TRAJ_SET_ACCELERATION";
     case EMC_TRAJ_SET_AXES_TYPE:
@@ -1515,6 +1520,7 @@ void EMC_TRAJ_LINEAR_MOVE::update(CMS * cms)
     cms->update(acc);
     cms->update(feed_mode);
     cms->update(indexrotary);
+    cms->update(plan_vel);
 }
 
 /*
@@ -1537,7 +1543,22 @@ void EMC_TRAJ_CIRCULAR_MOVE::update(CMS * cms)
     cms->update(ini_maxvel);
     cms->update(acc);
     cms->update(feed_mode);
+    cms->update(plan_vel);
+}
+
+void EMC_TRAJ_SPLINE_MOVE::update(CMS * cms)
+{
 
+    EMC_TRAJ_CMD_MSG::update(cms);
+    EmcPose_update(cms, &end);
+    cms->update(ctrl1);
+    cms->update(ctrl2);
+    cms->update(type);
+    cms->update(vel);
+    cms->update(ini_maxvel);
+    cms->update(acc);
+    cms->update(feed_mode);
+    cms->update(plan_vel);
 }
 
 /*
@@ -781,7 +781,8 @@ class EMC_TRAJ_DELAY:public EMC_TRAJ_CMD_MSG {
 class EMC_TRAJ_LINEAR_MOVE:public EMC_TRAJ_CMD_MSG {
   public:
     EMC_TRAJ_LINEAR_MOVE():EMC_TRAJ_CMD_MSG(EMC_TRAJ_LINEAR_MOVE_TYPE,
-					    sizeof(EMC_TRAJ_LINEAR_MOVE)) {
+					    sizeof(EMC_TRAJ_LINEAR_MOVE)),
+	plan_vel(-1.0) {
     };
 
     // For internal NML/CMS use only.
@@ -792,13 +793,15 @@ class EMC_TRAJ_LINEAR_MOVE:public EMC_TRAJ_CMD_MSG {
     double vel, ini_maxvel, acc;
     int feed_mode;
     int indexrotary;
+    double plan_vel;		// final velocity planned by task look-ahead, <0 = none
 };
 
 class EMC_TRAJ_CIRCULAR_MOVE:public EMC_TRAJ_CMD_MSG {
   public:
     EMC_TRAJ_CIRCULAR_MOVE():EMC_TRAJ_CMD_MSG(EMC_TRAJ_CIRCULAR_MOVE_TYPE,
 					      sizeof
-					      (EMC_TRAJ_CIRCULAR_MOVE)) {
+					      (EMC_TRAJ_CIRCULAR_MOVE)),
+	plan_vel(-1.0) {
     };
 
     // For internal NML/CMS use only.
@@ -811,6 +814,28 @@ class EMC_TRAJ_CIRCULAR_MOVE:public EMC_TRAJ_CMD_MSG {
     int type;
     double vel, ini_maxvel, acc;
     int feed_mode;
+    double plan_vel;		// final velocity planned by task look-ahead, <0 = none
+};
+
+// XY cubic Bezier from the current position to end, with inner control
+// points ctrl1 and ctrl2 - one piece of a G5, G5.1 or G5.2 spline
+class EMC_TRAJ_SPLINE_MOVE:public EMC_TRAJ_CMD_MSG {
+  public:
+    EMC_TRAJ_SPLINE_MOVE():EMC_TRAJ_CMD_MSG(EMC_TRAJ_SPLINE_MOVE_TYPE,
+					    sizeof(EMC_TRAJ_SPLINE_MOVE)),
+	plan_vel(-1.0) {
+    };
+
+    // For internal NML/CMS use only.
+    void update(CMS * cms);
+
+    EmcPose end;
+    PM_CARTESIAN ctrl1;
+    PM_CARTESIAN ctrl2;
+    int type;
+    double vel, ini_maxvel, acc;
+    int feed_mode;
+    double plan_vel;		// final velocity planned by task look-ahead, <0 = none
 };
 
 class EMC_TRAJ_SET_TERM_COND:public EMC_TRAJ_CMD_MSG {
@@ -36,6 +36,9 @@ extern "C" {
 /* default interp len */
 #define DEFAULT_EMC_TASK_INTERP_MAX_LEN 1000
 
+/* moves planned ahead by task, 0 leaves it all to the RT planner */
+#define DEFAULT_EMC_TASK_LOOKAHEAD_DEPTH 0
+
 /* default name of EMC_TOOL tool table file */
 #define DEFAULT_TOOL_TABLE_FILE "tool.tbl"
 
@@ -32,6 +32,7 @@ double emc_task_cycle_time = DEFAULT_EMC_TASK_CYCLE_TIME;
 double emc_io_cycle_time = DEFAULT_EMC_IO_CYCLE_TIME;
 
 int emc_task_interp_max_len = DEFAULT_EMC_TASK_INTERP_MAX_LEN;
+int emc_task_lookahead_depth = DEFAULT_EMC_TASK_LOOKAHEAD_DEPTH;
 
 char tool_table_file[LINELEN] = DEFAULT_TOOL_TABLE_FILE;
 
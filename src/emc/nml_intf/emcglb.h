@@ -52,6 +52,7 @@ extern "C" {
     extern double emc_io_cycle_time;
 
     extern int emc_task_interp_max_len;
+    extern int emc_task_lookahead_depth;
 
     extern char tool_table_file[LINELEN];
 
@@ -0,0 +1,222 @@
+/********************************************************************
+* Description: emcstatshm.cc
+*   A shared copy of EMC_STAT for local status readers, guarded by a
+*   sequence lock - see emcstatshm.hh
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <string.h>		/* memcmp(), memcpy() */
+#include <sched.h>		/* sched_yield() */
+#include <unistd.h>		/* getpid() */
+
+#include "rcs.hh"
+#include "rcs_print.hh"		// rcs_print_error()
+#include "shm.hh"		// RCS_SHAREDMEM
+#include "timer.hh"		// etime()
+#include "emcstatshm.hh"
+
+#define EMC_STAT_SHM_MAGIC 0x45535453
+// a reader gives up after this many attempts to get a consistent copy,
+// e.g. when task died while writing
+#define EMC_STAT_SHM_TRIES 1000
+// a reader without a region tries to attach this often (s)
+#define EMC_STAT_SHM_ATTACH_INTERVAL 1.0
+
+struct emc_stat_shm_t {
+    int magic;
+    int size;			// sizeof(EMC_STAT) of the writer
+    int writer;			// pid of task, 0 if none
+    unsigned seq;		// odd while task writes
+    unsigned generation[EMC_STAT_SHARDS];	// never 0
+    char stat[sizeof(EMC_STAT)] __attribute__((aligned(16)));
+};
+
+static unsigned next_generation(unsigned gen)
+{
+    return (gen + 1) ? gen + 1 : 1;
+}
+
+EMC_STAT_SHM::EMC_STAT_SHM(bool _writer)
+{
+    writer = _writer;
+    last_attach = -EMC_STAT_SHM_ATTACH_INTERVAL;
+    shm = NULL;
+    region = NULL;
+
+    EMC_STAT *st = new EMC_STAT;
+    shard_offsets(st, offset);
+    delete st;
+
+    if (!writer) {
+	attach();
+	return;
+    }
+
+    shm = new RCS_SHAREDMEM(EMC_STAT_SHM_KEY, sizeof(emc_stat_shm_t),
+			    RCS_SHAREDMEM_CREATE, 0666);
+    if (shm->addr == NULL || shm->create_errno) {
+	rcs_print_error("can't create the EMC_STAT shared memory: %s\n",
+			strerror(shm->create_errno));
+	delete shm;
+	shm = NULL;
+	return;
+    }
+    shm->delete_totally = 1;
+    region = (emc_stat_shm_t *) shm->addr;
+
+    if (region->magic != EMC_STAT_SHM_MAGIC ||
+	region->size != (int) sizeof(EMC_STAT)) {
+	memset(region, 0, sizeof(emc_stat_shm_t));
+	region->magic = EMC_STAT_SHM_MAGIC;
+	region->size = sizeof(EMC_STAT);
+    }
+    // readers of a previous task must not mistake the first status
+    // for one they have seen; a task which died while writing
+    // left seq odd
+    for (int s = 0; s < EMC_STAT_SHARDS; s++)
+	region->generation[s] = next_generation(region->generation[s]);
+    region->seq = (region->seq + 1) & ~1U;
+    __atomic_store_n(&region->writer, (int) getpid(), __ATOMIC_RELEASE);
+}
+
+EMC_STAT_SHM::~EMC_STAT_SHM()
+{
+    if (writer && region)
+	__atomic_store_n(&region->writer, 0, __ATOMIC_RELEASE);
+    delete shm;
+}
+
+void EMC_STAT_SHM::shard_offsets(const EMC_STAT *st,
+				 size_t offset[EMC_STAT_SHARDS + 1])
+{
+    const char *base = (const char *) st;
+    offset[EMC_STAT_SHARD_TASK] = 0;
+    offset[EMC_STAT_SHARD_TRAJ] = (const char *) &st->motion - base;
+    offset[EMC_STAT_SHARD_MOTION] = (const char *) &st->motion.axis - base;
+    offset[EMC_STAT_SHARD_IO] = (const char *) &st->io - base;
+    offset[EMC_STAT_SHARDS] = sizeof(EMC_STAT);
+}
+
+int EMC_STAT_SHM::update(EMC_STAT *dst, const EMC_STAT *src)
+{
+    size_t offset[EMC_STAT_SHARDS + 1];
+    char *d = (char *) dst;
+    const char *s = (const char *) src;
+    int copied = 0;
+
+    shard_offsets(dst, offset);
+    for (int i = 0; i < EMC_STAT_SHARDS; i++) {
+	size_t off = offset[i], len = offset[i + 1] - off;
+	if (!memcmp(d + off, s + off, len))
+	    continue;
+	memcpy(d + off, s + off, len);
+	copied |= 1 << i;
+    }
+    return copied;
+}
+
+bool EMC_STAT_SHM::valid()
+{
+    return region != NULL &&
+	region->magic == EMC_STAT_SHM_MAGIC &&
+	region->size == (int) sizeof(EMC_STAT) &&
+	__atomic_load_n(&region->writer, __ATOMIC_ACQUIRE) != 0;
+}
+
+// attach a reader to the region, at most once per
+// EMC_STAT_SHM_ATTACH_INTERVAL since task may start after us
+bool EMC_STAT_SHM::attach()
+{
+    if (writer)
+	return false;
+    delete shm;			// task exited, its region is stale
+    shm = NULL;
+    region = NULL;
+
+    double now = etime();
+    if (now - last_attach < EMC_STAT_SHM_ATTACH_INTERVAL)
+	return false;
+    last_attach = now;
+
+    // attaching fails noisily if task isn't running yet
+    RCS_PRINT_DESTINATION_TYPE dest = get_rcs_print_destination();
+    set_rcs_print_destination(RCS_PRINT_TO_NULL);
+    shm = new RCS_SHAREDMEM(EMC_STAT_SHM_KEY, sizeof(emc_stat_shm_t),
+			    RCS_SHAREDMEM_NOCREATE);
+    set_rcs_print_destination(dest);
+
+    if (shm->addr == NULL || shm->create_errno) {
+	delete shm;
+	shm = NULL;
+	return false;
+    }
+    region = (emc_stat_shm_t *) shm->addr;
+    return valid();
+}
+
+void EMC_STAT_SHM::write(const EMC_STAT *stat)
+{
+    if (!writer || region == NULL)
+	return;
+
+    const char *src = (const char *) stat;
+    unsigned seq = region->seq;
+    bool writing = false;
+
+    for (int s = 0; s < EMC_STAT_SHARDS; s++) {
+	size_t off = offset[s], len = offset[s + 1] - off;
+
+	// only task writes, so it may compare without the lock
+	if (!memcmp(region->stat + off, src + off, len))
+	    continue;
+	if (!writing) {
+	    __atomic_store_n(&region->seq, seq + 1, __ATOMIC_RELAXED);
+	    __atomic_thread_fence(__ATOMIC_RELEASE);
+	    writing = true;
+	}
+	memcpy(region->stat + off, src + off, len);
+	__atomic_store_n(&region->generation[s],
+			 next_generation(region->generation[s]),
+			 __ATOMIC_RELAXED);
+    }
+    if (writing)
+	__atomic_store_n(&region->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+int EMC_STAT_SHM::read(EMC_STAT *stat, unsigned gen[EMC_STAT_SHARDS])
+{
+    if (!valid() && !attach())
+	return -1;
+
+    char *dst = (char *) stat;
+    for (int tries = 0; tries < EMC_STAT_SHM_TRIES; tries++) {
+	unsigned seq = __atomic_load_n(&region->seq, __ATOMIC_ACQUIRE);
+	if (seq & 1) {
+	    sched_yield();
+	    continue;
+	}
+
+	unsigned g[EMC_STAT_SHARDS];
+	int copied = 0;
+	for (int s = 0; s < EMC_STAT_SHARDS; s++) {
+	    g[s] = __atomic_load_n(&region->generation[s], __ATOMIC_RELAXED);
+	    if (g[s] == gen[s])
+		continue;
+	    size_t off = offset[s];
+	    memcpy(dst + off, region->stat + off, offset[s + 1] - off);
+	    copied |= 1 << s;
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&region->seq, __ATOMIC_RELAXED) != seq)
+	    continue;		// task wrote meanwhile
+
+	memcpy(gen, g, sizeof(g));
+	return copied;
+    }
+    // stat may be torn now - have the next read copy everything
+    memset(gen, 0, sizeof(unsigned) * EMC_STAT_SHARDS);
+    return -1;
+}
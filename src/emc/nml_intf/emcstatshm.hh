@@ -0,0 +1,77 @@
+/********************************************************************
+* Description: emcstatshm.hh
+*   A shared copy of EMC_STAT for local status readers, published
+*   by task alongside the emcStatus NML buffer.
+*
+*   The NML buffer is locked by a semaphore for each write and read,
+*   so every GUI poll competes with the task cycle. Here the writer
+*   never waits: the region is guarded by a sequence lock, and readers
+*   retry if task wrote while they were copying.
+*
+*   EMC_STAT is split into shards (task, traj, motion, io). Task only
+*   copies a shard which changed and bumps its generation; a reader
+*   passes the generations it saw last and copies changed shards only.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#ifndef EMCSTATSHM_HH
+#define EMCSTATSHM_HH
+
+#include "emc_nml.hh"		// EMC_STAT
+
+class RCS_SHAREDMEM;
+
+// shared memory key; must not be used by a buffer in the .nml file
+#define EMC_STAT_SHM_KEY 0x45535400
+
+enum {
+    EMC_STAT_SHARD_TASK,	// status header, task
+    EMC_STAT_SHARD_TRAJ,	// motion status header, traj
+    EMC_STAT_SHARD_MOTION,	// axes, spindle, dio/aio
+    EMC_STAT_SHARD_IO,		// io, debug
+    EMC_STAT_SHARDS
+};
+
+struct emc_stat_shm_t;
+
+class EMC_STAT_SHM {
+  public:
+    // the writer (task) creates the region, readers attach to it
+    EMC_STAT_SHM(bool writer);
+    ~EMC_STAT_SHM();
+
+    // writer: publish a status, never blocks
+    void write(const EMC_STAT *stat);
+
+    // reader: copy the shards of stat whose generation differs from
+    // gen[] into stat, and update gen[]. Zero gen[] for a full copy.
+    // Returns a mask of the shards copied (1 << EMC_STAT_SHARD_*), or -1
+    // if there is no valid region - the caller should fall back to NML.
+    int read(EMC_STAT *stat, unsigned gen[EMC_STAT_SHARDS]);
+
+    bool valid();
+
+    // where each shard starts within an EMC_STAT; offset[EMC_STAT_SHARDS]
+    // is sizeof(EMC_STAT)
+    static void shard_offsets(const EMC_STAT *stat,
+			      size_t offset[EMC_STAT_SHARDS + 1]);
+
+    // copy the shards of src which differ from dst, for readers which
+    // got src through NML. Returns a mask of the shards copied.
+    static int update(EMC_STAT *dst, const EMC_STAT *src);
+
+  private:
+    bool attach();
+
+    bool writer;
+    double last_attach;
+    RCS_SHAREDMEM *shm;
+    emc_stat_shm_t *region;
+    size_t offset[EMC_STAT_SHARDS + 1];
+
+    EMC_STAT_SHM(const EMC_STAT_SHM &);	// Don't copy me.
+};
+
+#endif
@@ -144,6 +144,42 @@ NMLmsg *NML_INTERP_LIST::get()
     return ret;
 }
 
+NMLmsg *NML_INTERP_LIST::get_newest()
+{
+    NML_INTERP_LIST_NODE *node_ptr;
+
+    if (NULL == linked_list_ptr) {
+	return NULL;
+    }
+    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_tail();
+    if (NULL == node_ptr) {
+	return NULL;
+    }
+    return (NMLmsg *) ((char *) node_ptr->command.commandbuf);
+}
+
+NMLmsg *NML_INTERP_LIST::get_older()
+{
+    NML_INTERP_LIST_NODE *node_ptr;
+
+    if (NULL == linked_list_ptr) {
+	return NULL;
+    }
+    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_last();
+    if (NULL == node_ptr) {
+	return NULL;
+    }
+    return (NMLmsg *) ((char *) node_ptr->command.commandbuf);
+}
+
+int NML_INTERP_LIST::get_serial()
+{
+    if (NULL == linked_list_ptr) {
+	return -1;
+    }
+    return linked_list_ptr->get_current_id();
+}
+
 void NML_INTERP_LIST::clear()
 {
     if (NULL != linked_list_ptr) {
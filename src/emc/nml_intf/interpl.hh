@@ -53,6 +53,11 @@ class NML_INTERP_LIST {
     int append(NMLmsg &);
     int append(NMLmsg *);
     NMLmsg *get();
+    // walk the list from the newest entry back towards the oldest, e.g. to
+    // annotate queued moves in place. append() and get() end the walk.
+    NMLmsg *get_newest();
+    NMLmsg *get_older();
+    int get_serial();		// increasing serial number of the walked entry
     void clear();
     void print();
     int len();
@@ -18,6 +18,8 @@
 
 #include <Python.h>
 #include <structmember.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "rs274ngc.hh"
 #include "rs274ngc_interp.hh"
@@ -140,6 +142,7 @@ static PyTypeObject LineCodeType = {
 static PyObject *callback;
 static int interp_error;
 static int last_sequence_number;
+static bool line_deferred;
 static bool metric;
 static double _pos_x, _pos_y, _pos_z, _pos_a, _pos_b, _pos_c, _pos_u, _pos_v, _pos_w;
 EmcPose tool_offset;
@@ -149,12 +152,464 @@ static InterpBase *pinterp;
 
 #define callmethod(o, m, f, ...) PyObject_CallMethod((o), (char*)(m), (char*)(f), ## __VA_ARGS__)
 
+static void unrotate(double &x, double &y, double c, double s) {
+    double tx = x * c + y * s;
+    y = -x * s + y * c;
+    x = tx;
+}
+
+static void rotate(double &x, double &y, double c, double s) {
+    double tx = x * c - y * s;
+    y = x * s + y * c;
+    x = tx;
+}
+
+// an arc as ARC_FEED gives it, with the canon state it is drawn in
+struct arc_params {
+    double o[9];                // start, translated
+    double x1, y1, cx, cy, z1;
+    double a, b, c, u, v, w;
+    int rot, plane;
+    double rotation_cos, rotation_sin;
+    double g5xoffset[9], g92offset[9];
+};
+
+static void arc_axes(int plane, int &X, int &Y, int &Z) {
+    if(plane == 1) {
+        X=0; Y=1; Z=2;
+    } else if(plane == 3) {
+        X=2; Y=0; Z=1;
+    } else {
+        X=1; Y=2; Z=0;
+    }
+}
+
+static void arc_translate(const arc_params &arc, double p[9]) {
+    for(int ax=0; ax<9; ax++) p[ax] += arc.g92offset[ax];
+    rotate(p[0], p[1], arc.rotation_cos, arc.rotation_sin);
+    for(int ax=0; ax<9; ax++) p[ax] += arc.g5xoffset[ax];
+}
+
+// the translated end point of an arc
+static void arc_end(const arc_params &arc, double n[9]) {
+    int X, Y, Z;
+    arc_axes(arc.plane, X, Y, Z);
+    n[X] = arc.x1;
+    n[Y] = arc.y1;
+    n[Z] = arc.z1;
+    n[3] = arc.a;
+    n[4] = arc.b;
+    n[5] = arc.c;
+    n[6] = arc.u;
+    n[7] = arc.v;
+    n[8] = arc.w;
+    arc_translate(arc, n);
+}
+
+// split an arc into straight segments, storing their translated end points
+// in segs (9 doubles each). Returns the number of segments; with segs NULL
+// only counts them.
+static int arc_segments(const arc_params &arc, int max_segments, double *segs) {
+    double o[9], n[9];
+    int X, Y, Z;
+
+    arc_axes(arc.plane, X, Y, Z);
+    n[X] = arc.x1;
+    n[Y] = arc.y1;
+    n[Z] = arc.z1;
+    n[3] = arc.a;
+    n[4] = arc.b;
+    n[5] = arc.c;
+    n[6] = arc.u;
+    n[7] = arc.v;
+    n[8] = arc.w;
+    memcpy(o, arc.o, sizeof(o));
+    for(int ax=0; ax<9; ax++) o[ax] -= arc.g5xoffset[ax];
+    unrotate(o[0], o[1], arc.rotation_cos, arc.rotation_sin);
+    for(int ax=0; ax<9; ax++) o[ax] -= arc.g92offset[ax];
+
+    double cx = arc.cx, cy = arc.cy;
+    double theta1 = rtapi_atan2(o[Y]-cy, o[X]-cx);
+    double theta2 = rtapi_atan2(n[Y]-cy, n[X]-cx);
+
+    if(arc.rot < 0) {
+        while(theta2 - theta1 > -CIRCLE_FUZZ) theta2 -= 2*M_PI;
+    } else {
+        while(theta2 - theta1 < CIRCLE_FUZZ) theta2 += 2*M_PI;
+    }
+
+    // if multi-turn, add the right number of full circles
+    if(arc.rot < -1) theta2 += 2*M_PI*(arc.rot+1);
+    if(arc.rot > 1) theta2 += 2*M_PI*(arc.rot-1);
+
+    int steps = std::max(3, int(max_segments * rtapi_fabs(theta1 - theta2) / M_PI));
+    if(!segs) return steps;
+    double rsteps = 1. / steps;
+
+    double dtheta = theta2 - theta1;
+    double d[9] = {0, 0, 0, n[3]-o[3], n[4]-o[4], n[5]-o[5], n[6]-o[6], n[7]-o[7], n[8]-o[8]};
+    d[Z] = n[Z] - o[Z];
+
+    double tx = o[X] - cx, ty = o[Y] - cy, dc = rtapi_cos(dtheta*rsteps), ds = rtapi_sin(dtheta*rsteps);
+    for(int i=0; i<steps-1; i++) {
+        double f = (i+1) * rsteps;
+        double *p = segs + 9*i;
+        rotate(tx, ty, dc, ds);
+        p[X] = tx + cx;
+        p[Y] = ty + cy;
+        p[Z] = o[Z] + d[Z] * f;
+        p[3] = o[3] + d[3] * f;
+        p[4] = o[4] + d[4] * f;
+        p[5] = o[5] + d[5] * f;
+        p[6] = o[6] + d[6] * f;
+        p[7] = o[7] + d[7] * f;
+        p[8] = o[8] + d[8] * f;
+        arc_translate(arc, p);
+    }
+    arc_translate(arc, n);
+    memcpy(segs + 9*(steps-1), n, sizeof(n));
+    return steps;
+}
+
+/* gcode.parse_preview() runs the interpreter like gcode.parse(), but keeps
+ * the motion it makes here instead of passing each move to the canon: the
+ * canon state glcanon.GLCanon tracks for drawing (current point, offsets,
+ * rotation, plane, feed rate, tool offset) is tracked alongside, and moves
+ * are appended to arrays of segments in the layout glcanon uses for its
+ * lists. Other canon calls still reach the Python canon.
+ *
+ * Arcs are only recorded while the interpreter runs. When it is done,
+ * with the GIL released, they are split into segments and the extents are
+ * computed, both spread over the available cores.
+ */
+struct preview_segment {
+    double line;
+    double start[9], end[9];
+    double feedrate;            // 0 for traverses
+    double tool[3];
+};
+
+struct preview_dwell {
+    double line;
+    double kind;                // 0 dwell, 1 user defined M-code
+    double x, y, z;
+    double plane;               // 0 XY, 1 XZ, 2 YZ
+    double time;
+};
+
+struct preview_arc {
+    int line;
+    double feedrate;
+    double tool[3];
+    arc_params arc;
+};
+
+enum { PREVIEW_TRAVERSE, PREVIEW_FEED, PREVIEW_ARCFEED, PREVIEW_DWELLS,
+       PREVIEW_VIEWS };
+
+// rows of doubles per view
+static const int preview_columns[PREVIEW_VIEWS] = {
+    sizeof(preview_segment) / sizeof(double),
+    sizeof(preview_segment) / sizeof(double),
+    sizeof(preview_segment) / sizeof(double),
+    sizeof(preview_dwell) / sizeof(double),
+};
+
+// fewer items than this aren't worth a thread
+#define PREVIEW_MIN_CHUNK 4096
+#define PREVIEW_MAX_THREADS 16
+
+struct Preview {
+    Preview(int arcdivision);
+    void finish();
+
+    const double *data(int view);
+    Py_ssize_t rows(int view);
+
+    // canon state
+    double lo[9];
+    double g5xoffset[9], g92offset[9];
+    double rotation_cos, rotation_sin;
+    double tool[9];
+    double feedrate;
+    int plane;
+    bool first_move;
+    int suppress;
+    int arcdivision;
+
+    std::vector<preview_segment> segments[PREVIEW_DWELLS];
+    std::vector<preview_dwell> dwells;
+    std::vector<preview_arc> arcs;
+    std::vector<size_t> arc_first;      // first arcfeed row of each arc
+    double dwell_time;
+    double extents[12];                 // as calc_extents() returns them
+};
+
+static Preview *preview;
+
+Preview::Preview(int _arcdivision) {
+    for(int ax=0; ax<9; ax++)
+        lo[ax] = g5xoffset[ax] = g92offset[ax] = tool[ax] = 0;
+    rotation_cos = 1;
+    rotation_sin = 0;
+    feedrate = 1;
+    plane = 1;
+    first_move = true;
+    suppress = 0;
+    arcdivision = _arcdivision;
+    dwell_time = 0;
+    for(int i=0; i<6; i++) {
+        extents[i < 3 ? i : i + 3] = 9e99;
+        extents[i < 3 ? i + 3 : i + 6] = -9e99;
+    }
+}
+
+const double *Preview::data(int view) {
+    static double empty;
+    if(!rows(view)) return &empty;
+    if(view == PREVIEW_DWELLS) return &dwells[0].line;
+    return &segments[view][0].line;
+}
+
+Py_ssize_t Preview::rows(int view) {
+    if(view == PREVIEW_DWELLS) return dwells.size();
+    return segments[view].size();
+}
+
+// a move on a new line while previewing: the canon is told about the line
+// only if a call it sees follows
+static void preview_new_line(int sequence_number) {
+    if(sequence_number == last_sequence_number) return;
+    last_sequence_number = sequence_number;
+    line_deferred = true;
+}
+
+static void preview_translate(double p[9]) {
+    for(int ax=0; ax<9; ax++) p[ax] += preview->g92offset[ax];
+    rotate(p[0], p[1], preview->rotation_cos, preview->rotation_sin);
+    for(int ax=0; ax<9; ax++) p[ax] += preview->g5xoffset[ax];
+}
+
+static void preview_append(int view, int line, const double start[9],
+        const double end[9], double feedrate) {
+    preview_segment s;
+    s.line = line;
+    memcpy(s.start, start, sizeof(s.start));
+    memcpy(s.end, end, sizeof(s.end));
+    s.feedrate = feedrate;
+    memcpy(s.tool, preview->tool, sizeof(s.tool));
+    preview->segments[view].push_back(s);
+}
+
+static void preview_move(int view, int line, double x, double y, double z,
+        double a, double b, double c, double u, double v, double w) {
+    if(preview->suppress > 0) return;
+    double l[9] = {x, y, z, a, b, c, u, v, w};
+    preview_translate(l);
+    if(view == PREVIEW_TRAVERSE) {
+        if(!preview->first_move)
+            preview_append(view, line, preview->lo, l, 0);
+    } else {
+        preview->first_move = false;
+        preview_append(view, line, preview->lo, l, preview->feedrate);
+    }
+    memcpy(preview->lo, l, sizeof(l));
+}
+
+static void preview_rigid_tap(int line, double x, double y, double z) {
+    if(preview->suppress > 0) return;
+    preview->first_move = false;
+    double l[9] = {x, y, z, 0, 0, 0, 0, 0, 0};
+    preview_translate(l);
+    memcpy(l + 3, preview->lo + 3, 6 * sizeof(double));
+    preview_append(PREVIEW_FEED, line, preview->lo, l, preview->feedrate);
+    preview_append(PREVIEW_FEED, line, l, preview->lo, preview->feedrate);
+}
+
+static void preview_arc_feed(int line, double x1, double y1, double cx,
+        double cy, int rot, double z1, double a, double b, double c,
+        double u, double v, double w) {
+    if(preview->suppress > 0) return;
+    preview->first_move = false;
+    preview_arc pa;
+    pa.line = line;
+    pa.feedrate = preview->feedrate;
+    memcpy(pa.tool, preview->tool, sizeof(pa.tool));
+    arc_params &arc = pa.arc;
+    memcpy(arc.o, preview->lo, sizeof(arc.o));
+    arc.x1 = x1; arc.y1 = y1; arc.cx = cx; arc.cy = cy; arc.z1 = z1;
+    arc.a = a; arc.b = b; arc.c = c; arc.u = u; arc.v = v; arc.w = w;
+    arc.rot = rot;
+    arc.plane = preview->plane;
+    arc.rotation_cos = preview->rotation_cos;
+    arc.rotation_sin = preview->rotation_sin;
+    memcpy(arc.g5xoffset, preview->g5xoffset, sizeof(arc.g5xoffset));
+    memcpy(arc.g92offset, preview->g92offset, sizeof(arc.g92offset));
+    preview->arcs.push_back(pa);
+    arc_end(arc, preview->lo);
+}
+
+static void preview_add_dwell(int line, int kind, double time) {
+    preview_new_line(line);
+    if(preview->suppress > 0) return;
+    static const int plane_index[] = {0, 0, 2, 1};
+    preview_dwell d;
+    d.line = line;
+    d.kind = kind;
+    d.x = preview->lo[0];
+    d.y = preview->lo[1];
+    d.z = preview->lo[2];
+    d.plane = preview->plane >= 1 && preview->plane <= 3 ?
+        plane_index[preview->plane] : 0;
+    d.time = time;
+    preview->dwells.push_back(d);
+    preview->dwell_time += time;
+}
+
+static void preview_tool_offset(const EmcPose &offset) {
+    double o[9] = {offset.tran.x, offset.tran.y, offset.tran.z,
+        offset.a, offset.b, offset.c, offset.u, offset.v, offset.w};
+    preview->first_move = true;
+    for(int ax=0; ax<9; ax++) {
+        preview->lo[ax] += preview->tool[ax] - o[ax];
+        preview->tool[ax] = o[ax];
+    }
+}
+
+// run fn over [0, n) in chunks, one thread each
+struct preview_job {
+    void (*fn)(void *arg, size_t begin, size_t end, int chunk);
+    void *arg;
+    size_t begin, end;
+    int chunk;
+    pthread_t thread;
+};
+
+static void *preview_worker(void *arg) {
+    preview_job *job = (preview_job *)arg;
+    job->fn(job->arg, job->begin, job->end, job->chunk);
+    return NULL;
+}
+
+static int preview_chunks(size_t n) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t chunks = (n + PREVIEW_MIN_CHUNK - 1) / PREVIEW_MIN_CHUNK;
+    if(cpus < 1) cpus = 1;
+    if(cpus > PREVIEW_MAX_THREADS) cpus = PREVIEW_MAX_THREADS;
+    if(chunks > (size_t)cpus) chunks = cpus;
+    return chunks ? chunks : 1;
+}
+
+static void parallel_for(size_t n, int chunks,
+        void (*fn)(void *arg, size_t begin, size_t end, int chunk),
+        void *arg) {
+    preview_job job[PREVIEW_MAX_THREADS];
+    bool started[PREVIEW_MAX_THREADS];
+    for(int i=0; i<chunks; i++) {
+        job[i].fn = fn;
+        job[i].arg = arg;
+        job[i].begin = n * i / chunks;
+        job[i].end = n * (i+1) / chunks;
+        job[i].chunk = i;
+        // the first chunk, and any a thread can't be had for, run here
+        started[i] = i > 0 &&
+            !pthread_create(&job[i].thread, NULL, preview_worker, &job[i]);
+    }
+    for(int i=0; i<chunks; i++)
+        if(!started[i]) preview_worker(&job[i]);
+    for(int i=0; i<chunks; i++)
+        if(started[i]) pthread_join(job[i].thread, NULL);
+}
+
+static void count_arcs(void *arg, size_t begin, size_t end, int chunk) {
+    Preview *p = (Preview *)arg;
+    for(size_t i=begin; i<end; i++)
+        p->arc_first[i+1] = arc_segments(p->arcs[i].arc, p->arcdivision, NULL);
+}
+
+static void split_arcs(void *arg, size_t begin, size_t end, int chunk) {
+    Preview *p = (Preview *)arg;
+    std::vector<double> segs;
+    for(size_t i=begin; i<end; i++) {
+        const preview_arc &pa = p->arcs[i];
+        size_t first = p->arc_first[i], steps = p->arc_first[i+1] - first;
+        segs.resize(9 * steps);
+        arc_segments(pa.arc, p->arcdivision, &segs[0]);
+        const double *lo = pa.arc.o;
+        for(size_t j=0; j<steps; j++) {
+            preview_segment &s = p->segments[PREVIEW_ARCFEED][first + j];
+            s.line = pa.line;
+            memcpy(s.start, lo, sizeof(s.start));
+            memcpy(s.end, &segs[9*j], sizeof(s.end));
+            s.feedrate = pa.feedrate;
+            memcpy(s.tool, pa.tool, sizeof(s.tool));
+            lo = &segs[9*j];
+        }
+    }
+}
+
+struct extents_job {
+    const preview_segment *segs;
+    double (*extents)[12];
+};
+
+static void extend(double e[12], const double p[3], const double t[3]) {
+    for(int ax=0; ax<3; ax++) {
+        e[ax] = std::min(e[ax], p[ax]);
+        e[ax+3] = std::max(e[ax+3], p[ax]);
+        e[ax+6] = std::min(e[ax+6], p[ax] + t[ax]);
+        e[ax+9] = std::max(e[ax+9], p[ax] + t[ax]);
+    }
+}
+
+static void merge_extents(double e[12], const double f[12]) {
+    for(int ax=0; ax<3; ax++) {
+        e[ax] = std::min(e[ax], f[ax]);
+        e[ax+3] = std::max(e[ax+3], f[ax+3]);
+        e[ax+6] = std::min(e[ax+6], f[ax+6]);
+        e[ax+9] = std::max(e[ax+9], f[ax+9]);
+    }
+}
+
+static void segment_extents(void *arg, size_t begin, size_t end, int chunk) {
+    extents_job *job = (extents_job *)arg;
+    double *e = job->extents[chunk];
+    for(size_t i=begin; i<end; i++)
+        extend(e, job->segs[i].start, job->segs[i].tool);
+}
+
+void Preview::finish() {
+    arc_first.assign(arcs.size() + 1, 0);
+    int chunks = preview_chunks(arcs.size());
+    parallel_for(arcs.size(), chunks, count_arcs, this);
+    for(size_t i=0; i<arcs.size(); i++)
+        arc_first[i+1] += arc_first[i];
+    segments[PREVIEW_ARCFEED].resize(arc_first.back());
+    parallel_for(arcs.size(), chunks, split_arcs, this);
+
+    // the start of each segment, and the end of the last one of each kind
+    for(int view=0; view<PREVIEW_DWELLS; view++) {
+        const std::vector<preview_segment> &s = segments[view];
+        if(s.empty()) continue;
+        double e[PREVIEW_MAX_THREADS][12];
+        extents_job job = {&s[0], e};
+        chunks = preview_chunks(s.size());
+        for(int i=0; i<chunks; i++)
+            memcpy(e[i], extents, sizeof(extents));
+        parallel_for(s.size(), chunks, segment_extents, &job);
+        for(int i=0; i<chunks; i++)
+            merge_extents(extents, e[i]);
+        extend(extents, s.back().end, s.back().tool);
+    }
+}
+
 static void maybe_new_line(int sequence_number=interp_new.sequence_number());
 static void maybe_new_line(int sequence_number) {
     if(!pinterp) return;
     if(interp_error) return;
-    if(sequence_number == last_sequence_number)
+    if(sequence_number == last_sequence_number && !line_deferred)
         return;
+    line_deferred = false;
     LineCode *new_line_code =
         (LineCode*)(PyObject_New(LineCode, &LineCodeType));
     interp_new.active_settings(new_line_code->settings);
@@ -203,6 +658,14 @@ void ARC_FEED(int line_number,
         v_position /= 25.4;
         w_position /= 25.4;
     }
+    if(preview) {
+        preview_new_line(line_number);
+        preview_arc_feed(line_number, first_end, second_end,
+                first_axis, second_axis, rotation, axis_end_point,
+                a_position, b_position, c_position,
+                u_position, v_position, w_position);
+        return;
+    }
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
@@ -223,6 +686,11 @@ void STRAIGHT_FEED(int line_number,
     _pos_a=a; _pos_b=b; _pos_c=c;
     _pos_u=u; _pos_v=v; _pos_w=w;
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
+    if(preview) {
+        preview_new_line(line_number);
+        preview_move(PREVIEW_FEED, line_number, x, y, z, a, b, c, u, v, w);
+        return;
+    }
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
@@ -240,6 +708,11 @@ void STRAIGHT_TRAVERSE(int line_number,
     _pos_a=a; _pos_b=b; _pos_c=c;
     _pos_u=u; _pos_v=v; _pos_w=w;
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
+    if(preview) {
+        preview_new_line(line_number);
+        preview_move(PREVIEW_TRAVERSE, line_number, x, y, z, a, b, c, u, v, w);
+        return;
+    }
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
@@ -254,6 +727,10 @@ void SET_G5X_OFFSET(int g5x_index,
                     double a, double b, double c,
                     double u, double v, double w) {
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
+    if(preview) {
+        double o[9] = {x, y, z, a, b, c, u, v, w};
+        memcpy(preview->g5xoffset, o, sizeof(o));
+    }
     maybe_new_line();
     if(interp_error) return;
     PyObject *result =
@@ -267,6 +744,10 @@ void SET_G92_OFFSET(double x, double y, double z,
                     double a, double b, double c,
                     double u, double v, double w) {
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
+    if(preview) {
+        double o[9] = {x, y, z, a, b, c, u, v, w};
+        memcpy(preview->g92offset, o, sizeof(o));
+    }
     maybe_new_line();
     if(interp_error) return;
     PyObject *result =
@@ -277,6 +758,10 @@ void SET_G92_OFFSET(double x, double y, double z,
 }
 
 void SET_XY_ROTATION(double t) {
+    if(preview) {
+        preview->rotation_cos = rtapi_cos(t * M_PI / 180);
+        preview->rotation_sin = rtapi_sin(t * M_PI / 180);
+    }
     maybe_new_line();
     if(interp_error) return;
     PyObject *result =
@@ -288,6 +773,7 @@ void SET_XY_ROTATION(double t) {
 void USE_LENGTH_UNITS(CANON_UNITS u) { metric = u == CANON_UNITS_MM; }
 
 void SELECT_PLANE(CANON_PLANE pl) {
+    if(preview) preview->plane = pl;
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
@@ -317,6 +803,7 @@ void SET_FEED_MODE(int mode) {
 }
 
 void CHANGE_TOOL(int pocket) {
+    if(preview) preview->first_move = true;
     maybe_new_line();
     if(interp_error) return;
     PyObject *result = 
@@ -339,6 +826,7 @@ void SET_FEED_RATE(double rate) {
     maybe_new_line();   
     if(interp_error) return;
     if(metric) rate /= 25.4;
+    if(preview) preview->feedrate = rate / 60.;
     PyObject *result =
         callmethod(callback, "set_feed_rate", "f", rate);
     if(result == NULL) interp_error ++;
@@ -346,6 +834,10 @@ void SET_FEED_RATE(double rate) {
 }
 
 void DWELL(double time) {
+    if(preview) {
+        preview_add_dwell(interp_new.sequence_number(), 0, time);
+        return;
+    }
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
@@ -375,6 +867,14 @@ void COMMENT(const char *comment) {
         callmethod(callback, "comment", "s", comment);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
+    // glcanon hides moves between (AXIS,hide) and (AXIS,show)
+    if(preview && !interp_error &&
+            PyObject_HasAttrString(callback, "suppress")) {
+        PyObject *suppress = PyObject_GetAttrString(callback, "suppress");
+        if(suppress && PyInt_Check(suppress))
+            preview->suppress = PyInt_AsLong(suppress);
+        Py_XDECREF(suppress);
+    }
 }
 
 void SET_TOOL_TABLE_ENTRY(int pocket, int toolno, EmcPose offset, double diameter,
@@ -388,6 +888,7 @@ void USE_TOOL_LENGTH_OFFSET(EmcPose offset) {
     if(metric) {
         offset.tran.x /= 25.4; offset.tran.y /= 25.4; offset.tran.z /= 25.4;
         offset.u /= 25.4; offset.v /= 25.4; offset.w /= 25.4; }
+    if(preview) preview_tool_offset(offset);
     PyObject *result = callmethod(callback, "tool_offset", "ddddddddd", offset.tran.x, offset.tran.y, offset.tran.z,
         offset.a, offset.b, offset.c, offset.u, offset.v, offset.w);
     if(result == NULL) interp_error ++;
@@ -476,6 +977,11 @@ void STRAIGHT_PROBE(int line_number,
     _pos_a=a; _pos_b=b; _pos_c=c;
     _pos_u=u; _pos_v=v; _pos_w=w;
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
+    if(preview) {
+        preview_new_line(line_number);
+        preview_move(PREVIEW_FEED, line_number, x, y, z, a, b, c, u, v, w);
+        return;
+    }
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
@@ -488,6 +994,11 @@ void STRAIGHT_PROBE(int line_number,
 void RIGID_TAP(int line_number,
                double x, double y, double z) {
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; }
+    if(preview) {
+        preview_new_line(line_number);
+        preview_rigid_tap(line_number, x, y, z);
+        return;
+    }
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
@@ -548,6 +1059,10 @@ int WAIT(int index, int input_type, int wait_type, double timeout) { return 0;}
 
 static void user_defined_function(int num, double arg1, double arg2) {
     if(interp_error) return;
+    if(preview) {
+        preview_add_dwell(interp_new.sequence_number(), 1, 0);
+        return;
+    }
     maybe_new_line();
     PyObject *result =
         callmethod(callback, "user_defined_function",
@@ -682,14 +1197,11 @@ CANON_MOTION_MODE GET_EXTERNAL_MOTION_CONTROL_MODE() { return motion_mode; }
 void SET_NAIVECAM_TOLERANCE(double tolerance) { }
 
 #define RESULT_OK (result == INTERP_OK || result == INTERP_EXECUTE_FINISH)
-static PyObject *parse_file(PyObject *self, PyObject *args) {
-    char *f;
-    char *unitcode=0, *initcode=0, *interpname=0;
+static PyObject *run_interp(char *f, char *unitcode, char *initcode,
+        char *interpname) {
     int error_line_offset = 0;
     struct timeval t0, t1;
     int wait = 1;
-    if(!PyArg_ParseTuple(args, "sO|sss", &f, &callback, &unitcode, &initcode, &interpname))
-        return NULL;
 
     if(pinterp) {
         delete pinterp;
@@ -708,6 +1220,7 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
     metric=false;
     interp_error = 0;
     last_sequence_number = -1;
+    line_deferred = false;
 
     _pos_x = _pos_y = _pos_z = _pos_a = _pos_b = _pos_c = 0;
     _pos_u = _pos_v = _pos_w = 0;
@@ -758,6 +1271,262 @@ out_error:
     return retval;
 }
 
+static PyObject *parse_file(PyObject *self, PyObject *args) {
+    char *f;
+    char *unitcode=0, *initcode=0, *interpname=0;
+    if(!PyArg_ParseTuple(args, "sO|sss", &f, &callback, &unitcode, &initcode, &interpname))
+        return NULL;
+    return run_interp(f, unitcode, initcode, interpname);
+}
+
+typedef struct {
+    PyObject_HEAD
+    Preview *p;
+} pyPreview;
+
+static void Preview_dealloc(PyObject *self) {
+    delete ((pyPreview*)self)->p;
+    PyObject_Del(self);
+}
+
+static PyObject *Preview_view(pyPreview *self, int view);
+
+static PyObject *Preview_traverse(pyPreview *self) {
+    return Preview_view(self, PREVIEW_TRAVERSE);
+}
+static PyObject *Preview_feed(pyPreview *self) {
+    return Preview_view(self, PREVIEW_FEED);
+}
+static PyObject *Preview_arcfeed(pyPreview *self) {
+    return Preview_view(self, PREVIEW_ARCFEED);
+}
+static PyObject *Preview_dwells(pyPreview *self) {
+    return Preview_view(self, PREVIEW_DWELLS);
+}
+static PyObject *Preview_extents(pyPreview *self) {
+    double *e = self->p->extents;
+    return Py_BuildValue("[ddd][ddd][ddd][ddd]",
+        e[0], e[1], e[2],  e[3], e[4], e[5],
+        e[6], e[7], e[8],  e[9], e[10], e[11]);
+}
+static PyObject *Preview_dwell_time(pyPreview *self) {
+    return PyFloat_FromDouble(self->p->dwell_time);
+}
+
+// a segment as glcanon.GLCanon appends it to its lists
+static PyObject *segment_tuple(const preview_segment &s, bool feed) {
+    const double *a = s.start, *b = s.end;
+    if(!feed)
+        return Py_BuildValue("(i(ddddddddd)(ddddddddd)[ddd])", (int)s.line,
+            a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8],
+            b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7], b[8],
+            s.tool[0], s.tool[1], s.tool[2]);
+    return Py_BuildValue("(i(ddddddddd)(ddddddddd)d[ddd])", (int)s.line,
+        a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8],
+        b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7], b[8],
+        s.feedrate, s.tool[0], s.tool[1], s.tool[2]);
+}
+
+static PyObject *Preview_lists(pyPreview *self) {
+    PyObject *res = PyTuple_New(PREVIEW_VIEWS);
+    if(!res) return NULL;
+    for(int view=0; view<PREVIEW_VIEWS; view++) {
+        Py_ssize_t rows = self->p->rows(view);
+        PyObject *l = PyList_New(rows);
+        if(!l) { Py_DECREF(res); return NULL; }
+        PyTuple_SET_ITEM(res, view, l);
+        for(Py_ssize_t i=0; i<rows; i++) {
+            PyObject *row;
+            if(view == PREVIEW_DWELLS) {
+                const preview_dwell &d = self->p->dwells[i];
+                row = Py_BuildValue("(iidddi)", (int)d.line, (int)d.kind,
+                        d.x, d.y, d.z, (int)d.plane);
+            } else {
+                row = segment_tuple(self->p->segments[view][i],
+                        view != PREVIEW_TRAVERSE);
+            }
+            if(!row) { Py_DECREF(res); return NULL; }
+            PyList_SET_ITEM(l, i, row);
+        }
+    }
+    return res;
+}
+
+static PyMethodDef PreviewMethods[] = {
+    {"lists", (PyCFunction)Preview_lists, METH_NOARGS,
+        "the traverse, feed, arcfeed and dwells lists as glcanon.GLCanon\n"
+        "keeps them, with the kind in place of the color of a dwell"},
+    {NULL},
+};
+
+static PyGetSetDef PreviewGetSet[] = {
+    {(char*)"traverse", (getter)Preview_traverse, NULL,
+        (char*)"traverses: line, start[9], end[9], 0, tool[3]"},
+    {(char*)"feed", (getter)Preview_feed, NULL,
+        (char*)"feeds: line, start[9], end[9], feed rate, tool[3]"},
+    {(char*)"arcfeed", (getter)Preview_arcfeed, NULL,
+        (char*)"arc segments: line, start[9], end[9], feed rate, tool[3]"},
+    {(char*)"dwells", (getter)Preview_dwells, NULL,
+        (char*)"dwells: line, kind, x, y, z, plane, time"},
+    {(char*)"extents", (getter)Preview_extents, NULL,
+        (char*)"extents, as calc_extents() returns them"},
+    {(char*)"dwell_time", (getter)Preview_dwell_time, NULL,
+        (char*)"total dwell time"},
+    {NULL, NULL},
+};
+
+static PyTypeObject PreviewType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "gcode.preview",        /*tp_name*/
+    sizeof(pyPreview),      /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)Preview_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    0,                      /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    0,                      /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,     /*tp_flags*/
+    0,                      /*tp_doc*/
+    0,                      /*tp_traverse*/
+    0,                      /*tp_clear*/
+    0,                      /*tp_richcompare*/
+    0,                      /*tp_weaklistoffset*/
+    0,                      /*tp_iter*/
+    0,                      /*tp_iternext*/
+    PreviewMethods,         /*tp_methods*/
+    0,                      /*tp_members*/
+    PreviewGetSet,          /*tp_getset*/
+};
+
+// a 2-d array of doubles, one row per item, over one of a preview's arrays
+typedef struct {
+    PyObject_HEAD
+    pyPreview *preview;     // owns the memory
+    int view;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+} pyPreviewView;
+
+static void PreviewView_dealloc(PyObject *self) {
+    Py_XDECREF(((pyPreviewView*)self)->preview);
+    PyObject_Del(self);
+}
+
+static int PreviewView_getbuffer(PyObject *_self, Py_buffer *view, int flags) {
+    pyPreviewView *self = (pyPreviewView*)_self;
+
+    view->obj = NULL;
+    if(flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "preview views are read-only");
+        return -1;
+    }
+
+    view->buf = (void*)self->preview->p->data(self->view);
+    view->len = self->shape[0] * self->shape[1] * sizeof(double);
+    view->readonly = 1;
+    view->itemsize = sizeof(double);
+    view->format = (flags & PyBUF_FORMAT) ? (char*)"d" : NULL;
+    view->ndim = 2;
+    view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+    view->strides =
+        (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    view->obj = _self;
+    Py_INCREF(_self);
+    return 0;
+}
+
+static PyBufferProcs PreviewView_as_buffer = {
+    0,                      /*bf_getreadbuffer*/
+    0,                      /*bf_getwritebuffer*/
+    0,                      /*bf_getsegcount*/
+    0,                      /*bf_getcharbuffer*/
+    PreviewView_getbuffer,  /*bf_getbuffer*/
+    0,                      /*bf_releasebuffer*/
+};
+
+static PyTypeObject PreviewViewType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "gcode.previewview",    /*tp_name*/
+    sizeof(pyPreviewView),  /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)PreviewView_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    0,                      /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    &PreviewView_as_buffer, /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /*tp_flags*/
+    0,                      /*tp_doc*/
+};
+
+static PyObject *Preview_view(pyPreview *self, int view) {
+    pyPreviewView *v = PyObject_New(pyPreviewView, &PreviewViewType);
+    if(!v) return NULL;
+    Py_INCREF(self);
+    v->preview = self;
+    v->view = view;
+    v->shape[0] = self->p->rows(view);
+    v->shape[1] = preview_columns[view];
+    v->strides[0] = preview_columns[view] * sizeof(double);
+    v->strides[1] = sizeof(double);
+    PyObject *res = PyMemoryView_FromObject((PyObject*)v);
+    Py_DECREF(v);
+    return res;
+}
+
+static PyObject *parse_preview(PyObject *self, PyObject *args) {
+    char *f;
+    char *unitcode=0, *initcode=0, *interpname=0;
+    int arcdivision = 64;
+    if(!PyArg_ParseTuple(args, "sO|sssi", &f, &callback, &unitcode, &initcode,
+                &interpname, &arcdivision))
+        return NULL;
+
+    pyPreview *pv = PyObject_New(pyPreview, &PreviewType);
+    if(!pv) return NULL;
+    pv->p = preview = new Preview(arcdivision);
+    PyObject *result = run_interp(f, unitcode, initcode, interpname);
+    preview = NULL;
+    if(!result) {
+        Py_DECREF(pv);
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    pv->p->finish();
+    Py_END_ALLOW_THREADS
+
+    PyObject *retval = Py_BuildValue("(OON)", PyTuple_GET_ITEM(result, 0),
+            PyTuple_GET_ITEM(result, 1), pv);
+    Py_DECREF(result);
+    return retval;
+}
+
 
 static int maxerror = -1;
 
@@ -872,35 +1641,21 @@ static bool get_attr(PyObject *o, const char *attr_name, const char *fmt, ...) {
     return result;
 }
 
-static void unrotate(double &x, double &y, double c, double s) {
-    double tx = x * c + y * s;
-    y = -x * s + y * c;
-    x = tx;
-}
-
-static void rotate(double &x, double &y, double c, double s) {
-    double tx = x * c - y * s;
-    y = x * s + y * c;
-    x = tx;
-}
-
 static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
     PyObject *canon;
-    double x1, y1, cx, cy, z1, a, b, c, u, v, w;
-    double o[9], n[9], g5xoffset[9], g92offset[9];
-    int rot, plane;
-    int X, Y, Z;
-    double rotation_cos, rotation_sin;
+    arc_params arc;
     int max_segments = 128;
 
     if(!PyArg_ParseTuple(args, "Oddddiddddddd|i:arcs_to_segments",
-        &canon, &x1, &y1, &cx, &cy, &rot, &z1, &a, &b, &c, &u, &v, &w, &max_segments)) return NULL;
+        &canon, &arc.x1, &arc.y1, &arc.cx, &arc.cy, &arc.rot, &arc.z1,
+        &arc.a, &arc.b, &arc.c, &arc.u, &arc.v, &arc.w, &max_segments)) return NULL;
+    double *o = arc.o, *g5xoffset = arc.g5xoffset, *g92offset = arc.g92offset;
     if(!get_attr(canon, "lo", "ddddddddd:arcs_to_segments lo", &o[0], &o[1], &o[2],
                     &o[3], &o[4], &o[5], &o[6], &o[7], &o[8]))
         return NULL;
-    if(!get_attr(canon, "plane", &plane)) return NULL;
-    if(!get_attr(canon, "rotation_cos", &rotation_cos)) return NULL;
-    if(!get_attr(canon, "rotation_sin", &rotation_sin)) return NULL;
+    if(!get_attr(canon, "plane", &arc.plane)) return NULL;
+    if(!get_attr(canon, "rotation_cos", &arc.rotation_cos)) return NULL;
+    if(!get_attr(canon, "rotation_sin", &arc.rotation_sin)) return NULL;
     if(!get_attr(canon, "g5x_offset_x", &g5xoffset[0])) return NULL;
     if(!get_attr(canon, "g5x_offset_y", &g5xoffset[1])) return NULL;
     if(!get_attr(canon, "g5x_offset_z", &g5xoffset[2])) return NULL;
@@ -920,77 +1675,22 @@ static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
     if(!get_attr(canon, "g92_offset_v", &g92offset[7])) return NULL;
     if(!get_attr(canon, "g92_offset_w", &g92offset[8])) return NULL;
 
-    if(plane == 1) {
-        X=0; Y=1; Z=2;
-    } else if(plane == 3) {
-        X=2; Y=0; Z=1;
-    } else {
-        X=1; Y=2; Z=0;
-    }
-    n[X] = x1;
-    n[Y] = y1;
-    n[Z] = z1;
-    n[3] = a;
-    n[4] = b;
-    n[5] = c;
-    n[6] = u;
-    n[7] = v;
-    n[8] = w;
-    for(int ax=0; ax<9; ax++) o[ax] -= g5xoffset[ax];
-    unrotate(o[0], o[1], rotation_cos, rotation_sin);
-    for(int ax=0; ax<9; ax++) o[ax] -= g92offset[ax];
-
-    double theta1 = rtapi_atan2(o[Y]-cy, o[X]-cx);
-    double theta2 = rtapi_atan2(n[Y]-cy, n[X]-cx);
-
-    if(rot < 0) {
-        while(theta2 - theta1 > -CIRCLE_FUZZ) theta2 -= 2*M_PI;
-    } else {
-        while(theta2 - theta1 < CIRCLE_FUZZ) theta2 += 2*M_PI;
-    }
-
-    // if multi-turn, add the right number of full circles
-    if(rot < -1) theta2 += 2*M_PI*(rot+1);
-    if(rot > 1) theta2 += 2*M_PI*(rot-1);
-
-    int steps = std::max(3, int(max_segments * rtapi_fabs(theta1 - theta2) / M_PI));
-    double rsteps = 1. / steps;
+    int steps = arc_segments(arc, max_segments, NULL);
+    std::vector<double> p(9 * steps);
+    arc_segments(arc, max_segments, &p[0]);
     PyObject *segs = PyList_New(steps);
-
-    double dtheta = theta2 - theta1;
-    double d[9] = {0, 0, 0, n[3]-o[3], n[4]-o[4], n[5]-o[5], n[6]-o[6], n[7]-o[7], n[8]-o[8]};
-    d[Z] = n[Z] - o[Z];
-
-    double tx = o[X] - cx, ty = o[Y] - cy, dc = rtapi_cos(dtheta*rsteps), ds = rtapi_sin(dtheta*rsteps);
-    for(int i=0; i<steps-1; i++) {
-        double f = (i+1) * rsteps;
-        double p[9];
-        rotate(tx, ty, dc, ds);
-        p[X] = tx + cx;
-        p[Y] = ty + cy;
-        p[Z] = o[Z] + d[Z] * f;
-        p[3] = o[3] + d[3] * f;
-        p[4] = o[4] + d[4] * f;
-        p[5] = o[5] + d[5] * f;
-        p[6] = o[6] + d[6] * f;
-        p[7] = o[7] + d[7] * f;
-        p[8] = o[8] + d[8] * f;
-        for(int ax=0; ax<9; ax++) p[ax] += g92offset[ax];
-        rotate(p[0], p[1], rotation_cos, rotation_sin);
-        for(int ax=0; ax<9; ax++) p[ax] += g5xoffset[ax];
+    for(int i=0; i<steps; i++) {
+        double *q = &p[9*i];
         PyList_SET_ITEM(segs, i,
-            Py_BuildValue("ddddddddd", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8]));
+            Py_BuildValue("ddddddddd", q[0], q[1], q[2], q[3], q[4], q[5], q[6], q[7], q[8]));
     }
-    for(int ax=0; ax<9; ax++) n[ax] += g92offset[ax];
-    rotate(n[0], n[1], rotation_cos, rotation_sin);
-    for(int ax=0; ax<9; ax++) n[ax] += g5xoffset[ax];
-    PyList_SET_ITEM(segs, steps-1,
-        Py_BuildValue("ddddddddd", n[0], n[1], n[2], n[3], n[4], n[5], n[6], n[7], n[8]));
     return segs;
 }
 
 static PyMethodDef gcode_methods[] = {
     {"parse", (PyCFunction)parse_file, METH_VARARGS, "Parse a G-Code file"},
+    {"parse_preview", (PyCFunction)parse_preview, METH_VARARGS,
+        "Parse a G-Code file, keeping its motion in a gcode.preview"},
     {"strerror", (PyCFunction)rs274_strerror, METH_VARARGS,
         "Convert a numeric error to a string"},
     {"calc_extents", (PyCFunction)rs274_calc_extents, METH_VARARGS,
@@ -1006,6 +1706,9 @@ initgcode(void) {
                 "Interface to EMC rs274ngc interpreter");
     PyType_Ready(&LineCodeType);
     PyModule_AddObject(m, "linecode", (PyObject*)&LineCodeType);
+    PyType_Ready(&PreviewType);
+    PyModule_AddObject(m, "preview", (PyObject*)&PreviewType);
+    PyType_Ready(&PreviewViewType);
     PyObject_SetAttrString(m, "MAX_ERROR", PyInt_FromLong(maxerror));
     PyObject_SetAttrString(m, "MIN_ERROR",
             PyInt_FromLong(INTERP_MIN_ERROR));
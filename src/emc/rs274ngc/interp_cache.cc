@@ -0,0 +1,593 @@
+/********************************************************************
+* Description: interp_cache.cc
+*
+*   On-disk cache of parsed G-code lines - see interp_cache.hh
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <boost/python.hpp>
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "interp_internal.hh"
+#include "rs274ngc_interp.hh"
+#include "interp_cache.hh"
+
+#define NGC_CACHE_MAGIC 0x4e474343	// "NGCC"
+#define NGC_CACHE_VERSION 2
+
+#define HASH_CHUNK (1 << 20)		// program read size, multiple of 8
+#define RECORD_CHUNK (64 << 10)	// record buffer size
+
+// cache file layout: header, records, index
+struct ngc_cache_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t program_size;
+    uint64_t program_hash;
+    uint64_t index;		// file offset of the index
+    uint64_t n_lines;
+};
+
+// index entry, sorted by offset
+struct ngc_cache_line {
+    uint64_t offset;		// of the line in the program
+    uint64_t record;		// file offset of its record
+};
+
+// FNV-1a over 64 bit words, folded so that high bits reach the low ones.
+// Chunks but the last must be a multiple of 8 bytes.
+static uint64_t hash_chunk(uint64_t h, const unsigned char *p, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+	uint64_t w;
+	memcpy(&w, p + i, 8);
+	h = (h ^ w) * 0x100000001b3ULL;
+	h ^= h >> 29;
+    }
+    for (; i < n; i++)
+	h = (h ^ p[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+BlockCache::BlockCache()
+    : program_size(0), program_hash(0xcbf29ce484222325ULL),
+      ready(0), map(NULL), map_size(0), header(NULL), lines(NULL),
+      n_lines(0), cursor(0), records_size(0),
+      hashing(false), writing(false)
+{
+}
+
+BlockCache::~BlockCache()
+{
+    if (writing)
+	pthread_join(writer, NULL);
+    if (hashing)
+	pthread_join(hasher, NULL);
+    if (map)
+	munmap(map, map_size);
+}
+
+bool BlockCache::open(const char *dir, const char *program)
+{
+    if (access(program, R_OK) < 0)
+	return false;
+    this->dir = dir;
+    program_name = program;
+
+    // a large program takes a while to hash; lines are read as usual
+    // until the cache is ready
+    hashing = pthread_create(&hasher, NULL, hash_thread, this) == 0;
+    if (!hashing)
+	load();
+    return true;
+}
+
+void *BlockCache::hash_thread(void *arg)
+{
+    ((BlockCache *) arg)->load();
+    return NULL;
+}
+
+// hash the program, and map a cache of its text if there is one
+void BlockCache::load()
+{
+    int fd = ::open(program_name.c_str(), O_RDONLY);
+    if (fd < 0)
+	return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    std::vector<unsigned char> buf(HASH_CHUNK);
+    ssize_t n;
+    size_t fill = 0;
+    // hash full chunks only, a short read may end anywhere
+    while ((n = read(fd, &buf[fill], HASH_CHUNK - fill)) > 0) {
+	fill += n;
+	program_size += n;
+	if (fill == HASH_CHUNK) {
+	    program_hash = hash_chunk(program_hash, &buf[0], fill);
+	    fill = 0;
+	}
+    }
+    ::close(fd);
+    if (n < 0)
+	return;
+    program_hash = hash_chunk(program_hash, &buf[0], fill);
+
+    char name[PATH_MAX];
+    snprintf(name, sizeof(name), "%s/%016llx-%llx.ngcc", dir.c_str(),
+	     (unsigned long long) program_hash,
+	     (unsigned long long) program_size);
+    cache_name = name;
+
+    struct stat st;
+    fd = ::open(name, O_RDONLY);
+    if (fd < 0)
+	return;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(ngc_cache_header)) {
+	::close(fd);
+	return;
+    }
+    map_size = st.st_size;
+    map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+	map = NULL;
+	return;
+    }
+
+    const ngc_cache_header *h = (const ngc_cache_header *) map;
+    if (h->magic != NGC_CACHE_MAGIC || h->version != NGC_CACHE_VERSION ||
+	h->program_size != program_size || h->program_hash != program_hash ||
+	h->index < sizeof(ngc_cache_header) || h->index > map_size ||
+	h->n_lines > (map_size - h->index) / sizeof(ngc_cache_line)) {
+	munmap(map, map_size);
+	map = NULL;
+	return;
+    }
+    header = h;
+    lines = (const ngc_cache_line *) ((const char *) map + h->index);
+    n_lines = h->n_lines;
+    __atomic_store_n(&ready, 1, __ATOMIC_RELEASE);
+}
+
+const unsigned char *BlockCache::find(long offset, const unsigned char **end)
+{
+    if (!__atomic_load_n(&ready, __ATOMIC_ACQUIRE))
+	return NULL;
+
+    // lines are mostly read in order; o-word loops and calls jump
+    if (cursor >= n_lines || lines[cursor].offset != (uint64_t) offset) {
+	size_t lo = 0, hi = n_lines;
+	while (lo < hi) {
+	    size_t mid = (lo + hi) / 2;
+	    if (lines[mid].offset < (uint64_t) offset)
+		lo = mid + 1;
+	    else
+		hi = mid;
+	}
+	cursor = lo;
+	if (cursor >= n_lines || lines[cursor].offset != (uint64_t) offset)
+	    return NULL;
+    }
+    uint64_t record = lines[cursor++].record;
+    if (record < sizeof(ngc_cache_header) || record >= header->index)
+	return NULL;
+    *end = (const unsigned char *) map + header->index;
+    return (const unsigned char *) map + record;
+}
+
+// true if the mapped cache has a record of the line at offset
+bool BlockCache::cached(uint64_t offset)
+{
+    if (!__atomic_load_n(&ready, __ATOMIC_ACQUIRE))
+	return false;
+    size_t lo = 0, hi = n_lines;
+    while (lo < hi) {
+	size_t mid = (lo + hi) / 2;
+	if (lines[mid].offset < offset)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo < n_lines && lines[lo].offset == offset;
+}
+
+// lines may be read in any order - a run from line, a subroutine
+// defined below its call - so every line is looked up
+bool BlockCache::recording(long offset)
+{
+    return !writing && !recorded.count(offset) && !cached(offset);
+}
+
+void BlockCache::seen(long offset, const std::string &record)
+{
+    if (record.empty() || !recording(offset))
+	return;
+    recorded[offset] = records_size;
+    if (records.empty() || records.back().size() + record.size() > RECORD_CHUNK) {
+	records.push_back(std::string());
+	records.back().reserve(RECORD_CHUNK);
+    }
+    records.back() += record;
+    records_size += record.size();
+}
+
+void BlockCache::write()
+{
+    if (recorded.empty() || writing)
+	return;
+    writing = pthread_create(&writer, NULL, write_thread, this) == 0;
+    if (!writing)
+	store();
+}
+
+void *BlockCache::write_thread(void *arg)
+{
+    ((BlockCache *) arg)->store();
+    return NULL;
+}
+
+// write the mapped cache and the recorded lines to a new cache
+void BlockCache::store()
+{
+    // the cache name and the mapped cache come from the hash
+    if (hashing) {
+	pthread_join(hasher, NULL);
+	hashing = false;
+    }
+    if (cache_name.empty())
+	return;
+
+    // new records go after the old ones; the index is merged
+    uint64_t base = header ? header->index : sizeof(ngc_cache_header);
+    ngc_cache_header h;
+    memset(&h, 0, sizeof(h));
+    h.magic = NGC_CACHE_MAGIC;
+    h.version = NGC_CACHE_VERSION;
+    h.program_size = program_size;
+    h.program_hash = program_hash;
+    h.index = base + records_size;
+    h.n_lines = 0;
+
+    // written aside and renamed, as preview and task may race here
+    std::string tmp = cache_name + ".XXXXXX";
+    std::vector<char> tmpname(tmp.begin(), tmp.end());
+    tmpname.push_back(0);
+    int fd = mkstemp(&tmpname[0]);
+    if (fd < 0)
+	return;
+    fchmod(fd, 0644);
+    FILE *f = fdopen(fd, "w");
+    if (!f) {
+	::close(fd);
+	unlink(&tmpname[0]);
+	return;
+    }
+
+    // the header is rewritten once the index is counted
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    if (header)
+	ok = ok && fwrite((const char *) map + sizeof(h),
+			  base - sizeof(h), 1, f) == 1;
+    for (size_t i = 0; ok && i < records.size(); i++)
+	ok = fwrite(records[i].data(), records[i].size(), 1, f) == 1;
+
+    // both are sorted by offset
+    std::map<uint64_t, uint64_t>::const_iterator r = recorded.begin();
+    size_t i = 0;
+    while (ok && (i < n_lines || r != recorded.end())) {
+	ngc_cache_line l;
+	if (r == recorded.end() || (i < n_lines && lines[i].offset < r->first)) {
+	    l = lines[i++];
+	} else {
+	    if (i < n_lines && lines[i].offset == r->first)
+		i++;
+	    l.offset = r->first;
+	    l.record = base + r->second;
+	    ++r;
+	}
+	ok = fwrite(&l, sizeof(l), 1, f) == 1;
+	h.n_lines++;
+    }
+    ok = ok && fseek(f, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, f) == 1;
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok || rename(&tmpname[0], cache_name.c_str()) < 0)
+	unlink(&tmpname[0]);
+    recorded.clear();
+    records.clear();
+}
+
+/****************************************************************************/
+
+// The words of a block which read_items() fills in from a plain line.
+// A record is a sequence of words, each a letter followed by its value,
+// ended by a 0:
+//   a b c d e f i j k p q r s u v w x y z @ ^   double
+//   h l t n                                     int
+//   g m                                         modal group byte, int
+//   (                                           comment, 0 terminated
+// x is stored as read, before lathe diameter mode halves it.
+
+static const struct {
+    char letter;
+    bool block::*flag;
+    double block::*number;
+} real_words[] = {
+    {'a', &block::a_flag, &block::a_number},
+    {'b', &block::b_flag, &block::b_number},
+    {'c', &block::c_flag, &block::c_number},
+    {'d', &block::d_flag, &block::d_number_float},
+    {'e', &block::e_flag, &block::e_number},
+    {'f', &block::f_flag, &block::f_number},
+    {'i', &block::i_flag, &block::i_number},
+    {'j', &block::j_flag, &block::j_number},
+    {'k', &block::k_flag, &block::k_number},
+    {'p', &block::p_flag, &block::p_number},
+    {'q', &block::q_flag, &block::q_number},
+    {'r', &block::r_flag, &block::r_number},
+    {'s', &block::s_flag, &block::s_number},
+    {'u', &block::u_flag, &block::u_number},
+    {'v', &block::v_flag, &block::v_number},
+    {'w', &block::w_flag, &block::w_number},
+    {'x', &block::x_flag, &block::x_number},
+    {'y', &block::y_flag, &block::y_number},
+    {'z', &block::z_flag, &block::z_number},
+};
+
+static const struct {
+    char letter;
+    bool block::*flag;
+    int block::*number;
+} int_words[] = {
+    {'h', &block::h_flag, &block::h_number},
+    {'l', &block::l_flag, &block::l_number},
+    {'t', &block::t_flag, &block::t_number},
+};
+
+#define N_WORDS(w) (sizeof(w) / sizeof(w[0]))
+
+template <class T> static void put(std::string &r, char letter, T v)
+{
+    r += letter;
+    r.append((const char *) &v, sizeof(v));
+}
+
+template <class T> static bool get(const unsigned char *&p,
+				   const unsigned char *end, T *v)
+{
+    if (end - p < (ptrdiff_t) sizeof(T))
+	return false;
+    memcpy(v, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+static bool remapped(int_remap_map &map, int code)
+{
+    if (map.empty())
+	return false;
+    int_remap_iterator it = map.find(code);
+    return it != map.end() && it->second;
+}
+
+// true if line has nothing but literal words and comments, so that
+// reading it has no side effects and doesn't depend on parameters
+static bool plain_line(const char *line)
+{
+    for (const char *s = line; *s; s++) {
+	if (*s == '(') {
+	    if (!(s = strchr(s, ')')))
+		return false;
+	    continue;
+	}
+	if (*s == '#' || *s == '[' || *s == ';' || *s == 'o')
+	    return false;
+    }
+    return true;
+}
+
+int Interp::cache_open(const char *filename)
+{
+    delete _setup.block_cache;
+    _setup.block_cache = NULL;
+    if (!_setup.block_cache_dir[0])
+	return INTERP_OK;
+
+    BlockCache *cache = new BlockCache;
+    if (!cache->open(_setup.block_cache_dir, filename)) {
+	logDebug("block cache: can't read %s", filename);
+	delete cache;
+	return INTERP_OK;
+    }
+    _setup.block_cache = cache;
+    return INTERP_OK;
+}
+
+// the cache is written on a helper thread, so it is kept until the next
+// close rather than waited for
+void Interp::cache_close()
+{
+    if (!_setup.block_cache)
+	return;
+    _setup.block_cache->write();
+    delete _setup.block_cache_closed;
+    _setup.block_cache_closed = _setup.block_cache;
+    _setup.block_cache = NULL;
+}
+
+// the cache applies to lines of the opened program only, not to lines of
+// subroutine files, and not while skipping to an o-word
+static bool cache_line(setup_pointer settings)
+{
+    BlockCache *cache = settings->block_cache;
+    return cache && settings->cache_offset >= 0 && !settings->skipping_o &&
+	!strcmp(settings->filename, cache->program());
+}
+
+bool Interp::cache_replay(block_pointer block, setup_pointer settings)
+{
+    const unsigned char *p, *end;
+    size_t i;
+
+    if (!cache_line(settings) ||
+	!(p = settings->block_cache->find(settings->cache_offset, &end)))
+	return false;
+
+    // anything this configuration reads differently from the one that
+    // recorded the line - an axis gone, a code remapped - is read again
+    while (p < end && *p) {
+	char letter = *p++;
+	unsigned char mode;
+	int value;
+	double number;
+
+	switch (letter) {
+	case 'g':
+	    if (!get(p, end, &mode) || !get(p, end, &value) || mode >= 16 ||
+		!_readers[(int) 'g'] || remapped(settings->g_remapped, value))
+		goto miss;
+	    block->g_modes[mode] = value;
+	    continue;
+	case 'm':
+	    if (!get(p, end, &mode) || !get(p, end, &value) || mode >= 11 ||
+		!_readers[(int) 'm'] || remapped(settings->m_remapped, value))
+		goto miss;
+	    block->m_modes[mode] = value;
+	    block->m_count++;
+	    if (value >= 100 && value < 200)
+		block->user_m = 1;
+	    continue;
+	case 'n':
+	    if (!get(p, end, &block->n_number))
+		goto miss;
+	    continue;
+	case '@':
+	case '^':
+	    if (!get(p, end, &number) || !_readers[(int) letter])
+		goto miss;
+	    if (letter == '@') {
+		block->radius_flag = true;
+		block->radius = number;
+	    } else {
+		block->theta_flag = true;
+		block->theta = number;
+	    }
+	    continue;
+	case '(': {
+	    const unsigned char *s = p;
+	    while (p < end && *p)
+		p++;
+	    if (p == end || p - s >= (ptrdiff_t) sizeof(block->comment))
+		goto miss;
+	    memcpy(block->comment, s, p - s + 1);
+	    p++;
+	    continue;
+	}
+	}
+
+	for (i = 0; i < N_WORDS(real_words); i++) {
+	    if (real_words[i].letter != letter)
+		continue;
+	    if (!get(p, end, &number) || !_readers[(int) letter])
+		goto miss;
+	    if (letter == 'x' && settings->lathe_diameter_mode)
+		number /= 2;
+	    block->*real_words[i].flag = true;
+	    block->*real_words[i].number = number;
+	    break;
+	}
+	if (i < N_WORDS(real_words))
+	    continue;
+	for (i = 0; i < N_WORDS(int_words); i++) {
+	    if (int_words[i].letter != letter)
+		continue;
+	    if (!get(p, end, &value) || !_readers[(int) letter])
+		goto miss;
+	    block->*int_words[i].flag = true;
+	    block->*int_words[i].number = value;
+	    break;
+	}
+	if (i == N_WORDS(int_words))
+	    goto miss;
+    }
+    if (p < end)
+	return true;
+
+miss:
+    init_block(block);
+    return false;
+}
+
+void Interp::cache_record(block_pointer block, const char *line,
+			  setup_pointer settings)
+{
+    if (!cache_line(settings) ||
+	!settings->block_cache->recording(settings->cache_offset))
+	return;
+
+    std::string r;
+    if (plain_line(line)) {
+	size_t i;
+	for (i = 0; i < N_WORDS(real_words); i++) {
+	    if (!(block->*real_words[i].flag))
+		continue;
+	    double number = block->*real_words[i].number;
+	    if (real_words[i].letter == 'x' && settings->lathe_diameter_mode)
+		number *= 2;
+	    put(r, real_words[i].letter, number);
+	}
+	for (i = 0; i < N_WORDS(int_words); i++)
+	    if (block->*int_words[i].flag)
+		put(r, int_words[i].letter, block->*int_words[i].number);
+	if (block->n_number != -1)
+	    put(r, 'n', block->n_number);
+	if (block->radius_flag)
+	    put(r, '@', block->radius);
+	if (block->theta_flag)
+	    put(r, '^', block->theta);
+	for (i = 0; i < 16; i++) {
+	    if (block->g_modes[i] == -1)
+		continue;
+	    if (remapped(settings->g_remapped, block->g_modes[i]))
+		goto uncached;
+	    put(r, 'g', (unsigned char) i);
+	    r.append((const char *) &block->g_modes[i], sizeof(int));
+	}
+	for (i = 0; i < 11; i++) {
+	    if (block->m_modes[i] == -1)
+		continue;
+	    if (remapped(settings->m_remapped, block->m_modes[i]))
+		goto uncached;
+	    put(r, 'm', (unsigned char) i);
+	    r.append((const char *) &block->m_modes[i], sizeof(int));
+	}
+	if (block->comment[0]) {
+	    r += '(';
+	    r += block->comment;
+	    r += '\0';
+	}
+	r += '\0';
+    }
+    settings->block_cache->seen(settings->cache_offset, r);
+    return;
+
+uncached:
+    settings->block_cache->seen(settings->cache_offset, std::string());
+}
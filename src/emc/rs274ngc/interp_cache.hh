@@ -0,0 +1,97 @@
+/********************************************************************
+* Description: interp_cache.hh
+*
+*   On-disk cache of parsed G-code lines.
+*
+*   Lines made of plain words - literal numbers, no parameters,
+*   expressions or o-words - parse to the same block every time. The
+*   cache keeps what read_items() made of such lines, keyed by their
+*   offset in the program, in a file named after a hash of the program
+*   text. Interp::open() looks for the cache of a program it has seen
+*   before, and parse_line() replays cached lines instead of reading
+*   them; lines it did read are recorded, and the cache is written back
+*   on close. Preview and task thus parse a program once between them.
+*
+*   Hashing the program and writing the cache back happen on helper
+*   threads, so neither open nor close waits for them. Until the hash
+*   is done, lines are read as usual.
+*
+*   Enabled by [RS274NGC]BLOCK_CACHE_DIR.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#ifndef INTERP_CACHE_HH
+#define INTERP_CACHE_HH
+
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <map>
+
+struct ngc_cache_header;
+struct ngc_cache_line;
+
+class BlockCache {
+public:
+    BlockCache();
+    // waits for the helper threads
+    ~BlockCache();
+
+    // start looking for the cache of program in dir. Returns false if
+    // the program can't be read.
+    bool open(const char *dir, const char *program);
+
+    // the cached record of the line at offset, or NULL. *end is set to
+    // the end of the record area.
+    const unsigned char *find(long offset, const unsigned char **end);
+
+    // note a line read at offset. Lines not cached or recorded yet are
+    // recorded if record is non-empty.
+    void seen(long offset, const std::string &record);
+    bool recording(long offset);
+
+    // start writing the cache back if lines were recorded. Nothing may
+    // be recorded afterwards.
+    void write();
+
+    const char *program() { return program_name.c_str(); }
+
+private:
+    std::string dir;
+    std::string program_name;
+    std::string cache_name;
+    uint64_t program_size;
+    uint64_t program_hash;
+
+    // the mapped cache, valid once ready is set
+    int ready;
+    void *map;
+    size_t map_size;
+    const ngc_cache_header *header;
+    const ngc_cache_line *lines;
+    size_t n_lines;
+    size_t cursor;              // next line expected
+
+    // lines not in the mapped cache, recorded on this run: the records
+    // in chunks, and their positions by line offset
+    std::vector<std::string> records;
+    uint64_t records_size;
+    std::map<uint64_t, uint64_t> recorded;
+
+    pthread_t hasher, writer;
+    bool hashing, writing;
+
+    bool cached(uint64_t offset);
+    void load();
+    void store();
+    static void *hash_thread(void *arg);
+    static void *write_thread(void *arg);
+
+    BlockCache(const BlockCache &);
+    BlockCache &operator=(const BlockCache &);
+};
+
+#endif
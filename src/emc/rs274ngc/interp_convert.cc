@@ -241,6 +241,7 @@ int Interp::convert_spline(int mode,
       nurbs_control_points.push_back(cp);
       cp.X = x2, cp.Y = y2;
       nurbs_control_points.push_back(cp);
+      inverse_time_rate_nurbs(nurbs_control_points, 3, block, settings);
       NURBS_FEED(block->line_number, nurbs_control_points, 3);
       nurbs_control_points.clear();
       settings->current_x = x2;
@@ -272,6 +273,7 @@ int Interp::convert_spline(int mode,
       nurbs_control_points.push_back(cp);
       cp.X = x3, cp.Y = y3;
       nurbs_control_points.push_back(cp);
+      inverse_time_rate_nurbs(nurbs_control_points, 4, block, settings);
       NURBS_FEED(block->line_number, nurbs_control_points, 4);
       nurbs_control_points.clear();
 
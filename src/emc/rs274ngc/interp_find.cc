@@ -84,6 +84,43 @@ double Interp::find_arc_length(double x1,        //!< X-coordinate of start poin
     return rtapi_hypot((radius * theta), (z2 - z1));
 }
 
+/****************************************************************************/
+
+/*! find_nurbs_length
+
+Returned Value: double (length of the curve in the XY plane)
+
+Side effects: none
+
+Called by: inverse_time_rate_nurbs
+
+This sums the chords of the NURBS of order k through the given control
+points, at NURBS_LENGTH_SAMPLES chords per knot span. G5 and G5.1 are a
+single span, so this is their length to well within the fit tolerance
+canon splits them with.
+
+*/
+
+#define NURBS_LENGTH_SAMPLES 64
+
+double Interp::find_nurbs_length(std::vector<CONTROL_POINT> const &control_points,
+                                 unsigned int k)
+{
+  unsigned int n = control_points.size() - 1;
+  unsigned int umax = n - k + 2;
+  std::vector<unsigned int> knot_vector = knot_vector_creator(n, k);
+  PLANE_POINT prev = nurbs_point(0, k, control_points, knot_vector);
+  double length = 0.0;
+
+  for (unsigned int i = 1; i <= umax * NURBS_LENGTH_SAMPLES; i++) {
+    PLANE_POINT p = nurbs_point((double) i / NURBS_LENGTH_SAMPLES, k,
+                                control_points, knot_vector);
+    length += rtapi_hypot(p.X - prev.X, p.Y - prev.Y);
+    prev = p;
+  }
+  return length;
+}
+
 
 /* Find the real destination, given the axis's current position, the
    commanded destination, and the direction to turn (which comes from
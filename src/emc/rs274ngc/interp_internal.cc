@@ -339,7 +339,10 @@ int Interp::parse_line(char *line,       //!< array holding a line of RS274 code
                       setup_pointer settings)   //!< pointer to machine settings         
 {
   CHP(init_block(block));
-  CHP(read_items(block, line, settings->parameters));
+  if (!cache_replay(block, settings)) {
+    CHP(read_items(block, line, settings->parameters));
+    cache_record(block, line, settings);
+  }
 
   if(settings->skipping_o == 0)
   {
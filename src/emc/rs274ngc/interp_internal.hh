@@ -613,6 +613,8 @@ and is not represented here
 #define STACK_ENTRY_LEN 80
 #define MAX_SUB_DIRS 10
 
+class BlockCache;
+
 typedef struct setup_struct
 {
   setup_struct();
@@ -754,6 +756,10 @@ typedef struct setup_struct
   int use_lazy_close;                // wait until next open before closing
                                      // the input file
   int lazy_closing;                  // close has been called
+  char block_cache_dir[PATH_MAX];    // from ini RS274NGC/BLOCK_CACHE_DIR
+  BlockCache *block_cache;           // of the open file, or NULL
+  BlockCache *block_cache_closed;    // of the last file, maybe writing
+  long cache_offset;                 // of the line being parsed, or -1
   char wizard_root[PATH_MAX];
   int tool_change_at_g30;
   int tool_change_quill_up;
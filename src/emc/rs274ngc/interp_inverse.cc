@@ -72,6 +72,41 @@ int Interp::inverse_time_rate_arc(double x1,     //!< x coord of start point of
 
 /****************************************************************************/
 
+/*! inverse_time_rate_nurbs
+
+Returned Value: int (INTERP_OK)
+
+Side effects: a call is made to SET_FEED_RATE and _setup.feed_rate is set.
+
+Called by:
+  convert_spline
+
+This finds the feed rate needed by an inverse time spline move, from the
+length of the whole curve, so the move takes 1/F minutes however canon
+splits it into pieces.
+
+*/
+
+int Interp::inverse_time_rate_nurbs(std::vector<CONTROL_POINT> const &control_points,
+                                    unsigned int k,
+                                    block_pointer block,       //!< pointer to a block of RS274 instructions
+                                    setup_pointer settings)    //!< pointer to machine settings
+{
+  double length;
+  double rate;
+
+  if (settings->feed_mode != INVERSE_TIME) return -1;
+
+  length = find_nurbs_length(control_points, k);
+  rate = MAX(0.1, (length * block->f_number));
+  enqueue_SET_FEED_RATE(rate);
+  settings->feed_rate = rate;
+
+  return INTERP_OK;
+}
+
+/****************************************************************************/
+
 /*! inverse_time_rate_straight
 
 Returned Value: int (INTERP_OK)
@@ -121,6 +121,9 @@ setup_struct::setup_struct() :
     debugmask(0),
     use_lazy_close(0),
     lazy_closing(0),
+    block_cache(NULL),
+    block_cache_closed(NULL),
+    cache_offset(-1),
     tool_change_at_g30(0),
     tool_change_quill_up(0),
     tool_change_with_spindle_on(0),
@@ -155,6 +158,7 @@ setup_struct::setup_struct() :
     memset(log_file, 0, sizeof(log_file));
     memset(program_prefix, 0, sizeof(program_prefix));
     memset(wizard_root, 0, sizeof(wizard_root));
+    memset(block_cache_dir, 0, sizeof(block_cache_dir));
     memset(tool_table, 0, sizeof(tool_table));
     ZERO_EMC_POSE(tool_offset);
 
@@ -362,6 +362,8 @@ public:
  double find_arc_length(double x1, double y1, double z1,
                               double center_x, double center_y, int turn,
                               double x2, double y2, double z2);
+ double find_nurbs_length(std::vector<CONTROL_POINT> const &control_points,
+                          unsigned int k);
  int find_current_in_system(setup_pointer s, int system, double *x, double *y, double *z,
                             double *a, double *b, double *c,
                             double *u, double *v, double *w);
@@ -388,10 +390,18 @@ public:
  double find_turn(double x1, double y1, double center_x,
                         double center_y, int turn, double x2, double y2);
  int init_block(block_pointer block);
+ int cache_open(const char *filename);
+ void cache_close();
+ bool cache_replay(block_pointer block, setup_pointer settings);
+ void cache_record(block_pointer block, const char *line,
+                   setup_pointer settings);
  int inverse_time_rate_arc(double x1, double y1, double z1,
                                  double cx, double cy, int turn, double x2,
                                  double y2, double z2, block_pointer block,
                                  setup_pointer settings);
+ int inverse_time_rate_nurbs(std::vector<CONTROL_POINT> const &control_points,
+                             unsigned int k, block_pointer block,
+                             setup_pointer settings);
  int inverse_time_rate_straight(double end_x, double end_y, double end_z,
                                 double AA_end, double BB_end, double CC_end,
                                 double u_end, double v_end, double w_end,
@@ -88,6 +88,7 @@ include an option for suppressing superfluous commands.
 #include "interp_internal.hh"	// interpreter private definitions
 #include "interp_queue.hh"
 #include "rs274ngc_interp.hh"
+#include "interp_cache.hh"	// BlockCache
 
 #include "units.h"
 
@@ -156,6 +157,10 @@ Interp::Interp()
 
 Interp::~Interp() {
 
+    // waits for the block cache to be written
+    delete _setup.block_cache;
+    delete _setup.block_cache_closed;
+
     if(log_file) {
         if(log_file != stderr)
             fclose(log_file);
@@ -219,6 +224,9 @@ Called By: external programs
 int Interp::close()
 {
     logOword("close()");
+    // with lazy close, the next close may be a long time coming
+    cache_close();
+
     // be "lazy" only if we're not aborting a call in progress
     // in which case we need to reset() the call stack
     // this does not reset the filename properly 
@@ -900,6 +908,17 @@ int Interp::init()
           }
           logDebug("_setup.program_prefix:%s:", _setup.program_prefix);
 
+	  _setup.block_cache_dir[0] = 0;
+          if(NULL != (inistring = inifile.Find("BLOCK_CACHE_DIR", "RS274NGC")))
+          {
+            if (inifile.TildeExpansion(inistring, _setup.block_cache_dir,
+                                       sizeof(_setup.block_cache_dir))) {
+                logDebug("TildeExpansion failed for: %s", inistring);
+                _setup.block_cache_dir[0] = 0;
+            }
+            logDebug("block cache dir:%s:", _setup.block_cache_dir);
+          }
+
 
           if(NULL != (inistring = inifile.Find("SUBROUTINE_PATH", "RS274NGC")))
           {
@@ -1391,6 +1410,7 @@ int Interp::open(const char *filename) //!< string: the name of the input NC-pro
     _setup.sequence_number = 0; // Going back to line 0
   }
   strcpy(_setup.filename, filename);
+  CHP(cache_open(filename));
   reset();
   return INTERP_OK;
 }
@@ -1569,9 +1589,12 @@ int Interp::_read(const char *command)  //!< may be NULL or a string to read
   _setup.parameters[5427] = _setup.v_current;
   _setup.parameters[5428] = _setup.w_current;
 
+  _setup.cache_offset = -1;
   if(_setup.file_pointer)
   {
       EXECUTING_BLOCK(_setup).offset = ftell(_setup.file_pointer);
+      if (command == NULL)
+          _setup.cache_offset = EXECUTING_BLOCK(_setup).offset;
   }
 
   read_status =
@@ -1312,66 +1312,123 @@ static double chord_deviation(double sx, double sy, double ex, double ey, double
 
 /* Spline and NURBS additional functions; */
 
-static double max(double a, double b) {
-    if(a < b) return b;
-    return a;
-}
-static void unit(double *x, double *y) {
-    double h = rtapi_hypot(*x, *y);
-    if(h != 0) { *x/=h; *y/=h; }
+// default tolerance for fitting NURBS spans with cubic splines, in mm
+#define NURBS_FIT_TOLERANCE 0.001
+// limit on how often a NURBS span is halved to fit it
+#define NURBS_FIT_MAX_DEPTH 8
+#define NURBS_DU (1e-5)
+
+/* Derivative of a NURBS with respect to u, by finite differences that stay
+ * within [lo, hi] - at knots, the curve may only be C0 or C1. */
+static PLANE_POINT
+nurbs_derivative(double u, double lo, double hi, unsigned int k,
+                 std::vector<CONTROL_POINT> const &nurbs_control_points,
+                 std::vector<unsigned int> const &knot_vector) {
+    double h = NURBS_DU;
+    PLANE_POINT d;
+    if (u - h < lo) {
+        PLANE_POINT P0 = nurbs_point(u, k, nurbs_control_points, knot_vector);
+        PLANE_POINT P1 = nurbs_point(u + h, k, nurbs_control_points, knot_vector);
+        PLANE_POINT P2 = nurbs_point(u + 2 * h, k, nurbs_control_points, knot_vector);
+        d.X = (-3 * P0.X + 4 * P1.X - P2.X) / (2 * h);
+        d.Y = (-3 * P0.Y + 4 * P1.Y - P2.Y) / (2 * h);
+    } else if (u + h > hi) {
+        PLANE_POINT P0 = nurbs_point(u, k, nurbs_control_points, knot_vector);
+        PLANE_POINT P1 = nurbs_point(u - h, k, nurbs_control_points, knot_vector);
+        PLANE_POINT P2 = nurbs_point(u - 2 * h, k, nurbs_control_points, knot_vector);
+        d.X = (3 * P0.X - 4 * P1.X + P2.X) / (2 * h);
+        d.Y = (3 * P0.Y - 4 * P1.Y + P2.Y) / (2 * h);
+    } else {
+        PLANE_POINT P1 = nurbs_point(u - h, k, nurbs_control_points, knot_vector);
+        PLANE_POINT P2 = nurbs_point(u + h, k, nurbs_control_points, knot_vector);
+        d.X = (P2.X - P1.X) / (2 * h);
+        d.Y = (P2.Y - P1.Y) / (2 * h);
+    }
+    return d;
 }
 
+/* Queue a cubic Bezier in the XY plane from the current position, with
+ * control points in program units. The TP evaluates it natively. */
 static void
-arc(int lineno, double x0, double y0, double x1, double y1, double dx, double dy) {
-    double small = 0.000001;
-    double x = x1-x0, y=y1-y0;
-    double den = 2 * (y*dx - x*dy);
-    CANON_POSITION p = unoffset_and_unrotate_pos(canonEndPoint);
-    to_prog(p);
-    if (rtapi_fabs(den) > small) {
-        double r = -(x*x+y*y)/den;
-        double i = dy*r, j = -dx*r;
-        double cx = x1+i, cy=y1+j;
-        ARC_FEED(lineno, x1, y1, cx, cy, r<0 ? 1 : -1,
-                 p.z, p.a, p.b, p.c, p.u, p.v, p.w);
-    } else { 
-        STRAIGHT_FEED(lineno, x1, y1, p.z, p.a, p.b, p.c, p.u, p.v, p.w);
-    }
-}
+spline_feed(int lineno, PLANE_POINT const &c1, PLANE_POINT const &c2,
+            PLANE_POINT const &p3) {
+    EMC_TRAJ_SPLINE_MOVE splineMoveMsg;
+    splineMoveMsg.feed_mode = feed_mode;
+
+    PM_CARTESIAN ctrl1(FROM_PROG_LEN(c1.X), FROM_PROG_LEN(c1.Y), 0.0);
+    PM_CARTESIAN ctrl2(FROM_PROG_LEN(c2.X), FROM_PROG_LEN(c2.Y), 0.0);
+    PM_CARTESIAN end_cart(FROM_PROG_LEN(p3.X), FROM_PROG_LEN(p3.Y), 0.0);
+    rotate_and_offset_xyz(ctrl1);
+    rotate_and_offset_xyz(ctrl2);
+    rotate_and_offset_xyz(end_cart);
+    // splines are planar, everything else stays where it is
+    ctrl1.z = ctrl2.z = end_cart.z = canonEndPoint.z;
 
-static int
-biarc(int lineno, double p0x, double p0y, double tsx, double tsy,
-      double p4x, double p4y, double tex, double tey, double r=1.0) {
-    unit(&tsx, &tsy);
-    unit(&tex, &tey);
+    CANON_POSITION endpt = canonEndPoint;
+    endpt.set_xyz(end_cart);
 
-    double vx = p0x - p4x, vy = p0y - p4y;
-    double c = vx*vx + vy*vy;
-    double b = 2 * (vx * (r*tsx + tex) + vy * (r*tsy + tey));
-    double a = 2 * r * (tsx * tex + tsy * tey - 1);
+    // Velocity and acceleration bounds of the plane; the TP limits
+    // velocity further for the curvature of the spline
+    double v_max = MIN(FROM_EXT_LEN(axis_max_velocity[0]),
+                       FROM_EXT_LEN(axis_max_velocity[1]));
+    double a_max = MIN(FROM_EXT_LEN(axis_max_acceleration[0]),
+                       FROM_EXT_LEN(axis_max_acceleration[1]));
+    double vel = MIN(currentLinearFeedRate, v_max);
 
-    double discr = b*b - 4*a*c;
-    if(discr < 0) return 0;
+    cartesian_move = 1;
 
-    double disq = rtapi_sqrt(discr);
-    double beta1 = (-b-disq) / 2 / a;
-    double beta2 = (-b+disq) / 2 / a;
+    splineMoveMsg.end = to_ext_pose(endpt);
+    splineMoveMsg.ctrl1 = to_ext_len(ctrl1);
+    splineMoveMsg.ctrl2 = to_ext_len(ctrl2);
+    splineMoveMsg.type = EMC_MOTION_TYPE_ARC;
+    splineMoveMsg.vel = toExtVel(vel);
+    splineMoveMsg.ini_maxvel = toExtVel(v_max);
+    splineMoveMsg.acc = toExtAcc(a_max);
+
+    if(vel && a_max) {
+        interp_list.set_line_number(lineno);
+        tag_and_send(splineMoveMsg, _tag);
+    }
+    canonUpdateEndPoint(endpt);
+}
 
-    if(beta1 > 0 && beta2 > 0)
-      return 0;
-    double beta = max(beta1, beta2);
-    double alpha = beta * r;
-    double ab = alpha + beta;
-    double p1x = p0x + alpha * tsx, p1y = p0y + alpha * tsy,
-         p3x = p4x - beta * tex, p3y = p4y - beta * tey,
-         p2x = (p1x*beta + p3x*alpha) / ab,
-         p2y = (p1y*beta + p3y*alpha) / ab;
-    double tmx = p3x-p2x, tmy = p3y-p2y;
-    unit(&tmx, &tmy);
+/* Fit the NURBS between u0 and u1 with the cubic that matches its end
+ * points and derivatives, halving the interval until the fit is within
+ * tolerance. This is exact for polynomial spans of order up to 4, which
+ * includes G5 and G5.1. */
+static void
+nurbs_span(int lineno, double u0, PLANE_POINT const &P0, PLANE_POINT const &D0,
+           double u1, PLANE_POINT const &P1, PLANE_POINT const &D1,
+           double lo, double hi, double tolerance, int depth, unsigned int k,
+           std::vector<CONTROL_POINT> const &nurbs_control_points,
+           std::vector<unsigned int> const &knot_vector) {
+    double h = (u1 - u0) / 3;
+    PLANE_POINT c1 = {P0.X + D0.X * h, P0.Y + D0.Y * h};
+    PLANE_POINT c2 = {P1.X - D1.X * h, P1.Y - D1.Y * h};
+
+    bool fits = true;
+    for(int i = 1; i < 4 && fits; i++) {
+        double t = i / 4.0, s = 1 - t;
+        PLANE_POINT B = {
+            s*s*s * P0.X + 3*s*s*t * c1.X + 3*s*t*t * c2.X + t*t*t * P1.X,
+            s*s*s * P0.Y + 3*s*s*t * c1.Y + 3*s*t*t * c2.Y + t*t*t * P1.Y};
+        PLANE_POINT N = nurbs_point(u0 + t * (u1 - u0), k,
+                                    nurbs_control_points, knot_vector);
+        fits = rtapi_hypot(B.X - N.X, B.Y - N.Y) <= tolerance;
+    }
 
-    arc(lineno, p0x, p0y, p2x, p2y, tsx, tsy);
-    arc(lineno, p2x, p2y, p4x, p4y, tmx, tmy);
-    return 1;
+    if(!fits && depth < NURBS_FIT_MAX_DEPTH) {
+        double um = (u0 + u1) / 2;
+        PLANE_POINT Pm = nurbs_point(um, k, nurbs_control_points, knot_vector);
+        PLANE_POINT Dm = nurbs_derivative(um, lo, hi, k,
+                                          nurbs_control_points, knot_vector);
+        nurbs_span(lineno, u0, P0, D0, um, Pm, Dm, lo, hi, tolerance, depth + 1,
+                   k, nurbs_control_points, knot_vector);
+        nurbs_span(lineno, um, Pm, Dm, u1, P1, D1, lo, hi, tolerance, depth + 1,
+                   k, nurbs_control_points, knot_vector);
+        return;
+    }
+    spline_feed(lineno, c1, c2, P1);
 }
 
 
@@ -1381,21 +1438,22 @@ void NURBS_FEED(int lineno, std::vector<CONTROL_POINT> nurbs_control_points, uns
     flush_segments();
 
     unsigned int n = nurbs_control_points.size() - 1;
-    double umax = n - k + 2;
-    unsigned int div = nurbs_control_points.size()*4;
-    std::vector<unsigned int> knot_vector = knot_vector_creator(n, k);	
-    PLANE_POINT P0, P0T, P1, P1T;
-
-    P0 = nurbs_point(0,k,nurbs_control_points,knot_vector);
-    P0T = nurbs_tangent(0, k, nurbs_control_points, knot_vector);
-
-    for(unsigned int i=1; i<=div; i++) {
-	double u = umax * i / div;
-        P1 = nurbs_point(u,k,nurbs_control_points,knot_vector);
-	P1T = nurbs_tangent(u,k,nurbs_control_points,knot_vector);
-        biarc(lineno, P0.X,P0.Y, P0T.X,P0T.Y, P1.X,P1.Y, P1T.X,P1T.Y);
-        P0 = P1;
-        P0T = P1T;
+    unsigned int umax = n - k + 2;
+    std::vector<unsigned int> knot_vector = knot_vector_creator(n, k);
+    double tolerance = TO_PROG_LEN(canonMotionTolerance > 0 ?
+                                   canonMotionTolerance : NURBS_FIT_TOLERANCE);
+
+    // one or more cubic pieces per knot span
+    for(unsigned int i=0; i<umax; i++) {
+        double u0 = i, u1 = i + 1;
+        PLANE_POINT P0 = nurbs_point(u0, k, nurbs_control_points, knot_vector);
+        PLANE_POINT D0 = nurbs_derivative(u0, u0, u1, k,
+                                          nurbs_control_points, knot_vector);
+        PLANE_POINT P1 = nurbs_point(u1, k, nurbs_control_points, knot_vector);
+        PLANE_POINT D1 = nurbs_derivative(u1, u0, u1, k,
+                                          nurbs_control_points, knot_vector);
+        nurbs_span(lineno, u0, P0, D0, u1, P1, D1, u0, u1, tolerance, 0, k,
+                   nurbs_control_points, knot_vector);
     }
     knot_vector.clear();
 }
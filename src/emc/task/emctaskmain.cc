@@ -69,6 +69,7 @@ fpu_control_t __fpu_control = _FPU_IEEE & ~(_FPU_MASK_IM | _FPU_MASK_ZM | _FPU_M
 #include "rcs.hh"		// NML classes, nmlErrorFormat()
 #include "emc.hh"		// EMC NML
 #include "emc_nml.hh"
+#include "emcstatshm.hh"	// EMC_STAT_SHM
 #include "canon.hh"		// CANON_TOOL_TABLE stuff
 #include "inifile.hh"		// INIFILE
 #include "interpl.hh"		// NML_INTERP_LIST, interp_list
@@ -96,6 +97,7 @@ char **Argv;
 // NML channels
 static RCS_CMD_CHANNEL *emcCommandBuffer = 0;
 static RCS_STAT_CHANNEL *emcStatusBuffer = 0;
+static EMC_STAT_SHM *emcStatusShm = 0;	// lock-free copy for local readers
 static NML *emcErrorBuffer = 0;
 
 // NML command channel data pointer
@@ -389,6 +391,7 @@ static EMC_TRAJ_SET_VELOCITY *emcTrajSetVelocityMsg;
 static EMC_TRAJ_SET_ACCELERATION *emcTrajSetAccelerationMsg;
 static EMC_TRAJ_LINEAR_MOVE *emcTrajLinearMoveMsg;
 static EMC_TRAJ_CIRCULAR_MOVE *emcTrajCircularMoveMsg;
+static EMC_TRAJ_SPLINE_MOVE *emcTrajSplineMoveMsg;
 static EMC_TRAJ_DELAY *emcTrajDelayMsg;
 static EMC_TRAJ_SET_TERM_COND *emcTrajSetTermCondMsg;
 static EMC_TRAJ_SET_SPINDLESYNC *emcTrajSetSpindlesyncMsg;
@@ -462,6 +465,7 @@ static int checkInterpList(NML_INTERP_LIST * il, EMC_STAT * stat)
 #define operator_error_msg ((EMC_OPERATOR_ERROR *) cmd)
 #define linear_move ((EMC_TRAJ_LINEAR_MOVE *) cmd)
 #define circular_move ((EMC_TRAJ_CIRCULAR_MOVE *) cmd)
+#define spline_move ((EMC_TRAJ_SPLINE_MOVE *) cmd)
 
     while (il->len() > 0) {
 	cmd = il->get();
@@ -539,6 +543,39 @@ static int checkInterpList(NML_INTERP_LIST * il, EMC_STAT * stat)
 	    }
 	    break;
 
+	case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	    if (spline_move->end.tran.x >
+		stat->motion.axis[0].maxPositionLimit) {
+		emcOperatorError(0, _("%s exceeds +X limit"), stat->task.command);
+		return -1;
+	    }
+	    if (spline_move->end.tran.y >
+		stat->motion.axis[1].maxPositionLimit) {
+		emcOperatorError(0, _("%s exceeds +Y limit"), stat->task.command);
+		return -1;
+	    }
+	    if (spline_move->end.tran.z >
+		stat->motion.axis[2].maxPositionLimit) {
+		emcOperatorError(0, _("%s exceeds +Z limit"), stat->task.command);
+		return -1;
+	    }
+	    if (spline_move->end.tran.x <
+		stat->motion.axis[0].minPositionLimit) {
+		emcOperatorError(0, _("%s exceeds -X limit"), stat->task.command);
+		return -1;
+	    }
+	    if (spline_move->end.tran.y <
+		stat->motion.axis[1].minPositionLimit) {
+		emcOperatorError(0, _("%s exceeds -Y limit"), stat->task.command);
+		return -1;
+	    }
+	    if (spline_move->end.tran.z <
+		stat->motion.axis[2].minPositionLimit) {
+		emcOperatorError(0, _("%s exceeds -Z limit"), stat->task.command);
+		return -1;
+	    }
+	    break;
+
 	default:
 	    break;
 	}
@@ -547,6 +584,7 @@ static int checkInterpList(NML_INTERP_LIST * il, EMC_STAT * stat)
     return 0;
 
     // get rid of the compile-time cast shortcuts
+#undef spline_move
 #undef circular_move_msg
 #undef linear_move_msg
 #undef operator_error_msg
@@ -1496,6 +1534,7 @@ static int emcTaskCheckPreconditions(NMLmsg * cmd)
 
     case EMC_TRAJ_LINEAR_MOVE_TYPE:
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
     case EMC_TRAJ_SET_VELOCITY_TYPE:
     case EMC_TRAJ_SET_ACCELERATION_TYPE:
     case EMC_TRAJ_SET_TERM_COND_TYPE:
@@ -1813,7 +1852,8 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
         retval = emcTrajLinearMove(emcTrajLinearMoveMsg->end,
                                    emcTrajLinearMoveMsg->type, emcTrajLinearMoveMsg->vel,
                                    emcTrajLinearMoveMsg->ini_maxvel, emcTrajLinearMoveMsg->acc,
-                                   emcTrajLinearMoveMsg->indexrotary);
+                                   emcTrajLinearMoveMsg->indexrotary,
+                                   emcTrajLinearMoveMsg->plan_vel);
 	break;
 
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
@@ -1824,7 +1864,20 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
                 emcTrajCircularMoveMsg->turn, emcTrajCircularMoveMsg->type,
                 emcTrajCircularMoveMsg->vel,
                 emcTrajCircularMoveMsg->ini_maxvel,
-                emcTrajCircularMoveMsg->acc);
+                emcTrajCircularMoveMsg->acc,
+                emcTrajCircularMoveMsg->plan_vel);
+	break;
+
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+    emcTrajUpdateTag(((EMC_TRAJ_SPLINE_MOVE *) cmd)->tag);
+	emcTrajSplineMoveMsg = (EMC_TRAJ_SPLINE_MOVE *) cmd;
+        retval = emcTrajSplineMove(emcTrajSplineMoveMsg->end,
+                emcTrajSplineMoveMsg->ctrl1, emcTrajSplineMoveMsg->ctrl2,
+                emcTrajSplineMoveMsg->type,
+                emcTrajSplineMoveMsg->vel,
+                emcTrajSplineMoveMsg->ini_maxvel,
+                emcTrajSplineMoveMsg->acc,
+                emcTrajSplineMoveMsg->plan_vel);
 	break;
 
     case EMC_TRAJ_PAUSE_TYPE:
@@ -2390,6 +2443,7 @@ static int emcTaskCheckPostconditions(NMLmsg * cmd)
 
     case EMC_TRAJ_LINEAR_MOVE_TYPE:
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
     case EMC_TRAJ_SET_VELOCITY_TYPE:
     case EMC_TRAJ_SET_ACCELERATION_TYPE:
     case EMC_TRAJ_SET_TERM_COND_TYPE:
@@ -2556,7 +2610,8 @@ static int emcTaskExecute(void)
 	if (!emcStatus->motion.traj.queueFull &&
 	    emcStatus->task.interpState != EMC_TASK_INTERP_PAUSED) {
 	    if (0 == emcTaskCommand) {
-		// need a new command
+		// need a new command - plan ahead over what's queued first
+		emcTaskPlanLookahead();
 		emcTaskCommand = interp_list.get();
 		// interp_list now has line number associated with this-- get
 		// it
@@ -2891,6 +2946,10 @@ static int emctask_startup()
 	rcs_print_error("can't get emcStatus buffer\n");
 	return -1;
     }
+    // local GUIs read status from here instead of through NML
+    if (emcStatusBuffer->cms->ProcessType == CMS_LOCAL_TYPE) {
+	emcStatusShm = new EMC_STAT_SHM(true);
+    }
 
     if (!(emc_debug & EMC_DEBUG_NML)) {
 	set_rcs_print_destination(RCS_PRINT_TO_NULL);	// inhibit diag
@@ -3057,6 +3116,10 @@ static int emctask_shutdown(void)
 	emcErrorBuffer = 0;
     }
 
+    if (0 != emcStatusShm) {
+	delete emcStatusShm;
+	emcStatusShm = 0;
+    }
     if (0 != emcStatusBuffer) {
 	delete emcStatusBuffer;
 	emcStatusBuffer = 0;
@@ -3138,6 +3201,14 @@ static int iniLoad(const char *filename)
 	}
     }
 
+    saveInt = emc_task_lookahead_depth;
+    if (NULL != (inistring = inifile.Find("LOOKAHEAD_DEPTH", "TASK"))) {
+	if (1 != sscanf(inistring, "%d", &emc_task_lookahead_depth) ||
+	    emc_task_lookahead_depth < 0) {
+	    emc_task_lookahead_depth = saveInt;
+	}
+    }
+
     if (NULL != (inistring = inifile.Find("RS274NGC_STARTUP_CODE", "EMC"))) {
 	// copy to global
 	strcpy(rs274ngc_startup_code, inistring);
@@ -3488,6 +3559,9 @@ int main(int argc, char *argv[])
 	// will be updated in the _update() functions above. There's
 	// no need to call the individual functions on all WM items.
 	emcStatusBuffer->write(emcStatus);
+	if (emcStatusShm) {
+	    emcStatusShm->write(emcStatus);
+	}
 
 	// wait on timer cycle, if specified, or calculate actual
 	// interval if ini file says to run full out via
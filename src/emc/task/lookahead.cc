@@ -0,0 +1,170 @@
+/********************************************************************
+* Description: lookahead.cc
+*   Velocity look-ahead over the moves queued on the interp list
+*
+*   The RT planner optimizes final velocities over a window of a few
+*   dozen segments, and must assume a stop at the end of its queue.
+*   On dense CAM output that window covers a fraction of a millimeter,
+*   which caps the feed well below what the machine could do.
+*
+*   Task sees much further ahead: the interp list holds up to
+*   [TASK]INTERP_MAX_LEN messages. Before a move is issued, this
+*   walks back from the newest queued message and annotates each
+*   move with the highest final velocity from which motion can still
+*   come to a stop within the moves known to follow it. It assumes a
+*   stop after the newest move, and at any message other than a move.
+*
+*   The RT planner ends the last segment of its queue at this velocity
+*   instead of at zero, and its optimization walk stops at the first
+*   segment planned here which comes out unchanged. So the velocity
+*   on a long run of short segments is set by what task sees, not by
+*   the RT optimization depth.
+*
+*   The RT planner must never find that it has to end a planned
+*   segment slower than planned, or it has to walk its queue back for
+*   the difference. So this plans on the slow side of what RT does:
+*   a quarter of the acceleration (a parabolic blend halves it, and
+*   arcs keep only half of it for the tangential part), over a quarter
+*   of each move (what RT counts on for its newest segment, which a
+*   blend arc may still cut short), along the chord.
+*
+*   The pass is incremental: entries already annotated by a previous
+*   pass end the walk once their limit comes out unchanged.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include "rtapi_math.h"		// rtapi_sqrt(), rtapi_fmin()
+
+#include "rcs.hh"		// NMLmsg
+#include "emc.hh"		// EMC NML
+#include "emc_nml.hh"
+#include "emcglb.h"		// emc_task_lookahead_depth
+#include "interpl.hh"		// NML_INTERP_LIST, interp_list
+#include "task.hh"
+
+// serial of the newest interp list entry annotated so far
+static int planned_serial = -1;
+
+// share of the acceleration and of the length of a move planned with,
+// on the slow side of the RT planner - see above
+#define PLAN_ACC_RATIO 0.25
+#define PLAN_LENGTH_RATIO 0.25
+
+// the dominant distance of a move, in the order the RT planner picks
+// its target: xyz, else uvw, else abc. For arcs and splines this is the
+// chord, which underestimates the length and so errs on the slow side.
+static double move_length(EmcPose const &from, EmcPose const &to)
+{
+    double dx = to.tran.x - from.tran.x;
+    double dy = to.tran.y - from.tran.y;
+    double dz = to.tran.z - from.tran.z;
+    double d = rtapi_sqrt(dx * dx + dy * dy + dz * dz);
+    if (d > 1e-9)
+	return d;
+
+    double du = to.u - from.u, dv = to.v - from.v, dw = to.w - from.w;
+    d = rtapi_sqrt(du * du + dv * dv + dw * dw);
+    if (d > 1e-9)
+	return d;
+
+    double da = to.a - from.a, db = to.b - from.b, dc = to.c - from.c;
+    return rtapi_sqrt(da * da + db * db + dc * dc);
+}
+
+void emcTaskPlanLookahead()
+{
+    NMLmsg *msg;
+    int n;
+
+    // what follows the move being planned, in program order: nothing
+    // known yet (the newest entry), a stop, or a move
+    enum { NEXT_UNKNOWN, NEXT_STOP, NEXT_MOVE } next = NEXT_UNKNOWN;
+    EmcPose next_end;
+    double next_vf = 0.0, next_acc = 0.0, next_maxvel = 0.0;
+
+    if (emc_task_lookahead_depth <= 0) {
+	return;
+    }
+
+    int newest = -1;
+    for (msg = interp_list.get_newest(), n = 0;
+	 msg != NULL && n < emc_task_lookahead_depth;
+	 msg = interp_list.get_older(), n++) {
+
+	int serial = interp_list.get_serial();
+	bool fresh = serial > planned_serial;
+	if (newest < 0) {
+	    newest = serial;
+	}
+
+	EmcPose *end;
+	double *plan_vel, acc, maxvel;
+
+	switch (msg->type) {
+	case EMC_TRAJ_LINEAR_MOVE_TYPE: {
+	    EMC_TRAJ_LINEAR_MOVE *m = (EMC_TRAJ_LINEAR_MOVE *) msg;
+	    end = &m->end;
+	    plan_vel = &m->plan_vel;
+	    acc = m->acc;
+	    maxvel = m->ini_maxvel;
+	    break;
+	}
+	case EMC_TRAJ_CIRCULAR_MOVE_TYPE: {
+	    EMC_TRAJ_CIRCULAR_MOVE *m = (EMC_TRAJ_CIRCULAR_MOVE *) msg;
+	    end = &m->end;
+	    plan_vel = &m->plan_vel;
+	    acc = m->acc;
+	    maxvel = m->ini_maxvel;
+	    break;
+	}
+	case EMC_TRAJ_SPLINE_MOVE_TYPE: {
+	    EMC_TRAJ_SPLINE_MOVE *m = (EMC_TRAJ_SPLINE_MOVE *) msg;
+	    end = &m->end;
+	    plan_vel = &m->plan_vel;
+	    acc = m->acc;
+	    maxvel = m->ini_maxvel;
+	    break;
+	}
+	case EMC_TRAJ_SET_TERM_COND_TYPE:
+	    // blending vs. exact stop is decided by the RT planner
+	    continue;
+	default:
+	    // motion comes to a stop before anything else is done.
+	    // behind an entry planned before, nothing can have changed.
+	    if (!fresh) {
+		goto done;
+	    }
+	    next = NEXT_STOP;
+	    continue;
+	}
+
+	// a stop after the newest move, or before a non-move
+	double vf = 0.0;
+	if (next == NEXT_MOVE) {
+	    // slow down to next_vf over the next move
+	    double len = move_length(*end, next_end);
+	    vf = rtapi_fmin(rtapi_fmin(maxvel, next_maxvel),
+			    rtapi_sqrt(next_vf * next_vf +
+				       2.0 * PLAN_ACC_RATIO * next_acc *
+				       PLAN_LENGTH_RATIO * len));
+	}
+	if (!fresh && *plan_vel == vf) {
+	    // settled - everything further back is unchanged too
+	    break;
+	}
+	*plan_vel = vf;
+
+	next = NEXT_MOVE;
+	next_end = *end;
+	next_vf = vf;
+	next_acc = acc;
+	next_maxvel = maxvel;
+    }
+done:
+    if (newest > planned_serial) {
+	planned_serial = newest;
+    }
+}
@@ -51,6 +51,7 @@ int emcTaskPlanReset();
 int emcTaskPlanLine();
 int emcTaskPlanLevel();
 int emcTaskPlanCommand(char *cmd);
+void emcTaskPlanLookahead();
 
 int emcTaskUpdate(EMC_TASK_STAT * stat);
 
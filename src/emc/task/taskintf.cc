@@ -994,7 +994,7 @@ int emcTrajSetTermCond(int cond, double tolerance)
 }
 
 int emcTrajLinearMove(EmcPose end, int type, double vel, double ini_maxvel, double acc,
-                      int indexrotary)
+                      int indexrotary, double plan_vel)
 {
 #ifdef ISNAN_TRAP
     if (rtapi_isnan(end.tran.x) || rtapi_isnan(end.tran.y) || rtapi_isnan(end.tran.z) ||
@@ -1016,12 +1016,14 @@ int emcTrajLinearMove(EmcPose end, int type, double vel, double ini_maxvel, doub
     emcmotCommand.ini_maxvel = ini_maxvel;
     emcmotCommand.acc = acc;
     emcmotCommand.turn = indexrotary;
+    emcmotCommand.plan_vel = plan_vel;
 
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
 int emcTrajCircularMove(EmcPose end, PM_CARTESIAN center,
-			PM_CARTESIAN normal, int turn, int type, double vel, double ini_maxvel, double acc)
+			PM_CARTESIAN normal, int turn, int type, double vel, double ini_maxvel, double acc,
+			double plan_vel)
 {
 #ifdef ISNAN_TRAP
     if (rtapi_isnan(end.tran.x) || rtapi_isnan(end.tran.y) || rtapi_isnan(end.tran.z) ||
@@ -1054,6 +1056,46 @@ int emcTrajCircularMove(EmcPose end, PM_CARTESIAN center,
     emcmotCommand.vel = vel;
     emcmotCommand.ini_maxvel = ini_maxvel;
     emcmotCommand.acc = acc;
+    emcmotCommand.plan_vel = plan_vel;
+
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
+int emcTrajSplineMove(EmcPose end, PM_CARTESIAN ctrl1,
+		      PM_CARTESIAN ctrl2, int type, double vel, double ini_maxvel, double acc,
+		      double plan_vel)
+{
+#ifdef ISNAN_TRAP
+    if (rtapi_isnan(end.tran.x) || rtapi_isnan(end.tran.y) || rtapi_isnan(end.tran.z) ||
+	rtapi_isnan(end.a) || rtapi_isnan(end.b) || rtapi_isnan(end.c) ||
+	rtapi_isnan(end.u) || rtapi_isnan(end.v) || rtapi_isnan(end.w) ||
+	rtapi_isnan(ctrl1.x) || rtapi_isnan(ctrl1.y) || rtapi_isnan(ctrl1.z) ||
+	rtapi_isnan(ctrl2.x) || rtapi_isnan(ctrl2.y) || rtapi_isnan(ctrl2.z)) {
+	printf("isnan error in emcTrajSplineMove()\n");
+	return 0;		// ignore it for now, just don't send it
+    }
+#endif
+
+    emcmotCommand.command = EMCMOT_SET_SPLINE;
+
+    emcmotCommand.pos = end;
+    emcmotCommand.motion_type = type;
+
+    emcmotCommand.ctrl1.x = ctrl1.x;
+    emcmotCommand.ctrl1.y = ctrl1.y;
+    emcmotCommand.ctrl1.z = ctrl1.z;
+
+    emcmotCommand.ctrl2.x = ctrl2.x;
+    emcmotCommand.ctrl2.y = ctrl2.y;
+    emcmotCommand.ctrl2.z = ctrl2.z;
+
+    emcmotCommand.id = localEmcTrajMotionId;
+    emcmotCommand.tag = localEmcTrajTag;
+
+    emcmotCommand.vel = vel;
+    emcmotCommand.ini_maxvel = ini_maxvel;
+    emcmotCommand.acc = acc;
+    emcmotCommand.plan_vel = plan_vel;
 
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
@@ -1479,6 +1521,7 @@ int emcMotionUpdate(EMC_MOTION_STAT * stat)
     int axis;
     int error;
     int exec;
+    int failed;
     int dio, aio;
 
     // read the emcmot status
@@ -1506,6 +1549,9 @@ int emcMotionUpdate(EMC_MOTION_STAT * stat)
 	// an error to report
 	emcOperatorError(0, "%s", errorString);
     }
+    // moves are not waited for when they are queued, so their failures
+    // turn up here
+    failed = usrmotCommandFailed(&emcmotStatus);
 
     // save the heartbeat and command number locally,
     // for use with emcMotionUpdate
@@ -1551,7 +1597,7 @@ int emcMotionUpdate(EMC_MOTION_STAT * stat)
 	    break;
 	}
     }
-    if (stat->traj.status == RCS_ERROR) {
+    if (stat->traj.status == RCS_ERROR || failed) {
 	error = 1;
     } else if (stat->traj.status == RCS_EXEC) {
 	exec = 1;
@@ -1590,3 +1636,9 @@ int emcSetMaxFeedOverride(double maxFeedScale) {
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
+int emcSetMaxJerk(double maxJerk) {
+    emcmotCommand.command = EMCMOT_SET_MAX_JERK;
+    emcmotCommand.maxJerk = maxJerk;
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
@@ -0,0 +1,235 @@
+/********************************************************************
+ * Description: bezier.c
+ *
+ * Cubic Bezier curves with arc length parametrization, for spline
+ * segments (G5, G5.1, G5.2) executed natively by the TP.
+ *
+ * License: GPL Version 2
+ * System: Linux
+ *
+ ********************************************************************/
+
+#include "posemath.h"
+#include "bezier.h"
+#include "tp_types.h"
+#include "rtapi_math.h"
+
+#include "tp_debug.h"
+
+/** Weighted sum of the control points. */
+static void bezierCombine(PmBezier const * const bez,
+        double w0, double w1, double w2, double w3,
+        PmCartesian * const out)
+{
+    out->x = w0 * bez->p0.x + w1 * bez->p1.x + w2 * bez->p2.x + w3 * bez->p3.x;
+    out->y = w0 * bez->p0.y + w1 * bez->p1.y + w2 * bez->p2.y + w3 * bez->p3.y;
+    out->z = w0 * bez->p0.z + w1 * bez->p1.z + w2 * bez->p2.z + w3 * bez->p3.z;
+}
+
+/** First derivative with respect to the curve parameter. */
+static void bezierDeriv(PmBezier const * const bez, double u,
+        PmCartesian * const out)
+{
+    double v = 1.0 - u;
+    // 3 * sum of the differences of adjacent control points, weighted by
+    // the quadratic Bernstein polynomials
+    bezierCombine(bez,
+            -3.0 * v * v,
+            3.0 * v * v - 6.0 * u * v,
+            6.0 * u * v - 3.0 * u * u,
+            3.0 * u * u,
+            out);
+}
+
+/** Second derivative with respect to the curve parameter. */
+static void bezierDeriv2(PmBezier const * const bez, double u,
+        PmCartesian * const out)
+{
+    double v = 1.0 - u;
+    bezierCombine(bez,
+            6.0 * v,
+            6.0 * u - 12.0 * v,
+            6.0 * v - 12.0 * u,
+            6.0 * u,
+            out);
+}
+
+/** Length of the curve per unit parameter at u. */
+static double bezierSpeed(PmBezier const * const bez, double u)
+{
+    PmCartesian d;
+    double speed;
+
+    bezierDeriv(bez, u, &d);
+    pmCartMag(&d, &speed);
+    return speed;
+}
+
+/** Arc length from u0 to u1 by Simpson's rule, given the speed at u0. */
+static double bezierSimpson(PmBezier const * const bez,
+        double u0, double speed0, double u1)
+{
+    return (u1 - u0) / 6.0 * (speed0 +
+            4.0 * bezierSpeed(bez, 0.5 * (u0 + u1)) +
+            bezierSpeed(bez, u1));
+}
+
+int bezierInit(PmBezier * const bez,
+        PmCartesian const * const p0,
+        PmCartesian const * const p1,
+        PmCartesian const * const p2,
+        PmCartesian const * const p3)
+{
+    if (!bez || !p0 || !p1 || !p2 || !p3) {
+        return TP_ERR_MISSING_INPUT;
+    }
+
+    bez->p0 = *p0;
+    bez->p1 = *p1;
+    bez->p2 = *p2;
+    bez->p3 = *p3;
+
+    // Tabulate the arc length
+    int i;
+    bez->s[0] = 0.0;
+    for (i = 1; i <= BEZIER_SAMPLES; ++i) {
+        double u0 = (double)(i - 1) / BEZIER_SAMPLES;
+        double u1 = (double)i / BEZIER_SAMPLES;
+        bez->s[i] = bez->s[i - 1] +
+            bezierSimpson(bez, u0, bezierSpeed(bez, u0), u1);
+    }
+
+    // Find the tightest curvature, at twice the sample resolution.
+    // Negative means the curve is straight.
+    bez->min_radius = -1.0;
+    for (i = 0; i <= 2 * BEZIER_SAMPLES; ++i) {
+        double u = (double)i / (2 * BEZIER_SAMPLES);
+        PmCartesian d1, d2, cross;
+        double speed, d2_mag, cross_mag;
+
+        bezierDeriv(bez, u, &d1);
+        bezierDeriv2(bez, u, &d2);
+        pmCartMag(&d1, &speed);
+        pmCartMag(&d2, &d2_mag);
+        pmCartCartCross(&d1, &d2, &cross);
+        pmCartMag(&cross, &cross_mag);
+
+        double radius;
+        if ((i == 0 || i == 2 * BEZIER_SAMPLES) &&
+                speed < d2_mag / (2 * BEZIER_SAMPLES)) {
+            // An inner control point on (or next to) the end point, as
+            // from G5 P0 Q0 or repeated NURBS control points. The curve
+            // still leaves along d2 without stopping; the curvature
+            // only blows up over a vanishing length, which the samples
+            // inside bound well enough.
+            continue;
+        } else if (speed < BEZIER_MIN_SPEED) {
+            // Cusp, motion has to come to a stop here
+            radius = 0.0;
+        } else if (cross_mag < BEZIER_MIN_SPEED * speed * speed * speed) {
+            continue;
+        } else {
+            radius = speed * speed * speed / cross_mag;
+        }
+        if (bez->min_radius < 0.0 || radius < bez->min_radius) {
+            bez->min_radius = radius;
+        }
+    }
+
+    tp_debug_print("bezier length = %f, min radius = %f\n",
+            bez->s[BEZIER_SAMPLES], bez->min_radius);
+    return TP_ERR_OK;
+}
+
+int bezierPoint(PmBezier const * const bez, double u, PmCartesian * const out)
+{
+    double v = 1.0 - u;
+    bezierCombine(bez,
+            v * v * v,
+            3.0 * u * v * v,
+            3.0 * u * u * v,
+            u * u * u,
+            out);
+    return TP_ERR_OK;
+}
+
+/**
+ * Unit tangent vector at u.
+ * Where an inner control point coincides with an end point, the first
+ * derivative vanishes at that end; the direction of the curve is then
+ * given by the second derivative.
+ */
+int bezierTangent(PmBezier const * const bez, double u, PmCartesian * const out)
+{
+    PmCartesian d;
+    double mag;
+
+    bezierDeriv(bez, u, &d);
+    pmCartMag(&d, &mag);
+    if (mag < BEZIER_MIN_SPEED) {
+        bezierDeriv2(bez, u, &d);
+        if (u > 0.5) {
+            pmCartScalMultEq(&d, -1.0);
+        }
+        pmCartMag(&d, &mag);
+    }
+    if (mag < BEZIER_MIN_SPEED) {
+        pmCartCartSub(&bez->p3, &bez->p0, &d);
+    }
+    return pmCartUnit(&d, out);
+}
+
+double bezierLength(PmBezier const * const bez)
+{
+    return bez->s[BEZIER_SAMPLES];
+}
+
+/**
+ * Find the curve parameter at which the arc length equals progress.
+ */
+int bezierParamFromProgress(PmBezier const * const bez, double progress,
+        double * const u)
+{
+    if (progress <= 0.0) {
+        *u = 0.0;
+        return TP_ERR_OK;
+    }
+    if (progress >= bez->s[BEZIER_SAMPLES]) {
+        *u = 1.0;
+        return TP_ERR_OK;
+    }
+
+    // Bracket progress in the table
+    int lo = 0, hi = BEZIER_SAMPLES;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (bez->s[mid] <= progress) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    double u0 = (double)lo / BEZIER_SAMPLES;
+    double u1 = (double)hi / BEZIER_SAMPLES;
+    double ds = bez->s[hi] - bez->s[lo];
+    double t = ds > 0.0 ? (progress - bez->s[lo]) / ds : 0.0;
+    double u_est = u0 + t * (u1 - u0);
+    double speed0 = bezierSpeed(bez, u0);
+
+    // Refine with Newton's method, using the same quadrature as the
+    // table so that the mapping is continuous across samples
+    int k;
+    for (k = 0; k < BEZIER_NEWTON_STEPS; ++k) {
+        double speed = bezierSpeed(bez, u_est);
+        if (speed < BEZIER_MIN_SPEED) {
+            break;
+        }
+        double s = bez->s[lo] + bezierSimpson(bez, u0, speed0, u_est);
+        u_est -= (s - progress) / speed;
+        u_est = rtapi_fmax(u0, rtapi_fmin(u1, u_est));
+    }
+
+    *u = u_est;
+    return TP_ERR_OK;
+}
@@ -0,0 +1,53 @@
+/********************************************************************
+ * Description: bezier.h
+ *
+ * Cubic Bezier curves with arc length parametrization, for spline
+ * segments (G5, G5.1, G5.2) executed natively by the TP.
+ *
+ * License: GPL Version 2
+ * System: Linux
+ *
+ ********************************************************************/
+#ifndef BEZIER_H
+#define BEZIER_H
+
+#include "posemath.h"
+
+// number of intervals of the curve parameter the arc length is sampled at
+#define BEZIER_SAMPLES 16
+// Newton steps to refine the parameter within a sample interval
+#define BEZIER_NEWTON_STEPS 3
+// below this speed (length per unit parameter) the curve is degenerate
+#define BEZIER_MIN_SPEED 1e-12
+
+/**
+ * Cubic Bezier curve.
+ * The arc length is tabulated at even steps of the curve parameter u, so
+ * that progress along the curve can be mapped back to u: a table lookup
+ * brackets u, and a few Newton steps on Simpson's rule refine it.
+ */
+typedef struct {
+    PmCartesian p0;             /* start point */
+    PmCartesian p1;             /* inner control points */
+    PmCartesian p2;
+    PmCartesian p3;             /* end point */
+    double s[BEZIER_SAMPLES + 1]; /* arc length at u = i / BEZIER_SAMPLES */
+    double min_radius;          /* smallest radius of curvature */
+} PmBezier;
+
+int bezierInit(PmBezier * const bez,
+        PmCartesian const * const p0,
+        PmCartesian const * const p1,
+        PmCartesian const * const p2,
+        PmCartesian const * const p3);
+
+int bezierPoint(PmBezier const * const bez, double u, PmCartesian * const out);
+
+int bezierTangent(PmBezier const * const bez, double u, PmCartesian * const out);
+
+double bezierLength(PmBezier const * const bez);
+
+int bezierParamFromProgress(PmBezier const * const bez, double progress,
+        double * const u);
+
+#endif
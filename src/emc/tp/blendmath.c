@@ -1606,6 +1606,29 @@ double pmCircleActualMaxVel(PmCircle * const circle, double v_max, double a_max,
 }
 
 
+/**
+ * Limit the velocity along a spline so that the normal acceleration stays
+ * within bounds at its tightest curvature.
+ */
+double pmBezierActualMaxVel(PmBezier const * const bez, double v_max, double a_max, int parabolic)
+{
+    if (bez->min_radius < 0.0) {
+        // Straight, no normal acceleration
+        return v_max;
+    }
+    if (parabolic) {
+        a_max /= 2.0;
+    }
+    double a_n_max = BLEND_ACC_RATIO_NORMAL * a_max;
+    double v_max_acc = pmSqrt(a_n_max * bez->min_radius);
+    if (v_max_acc < v_max) {
+        tp_debug_print("Spline maxvel limited from %f to %f for normal acceleration\n", v_max, v_max_acc);
+        return v_max_acc;
+    }
+    return v_max;
+}
+
+
 /** @section spiralfuncs Functions to approximate spiral arc length */
 
 /**
@@ -228,6 +228,10 @@ double pmCircleActualMaxVel(PmCircle * const circle,
         double v_max,
         double a_max,
         int parabolic);
+double pmBezierActualMaxVel(PmBezier const * const bez,
+        double v_max,
+        double a_max,
+        int parabolic);
 int findSpiralArcLengthFit(PmCircle const * const circle,
         SpiralArcLengthFit * const fit);
 int pmCircleAngleFromProgress(PmCircle const * const circle,
@@ -121,6 +121,12 @@ STATIC int tpRotaryMotionCheck(TP_STRUCT const * const tp, TC_STRUCT const * con
             } else {
                 return true;
             }
+        case TC_SPLINE:
+            if (tc->coords.spline.abc.tmag_zero && tc->coords.spline.uvw.tmag_zero) {
+                return false;
+            } else {
+                return true;
+            }
         case TC_SPHERICAL:
             return true;
         default:
@@ -316,7 +322,8 @@ STATIC inline double tpGetScaledAccel(TP_STRUCT const * const tp,
     if (tc->term_cond == TC_TERM_COND_PARABOLIC || tc->blend_prev) {
         a_scale *= 0.5;
     }
-    if (tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_SPHERICAL) {
+    if (tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_SPHERICAL ||
+            tc->motion_type == TC_SPLINE) {
         //Limit acceleration for cirular arcs to allow for normal acceleration
         a_scale *= BLEND_ACC_RATIO_TANGENTIAL;
     }
@@ -409,6 +416,7 @@ int tpClear(TP_STRUCT * const tp)
     tp->queueSize = 0;
     tp->goalPos = tp->currentPos;
     tp->nextId = 0;
+    tp->nextPlanVel = -1.0;
     tp->execId = 0;
     tp->motionType = 0;
     tp->termCond = TC_TERM_COND_PARABOLIC;
@@ -552,6 +560,25 @@ int tpSetId(TP_STRUCT * const tp, int id)
     return TP_ERR_OK;
 }
 
+/**
+ * Sets the planned final velocity for the next appended motion.
+ * The task look-ahead planner sees far more of the program than fits into the
+ * optimization window. For each move it passes down the highest final
+ * velocity from which motion can still stop within the moves it knows to
+ * follow. The value applies to the next tpAddLine/tpAddCircle/tpAddSpline
+ * only; a negative value means no velocity was planned.
+ */
+int tpSetPlanVel(TP_STRUCT * const tp, double vel)
+{
+    if (0 == tp) {
+        return TP_ERR_FAIL;
+    }
+
+    tp->nextPlanVel = vel;
+
+    return TP_ERR_OK;
+}
+
 /** Returns the id of the last motion that is currently
   executing.*/
 int tpGetExecId(TP_STRUCT * const tp)
@@ -713,14 +740,16 @@ STATIC double tpCalculateTriangleVel(TP_STRUCT const * const tp, TC_STRUCT * con
  * The problem here is that the last segment in the queue can always be cut
  * short by a blend to the next segment. However, we can only ever consume at
  * most 1/2 of the segment. This function computes the worst-case final
- * velocity the previous segment can have, if we want to exactly stop at the
- * halfway point.
+ * velocity the previous segment can have, if we want to be down to the
+ * segment's final velocity at the halfway point: zero, or the velocity planned
+ * by task, from which it was already made sure that motion can stop in time.
  */
 STATIC double tpCalculateOptimizationInitialVel(TP_STRUCT const * const tp, TC_STRUCT * const tc)
 {
     double acc_scaled = tpGetScaledAccel(tp, tc);
     //FIXME this is defined in two places!
-    double triangle_vel = pmSqrt( acc_scaled * tc->target * BLEND_DIST_FRACTION);
+    double triangle_vel = pmSqrt(pmSq(tc->finalvel) +
+            acc_scaled * tc->target * BLEND_DIST_FRACTION);
     double max_vel = tpGetMaxTargetVel(tp, tc);
     tp_debug_print("optimization initial vel for segment %d is %f\n", tc->id, triangle_vel);
     return rtapi_fmin(triangle_vel, max_vel);
@@ -1398,6 +1427,17 @@ STATIC int tpCreateLineLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc
 }
 
 
+/**
+ * Fetch the planned final velocity set for the segment being added, and reset
+ * it so it can't leak into a later segment.
+ */
+STATIC inline double tpTakePlanVel(TP_STRUCT * const tp) {
+    double vel = tp->nextPlanVel;
+    tp->nextPlanVel = -1.0;
+    return vel;
+}
+
+
 /**
  * Add a newly created motion segment to the tp queue.
  * Returns an error code if the queue operation fails, otherwise adds a new
@@ -1605,9 +1645,16 @@ STATIC int tpComputeOptimalVelocity(TP_STRUCT const * const tp, TC_STRUCT * cons
  * Do "rising tide" optimization to find allowable final velocities for each queued segment.
  * Walk along the queue from the back to the front. Based on the "current"
  * segment's final velocity, calculate the previous segment's maximum allowable
- * final velocity. The depth we walk along the queue is controlled by the
- * TP_LOOKAHEAD_DEPTH constant for now. The process safetly aborts early due to
- * a short queue or other conflicts.
+ * final velocity. The process safetly aborts early due to a short queue or
+ * other conflicts.
+ *
+ * The last segment ends at zero, or at the final velocity planned for it by
+ * the task look-ahead, which already made sure motion can stop within the
+ * moves that follow it. The walk then stops at the first segment with a
+ * planned velocity whose final velocity came out unchanged: the segments
+ * before it were optimized against that. A final velocity raised above what
+ * was planned is carried back over at most the optimization depth, as for
+ * segments without a plan; one lowered below it is always carried back.
  */
 STATIC int tpRunOptimization(TP_STRUCT * const tp) {
     // Pointers to the "current", previous, and 2nd previous trajectory
@@ -1625,11 +1672,15 @@ STATIC int tpRunOptimization(TP_STRUCT * const tp) {
     // Flag that says we've hit at least 1 non-tangent segment
     bool hit_non_tangent = false;
 
+    int depth = get_arcBlendOptDepth(tp->shared) + 2;
+    // a final velocity was lowered, so the walk goes on past the depth
+    bool lowered = false;
+
     /* Starting at the 2nd to last element in the queue, work backwards towards
      * the front. We can't do anything with the very last element because its
      * length may change if a new line is added to the queue.*/
 
-    for (x = 1; x < get_arcBlendOptDepth(tp->shared) + 2; ++x) {
+    for (x = 1; x < depth || lowered; ++x) {
         tp_info_print("==== Optimization step %d ====\n",x);
 
         // Update the pointers to the trajectory segments in use
@@ -1652,6 +1703,8 @@ STATIC int tpRunOptimization(TP_STRUCT * const tp) {
             } else  {
                 tp_debug_print("Found first non-tangent segment, contining\n");
                 hit_non_tangent = true;
+                // nothing before a stop depends on what comes after it
+                lowered = false;
                 continue;
             }
         }
@@ -1685,11 +1738,16 @@ STATIC int tpRunOptimization(TP_STRUCT * const tp) {
             tc->finalvel = 0.0;
         }
 
+        double vf_before = prev1_tc->finalvel;
         if (!tc->finalized) {
             tp_debug_print("Segment %d, type %d not finalized, continuing\n",tc->id,tc->motion_type);
+            if (tc->plan_vel >= 0 && !tc->atspeed) {
+                tc->finalvel = rtapi_fmin(tc->plan_vel, tc->maxvel);
+            } else {
+                tc->finalvel = 0.0;
+            }
             // use worst-case final velocity that allows for up to 1/2 of a segment to be consumed.
             prev1_tc->finalvel = rtapi_fmin(prev1_tc->maxvel, tpCalculateOptimizationInitialVel(tp,tc));
-            tc->finalvel = 0.0;
         } else {
             tpComputeOptimalVelocity(tp, tc, prev1_tc);
         }
@@ -1704,6 +1762,13 @@ STATIC int tpRunOptimization(TP_STRUCT * const tp) {
         }
 #endif
 
+        lowered = prev1_tc->finalvel < vf_before;
+        if (!lowered && prev1_tc->plan_vel >= 0 &&
+                prev1_tc->finalvel == vf_before) {
+            tp_debug_print("segment %d unchanged from its plan, stopping optimization\n",
+                    ind-1);
+            return TP_ERR_OK;
+        }
     }
     tp_debug_print("Reached optimization depth limit\n");
     return TP_ERR_OK;
@@ -1811,7 +1876,8 @@ STATIC int tpSetupTangent(TP_STRUCT const * const tp,
     //FIXME this ratio is arbitrary, should be more easily tunable
     double acc_scale_max = pmCartAbsMax(&acc_scale);
     //KLUDGE lumping a few calculations together here
-    if (prev_tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_CIRCULAR) {
+    if (prev_tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_CIRCULAR ||
+            prev_tc->motion_type == TC_SPLINE || tc->motion_type == TC_SPLINE) {
         acc_scale_max /= BLEND_ACC_RATIO_TANGENTIAL;
     }
 
@@ -1935,6 +2001,7 @@ int tpAddLine(TP_STRUCT * const tp, EmcPose end, int canon_motion_type, double v
             enables,
             atspeed);
     tc.tag = tag;
+    tc.plan_vel = tpTakePlanVel(tp);
 
     // Copy in motion parameters
     tcSetupMotion(&tc,
@@ -2021,6 +2088,7 @@ int tpAddCircle(TP_STRUCT * const tp,
             enables,
             atspeed);
     tc.tag = tag;
+    tc.plan_vel = tpTakePlanVel(tp);
     // Setup any synced IO for this move
     tpSetupSyncedIO(tp, &tc);
 
@@ -2075,6 +2143,93 @@ int tpAddCircle(TP_STRUCT * const tp,
 }
 
 
+/**
+ * Add a spline segment to the tc queue.
+ * The XYZ path is a cubic Bezier curve from the end of the previous move to
+ * end, with inner control points ctrl1 and ctrl2, which the TP evaluates
+ * directly rather than as a chain of short lines and arcs.
+ */
+int tpAddSpline(TP_STRUCT * const tp,
+        EmcPose end,
+        PmCartesian ctrl1,
+        PmCartesian ctrl2,
+        int canon_motion_type,
+        double vel,
+        double ini_maxvel,
+        double acc,
+        unsigned char enables,
+        char atspeed,
+        struct state_tag_t tag)
+{
+    if (tpErrorCheck(tp)<0) {
+        return TP_ERR_FAIL;
+    }
+
+    tp_info_print("== AddSpline ==\n");
+    tp_debug_print("ini_maxvel = %f\n",ini_maxvel);
+
+    TC_STRUCT tc = {0};
+
+    tcInit(&tc,
+            TC_SPLINE,
+            canon_motion_type,
+            tp->cycleTime,
+            enables,
+            atspeed);
+    tc.tag = tag;
+    tc.plan_vel = tpTakePlanVel(tp);
+    // Setup any synced IO for this move
+    tpSetupSyncedIO(tp, &tc);
+
+    // Copy over state data from the trajectory planner
+    tcSetupState(&tc, tp);
+
+    // Setup spline geometry
+    int res_init = pmSpline9Init(&tc.coords.spline,
+            &tp->goalPos,
+            &end,
+            &ctrl1,
+            &ctrl2);
+
+    if (res_init) return res_init;
+
+    tc.target = pmSpline9Target(&tc.coords.spline);
+    if (tc.target < TP_POS_EPSILON) {
+        return TP_ERR_FAIL;
+    }
+    tp_debug_print("tc.target = %f\n",tc.target);
+    tc.nominal_length = tc.target;
+
+    //Reduce max velocity to match sample rate
+    tcClampVelocityByLength(&tc);
+
+    double v_max_actual = pmBezierActualMaxVel(&tc.coords.spline.xyz, ini_maxvel, acc, false);
+
+    // Copy in motion parameters
+    tcSetupMotion(&tc,
+            vel,
+            v_max_actual,
+            acc);
+
+    TC_STRUCT *prev_tc;
+    prev_tc = tcqLast(&tp->queue);
+
+    tpCheckCanonType(prev_tc, &tc);
+    if (get_arcBlendEnable(tp->shared)){
+        // Splines aren't blended with arcs, but consecutive pieces of a
+        // spline are tangent and are joined here
+        tpHandleBlendArc(tp, &tc);
+    }
+    tcCheckLastParabolic(&tc, prev_tc);
+    tcFinalizeLength(prev_tc);
+    tcFlagEarlyStop(prev_tc, &tc);
+
+    int retval = tpAddSegmentToQueue(tp, &tc, true);
+
+    tpRunOptimization(tp);
+    return retval;
+}
+
 /**
  * Adjusts blend velocity and acceleration to safe limits.
  * If we are blending between tc and nexttc, then we need to figure out what a
@@ -2175,6 +2330,7 @@ STATIC int tcUpdateDistFromAccel(TC_STRUCT * const tc, double acc, double vel_de
     // Note that progress can be greater than the target after this step.
     if (v_next < 0.0) {
         v_next = 0.0;
+        acc = 0.0;
         //KLUDGE: the trapezoidal planner undershoots by half a cycle time, so
         //forcing the endpoint here is necessary. However, velocity undershoot
         //also occurs during pausing and stopping, which can happen far from
@@ -2189,6 +2345,7 @@ STATIC int tcUpdateDistFromAccel(TC_STRUCT * const tc, double acc, double vel_de
         clip_max(&tc->progress,tc->target);
     }
     tc->currentvel = v_next;
+    tc->currentacc = acc;
 
     // Check if we can make the desired velocity
     tc->on_final_decel = (rtapi_fabs(vel_desired - tc->currentvel) < TP_VEL_EPSILON) && (acc < 0.0);
@@ -2230,14 +2387,13 @@ STATIC void tpDebugCycleInfo(TP_STRUCT const * const tp,
  * acceleration limits. The formula has been tweaked slightly to allow a
  * non-zero velocity at the instant the target is reached.
  */
-void tpCalculateTrapezoidalAccel(TP_STRUCT const * const tp,
+STATIC void tpCalculateTrapezoidalAccelOver(TP_STRUCT const * const tp,
         TC_STRUCT * const tc,
         TC_STRUCT const * const nexttc,
+        double dx,
         double * const acc,
         double * const vel_desired)
 {
-    tc_debug_print("using trapezoidal acceleration\n");
-
     // Find maximum allowed velocity from feed and machine limits
     double tc_target_vel = tpGetRealTargetVel(tp, tc);
     // Store a copy of final velocity
@@ -2251,7 +2407,6 @@ void tpCalculateTrapezoidalAccel(TP_STRUCT const * const tp,
 #endif
 
     /* Calculations for desired velocity based on trapezoidal profile */
-    double dx = tc->target - tc->progress;
     double maxaccel = tpGetScaledAccel(tp, tc);
 
     double discr_term1 = pmSq(tc_finalvel);
@@ -2290,6 +2445,17 @@ void tpCalculateTrapezoidalAccel(TP_STRUCT const * const tp,
     *vel_desired = maxnewvel;
 }
 
+void tpCalculateTrapezoidalAccel(TP_STRUCT const * const tp,
+        TC_STRUCT * const tc,
+        TC_STRUCT const * const nexttc,
+        double * const acc,
+        double * const vel_desired)
+{
+    tc_debug_print("using trapezoidal acceleration\n");
+    tpCalculateTrapezoidalAccelOver(tp, tc, nexttc,
+            tc->target - tc->progress, acc, vel_desired);
+}
+
 /**
  * Calculate "ramp" acceleration for a cycle.
  */
@@ -2339,6 +2505,148 @@ STATIC int tpCalculateRampAccel(TP_STRUCT const * const tp,
     return TP_ERR_OK;
 }
 
+/**
+ * Distance needed to get from velocity v and acceleration acc to velocity
+ * vel_final, with acceleration limited to acc_max and jerk to jerk.
+ *
+ * Any positive acceleration is ramped down first. A negative one is taken as
+ * part of the ramp into the deceleration, whose start is backed out. The
+ * deceleration is symmetric, so the average velocity over it is the mean of
+ * its start and end velocities.
+ */
+STATIC double tpSCurveStopDistance(double v, double acc, double vel_final,
+        double acc_max, double jerk)
+{
+    double dist = 0.0;
+    if (acc > 0.0) {
+        double t = acc / jerk;
+        dist = v * t + 0.5 * acc * t * t - jerk * t * t * t / 6.0;
+        v += 0.5 * acc * t;
+        acc = 0.0;
+    }
+
+    double dist_done = 0.0;
+    if (acc < 0.0) {
+        double t = -acc / jerk;
+        v += 0.5 * acc * acc / jerk;
+        dist_done = v * t - jerk * t * t * t / 6.0;
+    }
+
+    double dv = v - vel_final;
+    if (dv <= 0.0) {
+        return dist;
+    }
+    double t_decel;
+    if (dv >= acc_max * acc_max / jerk) {
+        t_decel = dv / acc_max + acc_max / jerk;
+    } else {
+        t_decel = 2.0 * pmSqrt(dv / jerk);
+    }
+    return dist + (v + vel_final) * 0.5 * t_decel - dist_done;
+}
+
+/**
+ * Check if we can still make the final velocity within dx after applying
+ * acceleration acc for a cycle.
+ */
+STATIC bool tpSCurveCanStop(TC_STRUCT const * const tc, double acc, double dx,
+        double vel_final, double acc_max, double jerk)
+{
+    double v = tc->currentvel;
+    double v_next = v + acc * tc->cycle_time;
+    if (v_next <= 0.0) {
+        return true;
+    }
+    double dist = (v + v_next) * 0.5 * tc->cycle_time;
+    return dist + tpSCurveStopDistance(v_next, acc, vel_final, acc_max, jerk) <= dx;
+}
+
+/**
+ * Compute acceleration for a timestep based on a jerk-limited (S-curve)
+ * motion profile.
+ *
+ * Acceleration may change by at most jerk * cycle time per cycle. Within that
+ * range, take the highest acceleration from which the final velocity can still
+ * be made by the end of the segment, tapered so that acceleration reaches zero
+ * together with the velocity error. Jerk scales with the segment's
+ * acceleration, so parabolic blends and arcs get their share of it like they
+ * do of acceleration.
+ *
+ * The trapezoidal profile over the remaining distance stays a hard upper
+ * bound: where jerk-limited deceleration can't make the final velocity in
+ * time, jerk gives way rather than the segment overshooting.
+ */
+STATIC int tpCalculateSCurveAccel(TP_STRUCT const * const tp,
+        TC_STRUCT * const tc,
+        TC_STRUCT const * const nexttc,
+        double * const acc,
+        double * const vel_desired)
+{
+    double maxaccel = tpGetScaledAccel(tp, tc);
+    double jerk = get_maxJerk(tp->shared);
+    if (jerk <= 0.0 || maxaccel <= 0.0 || tc->maxaccel <= 0.0) {
+        return TP_ERR_FAIL;
+    }
+    jerk *= maxaccel / tc->maxaccel;
+    tc_debug_print("using S-curve acceleration, jerk = %f\n", jerk);
+
+    double dx = tc->target - tc->progress;
+    double v = tc->currentvel;
+    double a0 = tc->currentacc;
+    double dt = rtapi_fmax(tc->cycle_time, TP_TIME_EPSILON);
+    double vel_target = tpGetRealTargetVel(tp, tc);
+    double vel_final = tpGetRealFinalVel(tp, tc, nexttc);
+
+    // Acceleration that closes the velocity error with jerk to spare
+    double acc_goal;
+    if (v < vel_target) {
+        acc_goal = pmSqrt(2.0 * jerk * (vel_target - v));
+    } else {
+        acc_goal = -pmSqrt(2.0 * jerk * (v - vel_target));
+    }
+
+    double acc_lo = rtapi_fmax(a0 - jerk * dt, -maxaccel);
+    double acc_hi = rtapi_fmin(rtapi_fmin(a0 + jerk * dt, maxaccel), acc_goal);
+    acc_hi = rtapi_fmax(acc_hi, acc_lo);
+
+    double acc_cmd;
+    bool braking = false;
+    if (tpSCurveCanStop(tc, acc_hi, dx, vel_final, maxaccel, jerk)) {
+        acc_cmd = acc_hi;
+    } else if (!tpSCurveCanStop(tc, acc_lo, dx, vel_final, maxaccel, jerk)) {
+        acc_cmd = acc_lo;
+        braking = true;
+    } else {
+        // stopping distance grows with acceleration, so bisect
+        int i;
+        for (i = 0; i < TP_SCURVE_ITERATIONS; ++i) {
+            double acc_mid = (acc_lo + acc_hi) * 0.5;
+            if (tpSCurveCanStop(tc, acc_mid, dx, vel_final, maxaccel, jerk)) {
+                acc_lo = acc_mid;
+            } else {
+                acc_hi = acc_mid;
+            }
+        }
+        acc_cmd = acc_lo;
+        braking = true;
+    }
+
+    // Hard bound from the trapezoidal profile for the distance left. The
+    // target velocity isn't part of it, feed changes are eased into.
+    double acc_trap, vel_bound;
+    tpCalculateTrapezoidalAccelOver(tp, tc, nexttc, dx, &acc_trap, &vel_bound);
+    double acc_bound = saturate((vel_bound - v) / dt, maxaccel);
+
+    *acc = rtapi_fmin(acc_cmd, acc_bound);
+    // braking for the end of the segment counts as final deceleration
+    if (braking || acc_bound < acc_cmd) {
+        *vel_desired = v + *acc * dt;
+    } else {
+        *vel_desired = vel_bound;
+    }
+    return TP_ERR_OK;
+}
+
 void tpToggleDIOs(TP_STRUCT const * const tp,
 		  TC_STRUCT * const tc) {
 
@@ -2907,7 +3215,11 @@ STATIC int tpUpdateCycle(TP_STRUCT * const tp,
         res_accel = tpCalculateRampAccel(tp, tc, nexttc, &acc, &vel_desired);
     }
 
-    // Check the return in case the ramp calculation failed, fall back to trapezoidal
+    // Check the return in case the ramp calculation failed, fall back to
+    // S-curve if a jerk limit is set, trapezoidal otherwise
+    if (res_accel != TP_ERR_OK) {
+        res_accel = tpCalculateSCurveAccel(tp, tc, nexttc, &acc, &vel_desired);
+    }
     if (res_accel != TP_ERR_OK) {
         tpCalculateTrapezoidalAccel(tp, tc, nexttc, &acc, &vel_desired);
     }
@@ -3125,6 +3437,8 @@ STATIC int tpHandleSplitCycle(TP_STRUCT * const tp, TC_STRUCT * const tc,
         case TC_TERM_COND_TANGENT:
             nexttc->cycle_time = tp->cycleTime - tc->cycle_time;
             nexttc->currentvel = tc->term_vel;
+            // carry acceleration across so the jerk limit holds at the seam
+            nexttc->currentacc = tc->currentacc;
             tp_debug_print("Doing tangent split\n");
             break;
         case TC_TERM_COND_PARABOLIC:
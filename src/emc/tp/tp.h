@@ -32,6 +32,7 @@ typedef int (*tpSetVmax_t)(TP_STRUCT * tp, double vmax, double ini_maxvel);
 typedef int (*tpSetVlimit_t)(TP_STRUCT * tp, double limit);
 typedef int (*tpSetAmax_t)(TP_STRUCT * tp, double amax);
 typedef int (*tpSetId_t)(TP_STRUCT * tp, int id);
+typedef int (*tpSetPlanVel_t)(TP_STRUCT * tp, double vel);
 typedef int (*tpGetExecId_t)(TP_STRUCT * tp);
 typedef struct state_tag_t (*tpGetExecTag_t)(TP_STRUCT * const tp);
 typedef int (*tpSetTermCond_t)(TP_STRUCT * tp, int cond, double tolerance);
@@ -67,6 +68,17 @@ typedef int (*tpAddCircle_t)(TP_STRUCT * tp,
 			     unsigned char enables,
 			     char atspeed,
 			    struct state_tag_t tag);
+typedef int (*tpAddSpline_t)(TP_STRUCT * tp,
+			     EmcPose end,
+			     PmCartesian ctrl1,
+			     PmCartesian ctrl2,
+			     int type,
+			     double vel,
+			     double ini_maxvel,
+			     double acc,
+			     unsigned char enables,
+			     char atspeed,
+			    struct state_tag_t tag);
 typedef int (*tpRunCycle_t)(TP_STRUCT * tp, long period);
 typedef int (*tpPause_t)(TP_STRUCT * tp);
 typedef int (*tpResume_t)(TP_STRUCT * tp);
@@ -103,6 +115,7 @@ typedef struct {
     tpSetVlimit_t	tpSetVlimit;
     tpSetAmax_t		tpSetAmax;
     tpSetId_t	        tpSetId;
+    tpSetPlanVel_t      tpSetPlanVel;
     tpGetExecId_t	tpGetExecId;
     tpGetExecTag_t      tpGetExecTag;
     tpSetTermCond_t	tpSetTermCond;
@@ -112,6 +125,7 @@ typedef struct {
     tpAddRigidTap_t	tpAddRigidTap;
     tpAddLine_t	        tpAddLine;
     tpAddCircle_t	tpAddCircle;
+    tpAddSpline_t	tpAddSpline;
     tpRunCycle_t	tpRunCycle;
     tpPause_t	        tpPause;
     tpResume_t	        tpResume;
@@ -27,6 +27,7 @@ int tpSetVlimit(TP_STRUCT * tp, double limit);
 int tpSetAmax(TP_STRUCT * tp, double amax);
 
 int tpSetId(TP_STRUCT * tp, int id);
+int tpSetPlanVel(TP_STRUCT * tp, double vel);
 
 int tpGetExecId(TP_STRUCT * tp);
 
@@ -52,6 +53,10 @@ int tpAddCircle(TP_STRUCT * tp, EmcPose end, PmCartesian center,
 		PmCartesian normal, int turn, int type, double vel, double ini_maxvel,
 		double acc, unsigned char enables, char atspeed,struct state_tag_t tag);
 
+int tpAddSpline(TP_STRUCT * tp, EmcPose end, PmCartesian ctrl1,
+		PmCartesian ctrl2, int type, double vel, double ini_maxvel,
+		double acc, unsigned char enables, char atspeed, struct state_tag_t tag);
+
 int tpRunCycle(TP_STRUCT * tp, long period);
 
 int tpPause(TP_STRUCT * tp);
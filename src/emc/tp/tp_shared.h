@@ -30,6 +30,7 @@ typedef struct tp_shared_t {
     hal_bit_t   *arcBlendFallbackEnable;
     hal_float_t *arcBlendTangentKinkRatio;
     hal_float_t *maxFeedScale;
+    hal_float_t *maxJerk;       // 0: trapezoidal velocity profile
     hal_float_t *net_feed_scale;
 
     hal_float_t *acc_limit[3];
@@ -87,6 +88,8 @@ static inline hal_float_t get_net_feed_scale(tp_shared_t *ts)
 { return *(ts->net_feed_scale); }
 static inline hal_float_t get_maxFeedScale(tp_shared_t *ts)
 { return *(ts->maxFeedScale); }
+static inline hal_float_t get_maxJerk(tp_shared_t *ts)
+{ return *(ts->maxJerk); }
 
 static inline hal_bit_t get_stepping(tp_shared_t *ts)
 { return *(ts->stepping); }
@@ -34,6 +34,10 @@
  * the end of the program */
 #define TP_QUEUE_THRESHOLD 3
 
+/* bisection steps when picking an S-curve acceleration, resolution is
+ * 2 * jerk * cycle time / 2^n */
+#define TP_SCURVE_ITERATIONS 8
+
 /* closeness to zero, for determining if a move is pure rotation */
 #define TP_PURE_ROTATION_EPSILON 1e-6
 
@@ -117,6 +121,8 @@ typedef struct {
     double wMax;		/* rotational velocity max */
     double wDotMax;		/* rotational accelleration max */
     int nextId;
+    double nextPlanVel;         /* planned final velocity of the next
+                                   appended motion, negative = none */
     int execId;
     struct state_tag_t execTag; /* state tag corresponding to running motion */
     int termCond;
@@ -5,7 +5,7 @@
 #include "tp.h"
 #include "tp_private.h"
 
-#define VTVERSION  VTTP_VERSION1
+#define VTVERSION  VTTP_VERSION3
 
 MODULE_AUTHOR("Michael Haberler");
 MODULE_DESCRIPTION("machinekit trajectory planner");
@@ -23,6 +23,7 @@ static vtp_t vtp = {
     .tpSetVlimit       = tpSetVlimit,
     .tpSetAmax         = tpSetAmax,
     .tpSetId           = tpSetId,
+    .tpSetPlanVel      = tpSetPlanVel,
     .tpGetExecId       = tpGetExecId,
     .tpGetExecTag      = tpGetExecTag,
     .tpSetTermCond     = tpSetTermCond,
@@ -32,6 +33,7 @@ static vtp_t vtp = {
     .tpAddRigidTap     = tpAddRigidTap,
     .tpAddLine         = tpAddLine,
     .tpAddCircle       = tpAddCircle,
+    .tpAddSpline       = tpAddSpline,
     .tpRunCycle        = tpRunCycle,
     .tpPause           = tpPause,
     .tpResume          = tpResume,
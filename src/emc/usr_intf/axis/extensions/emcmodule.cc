@@ -24,6 +24,7 @@
 #include "rcs.hh"
 #include "emc.hh"
 #include "emc_nml.hh"
+#include "emcstatshm.hh"
 #include "kinematics.h"
 #include "config.h"
 #include "inifile.hh"
@@ -83,6 +84,9 @@ struct pyIniFile {
 struct pyStatChannel {
     PyObject_HEAD
     RCS_STAT_CHANNEL *c;
+    EMC_STAT_SHM *shm;  // NULL if task is remote
+    unsigned gen[EMC_STAT_SHARDS];
+    int changed;        // shards updated by the last poll()
     EMC_STAT status;
 };
 
@@ -261,10 +265,16 @@ static int Stat_init(pyStatChannel *self, PyObject *a, PyObject *k) {
     }
 
     self->c = c;
+    // a local task also publishes status without NML locking
+    self->shm = NULL;
+    memset(self->gen, 0, sizeof(self->gen));
+    if(c->cms && c->cms->ProcessType == CMS_LOCAL_TYPE)
+        self->shm = new EMC_STAT_SHM(false);
     return 0;
 }
 
 static void Stat_dealloc(PyObject *self) {
+    delete ((pyStatChannel*)self)->shm;
     delete ((pyStatChannel*)self)->c;
     PyObject_Del(self);
 }
@@ -278,23 +288,237 @@ static bool check_stat(RCS_STAT_CHANNEL *emcStatusBuffer) {
 }
 
 static PyObject *poll(pyStatChannel *s, PyObject *o) {
+    int changed;
+    if(s->shm && (changed = s->shm->read(&s->status, s->gen)) >= 0) {
+        s->changed = changed;
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    memset(s->gen, 0, sizeof(s->gen));
+    s->changed = 0;
     if(!check_stat(s->c)) return NULL;
     if(s->c->peek() == EMC_STAT_TYPE) {
         EMC_STAT *emcStatus = static_cast<EMC_STAT*>(s->c->get_address());
-        memcpy(&s->status, emcStatus, sizeof(EMC_STAT));
+        s->changed = EMC_STAT_SHM::update(&s->status, emcStatus);
     }
     Py_INCREF(Py_None);
     return Py_None;
 }
 
+/* Typed views of status fields, for GUIs which poll often.
+ *
+ * stat.view(name) returns a read-only memoryview straight over the
+ * status copy of the stat object, so no Python objects are built per
+ * item - numpy.asarray() or struct.unpack_from() read it in one go.
+ * Per-axis and per-pocket fields are exported as strided arrays over
+ * the axis and tool table structs. A view stays valid as long as it
+ * is referenced; it reflects the status as of the latest poll().
+ *
+ * Each view belongs to one of the shards of EMC_STAT_SHM. After a
+ * poll(), stat.changed has a bit STAT_TASK, STAT_TRAJ, STAT_MOTION or
+ * STAT_IO set for each shard which changed, and stat.views() maps view
+ * names to their shard bit - a GUI can skip every view whose bit is
+ * clear.
+ */
+struct stat_view_def {
+    const char *name;
+    Py_ssize_t offset;          // of the first item within EMC_STAT
+    const char *format;
+    Py_ssize_t itemsize;
+    int ndim;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+    int shard;                  // filled in by init_stat_views()
+};
+
+#define SV(x) offsetof(EMC_STAT, x)
+#define POSE(name, x) \
+    {name, SV(x), "d", sizeof(double), 1, {9}, {sizeof(double)}}
+#define ARRAY(name, x, fmt, type, n) \
+    {name, SV(x), fmt, sizeof(type), 1, {n}, {sizeof(type)}}
+#define AXIS(name, x, fmt, type) \
+    {name, SV(motion.axis[0].x), fmt, sizeof(type), 1, \
+        {EMC_AXIS_MAX}, {sizeof(EMC_AXIS_STAT)}}
+#define POCKET(name, x, fmt, type) \
+    {name, SV(io.tool.toolTable[0].x), fmt, sizeof(type), 1, \
+        {CANON_POCKETS_MAX}, {sizeof(CANON_TOOL_TABLE)}}
+static stat_view_def stat_views[] = {
+    POSE("position", motion.traj.position),
+    POSE("actual_position", motion.traj.actualPosition),
+    POSE("dtg", motion.traj.dtg),
+    POSE("probed_position", motion.traj.probedPosition),
+    POSE("g5x_offset", task.g5x_offset),
+    POSE("g92_offset", task.g92_offset),
+    POSE("tool_offset", task.toolOffset),
+    ARRAY("gcodes", task.activeGCodes, "i", int, ACTIVE_G_CODES),
+    ARRAY("mcodes", task.activeMCodes, "i", int, ACTIVE_M_CODES),
+    ARRAY("settings", task.activeSettings, "d", double, ACTIVE_SETTINGS),
+    ARRAY("din", motion.synch_di, "i", int, EMC_MAX_DIO),
+    ARRAY("dout", motion.synch_do, "i", int, EMC_MAX_DIO),
+    ARRAY("ain", motion.analog_input, "d", double, EMC_MAX_AIO),
+    ARRAY("aout", motion.analog_output, "d", double, EMC_MAX_AIO),
+    AXIS("joint_position", output, "d", double),
+    AXIS("joint_actual_position", input, "d", double),
+    AXIS("joint_velocity", velocity, "d", double),
+    AXIS("ferror_current", ferrorCurrent, "d", double),
+    AXIS("homed", homed, "B", unsigned char),
+    AXIS("homing", homing, "B", unsigned char),
+    AXIS("inpos", inpos, "B", unsigned char),
+    AXIS("enabled", enabled, "B", unsigned char),
+    AXIS("fault", fault, "B", unsigned char),
+    POCKET("tool_id", toolno, "i", int),
+    POCKET("tool_diameter", diameter, "d", double),
+    // pockets x (x y z a b c u v w)
+    {"tool_offsets", SV(io.tool.toolTable[0].offset), "d", sizeof(double), 2,
+        {CANON_POCKETS_MAX, 9}, {sizeof(CANON_TOOL_TABLE), sizeof(double)}},
+    {NULL}
+};
+#undef SV
+#undef POSE
+#undef ARRAY
+#undef AXIS
+#undef POCKET
+
+static void init_stat_views(void) {
+    EMC_STAT *st = new EMC_STAT;
+    size_t offset[EMC_STAT_SHARDS + 1];
+    EMC_STAT_SHM::shard_offsets(st, offset);
+    delete st;
+
+    for(stat_view_def *d = stat_views; d->name; d++) {
+        d->shard = 0;
+        for(int i = 0; i < EMC_STAT_SHARDS; i++)
+            if((size_t)d->offset >= offset[i] &&
+                    (size_t)d->offset < offset[i + 1])
+                d->shard = 1 << i;
+    }
+}
+
+struct pyStatView {
+    PyObject_HEAD
+    pyStatChannel *stat;    // owns the memory
+    stat_view_def *def;
+};
+
+static void StatView_dealloc(PyObject *self) {
+    Py_XDECREF(((pyStatView*)self)->stat);
+    PyObject_Del(self);
+}
+
+static int StatView_getbuffer(PyObject *_self, Py_buffer *view, int flags) {
+    pyStatView *self = (pyStatView*)_self;
+    stat_view_def *d = self->def;
+
+    view->obj = NULL;
+    if(flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "stat views are read-only");
+        return -1;
+    }
+    bool contiguous = d->ndim == 1 && d->strides[0] == d->itemsize;
+    if(!contiguous && (flags & PyBUF_STRIDES) != PyBUF_STRIDES) {
+        PyErr_Format(PyExc_BufferError, "stat view %s is strided", d->name);
+        return -1;
+    }
+
+    view->buf = (char*)&self->stat->status + d->offset;
+    view->len = d->itemsize;
+    for(int i = 0; i < d->ndim; i++) view->len *= d->shape[i];
+    view->readonly = 1;
+    view->itemsize = d->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? (char*)d->format : NULL;
+    view->ndim = d->ndim;
+    view->shape = (flags & PyBUF_ND) ? d->shape : NULL;
+    view->strides =
+        (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? d->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    view->obj = _self;
+    Py_INCREF(_self);
+    return 0;
+}
+
+static PyBufferProcs StatView_as_buffer = {
+    0,                      /*bf_getreadbuffer*/
+    0,                      /*bf_getwritebuffer*/
+    0,                      /*bf_getsegcount*/
+    0,                      /*bf_getcharbuffer*/
+    StatView_getbuffer,     /*bf_getbuffer*/
+    0,                      /*bf_releasebuffer*/
+};
+
+static PyTypeObject StatView_Type = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "linuxcnc.statview",    /*tp_name*/
+    sizeof(pyStatView),     /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)StatView_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    0,                      /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    &StatView_as_buffer,    /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /*tp_flags*/
+    0,                      /*tp_doc*/
+};
+
+static PyObject *Stat_view(pyStatChannel *s, PyObject *o) {
+    char *name;
+    if(!PyArg_ParseTuple(o, "s", &name)) return NULL;
+
+    for(stat_view_def *d = stat_views; d->name; d++) {
+        if(strcmp(d->name, name)) continue;
+        pyStatView *v = PyObject_New(pyStatView, &StatView_Type);
+        if(!v) return NULL;
+        Py_INCREF(s);
+        v->stat = s;
+        v->def = d;
+        PyObject *res = PyMemoryView_FromObject((PyObject*)v);
+        Py_DECREF(v);
+        return res;
+    }
+    PyErr_Format(PyExc_KeyError, "no stat view named '%s'", name);
+    return NULL;
+}
+
+static PyObject *Stat_views(pyStatChannel *s, PyObject *o) {
+    PyObject *res = PyDict_New();
+    if(!res) return NULL;
+    for(stat_view_def *d = stat_views; d->name; d++) {
+        PyObject *shard = PyInt_FromLong(d->shard);
+        if(!shard || PyDict_SetItemString(res, d->name, shard) < 0) {
+            Py_XDECREF(shard);
+            Py_DECREF(res);
+            return NULL;
+        }
+        Py_DECREF(shard);
+    }
+    return res;
+}
+
 static PyMethodDef Stat_methods[] = {
     {"poll", (PyCFunction)poll, METH_NOARGS, "Update current machine state"},
+    {"view", (PyCFunction)Stat_view, METH_VARARGS,
+        "Return a read-only memoryview of a status field"},
+    {"views", (PyCFunction)Stat_views, METH_NOARGS,
+        "Return a dict of view names and their STAT_* change bit"},
     {NULL}
 };
 
 #define O(x) offsetof(pyStatChannel,status.x)
 static PyMemberDef Stat_members[] = {
 // stat 
+    {(char*)"changed", T_INT, offsetof(pyStatChannel, changed), READONLY},
     {(char*)"echo_serial_number", T_INT, O(echo_serial_number), READONLY},
     {(char*)"state", T_INT, O(status), READONLY},
 
@@ -2206,6 +2430,8 @@ initlinuxcnc(void) {
     m = Py_InitModule3("linuxcnc", emc_methods, "Interface to LinuxCNC");
 
     PyType_Ready(&Stat_Type);
+    PyType_Ready(&StatView_Type);
+    init_stat_views();
     PyType_Ready(&Command_Type);
     PyType_Ready(&Error_Type);
     PyType_Ready(&Ini_Type);
@@ -2232,6 +2458,11 @@ initlinuxcnc(void) {
     PyModule_AddIntConstant(m, "NML_TEXT", NML_TEXT_TYPE);
     PyModule_AddIntConstant(m, "NML_DISPLAY", NML_DISPLAY_TYPE);
 
+    PyModule_AddIntConstant(m, "STAT_TASK", 1 << EMC_STAT_SHARD_TASK);
+    PyModule_AddIntConstant(m, "STAT_TRAJ", 1 << EMC_STAT_SHARD_TRAJ);
+    PyModule_AddIntConstant(m, "STAT_MOTION", 1 << EMC_STAT_SHARD_MOTION);
+    PyModule_AddIntConstant(m, "STAT_IO", 1 << EMC_STAT_SHARD_IO);
+
     PyStructSequence_InitType(&ToolResultType, &tool_result_desc);
     PyModule_AddObject(m, "tool", (PyObject*)&ToolResultType);
     PyModule_AddObject(m, "version", PyString_FromString(PACKAGE_VERSION));
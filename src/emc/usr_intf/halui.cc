@@ -28,6 +28,7 @@
 #include "posemath.h"		// PM_POSE, TO_RAD
 #include "emc.hh"		// EMC NML
 #include "emc_nml.hh"
+#include "emcstatshm.hh"	// EMC_STAT_SHM
 #include "emcglb.h"		// EMC_NMLFILE, TRAJ_MAX_VELOCITY, etc.
 #include "emccfg.h"		// DEFAULT_TRAJ_MAX_VELOCITY
 #include "inifile.hh"		// INIFILE
@@ -403,6 +404,9 @@ static int halui_sent_mdi = 0;
 static RCS_CMD_CHANNEL *emcCommandBuffer = 0;
 static RCS_STAT_CHANNEL *emcStatusBuffer = 0;
 EMC_STAT *emcStatus = 0;
+// status published by a local task without NML locking
+static EMC_STAT_SHM *emcStatusShm = 0;
+static unsigned emcStatusGen[EMC_STAT_SHARDS];
 
 // the NML channel for errors
 static NML *emcErrorBuffer = 0;
@@ -448,6 +452,8 @@ static int emcTaskNmlGet()
 	    retval = -1;
 	} else {
 	    emcStatus = (EMC_STAT *) emcStatusBuffer->get_address();
+	    if (emcStatusBuffer->cms->ProcessType == CMS_LOCAL_TYPE)
+		emcStatusShm = new EMC_STAT_SHM(false);
 	}
     }
 
@@ -537,6 +543,12 @@ static int updateStatus()
 	return -1;
     }
 
+    // copies into the NML buffer's local copy, emcStatus
+    if (emcStatusShm && emcStatusShm->read(emcStatus, emcStatusGen) >= 0) {
+	return 0;
+    }
+    memset(emcStatusGen, 0, sizeof(emcStatusGen));
+
     switch (type = emcStatusBuffer->peek()) {
     case -1:
 	// error on CMS channel
@@ -615,6 +627,7 @@ static void thisQuit()
     hal_exit(comp_id);
     
     if(emcCommandBuffer) { delete emcCommandBuffer;  emcCommandBuffer = 0; }
+    if(emcStatusShm) { delete emcStatusShm;  emcStatusShm = 0; }
     if(emcStatusBuffer) { delete emcStatusBuffer;  emcStatusBuffer = 0; }
     if(emcErrorBuffer) { delete emcErrorBuffer;  emcErrorBuffer = 0; }
     exit(0);
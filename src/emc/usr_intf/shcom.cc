@@ -27,6 +27,7 @@
 #include "posemath.h"		// PM_POSE, TO_RAD
 #include "emc.hh"		// EMC NML
 #include "emc_nml.hh"
+#include "emcstatshm.hh"	// EMC_STAT_SHM
 #include "canon.hh"		// CANON_UNITS, CANON_UNITS_INCHES,MM,CM
 #include "emcglb.h"		// EMC_NMLFILE, TRAJ_MAX_VELOCITY, etc.
 #include "emccfg.h"		// DEFAULT_TRAJ_MAX_VELOCITY
@@ -46,6 +47,9 @@ int saveEmcCommandSerialNumber;
 RCS_CMD_CHANNEL *emcCommandBuffer;
 RCS_STAT_CHANNEL *emcStatusBuffer;
 EMC_STAT *emcStatus;
+// status published by a local task without NML locking
+static EMC_STAT_SHM *emcStatusShm;
+static unsigned emcStatusGen[EMC_STAT_SHARDS];
 
 // the NML channel for errors
 NML *emcErrorBuffer;
@@ -97,6 +101,8 @@ int emcTaskNmlGet()
 	    retval = -1;
 	} else {
 	    emcStatus = (EMC_STAT *) emcStatusBuffer->get_address();
+	    if (emcStatusBuffer->cms->ProcessType == CMS_LOCAL_TYPE)
+		emcStatusShm = new EMC_STAT_SHM(false);
 	}
     }
 
@@ -181,6 +187,12 @@ int updateStatus()
 	return -1;
     }
 
+    // copies into the NML buffer's local copy, emcStatus
+    if (emcStatusShm && emcStatusShm->read(emcStatus, emcStatusGen) >= 0) {
+	return 0;
+    }
+    memset(emcStatusGen, 0, sizeof(emcStatusGen));
+
     switch (type = emcStatusBuffer->peek()) {
     case -1:
 	// error on CMS channel
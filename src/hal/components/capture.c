@@ -0,0 +1,509 @@
+/********************************************************************
+* Description:  capture.c
+*               Headless triggered capture of HAL pins, to catch rare
+*               faults unattended.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+/** Each instance is a capture session, with its own channels, trigger
+    conditions and shared memory: the layout is in hal_capture.h.
+    Sessions are independent of each other and of halscope.
+
+    Usage:
+
+    loadrt capture
+    newinst capture <name> channels=<types> [depth=N] [slots=N] [triggers=N]
+
+    'channels' gives the type of each channel pin, like the sampler's
+    cfg string: f(loat), b(it), s(32) or u(32). 'depth' is the number
+    of records per capture (default 16000), 'slots' the number of
+    finished captures which can wait for a reader (default 2), and
+    'triggers' the number of trigger conditions (default 4).
+
+    pins:
+      <name>.pin.N		IN	channel N
+      <name>.enable		IN	capture while true (default)
+      <name>.force		IO	fire the trigger, cleared when done
+      <name>.state		OUT	see enum capture_state
+      <name>.captures		OUT	number of captures finished
+      <name>.full		OUT	all slots wait for the reader
+
+    params:
+      <name>.pre-trigger	RW	records kept before the trigger
+      <name>.mult		RW	record every mult'th thread cycle
+      <name>.trig-all		RW	0: any condition fires, 1: all must
+      <name>.trig-overrun	RW	fire when the thread overran
+      <name>.overrun-pct	RW	... or started this much late
+      <name>.trig.K.channel	RW	channel tested, -1: condition unused
+      <name>.trig.K.mode	RW	see enum capture_mode
+      <name>.trig.K.level	RW
+      <name>.trig.K.high	RW	upper bound for inside/outside
+
+    The function <name>.sample records one record per call, and is
+    added to the thread which runs the code under test.  Finished
+    captures are read with halcapture, or streamed by haltalk.
+*/
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "rtapi_app.h"		/* RTAPI realtime module decls */
+#include "rtapi_atomics.h"
+#include "rtapi_string.h"
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"
+#include "hal_capture.h"
+
+MODULE_AUTHOR("Machinekit");
+MODULE_DESCRIPTION("Headless triggered capture of HAL pins");
+MODULE_LICENSE("GPL");
+RTAPI_TAG(HAL, HC_INSTANTIABLE);
+
+static char *channels = "";
+RTAPI_IP_STRING(channels, "channel types, one of f, b, s or u per channel");
+
+static int depth = 16000;
+RTAPI_IP_INT(depth, "records per capture");
+
+static int slots = 2;
+RTAPI_IP_INT(slots, "finished captures which can wait for a reader");
+
+static int triggers = 4;
+RTAPI_IP_INT(triggers, "number of trigger conditions");
+
+/***********************************************************************
+*                STRUCTURES AND GLOBAL VARIABLES                       *
+************************************************************************/
+
+typedef union {
+    hal_bit_t *b;
+    hal_float_t *f;
+    hal_u32_t *u;
+    hal_s32_t *s;
+} chan_ptr_t;
+
+typedef struct {
+    hal_s32_t channel;		/* param: channel tested, -1: unused */
+    hal_u32_t mode;		/* param: enum capture_mode */
+    hal_float_t level;		/* param */
+    hal_float_t high;		/* param */
+    int above;			/* value > level at the last record */
+} cond_t;
+
+typedef struct {
+    int shm_id;
+    capture_shm_t *shm;
+    int n_chan, n_trig;
+
+    hal_bit_t *enable;		/* pin */
+    hal_bit_t *force;		/* pin */
+    hal_s32_t *state;		/* pin */
+    hal_u32_t *captures;	/* pin */
+    hal_bit_t *full;		/* pin */
+
+    hal_s32_t pre_trigger;	/* param */
+    hal_s32_t mult;		/* param */
+    hal_bit_t trig_all;		/* param */
+    hal_bit_t trig_overrun;	/* param */
+    hal_s32_t overrun_pct;	/* param */
+    cond_t cond[CAPTURE_MAX_TRIGGERS];
+
+    /* capture in progress */
+    hal_data_u *ring;		/* of the slot being filled */
+    int pos;			/* ring index of the next record */
+    int filled;			/* records before pos, up to depth */
+    int pre;			/* records kept before the trigger */
+    int post;			/* records still to take after it */
+    int start;
+    int count;
+    int first;			/* no edges on the first record */
+    int mult_cntr;
+    int overran;		/* latched between records */
+    hal_u32_t fired;
+    long long timestamp;
+
+    /* copy plan: the channels sorted by width, floats first, then
+       32 bit integers, then bits */
+    int n_float, n_word, n_bit;
+    unsigned char plan[CAPTURE_MAX_CHANNELS];
+    chan_ptr_t chan[CAPTURE_MAX_CHANNELS];
+} capture_t;
+
+static int comp_id;
+static const char *compname = "capture";
+
+/***********************************************************************
+*                  LOCAL FUNCTION DECLARATIONS                         *
+************************************************************************/
+
+static int instantiate(const int argc, const char **argv);
+static int delete(const char *name, void *inst, const int inst_size);
+static int sample(void *arg, const hal_funct_args_t *fa);
+
+/***********************************************************************
+*                       INIT AND EXIT CODE                             *
+************************************************************************/
+
+int rtapi_app_main(void)
+{
+    comp_id = hal_xinit(TYPE_RT, 0, 0, instantiate, delete, compname);
+    if (comp_id < 0)
+	return comp_id;
+    hal_ready(comp_id);
+    return 0;
+}
+
+void rtapi_app_exit(void)
+{
+    hal_exit(comp_id);
+}
+
+static int parse_types(hal_type_t *type, const char *cfg)
+{
+    int n = 0;
+
+    for (; *cfg; cfg++) {
+	if (n == CAPTURE_MAX_CHANNELS)
+	    HALFAIL_RC(EINVAL, "more than %d channels", CAPTURE_MAX_CHANNELS);
+	switch (*cfg) {
+	case 'f':
+	case 'F':
+	    type[n++] = HAL_FLOAT;
+	    break;
+	case 'b':
+	case 'B':
+	    type[n++] = HAL_BIT;
+	    break;
+	case 's':
+	case 'S':
+	    type[n++] = HAL_S32;
+	    break;
+	case 'u':
+	case 'U':
+	    type[n++] = HAL_U32;
+	    break;
+	default:
+	    HALFAIL_RC(EINVAL, "unknown channel type '%c', must be f, b, s or u",
+		       *cfg);
+	}
+    }
+    if (n == 0)
+	HALFAIL_RC(EINVAL, "no channels given, use channels=<types>");
+    return n;
+}
+
+static int export_capture(capture_t *cp, const int inst_id, const char *name,
+			  const hal_type_t *type)
+{
+    int n, retval;
+
+    for (n = 0; n < cp->n_chan; n++) {
+	retval = hal_pin_newf(type[n], HAL_IN, (void **) &cp->chan[n],
+			      inst_id, "%s.pin.%d", name, n);
+	if (retval)
+	    return retval;
+    }
+    if ((retval = hal_pin_bit_newf(HAL_IN, &cp->enable, inst_id,
+				   "%s.enable", name)) ||
+	(retval = hal_pin_bit_newf(HAL_IO, &cp->force, inst_id,
+				   "%s.force", name)) ||
+	(retval = hal_pin_s32_newf(HAL_OUT, &cp->state, inst_id,
+				   "%s.state", name)) ||
+	(retval = hal_pin_u32_newf(HAL_OUT, &cp->captures, inst_id,
+				   "%s.captures", name)) ||
+	(retval = hal_pin_bit_newf(HAL_OUT, &cp->full, inst_id,
+				   "%s.full", name)))
+	return retval;
+    *(cp->enable) = 1;
+
+    if ((retval = hal_param_s32_newf(HAL_RW, &cp->pre_trigger, inst_id,
+				     "%s.pre-trigger", name)) ||
+	(retval = hal_param_s32_newf(HAL_RW, &cp->mult, inst_id,
+				     "%s.mult", name)) ||
+	(retval = hal_param_bit_newf(HAL_RW, &cp->trig_all, inst_id,
+				     "%s.trig-all", name)) ||
+	(retval = hal_param_bit_newf(HAL_RW, &cp->trig_overrun, inst_id,
+				     "%s.trig-overrun", name)) ||
+	(retval = hal_param_s32_newf(HAL_RW, &cp->overrun_pct, inst_id,
+				     "%s.overrun-pct", name)))
+	return retval;
+    cp->pre_trigger = depth / 2;
+    cp->mult = 1;
+    cp->overrun_pct = 50;
+
+    for (n = 0; n < cp->n_trig; n++) {
+	cond_t *c = &cp->cond[n];
+	if ((retval = hal_param_s32_newf(HAL_RW, &c->channel, inst_id,
+					 "%s.trig.%d.channel", name, n)) ||
+	    (retval = hal_param_u32_newf(HAL_RW, &c->mode, inst_id,
+					 "%s.trig.%d.mode", name, n)) ||
+	    (retval = hal_param_float_newf(HAL_RW, &c->level, inst_id,
+					   "%s.trig.%d.level", name, n)) ||
+	    (retval = hal_param_float_newf(HAL_RW, &c->high, inst_id,
+					   "%s.trig.%d.high", name, n)))
+	    return retval;
+	c->channel = -1;
+    }
+
+    /* the copy plan */
+    for (n = 0; n < cp->n_chan; n++)
+	if (type[n] == HAL_FLOAT)
+	    cp->plan[cp->n_float++] = n;
+    for (n = 0; n < cp->n_chan; n++)
+	if ((type[n] == HAL_S32) || (type[n] == HAL_U32))
+	    cp->plan[cp->n_float + cp->n_word++] = n;
+    for (n = 0; n < cp->n_chan; n++)
+	if (type[n] == HAL_BIT)
+	    cp->plan[cp->n_float + cp->n_word + cp->n_bit++] = n;
+
+    hal_export_xfunct_args_t xfunct_args = {
+	.type = FS_XTHREADFUNC,
+	.funct.x = sample,
+	.arg = cp,
+	.uses_fp = 1,
+	.reentrant = 0,
+	.owner_id = inst_id
+    };
+    return hal_export_xfunctf(&xfunct_args, "%s.sample", name);
+}
+
+static int instantiate(const int argc, const char **argv)
+{
+    const char *name = argv[1];
+    hal_type_t type[CAPTURE_MAX_CHANNELS];
+    capture_t *cp;
+    void *shm_ptr;
+    unsigned long size;
+    int n, n_chan, inst_id, retval;
+
+    if ((n_chan = parse_types(type, channels)) < 0)
+	return n_chan;
+    if ((depth < 2) || (slots < 1) ||
+	(triggers < 0) || (triggers > CAPTURE_MAX_TRIGGERS))
+	HALFAIL_RC(EINVAL, "%s: need depth >= 2, slots >= 1, "
+		   "0 <= triggers <= %d", name, CAPTURE_MAX_TRIGGERS);
+
+    inst_id = hal_inst_create(name, comp_id, sizeof(capture_t), (void **) &cp);
+    if (inst_id < 0)
+	return inst_id;
+    cp->n_chan = n_chan;
+    cp->n_trig = triggers;
+
+    /* the session's shm segment, found by readers through inst_id */
+    size = capture_shm_size(n_chan, depth, slots);
+    cp->shm_id = rtapi_shmem_new(CAPTURE_KEY(inst_id), comp_id, size);
+    if (cp->shm_id < 0)
+	HALFAIL_RC(ENOMEM, "%s: can't allocate %lu bytes of shared memory",
+		   name, size);
+    retval = rtapi_shmem_getptr(cp->shm_id, &shm_ptr, 0);
+    if (retval < 0) {
+	rtapi_shmem_delete(cp->shm_id, comp_id);
+	HALFAIL_RC(ENOMEM, "%s: can't map shared memory", name);
+    }
+    cp->shm = shm_ptr;
+    cp->shm->n_chan = n_chan;
+    cp->shm->depth = depth;
+    cp->shm->n_slots = slots;
+    for (n = 0; n < n_chan; n++)
+	cp->shm->type[n] = type[n];
+    cp->shm->produced = cp->shm->consumed = 0;
+
+    if ((retval = export_capture(cp, inst_id, name, type)) != 0) {
+	rtapi_shmem_delete(cp->shm_id, comp_id);
+	HALFAIL_RC(-retval, "%s: export failed", name);
+    }
+    /* ready for readers */
+    rtapi_smp_wmb();
+    cp->shm->magic = CAPTURE_MAGIC;
+    return 0;
+}
+
+static int delete(const char *name, void *inst, const int inst_size)
+{
+    capture_t *cp = inst;
+
+    cp->shm->magic = 0;
+    rtapi_shmem_delete(cp->shm_id, comp_id);
+    return 0;
+}
+
+/***********************************************************************
+*                         REALTIME FUNCTIONS                           *
+************************************************************************/
+
+static double value_of(const hal_u32_t type, const hal_data_u *v)
+{
+    switch (type) {
+    case HAL_FLOAT:
+	return get_float_value(v);
+    case HAL_BIT:
+	return get_bit_value(v);
+    case HAL_S32:
+	return get_s32_value(v);
+    case HAL_U32:
+	return get_u32_value(v);
+    default:
+	return 0.0;
+    }
+}
+
+/* the thread overran: the last cycle ran longer than the period,
+   or this one started more than overrun-pct of a period late */
+static int thread_overran(const capture_t *cp, const hal_funct_args_t *fa)
+{
+    long long period = fa_period(fa);
+
+    if ((period <= 0) || (fa->thread == NULL))
+	return 0;
+    return (get_s32_pin(fa->thread->runtime) > period) ||
+	(fa_current_period(fa) > period + period * cp->overrun_pct / 100);
+}
+
+/* which trigger conditions fire on record rec */
+static hal_u32_t check_trigger(capture_t *cp, const hal_data_u *rec)
+{
+    capture_shm_t *shm = cp->shm;
+    hal_u32_t fired = 0, used = 0;
+    int k;
+
+    for (k = 0; k < cp->n_trig; k++) {
+	cond_t *c = &cp->cond[k];
+	double v;
+	int above, hit;
+
+	if ((c->channel < 0) || (c->channel >= cp->n_chan))
+	    continue;
+	v = value_of(shm->type[c->channel], &rec[c->channel]);
+	above = v > c->level;
+	switch (c->mode) {
+	case CAPTURE_RISING:
+	    hit = !cp->first && above && !c->above;
+	    break;
+	case CAPTURE_FALLING:
+	    hit = !cp->first && !above && c->above;
+	    break;
+	case CAPTURE_ABOVE:
+	    hit = above;
+	    break;
+	case CAPTURE_BELOW:
+	    hit = v < c->level;
+	    break;
+	case CAPTURE_INSIDE:
+	    hit = (v >= c->level) && (v <= c->high);
+	    break;
+	case CAPTURE_OUTSIDE:
+	    hit = (v < c->level) || (v > c->high);
+	    break;
+	default:
+	    hit = 0;
+	}
+	c->above = above;
+	used |= 1U << k;
+	if (hit)
+	    fired |= 1U << k;
+    }
+    cp->first = 0;
+    if (cp->trig_all && (fired != used))
+	fired = 0;
+    if (cp->trig_overrun && cp->overran)
+	fired |= CAPTURE_FIRED_OVERRUN;
+    if (*(cp->force))
+	fired |= CAPTURE_FIRED_FORCED;
+    return fired;
+}
+
+static void finish_capture(capture_t *cp, const hal_funct_args_t *fa)
+{
+    capture_shm_t *shm = cp->shm;
+    hal_u32_t produced = shm->produced;
+    capture_slot_t *slot = &shm->slot[produced % shm->n_slots];
+
+    slot->seq = produced + 1;
+    slot->trigger = cp->fired;
+    slot->start = cp->start;
+    slot->pre = cp->pre;
+    slot->count = cp->count;
+    slot->period = fa_period(fa) * cp->mult;
+    slot->timestamp = cp->timestamp;
+    /* publish the slot once complete */
+    rtapi_smp_wmb();
+    rtapi_store_u32(&shm->produced, produced + 1);
+    *(cp->captures) = produced + 1;
+    *(cp->force) = 0;
+    *(cp->state) = CAPTURE_IDLE;
+}
+
+static int sample(void *arg, const hal_funct_args_t *fa)
+{
+    capture_t *cp = arg;
+    capture_shm_t *shm = cp->shm;
+    hal_data_u *rec;
+    unsigned char *plan;
+    int n;
+
+    if (cp->trig_overrun && thread_overran(cp, fa))
+	cp->overran = 1;
+    if (!*(cp->enable)) {
+	/* disabling drops a capture in progress */
+	*(cp->state) = CAPTURE_IDLE;
+	return 0;
+    }
+    if (++cp->mult_cntr < cp->mult)
+	return 0;
+    cp->mult_cntr = 0;
+
+    if (*(cp->state) == CAPTURE_IDLE) {
+	hal_u32_t produced = shm->produced;
+
+	if (produced - rtapi_load_u32(&shm->consumed) >= shm->n_slots) {
+	    /* every slot waits for the reader */
+	    *(cp->full) = 1;
+	    return 0;
+	}
+	*(cp->full) = 0;
+	cp->ring = capture_ring(shm, produced % shm->n_slots);
+	cp->pos = cp->filled = 0;
+	cp->pre = cp->pre_trigger;
+	if (cp->pre < 0)
+	    cp->pre = 0;
+	if (cp->pre > shm->depth - 1)
+	    cp->pre = shm->depth - 1;
+	cp->first = 1;
+	cp->overran = 0;
+	*(cp->state) = CAPTURE_WAIT;
+    }
+
+    /* take the record, one loop per width */
+    rec = cp->ring + cp->pos * cp->n_chan;
+    plan = cp->plan;
+    for (n = 0; n < cp->n_float; n++, plan++)
+	set_float_value(&rec[*plan], *(cp->chan[*plan].f));
+    for (n = 0; n < cp->n_word; n++, plan++)
+	set_u32_value(&rec[*plan], *(cp->chan[*plan].u));
+    for (n = 0; n < cp->n_bit; n++, plan++)
+	set_bit_value(&rec[*plan], *(cp->chan[*plan].b) != 0);
+
+    if (*(cp->state) == CAPTURE_WAIT) {
+	cp->fired = check_trigger(cp, rec);
+	cp->overran = 0;
+	if (cp->fired) {
+	    /* keep up to pre records before this one */
+	    if (cp->pre > cp->filled)
+		cp->pre = cp->filled;
+	    cp->start = (cp->pos + shm->depth - cp->pre) % shm->depth;
+	    cp->count = cp->pre + 1;
+	    cp->post = shm->depth - 1 - cp->pre;
+	    cp->timestamp = fa_start_time(fa);
+	    *(cp->state) = CAPTURE_POST;
+	} else if (cp->filled < shm->depth) {
+	    cp->filled++;
+	}
+    } else {
+	cp->count++;
+	cp->post--;
+    }
+    cp->pos = (cp->pos + 1) % shm->depth;
+    if ((*(cp->state) == CAPTURE_POST) && (cp->post <= 0))
+	finish_capture(cp, fa);
+    return 0;
+}
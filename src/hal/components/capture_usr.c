@@ -0,0 +1,208 @@
+/********************************************************************
+* Description:  capture_usr.c
+*               Reader for the sessions of the "capture" component.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+/** halcapture waits for the captures of a capture session to finish,
+    prints them as text to stdout, and releases their slots so the
+    session can capture again.
+
+    Invoking:
+
+    halcapture [-n num_captures] [-N compname] session
+
+    'session' is the name of the capture instance.
+
+    'num_captures', if present, is the number of captures printed,
+    after which the program exits.  If omitted it runs until killed.
+
+    Each capture starts with a line
+
+    capture <seq> trigger <hex> pre <pre> count <count> period <nsec>
+
+    followed by a line with the name of each channel, and one line per
+    record: the record number relative to the trigger record, and the
+    value of each channel.
+
+    There is one reader per session: halcapture and a haltalk which
+    publishes the session can't run at the same time.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"
+#include "hal_capture.h"
+
+/***********************************************************************
+*                         GLOBAL VARIABLES                             *
+************************************************************************/
+
+int comp_id = -1;	/* -1 means hal_init() not called yet */
+int shmem_id = -1;
+int exitval = 1;	/* program return code - 1 means error */
+int ignore_sig = 0;	/* used to flag critical regions */
+volatile sig_atomic_t stop = 0;
+char comp_name[HAL_NAME_LEN+1];
+
+/***********************************************************************
+*                            MAIN PROGRAM                              *
+************************************************************************/
+
+/* signal handler */
+static void quit(int sig)
+{
+    if ( ignore_sig ) {
+	return;
+    }
+    if ( shmem_id >= 0 ) {
+	/* let the main loop release the slot it is printing */
+	stop = 1;
+	return;
+    }
+    if ( comp_id >= 0 ) {
+	hal_exit(comp_id);
+    }
+    exit(exitval);
+}
+
+static void print_value(const hal_u32_t type, const hal_data_u *v)
+{
+    switch ( type ) {
+    case HAL_FLOAT:
+	printf("%f ", get_float_value(v));
+	break;
+    case HAL_BIT:
+	printf("%d ", get_bit_value(v) ? 1 : 0);
+	break;
+    case HAL_U32:
+	printf("%u ", (unsigned int) get_u32_value(v));
+	break;
+    case HAL_S32:
+	printf("%d ", (int) get_s32_value(v));
+	break;
+    default:
+	printf("? ");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int c, n, i, captures = -1;
+    char *name = NULL, *session;
+    char chan_name[HAL_NAME_LEN+1];
+    capture_shm_t *shm;
+    capture_slot_t *slot;
+    struct timespec delay;
+
+    while ((c = getopt(argc, argv, "n:N:")) != -1) {
+	switch(c) {
+	case 'n':
+	    captures = atoi(optarg);
+	    if ( captures < 0 ) {
+		fprintf(stderr, "ERROR: invalid number of captures: %s\n",
+			optarg);
+		exit(1);
+	    }
+	    break;
+	case 'N':
+	    name = optarg;
+	    break;
+	default:
+	    fprintf(stderr,
+		    "usage: halcapture [-n num_captures] [-N compname] session\n");
+	    exit(1);
+	}
+    }
+    if ( optind != argc-1 ) {
+	fprintf(stderr, "ERROR: name exactly one capture session\n");
+	exit(1);
+    }
+    session = argv[optind];
+
+    /* register signal handlers - if the process is killed
+       we need to call hal_exit() to free the shared memory */
+    signal(SIGINT, quit);
+    signal(SIGTERM, quit);
+    signal(SIGPIPE, quit);
+    if (name == NULL) {
+	snprintf(comp_name, sizeof(comp_name), "halcapture%d", getpid());
+	name = comp_name;
+    }
+    /* connect to the HAL */
+    ignore_sig = 1;
+    comp_id = hal_init(name);
+    ignore_sig = 0;
+    if (comp_id < 0) {
+	fprintf(stderr, "ERROR: hal_init() failed: %d\n", comp_id );
+	goto out;
+    }
+    hal_ready(comp_id);
+
+    ignore_sig = 1;
+    shm = halg_capture_attach(1, session, comp_id, &shmem_id);
+    ignore_sig = 0;
+    if ( shm == NULL ) {
+	fprintf(stderr, "ERROR: can't attach to capture session '%s': %s\n",
+		session, strerror(-_halerrno));
+	goto out;
+    }
+
+    while (( captures != 0 ) && !stop ) {
+	while ((( slot = capture_next(shm) ) == NULL ) && !stop ) {
+	    /* nothing finished, sleep for 10mS */
+	    delay.tv_sec = 0;
+	    delay.tv_nsec = 10000000;
+	    nanosleep(&delay,NULL);
+	}
+	if ( stop ) {
+	    break;
+	}
+	printf("capture %u trigger 0x%08x pre %u count %u period %d\n",
+	       (unsigned int) slot->seq, (unsigned int) slot->trigger,
+	       (unsigned int) slot->pre, (unsigned int) slot->count,
+	       (int) slot->period);
+	for ( n = 0 ; n < shm->n_chan ; n++ ) {
+	    if ( halg_capture_channel_name(1, session, n, chan_name,
+					   sizeof(chan_name)) < 0 ) {
+		snprintf(chan_name, sizeof(chan_name), "%d", n);
+	    }
+	    printf("%s ", chan_name);
+	}
+	printf("\n");
+	for ( i = 0 ; i < slot->count ; i++ ) {
+	    hal_data_u *rec = capture_record(shm, slot, i);
+
+	    printf("%d ", i - (int) slot->pre);
+	    for ( n = 0 ; n < shm->n_chan ; n++ ) {
+		print_value(shm->type[n], &rec[n]);
+	    }
+	    printf("\n");
+	}
+	fflush(stdout);
+	capture_release(shm);
+	if ( captures > 0 ) {
+	    captures--;
+	}
+    }
+    exitval = 0;
+
+out:
+    ignore_sig = 1;
+    if ( shmem_id >= 0 ) {
+	hal_capture_detach(shmem_id, comp_id);
+    }
+    if ( comp_id >= 0 ) {
+	hal_exit(comp_id);
+    }
+    return exitval;
+}
@@ -55,6 +55,7 @@
 
 #include "rtapi.h"              /* RTAPI realtime OS API */
 #include "rtapi_app.h"          /* RTAPI realtime module decls */
+#include "rtapi_atomics.h"
 #include "hal.h"                /* HAL public API decls */
 #include "streamer.h"		/* decls and such for fifos */
 #include "rtapi_errno.h"
@@ -82,6 +83,10 @@ typedef struct {
     hal_bit_t *enable;		/* pin: enable sampling */
     hal_s32_t *overruns;	/* pin: number of overruns */
     hal_s32_t *sample_num;	/* pin: sample ID / timestamp */
+    int n_float;		/* copy plan: the channels sorted by */
+    int n_word;			/* width, floats first, then 32 bit */
+    int n_bit;			/* integers, then bits */
+    unsigned char plan[MAX_PINS];
 } sampler_t;
 
 /* other globals */
@@ -182,6 +187,7 @@ static void sample(void *arg, long period)
     fifo_t *fifo;
     pin_data_t *pptr;
     shmem_data_t *dptr;
+    unsigned char *plan;
     int tmpin, newin, tmpout, n;
 
     /* point at sampler struct in HAL shmem */
@@ -219,34 +225,23 @@ static void sample(void *arg, long period)
     }
     /* make pointer to fifo entry */
     dptr += tmpin * (fifo->num_pins+1);
-    /* copy data from HAL pins to fifo */
-    for ( n = 0 ; n < fifo->num_pins ; n++ ) {
-	switch ( fifo->type[n] ) {
-	case HAL_FLOAT:
-	    dptr->f = *(pptr->hfloat);
-	    break;
-	case HAL_BIT:
-	    if ( *(pptr->hbit) ) {
-		dptr->b = 1;
-	    } else {
-		dptr->b = 0;
-	    }
-	    break;
-	case HAL_U32:
-	    dptr->u = *(pptr->hu32);
-	    break;
-	case HAL_S32:
-	    dptr->s = *(pptr->hs32);
-	    break;
-	default:
-	    break;
-	}
-	dptr++;
-	pptr++;
+    /* copy data from HAL pins to fifo, one loop per width, so
+       there is no switch on the type of each pin */
+    plan = samp->plan;
+    for ( n = 0 ; n < samp->n_float ; n++, plan++ ) {
+	dptr[*plan].f = *(pptr[*plan].hfloat);
     }
+    for ( n = 0 ; n < samp->n_word ; n++, plan++ ) {
+	dptr[*plan].u = *(pptr[*plan].hu32);
+    }
+    for ( n = 0 ; n < samp->n_bit ; n++, plan++ ) {
+	dptr[*plan].b = *(pptr[*plan].hbit) != 0;
+    }
+    dptr += fifo->num_pins;
     /* store sample number at the end of the fifo record */
     dptr->u = (*samp->sample_num)++;
-    /* update fifo pointer */
+    /* update fifo pointer, once the record is complete */
+    rtapi_smp_wmb();
     fifo->in = newin;
     /* calculate current depth */
     if ( newin < tmpout ) {
@@ -395,6 +390,23 @@ static int init_sampler(int num, fifo_t *tmp_fifo)
 	}
 	pptr++;
     }
+    /* make the copy plan */
+    str->n_float = str->n_word = str->n_bit = 0;
+    for ( n = 0 ; n < tmp_fifo->num_pins ; n++ ) {
+	if ( tmp_fifo->type[n] == HAL_FLOAT ) {
+	    str->plan[str->n_float++] = n;
+	}
+    }
+    for ( n = 0 ; n < tmp_fifo->num_pins ; n++ ) {
+	if (( tmp_fifo->type[n] == HAL_U32 ) || ( tmp_fifo->type[n] == HAL_S32 )) {
+	    str->plan[str->n_float + str->n_word++] = n;
+	}
+    }
+    for ( n = 0 ; n < tmp_fifo->num_pins ; n++ ) {
+	if ( tmp_fifo->type[n] == HAL_BIT ) {
+	    str->plan[str->n_float + str->n_word + str->n_bit++] = n;
+	}
+    }
     /* export update function */
     rtapi_snprintf(buf, sizeof(buf), "sampler.%d", num);
     retval = hal_export_funct(buf, sample, str, usefp, 0, comp_id);
@@ -20,7 +20,7 @@
 
     Invoking:
 
-    halsampler [-c chan_num] [-n num_samples] [-t]
+    halsampler [-c chan_num] [-n num_samples] [-t] [-b] [filename]
 
     'chan_num', if present, specifies the sampler channel to use.
     The default is channel zero.
@@ -32,6 +32,12 @@
     '-t' tells sampler to print the sample number at the start
     of each line.
 
+    '-b' writes a binary capture instead of text, in the format
+    described in streamer.h.  A named output file which is a regular
+    file is written through a memory mapping, anything else through
+    a large buffer.  Either way, full rate data from many channels
+    can be logged for hours, which printing text can't keep up with.
+
 */
 
 /** This program is free software; you can redistribute it and/or
@@ -69,15 +75,23 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
 
 #include "rtapi.h"		/* RTAPI realtime OS API */
+#include "rtapi_atomics.h"
 #include "hal.h"                /* HAL public API decls */
+#include "hal_priv.h"
 #include "streamer.h"
 
 /***********************************************************************
 *                  LOCAL FUNCTION DECLARATIONS                         *
 ************************************************************************/
 
+static int output_open(int fd);
+static int output_write(const void *data, size_t len);
+static int output_close(void);
+
 /***********************************************************************
 *                         GLOBAL VARIABLES                             *
 ************************************************************************/
@@ -86,6 +100,8 @@ int comp_id = -1;	/* -1 means hal_init() not called yet */
 int shmem_id = -1;
 int exitval = 1;	/* program return code - 1 means error */
 int ignore_sig = 0;	/* used to flag critical regions */
+int running = 0;	/* in the main loop, which stops on signals */
+volatile sig_atomic_t stop = 0;
 char comp_name[HAL_NAME_LEN+1];	/* name for this instance of sampler */
 
 /***********************************************************************
@@ -98,6 +114,11 @@ static void quit(int sig)
     if ( ignore_sig ) {
 	return;
     }
+    if ( running ) {
+	/* let the main loop finish the output */
+	stop = 1;
+	return;
+    }
     if ( shmem_id >= 0 ) {
 	rtapi_shmem_delete(shmem_id, comp_id);
     }
@@ -108,11 +129,13 @@ static void quit(int sig)
 }
 
 #define BUF_SIZE 4000
+#define OUTPUT_BUF_SIZE (1024 * 1024)	/* for binary output */
+#define OUTPUT_MAP_SIZE (16 * 1024 * 1024)	/* mapped file window */
 
 int main(int argc, char **argv)
 {
-    int n, channel, retval, size, tag;
-    long int samples;
+    int n, channel, retval, size, tag, binary;
+    long int samples, overruns;
     unsigned long this_sample;
     char  *cp2;
     char *name = NULL;
@@ -121,15 +144,21 @@ int main(int argc, char **argv)
     shmem_data_t *data, *dptr, buf[MAX_PINS];
     int tmpout, newout;
     struct timespec delay;
+    sampler_file_header_t header;
+    sampler_file_column_t column[MAX_PINS];
+    int width[MAX_PINS];
+    char record[sizeof(hal_u32_t) + MAX_PINS * sizeof(real_t)];
 
     /* set return code to "fail", clear it later if all goes well */
     exitval = 1;
     channel = 0;
     tag = 0;
+    binary = 0;
+    overruns = 0;
     samples = -1;  /* -1 means run forever */
     int  opt;
 
-    while ((opt = getopt(argc, argv, "tn:c:N:")) != -1) {
+    while ((opt = getopt(argc, argv, "tbn:c:N:")) != -1) {
 	switch (opt) {
 	case 'c':
 	    channel = strtol(optarg, &cp2, 10);
@@ -151,10 +180,14 @@ int main(int argc, char **argv)
 	case 't':
 	    tag = 1;
 	    break;
+	case 'b':
+	    binary = 1;
+	    break;
 	default: /* '?' */
 	    fprintf(stderr,"ERROR: unknown option '%c'\n", opt);
 	    fprintf(stderr,"valid options are:\n" );
 	    fprintf(stderr,"\t-t\t\ttag values with sample number\n" );
+	    fprintf(stderr,"\t-b\t\twrite binary records, see streamer.h\n" );
 	    fprintf(stderr,"\t-c <int>\t channel number\n" );
 	    fprintf(stderr,"\t-n <int>\t sample count\n" );
 	    fprintf(stderr,"\t-N <name>\t set HAL component name\n" );
@@ -169,7 +202,17 @@ int main(int argc, char **argv)
 	    exit(1);
 	}
 	// make stdout be the named file
-	fd = open(argv[optind], O_WRONLY | O_CREAT, 0666);
+	if ( binary ) {
+	    /* read access too, so it can be mapped */
+	    fd = open(argv[optind], O_RDWR | O_CREAT | O_TRUNC, 0666);
+	} else {
+	    fd = open(argv[optind], O_WRONLY | O_CREAT, 0666);
+	}
+	if ( fd < 0 ) {
+	    fprintf(stderr, "ERROR: can't open '%s': %s\n",
+		    argv[optind], strerror(errno));
+	    exit(1);
+	}
 	close(1);
 	dup2(fd, 1);
     }
@@ -228,13 +271,56 @@ int main(int argc, char **argv)
     }
     fifo = shmem_ptr;
     data = fifo->data;
-    while ( samples != 0 ) {
-	while ( fifo->in == fifo->out ) {
+    if ( binary ) {
+	/* lay out the records, and name the columns after what the
+	   sampler pins are linked to */
+	memset(&header, 0, sizeof(header));
+	memset(column, 0, sizeof(column));
+	memcpy(header.magic, SAMPLER_FILE_MAGIC, sizeof(SAMPLER_FILE_MAGIC));
+	header.version = SAMPLER_FILE_VERSION;
+	header.byte_order = SAMPLER_FILE_BYTE_ORDER;
+	header.num_pins = fifo->num_pins;
+	header.channel = channel;
+	header.header_size = sizeof(header) + fifo->num_pins * sizeof(column[0]);
+	header.record_size = sizeof(hal_u32_t);
+	rtapi_mutex_get(&(hal_data->mutex));
+	for ( n = 0 ; n < fifo->num_pins ; n++ ) {
+	    char pname[HAL_NAME_LEN + 1];
+	    hal_pin_t *pin;
+	    hal_sig_t *sig;
+
+	    width[n] = fifo->type[n] == HAL_FLOAT ? sizeof(real_t) :
+		fifo->type[n] == HAL_BIT ? 1 : sizeof(hal_u32_t);
+	    column[n].type = fifo->type[n];
+	    column[n].offset = header.record_size;
+	    header.record_size += width[n];
+	    snprintf(pname, sizeof(pname), "sampler.%d.pin.%d", channel, n);
+	    pin = halpr_find_pin_by_name(pname);
+	    sig = pin ? signal_of(pin) : NULL;
+	    snprintf(column[n].name, sizeof(column[n].name), "%s",
+		     sig ? ho_name(sig) : pname);
+	}
+	rtapi_mutex_give(&(hal_data->mutex));
+	if (( output_open(1) < 0 ) ||
+	    ( output_write(&header, sizeof(header)) < 0 ) ||
+	    ( output_write(column, fifo->num_pins * sizeof(column[0])) < 0 )) {
+	    fprintf(stderr, "ERROR: can't write output: %s\n", strerror(errno));
+	    goto out;
+	}
+	running = 1;
+    }
+    while (( samples != 0 ) && !stop ) {
+	while (( fifo->in == fifo->out ) && !stop ) {
             /* fifo empty, sleep for 10mS */
 	    delay.tv_sec = 0;
 	    delay.tv_nsec = 10000000;
 	    nanosleep(&delay,NULL);
 	}
+	if ( stop ) {
+	    break;
+	}
+	/* the record is complete once 'in' moved past it */
+	rtapi_smp_rmb();
 	/* make pointer to fifo entry */
 	tmpout = fifo->out;
 	newout = tmpout + 1;
@@ -248,6 +334,7 @@ int main(int argc, char **argv)
 	}
 	/* and read sample number */
 	this_sample = dptr->u;
+	rtapi_smp_rmb();
 	if ( fifo->out != tmpout ) {
 	    /* the sample was overwritten while we were reading it */
 	    /* so ignore it */
@@ -257,9 +344,34 @@ int main(int argc, char **argv)
 	    fifo->out = newout;
 	}
 	if ( this_sample != ++(fifo->last_sample) ) {
-	    printf ( "overrun\n" );
+	    /* binary records show overruns as gaps in the sample number */
+	    if ( binary ) {
+		overruns++;
+	    } else {
+		printf ( "overrun\n" );
+	    }
 	    fifo->last_sample = this_sample;
 	}
+	if ( binary ) {
+	    char *rp = record;
+	    hal_u32_t num = this_sample;
+
+	    memcpy(rp, &num, sizeof(num));
+	    rp += sizeof(num);
+	    /* every member of the union starts at its first byte */
+	    for ( n = 0 ; n < fifo->num_pins ; n++ ) {
+		memcpy(rp, &buf[n], width[n]);
+		rp += width[n];
+	    }
+	    if ( output_write(record, rp - record) < 0 ) {
+		fprintf(stderr, "ERROR: can't write output: %s\n", strerror(errno));
+		goto out;
+	    }
+	    if ( samples > 0 ) {
+		samples--;
+	    }
+	    continue;
+	}
 	if ( tag ) {
 	    printf ( "%ld ", this_sample );
 	}
@@ -291,6 +403,15 @@ int main(int argc, char **argv)
 	    samples--;
 	}
     }
+    if ( binary ) {
+	if ( output_close() < 0 ) {
+	    fprintf(stderr, "ERROR: can't write output: %s\n", strerror(errno));
+	    goto out;
+	}
+	if ( overruns ) {
+	    fprintf(stderr, "halsampler: %ld overruns\n", overruns);
+	}
+    }
     /* run was succesfull */
     exitval = 0;
 
@@ -304,3 +425,138 @@ out:
     }
     return exitval;
 }
+
+/***********************************************************************
+*                         BINARY OUTPUT                                *
+************************************************************************/
+
+/* a regular file is written through a window mapped onto it, which
+   moves along as it fills: records are copied once, and the kernel
+   writes them back.  Pipes, terminals and files which can't be mapped
+   get a large buffer, written out with one write() when full. */
+
+static struct {
+    int fd;
+    int mapped;
+    char *buf;		/* the write buffer, or the mapped window */
+    size_t size;	/* of buf */
+    size_t len;		/* bytes used in buf */
+    off_t offset;	/* file offset of a mapped window */
+} output;
+
+static int map_window(void)
+{
+    if ( ftruncate(output.fd, output.offset + output.size) < 0 ) {
+	return -1;
+    }
+    output.buf = mmap(NULL, output.size, PROT_READ | PROT_WRITE,
+		      MAP_SHARED, output.fd, output.offset);
+    if ( output.buf == MAP_FAILED ) {
+	output.buf = NULL;
+	return -1;
+    }
+    return 0;
+}
+
+static int flush_buffer(void)
+{
+    size_t done = 0;
+    ssize_t n;
+
+    while ( done < output.len ) {
+	n = write(output.fd, output.buf + done, output.len - done);
+	if ( n < 0 ) {
+	    if ( errno == EINTR ) {
+		continue;
+	    }
+	    return -1;
+	}
+	done += n;
+    }
+    output.len = 0;
+    return 0;
+}
+
+static int output_open(int fd)
+{
+    struct stat st;
+    off_t start;
+    long page = sysconf(_SC_PAGESIZE);
+
+    memset(&output, 0, sizeof(output));
+    output.fd = fd;
+    start = lseek(fd, 0, SEEK_CUR);
+    if (( fstat(fd, &st) == 0 ) && S_ISREG(st.st_mode) && ( start >= 0 )) {
+	/* windows start on a page, the data where the file ends now */
+	output.mapped = 1;
+	output.size = OUTPUT_MAP_SIZE;
+	output.offset = start & ~(off_t)(page - 1);
+	output.len = start - output.offset;
+	if ( map_window() == 0 ) {
+	    return 0;
+	}
+	/* opened write-only, most likely */
+	if ( ftruncate(fd, start) < 0 ) {
+	    return -1;
+	}
+	output.mapped = 0;
+	output.len = 0;
+    }
+    output.size = OUTPUT_BUF_SIZE;
+    output.buf = malloc(output.size);
+    return output.buf ? 0 : -1;
+}
+
+static int output_write(const void *data, size_t len)
+{
+    const char *p = data;
+    size_t n;
+
+    while ( len > 0 ) {
+	if ( output.len == output.size ) {
+	    if ( output.mapped ) {
+		/* move the window along */
+		munmap(output.buf, output.size);
+		output.buf = NULL;
+		output.offset += output.size;
+		output.len = 0;
+		if ( map_window() < 0 ) {
+		    return -1;
+		}
+	    } else if ( flush_buffer() < 0 ) {
+		return -1;
+	    }
+	}
+	n = output.size - output.len;
+	if ( n > len ) {
+	    n = len;
+	}
+	memcpy(output.buf + output.len, p, n);
+	output.len += n;
+	p += n;
+	len -= n;
+    }
+    return 0;
+}
+
+static int output_close(void)
+{
+    int retval = 0;
+
+    if ( output.buf == NULL ) {
+	return -1;
+    }
+    if ( output.mapped ) {
+	/* cut the file back to what was written */
+	munmap(output.buf, output.size);
+	if (( ftruncate(output.fd, output.offset + output.len) < 0 ) ||
+	    ( lseek(output.fd, output.offset + output.len, SEEK_SET) < 0 )) {
+	    retval = -1;
+	}
+    } else {
+	retval = flush_buffer();
+	free(output.buf);
+    }
+    output.buf = NULL;
+    return retval;
+}
@@ -13,8 +13,8 @@
 
 #define MAX_STREAMERS		8
 #define MAX_SAMPLERS		8
-#define MAX_PINS 		20
-#define MAX_SHMEM 		128000
+#define MAX_PINS 		32
+#define MAX_SHMEM 		2000000
 
 #define FIFO_MAGIC_NUM		0x4649464F
 
@@ -49,3 +49,31 @@ typedef union {
     hal_s32_t *hs32;
 } pin_data_t;
 
+/* 'halsampler -b' writes this binary file format: a header, one
+   column descriptor per pin, then one record per sample.  A record
+   holds the sample number as a u32 followed by the pins, packed at
+   the offsets in their column descriptors: 8 bytes for a float (a
+   double), 4 bytes for u32 and s32, and 1 byte (0 or 1) for a bit.
+   All numbers are in the byte order of the machine that wrote the
+   file - byte_order reads as SAMPLER_FILE_BYTE_ORDER if it matches.
+*/
+
+#define SAMPLER_FILE_MAGIC	"HALSAMP"
+#define SAMPLER_FILE_VERSION	1
+#define SAMPLER_FILE_BYTE_ORDER	0x01020304
+
+typedef struct {
+    char magic[8];		/* SAMPLER_FILE_MAGIC */
+    hal_u32_t version;
+    hal_u32_t byte_order;
+    hal_u32_t header_size;	/* offset of the first record */
+    hal_u32_t record_size;
+    hal_u32_t num_pins;
+    hal_u32_t channel;		/* the sampler channel captured */
+} sampler_file_header_t;
+
+typedef struct {
+    hal_u32_t type;		/* hal_type_t of the pin */
+    hal_u32_t offset;		/* of the value in a record */
+    char name[HAL_MAX_NAME_LEN + 1];	/* linked signal, or the pin */
+} sampler_file_column_t;
@@ -74,6 +74,7 @@ TYPE_REMOTE = hal_const.TYPE_REMOTE
 RINGTYPE_RECORD = ring_const.RINGTYPE_RECORD
 RINGTYPE_MULTIPART = ring_const.RINGTYPE_MULTIPART
 RINGTYPE_STREAM = ring_const.RINGTYPE_STREAM
+RINGTYPE_MPMC = ring_const.RINGTYPE_MPMC
 RINGTYPE_MASK = ring_const.RINGTYPE_MASK
 
 USE_RMUTEX = ring_const.USE_RMUTEX
@@ -60,7 +60,9 @@ cdef class HALData:
 
     property heap_flags:
         def __set__(self, int f):
-            rtapi_heap_setflags(&hal_data.heap,f)
+            rc = rtapi_heap_setflags(&hal_data.heap,f)
+            if rc < 0:
+                raise RuntimeError("heap_flags: can't change the allocator of a heap in use")
 
     property heap_freelist:
         def __get__(self):
@@ -192,6 +192,7 @@ cdef extern from "hal_priv.h":
 
     int sig_type(const hal_sig_t *sig)
     hal_data_u *sig_value(hal_sig_t *sig)
+    void hal_sig_written(hal_sig_t *sig)
     hal_sig_t *signal_of(const hal_pin_t *pin)
     int pin_linked_to(const hal_pin_t *pin, const hal_sig_t *sig)
     bint pin_is_linked(const hal_pin_t *pin)
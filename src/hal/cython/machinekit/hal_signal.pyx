@@ -101,7 +101,9 @@ cdef class Signal(HALObject):
         if self._o.sig.writers > 0:
             raise RuntimeError("Signal %s already as %d writer(s)" %
                                       (hh_get_name(&self._o.sig.hdr), self._o.sig.writers))
-        return py2hal(self._o.sig.type, self._storage, v)
+        r = py2hal(self._o.sig.type, self._storage, v)
+        hal_sig_written(self._o.sig)
+        return r
 
     def get(self):
         self._alive_check()
@@ -8,6 +8,7 @@ cdef extern from "ring.h":
     int RINGTYPE_RECORD
     int RINGTYPE_MULTIPART
     int RINGTYPE_STREAM
+    int RINGTYPE_MPMC
     int RINGTYPE_MASK
 
     int USE_RMUTEX
@@ -63,6 +63,12 @@ RTAPI_MP_ARRAY_STRING(config, MAX_ETH_BOARDS, "config string for the AnyIO board
 int debug = 0;
 RTAPI_MP_INT(debug, "Developer/debug use only!  Enable debug logging.");
 
+static int pipeline = 0;
+RTAPI_MP_INT(pipeline, "Request the next TRAM read right after the TRAM write, so the response is waiting at the next read");
+
+static int read_timeout = 800000;
+RTAPI_MP_INT(read_timeout, "Time to wait for a read response once the board is running, in ns; keep it below the servo period");
+
 static hm2_eth_t boards[MAX_ETH_BOARDS];
 static int boards_count = 0;
 
@@ -74,6 +80,7 @@ static int comp_id;
 #define SEND_TIMEOUT_US 10
 #define RECV_TIMEOUT_US 10
 #define READ_PCK_DELAY_NS 10000
+#define SETUP_READ_TIMEOUT_NS (200*1000*1000)
 
 static int sockfd = -1;
 static struct sockaddr_in local_addr;
@@ -81,11 +88,25 @@ static struct sockaddr_in server_addr;
 
 static lbp16_cmd_addr read_packet;
 
+// reads during board setup may wait long, reads from the servo thread
+// only up to read_timeout
+static long long read_timeout_ns = SETUP_READ_TIMEOUT_NS;
+
 read_queue_entry_t queue_reads[MAX_ETH_READS];
 lbp16_cmd_addr queue_packets[MAX_ETH_READS];
 int queue_reads_count = 0;
 int queue_buff_size = 0;
 
+// pipelined TRAM reads: the last TRAM read request is sent again at the
+// end of the TRAM write, and its response picked up by the next TRAM read
+// if that asks for the same. TRAM data is then as of the end of the
+// previous write funct rather than the start of the read funct.
+static lbp16_cmd_addr prefetch_packets[MAX_ETH_READS];
+static int prefetch_count = 0;      // commands in the request, 0 if none
+static int prefetch_size = 0;       // bytes in the response
+static int prefetch_state = PREFETCH_NONE;
+static u8 prefetch_buffer[MAX_ETH_READS * LBP16_MAX_PACKET_DATA_SIZE * 4];
+
 static u8 write_packet[1400];
 void *write_packet_ptr = &write_packet;
 int write_packet_size = 0;
@@ -253,6 +274,10 @@ static int fetch_hwaddr(int sockfd, unsigned char buf[6]) {
     return 0;
 }
 
+static bool board_is_local(void) {
+    return (ntohl(server_addr.sin_addr.s_addr) >> 24) == IN_LOOPBACKNET;
+}
+
 static int init_net(void) {
     int ret;
 
@@ -274,7 +299,11 @@ static int init_net(void) {
         return -errno;
     }
 
-    if(use_iptables()) {
+    if(board_is_local()) {
+        // a simulated board (hm2_eth_sim) - no arp entry or firewall
+        LL_PRINT("Using a simulated board at %s\n", board_ip);
+        iptables_state = 0;
+    } else if(use_iptables()) {
         LL_PRINT("Using iptables for exclusive access to network interface\n")
         // firewall has to be open in order to successfully arp the board
         clear_iptables();
@@ -309,6 +338,9 @@ static int init_net(void) {
     sin->sin_family = AF_INET;
     sin->sin_addr.s_addr = inet_addr(board_ip);
 
+    if(board_is_local())
+        return 0;
+
     req.arp_ha.sa_family = AF_LOCAL;
     req.arp_flags = ATF_PERM | ATF_COM;
     ret = fetch_hwaddr( sockfd, (void*)&req.arp_ha.sa_data );
@@ -355,16 +387,80 @@ static int eth_socket_recv(int sockfd, void *buffer, int len, int flags) {
     return recv(sockfd, buffer, len, flags);
 }
 
+// LBP16 responses carry no tag, so a response which arrives after its
+// read gave up would be taken for the answer to the next request. Throw
+// away whatever is waiting in the socket before a request is sent.
+static void eth_socket_drain(void) {
+    u8 tmp_buffer[LBP16_MAX_PACKET_DATA_SIZE * 4];
+    int recv, stale = 0;
+
+    while ((recv = eth_socket_recv(sockfd, tmp_buffer, sizeof(tmp_buffer), MSG_DONTWAIT)) >= 0)
+        stale++;
+    LL_PRINT_IF(debug && stale, "drain(%d) : DISCARDED %d STALE PACKETS\n", read_cnt, stale);
+}
+
+// wait up to read_timeout_ns for the response to a read request; a
+// datagram of the wrong size is not the response and is skipped
+static int eth_socket_recv_response(void *buffer, int len, int *tries, long long *waited) {
+    int recv, i = 0;
+    long long t1, t2;
+
+    t1 = rtapi_get_time();
+    do {
+        recv = eth_socket_recv(sockfd, buffer, len, MSG_TRUNC);
+        t2 = rtapi_get_time();
+        i++;
+        if (recv == len) break;
+        if (recv >= 0) {
+            LL_PRINT_IF(debug, "recv(%d) : DISCARDED PACKET [SIZE: %d | EXPECTED: %d]\n", read_cnt, recv, len);
+            recv = -1;
+            continue;
+        }
+        rtapi_delay(READ_PCK_DELAY_NS);
+    } while ((t2 - t1) < read_timeout_ns);
+
+    *tries = i;
+    *waited = t2 - t1;
+    return recv;
+}
+
+// a TRAM read request sent ahead must be answered before anything else
+// is read from the socket
+static void hm2_eth_prefetch_receive(void) {
+    int recv, tries;
+    long long waited;
+
+    if (prefetch_state != PREFETCH_SENT) return;
+    recv = eth_socket_recv_response(prefetch_buffer, prefetch_size, &tries, &waited);
+    LL_PRINT_IF(debug, "prefetch(%d) : PACKET RECV [SIZE: %d | TRIES: %d | TIME: %llu]\n", read_cnt, recv, tries, waited);
+    prefetch_state = recv == prefetch_size ? PREFETCH_RECEIVED : PREFETCH_NONE;
+}
+
+static void hm2_eth_prefetch_send(void) {
+    int send;
+
+    if (!pipeline || prefetch_count == 0 || prefetch_state != PREFETCH_NONE) return;
+    eth_socket_drain();
+    send = eth_socket_send(sockfd, (void*) &prefetch_packets, sizeof(lbp16_cmd_addr)*prefetch_count, 0);
+    if (send < 0) {
+        LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
+        return;
+    }
+    prefetch_state = PREFETCH_SENT;
+}
+
 /// hm2_eth io functions
 
 static int hm2_eth_read(hm2_lowlevel_io_t *this, u32 addr, void *buffer, int size) {
     int send, recv, i = 0;
     u8 tmp_buffer[size + 4];
-    long long t1, t2;
+    long long waited;
 
     if (comm_active == 0) return 1;
     if (size == 0) return 1;
     read_cnt++;
+    hm2_eth_prefetch_receive();
+    eth_socket_drain();
 
     LBP16_INIT_PACKET4(read_packet, CMD_READ_HOSTMOT2_ADDR32_INCR(size/4), addr & 0xFFFF);
 
@@ -373,18 +469,12 @@ static int hm2_eth_read(hm2_lowlevel_io_t *this, u32 addr, void *buffer, int siz
         LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
     LL_PRINT_IF(debug, "read(%d) : PACKET SENT [CMD:%02X%02X | ADDR: %02X%02X | SIZE: %d]\n", read_cnt, read_packet.cmd_hi, read_packet.cmd_lo,
       read_packet.addr_lo, read_packet.addr_hi, size);
-    t1 = rtapi_get_time();
-    do {
-        rtapi_delay(READ_PCK_DELAY_NS);
-        recv = eth_socket_recv(sockfd, (void*) &tmp_buffer, size, 0);
-        t2 = rtapi_get_time();
-        i++;
-    } while ((recv < 0) && ((t2 - t1) < 200*1000*1000));
+    recv = eth_socket_recv_response(tmp_buffer, size, &i, &waited);
 
     if (recv == 4) {
-        LL_PRINT_IF(debug, "read(%d) : PACKET RECV [DATA: %08X | SIZE: %d | TRIES: %d | TIME: %llu]\n", read_cnt, *tmp_buffer, recv, i, t2 - t1);
+        LL_PRINT_IF(debug, "read(%d) : PACKET RECV [DATA: %08X | SIZE: %d | TRIES: %d | TIME: %llu]\n", read_cnt, *tmp_buffer, recv, i, waited);
     } else {
-        LL_PRINT_IF(debug, "read(%d) : PACKET RECV [SIZE: %d | TRIES: %d | TIME: %llu]\n", read_cnt, recv, i, t2 - t1);
+        LL_PRINT_IF(debug, "read(%d) : PACKET RECV [SIZE: %d | TRIES: %d | TIME: %llu]\n", read_cnt, recv, i, waited);
     }
     if (recv < 0)
         return 0;
@@ -396,27 +486,42 @@ static int hm2_eth_enqueue_read(hm2_lowlevel_io_t *this, u32 addr, void *buffer,
     if (comm_active == 0) return 1;
     if (size == 0) return 1;
     if (size == -1) {
-        int send, recv, i = 0;
-        long long t1, t2;
-        u8 tmp_buffer[queue_buff_size];
+        int send, recv = -1, i = 0;
+        long long waited = 0;
+        u8 *tmp_buffer = prefetch_buffer;
+        int count = queue_reads_count, len = queue_buff_size;
 
         read_cnt++;
-        send = eth_socket_send(sockfd, (void*) &queue_packets, sizeof(lbp16_cmd_addr)*queue_reads_count, 0);
-        if(send < 0)
-            LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
-        t1 = rtapi_get_time();
-        do {
-            rtapi_delay(READ_PCK_DELAY_NS);
-            recv = eth_socket_recv(sockfd, (void*) &tmp_buffer, queue_buff_size, 0);
-            t2 = rtapi_get_time();
-            i++;
-        } while ((recv < 0) && ((t2 - t1) < 200*1000*1000));
-        LL_PRINT_IF(debug, "enqueue_read(%d) : PACKET RECV [SIZE: %d | TRIES: %d | TIME: %llu]\n", read_cnt, recv, i, t2 - t1);
-
-        for (i = 0; i < queue_reads_count; i++) {
-            memcpy(queue_reads[i].buffer, &tmp_buffer[queue_reads[i].from], queue_reads[i].size);
+        hm2_eth_prefetch_receive();
+        if (prefetch_state == PREFETCH_RECEIVED &&
+                (count != prefetch_count ||
+                 memcmp(queue_packets, prefetch_packets, sizeof(lbp16_cmd_addr)*count))) {
+            prefetch_state = PREFETCH_NONE;   // not what we ask for now
+        }
+        if (prefetch_state == PREFETCH_RECEIVED) {
+            recv = len;
+            LL_PRINT_IF(debug, "enqueue_read(%d) : PREFETCHED [SIZE: %d]\n", read_cnt, recv);
+        } else {
+            eth_socket_drain();
+            send = eth_socket_send(sockfd, (void*) &queue_packets, sizeof(lbp16_cmd_addr)*count, 0);
+            if(send < 0)
+                LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
+            recv = eth_socket_recv_response(tmp_buffer, len, &i, &waited);
+            LL_PRINT_IF(debug, "enqueue_read(%d) : PACKET RECV [SIZE: %d | TRIES: %d | TIME: %llu]\n", read_cnt, recv, i, waited);
+        }
+        prefetch_state = PREFETCH_NONE;
+
+        if (recv >= 0) {
+            for (i = 0; i < count; i++) {
+                memcpy(queue_reads[i].buffer, &tmp_buffer[queue_reads[i].from], queue_reads[i].size);
+            }
         }
 
+        // the next request, if pipelining, is this one again
+        memcpy(prefetch_packets, queue_packets, sizeof(lbp16_cmd_addr)*count);
+        prefetch_count = count;
+        prefetch_size = len;
+
         queue_reads_count = 0;
         queue_buff_size = 0;
     } else {
@@ -469,6 +574,7 @@ static int hm2_eth_enqueue_write(hm2_lowlevel_io_t *this, u32 addr, void *buffer
         LL_PRINT_IF(debug, "enqueue_write(%d) : PACKET SEND [SIZE: %d | TIME: %llu]\n", write_cnt, send, t1 - t0);
         write_packet_ptr = &write_packet;
         write_packet_size = 0;
+        hm2_eth_prefetch_send();
     } else {
         lbp16_cmd_addr *packet = (lbp16_cmd_addr *) write_packet_ptr;
 
@@ -593,6 +699,9 @@ static int hm2_eth_probe() {
     val = val | O_NONBLOCK;
     fcntl(sockfd, F_SETFL, val);
 
+    // from here on reads come from the servo thread
+    read_timeout_ns = read_timeout;
+
     return 0;
 }
 
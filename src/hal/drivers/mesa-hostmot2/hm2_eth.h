@@ -37,4 +37,11 @@ typedef struct {
     int from;
 } read_queue_entry_t;
 
+// the TRAM read request sent ahead when pipelining
+enum {
+    PREFETCH_NONE,
+    PREFETCH_SENT,          // response not yet received
+    PREFETCH_RECEIVED,      // response in prefetch_buffer
+};
+
 #endif
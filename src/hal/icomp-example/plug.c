@@ -14,7 +14,7 @@ static int comp_id;
 static char *compname = "plug";
 
 struct inst_data {
-    hal_plug_t  *rplug, *wplug;
+    hal_plug_t  *rplug, *wplug, *tplug;
 };
 
 static char *wring = NULL;
@@ -23,11 +23,22 @@ RTAPI_IP_STRING(wring, "a ring this instance should plug to as a writer");
 static char *rring = NULL;
 RTAPI_IP_STRING(rring, "a ring this instance should plug to as a reader");
 
+static char *tring = NULL;
+RTAPI_IP_STRING(tring, "a record ring this instance should tap");
+
 static int funct(void *arg, const hal_funct_args_t *fa)
 {
     // use the instance pointer passed in halinst_export_funct()
     struct inst_data *ip = arg;
 
+    // drain what the tap sees - this doesn't take records away
+    // from other taps of the same ring
+    if (ip->tplug) {
+	const void *data;
+	ringsize_t size;
+	while (hal_tap_read(ip->tplug, &data, &size) == 0)
+	    hal_tap_shift(ip->tplug);
+    }
     return 0; // extended thread functs return a value
 }
 
@@ -58,6 +69,18 @@ static int export_halobjs(struct inst_data *ip, int owner_id, const char *name)
 	if (ip->wplug == NULL)
 	    return _halerrno;
     }
+    if (tring) {
+	// any number of taps may read a ring, each at its own pace
+	plug_args_t targs = {
+	    .type = PLUG_TAP,
+	    .flags = RINGTYPE_RECORD,
+	    .ring_name = tring,
+	    .owner_name = name
+	};
+	ip->tplug = halg_plug_new(1, &targs);
+	if (ip->tplug == NULL)
+	    return _halerrno;
+    }
 
     // exporting '<instname>.funct' as an extended thread function
     // see lutn.c for a discussion of advantages
@@ -89,7 +112,7 @@ static int instantiate(const int argc, const char**argv)
     // here ip is guaranteed to point to a blob of HAL memory
     // of size sizeof(struct inst_data).
     HALDBG("inst=%s argc=%d\n", name, argc);
-    HALDBG("instance parms: rring=%s wring=%s", rring, wring);
+    HALDBG("instance parms: rring=%s wring=%s tring=%s", rring, wring, tring);
 
     // these pins/params/functs will be owned by the instance,
     // and can be separately exited 'halcmd delinst <instancename>'
@@ -148,6 +148,25 @@ void hal_typefailure(const char *file,
 
 #endif
 
+// record a change of a signal's value, after it was stored:
+// bump the signal generation, and flag the compiled groups
+// watching the signal. See hal_cgroup_match().
+static inline void hal_sig_written(hal_sig_t *sig)
+{
+    __atomic_add_fetch(&sig->generation, 1, __ATOMIC_RELEASE);
+    __u32 watchers = __atomic_load_n(&sig->watchers, __ATOMIC_RELAXED);
+    if (unlikely(watchers))
+	__atomic_fetch_or(&((hal_data_t *)hal_shmem_base)->watch_dirty,
+			  watchers, __ATOMIC_RELEASE);
+}
+
+// same, after a raw write through pin_value()
+static inline void hal_pin_written(hal_pin_t *pin)
+{
+    if (pin->_signal)
+	hal_sig_written((hal_sig_t *)hal_ptr(pin->_signal));
+}
+
 // export context-independent setters which are strongly typed,
 // and context-dependent accessors with a descriptor argument,
 // and an optional runtime type check
@@ -159,7 +178,10 @@ void hal_typefailure(const char *file,
     hal_data_u *u =							\
 	(hal_data_u *)hal_ptr(pin->data_ptr);				\
     _CHECK(pin_type(pin), OTYPE);					\
+    const bool changed = pin->_signal && (u->ACCESS != value);	\
     SETTER( pin, ACCESS, value,  CAST);				\
+    if (changed)							\
+	hal_sig_written((hal_sig_t *)hal_ptr(pin->_signal));		\
     return value;							\
     }									\
 									\
@@ -210,6 +232,8 @@ PINGETTER(_GETVALUEDOUBLE, float, HAL_FLOAT, f,   _f,  FLOATCAST);
 				     RTAPI_MEMORY_MODEL);		\
     if (unlikely(hh_get_wmb(&DESC->hdr)))				\
 	rtapi_smp_wmb();						\
+    if (DESC->_signal && VALUE)						\
+	hal_sig_written((hal_sig_t *)hal_ptr(DESC->_signal));		\
     return rvalue;
 
 #define PIN_INCREMENTER(type, tag)					\
@@ -265,7 +289,10 @@ SIGGETTER(_GETVALUEDOUBLE, float, HAL_FLOAT, f,   _f,   FLOATCAST);
 		      const hal_##TYPE##_t value) {			\
 	hal_data_u *u = &sig->value;					\
 	_CHECK(sig_type(sig), OTYPE);					\
+	const bool changed = (u->ACCESS != value);			\
 	SETTER( sig, ACCESS, value,  CAST);			\
+	if (changed)							\
+	    hal_sig_written(sig);					\
 	return value;							\
     }									\
 									\
@@ -0,0 +1,91 @@
+// userland access to capture sessions - see hal_capture.h
+
+#include "config.h"
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* HAL private decls */
+#include "hal_internal.h"
+#include "hal_capture.h"
+
+#include <stdio.h>		/* snprintf() */
+#include <string.h>
+
+// the capture component which owns instance 'name', or NULL
+static hal_inst_t *find_session(const char *name)
+{
+    hal_inst_t *inst = halpr_find_inst_by_name(name);
+    hal_comp_t *comp;
+
+    if (inst == NULL)
+	return NULL;
+    comp = halpr_find_owning_comp(ho_owner_id(inst));
+    if ((comp == NULL) || strcmp(ho_name(comp), "capture"))
+	return NULL;
+    return inst;
+}
+
+capture_shm_t *halg_capture_attach(const int use_hal_mutex,
+				   const char *name,
+				   const int comp_id,
+				   int *shm_id)
+{
+    hal_inst_t *inst;
+    int key;
+
+    PCHECK_HALDATA();
+    PCHECK_NULL(name);
+    {
+	WITH_HAL_MUTEX_IF(use_hal_mutex);
+	inst = find_session(name);
+	if (inst == NULL)
+	    HALFAIL_NULL(ENOENT, "no capture instance '%s'", name);
+	key = CAPTURE_KEY(ho_id(inst));
+    }
+
+    // size 0: attach to the segment the instance made
+    int id = rtapi_shmem_new(key, comp_id, 0);
+    if (id < 0)
+	HALFAIL_NULL(-id, "%s: can't attach to key 0x%x", name, key);
+
+    void *ptr;
+    unsigned long size;
+    int retval = rtapi_shmem_getptr(id, &ptr, &size);
+    capture_shm_t *shm = ptr;
+    if ((retval < 0) || (size < sizeof(capture_shm_t)) ||
+	(shm->magic != CAPTURE_MAGIC) ||
+	(size < capture_shm_size(shm->n_chan, shm->depth, shm->n_slots))) {
+	rtapi_shmem_delete(id, comp_id);
+	HALFAIL_NULL(EINVAL, "%s: not a capture session", name);
+    }
+    *shm_id = id;
+    return shm;
+}
+
+void hal_capture_detach(const int shm_id, const int comp_id)
+{
+    rtapi_shmem_delete(shm_id, comp_id);
+}
+
+int halg_capture_channel_name(const int use_hal_mutex,
+			      const char *name,
+			      const int chan,
+			      char *buf, const size_t size)
+{
+    char pname[HAL_MAX_NAME_LEN + 1];
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+
+    CHECK_HALDATA();
+    CHECK_NULL(name);
+    CHECK_NULL(buf);
+    rtapi_snprintf(pname, sizeof(pname), "%s.pin.%d", name, chan);
+    {
+	WITH_HAL_MUTEX_IF(use_hal_mutex);
+	pin = halpr_find_pin_by_name(pname);
+	if (pin == NULL)
+	    HALFAIL_RC(ENOENT, "no pin '%s'", pname);
+	sig = signal_of(pin);
+	snprintf(buf, size, "%s", sig ? ho_name(sig) : pname);
+    }
+    return 0;
+}
@@ -0,0 +1,152 @@
+#ifndef HAL_CAPTURE_H
+#define HAL_CAPTURE_H
+
+// headless triggered capture - the shared memory layout of a capture
+// session, and the userland reader API. See hal/components/capture.c.
+//
+// each instance of the capture component is a session: its own
+// channels, trigger conditions and shm segment. The segment is keyed
+// by the instance id, so a reader finds a session by instance name.
+//
+// the segment holds n_slots capture slots. RT fills the slot at
+// produced % n_slots, and moves on to the next one when a capture is
+// complete; the reader takes finished slots in order and releases
+// them by advancing consumed. When all slots wait for the reader, RT
+// stops capturing - so no finished capture is ever overwritten.
+// There is one reader per session.
+//
+// each slot is a ring of depth records; a record has one hal_data_u
+// per channel. A capture is count records from start on, wrapping
+// at depth, pre of them before the one which fired the trigger.
+
+#include "rtapi.h"
+#include "rtapi_atomics.h"
+#include "rtapi_shmkeys.h"
+#include "hal.h"
+#include "hal_priv.h"
+
+RTAPI_BEGIN_DECLS
+
+#define CAPTURE_MAX_CHANNELS 32
+#define CAPTURE_MAX_TRIGGERS 8
+#define CAPTURE_MAGIC 0x43415054	// "CAPT"
+
+// the shm key of the session of instance inst_id
+#define CAPTURE_KEY(inst_id) (CAPTURE_SHM_KEY + ((inst_id) & 0xffff))
+
+// trigger condition modes, param <name>.trig.<k>.mode
+enum capture_mode {
+    CAPTURE_RISING = 0,		// value crosses level upwards
+    CAPTURE_FALLING,		// value crosses level downwards
+    CAPTURE_ABOVE,		// value > level
+    CAPTURE_BELOW,		// value < level
+    CAPTURE_INSIDE,		// level <= value <= high
+    CAPTURE_OUTSIDE,		// value < level, or value > high
+};
+
+// states, pin <name>.state
+enum capture_state {
+    CAPTURE_IDLE = 0,		// disabled, or all slots full
+    CAPTURE_WAIT,		// recording pre-trigger, waiting
+    CAPTURE_POST,		// triggered, recording post-trigger
+};
+
+// what fired a capture, in capture_slot_t.trigger: bit k for
+// trigger condition k, and
+#define CAPTURE_FIRED_OVERRUN (1U << 30)	// the thread overran
+#define CAPTURE_FIRED_FORCED  (1U << 31)	// the force pin was set
+
+typedef struct {
+    hal_u32_t seq;		// capture number, from 1
+    hal_u32_t trigger;		// what fired, see above
+    hal_u32_t start;		// ring index of the first record
+    hal_u32_t pre;		// records before the trigger record
+    hal_u32_t count;		// records in the capture
+    hal_s32_t period;		// nsec between records
+    long long timestamp;	// rtapi_get_time() at the trigger record
+} capture_slot_t;
+
+typedef struct {
+    hal_u32_t magic;
+    hal_u32_t n_chan;
+    hal_u32_t depth;		// records per slot
+    hal_u32_t n_slots;
+    hal_u32_t type[CAPTURE_MAX_CHANNELS];	// hal_type_t of each channel
+    hal_u32_t produced;		// captures finished by RT
+    hal_u32_t consumed;		// captures released by the reader
+    capture_slot_t slot[];	// n_slots, then the rings
+} capture_shm_t;
+
+static inline unsigned long capture_header_size(const int n_slots)
+{
+    unsigned long n = sizeof(capture_shm_t) + n_slots * sizeof(capture_slot_t);
+    return (n + 7) & ~7UL;
+}
+
+static inline unsigned long capture_shm_size(const int n_chan,
+					     const int depth,
+					     const int n_slots)
+{
+    return capture_header_size(n_slots) +
+	(unsigned long) n_slots * depth * n_chan * sizeof(hal_data_u);
+}
+
+// the ring of slot i
+static inline hal_data_u *capture_ring(capture_shm_t *shm, const int i)
+{
+    return (hal_data_u *) ((char *) shm + capture_header_size(shm->n_slots)) +
+	(unsigned long) i * shm->depth * shm->n_chan;
+}
+
+// the oldest finished capture not yet released, or NULL
+static inline capture_slot_t *capture_next(capture_shm_t *shm)
+{
+    hal_u32_t consumed = shm->consumed;
+
+    if (rtapi_load_u32(&shm->produced) == consumed)
+	return NULL;
+    rtapi_smp_rmb();
+    return &shm->slot[consumed % shm->n_slots];
+}
+
+// record i of the capture in slot
+static inline hal_data_u *capture_record(capture_shm_t *shm,
+					 const capture_slot_t *slot,
+					 const int i)
+{
+    int n = slot - shm->slot;
+    return capture_ring(shm, n) +
+	((slot->start + i) % shm->depth) * shm->n_chan;
+}
+
+// hand the slot of capture_next() back to RT
+static inline void capture_release(capture_shm_t *shm)
+{
+    rtapi_smp_mb();
+    rtapi_store_u32(&shm->consumed, shm->consumed + 1);
+}
+
+#ifdef ULAPI
+// in hal_capture.c:
+
+// attach to the session of capture instance 'name', as HAL component
+// comp_id. Returns NULL and sets _halerrno if there is no such
+// instance, or it is not a capture session.
+capture_shm_t *halg_capture_attach(const int use_hal_mutex,
+				   const char *name,
+				   const int comp_id,
+				   int *shm_id);
+
+void hal_capture_detach(const int shm_id, const int comp_id);
+
+// the name of what channel chan of session 'name' records: the
+// signal linked to its pin, or the pin if it is not linked
+int halg_capture_channel_name(const int use_hal_mutex,
+			      const char *name,
+			      const int chan,
+			      char *buf, const size_t size);
+#endif
+
+RTAPI_END_DECLS
+
+#endif // HAL_CAPTURE_H
@@ -563,6 +563,15 @@ int init_hal_data(void)
     hal_data->str_freed = 0;
     hal_data->rt_alignment_loss = 0;
 
+#if !defined(BUILD_SYS_KBUILD)
+    // userland threads can wake a waiting reporter with a futex,
+    // see hal_watch_notify(). Xenomai threads would drop out of
+    // primary mode doing so, and keep relying on polling.
+    hal_data->watch_wakeup =
+	(rtapi_switch->thread_flavor_id == RTAPI_POSIX_ID) ||
+	(rtapi_switch->thread_flavor_id == RTAPI_RT_PREEMPT_ID);
+#endif
+
     RTAPI_ZERO_BITMAP(&hal_data->rings, HAL_MAX_RINGS);
     RTAPI_BIT_SET(hal_data->rings,0);
 
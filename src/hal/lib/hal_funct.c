@@ -2,6 +2,7 @@
 
 #include "config.h"
 #include "rtapi.h"		/* RTAPI realtime OS API */
+#include "rtapi_atomics.h"
 #include "hal.h"		/* HAL public API decls */
 #include "hal_priv.h"		/* HAL private decls */
 #include "hal_internal.h"
@@ -123,6 +124,7 @@ static int halg_export_xfunctfv(const int use_hal_mutex,
 	nf->arg = xf->arg;
 	nf->type = xf->type;
 	nf->funct.l = xf->funct.l; // a bit of a cheat really
+	memset(&nf->hist, 0, sizeof(nf->hist));
 
 	halg_add_object(false, (hal_object_ptr)nf);
     }
@@ -256,6 +258,11 @@ int hal_add_funct_to_thread(const char *funct_name,
 	if ((funct->uses_fp) && (!thread->uses_fp)) {
 	    HALFAIL_RC(EINVAL, "function '%s' needs FP", funct_name);
 	}
+	/* a parallel schedule is only rebuilt while threads are stopped */
+	if (thread->n_workers && hal_data->threads_running) {
+	    HALFAIL_RC(EBUSY, "thread '%s' runs in parallel, "
+		       "stop threads first", thread_name);
+	}
 	/* find insertion point */
 	list_root = &(thread->funct_list);
 	list_entry = list_root;
@@ -298,6 +305,13 @@ int hal_add_funct_to_thread(const char *funct_name,
 
 	/* add the entry to the list */
 	dlist_add_after((hal_list_t *) funct_entry, list_entry);
+
+	/* and make the thread see it */
+	if (hal_thread_publish(thread)) {
+	    dlist_remove_entry((hal_list_t *) funct_entry);
+	    free_funct_entry_struct(funct_entry);
+	    return _halerrno;
+	}
 	/* update the function usage count */
 	funct->users++;
     }
@@ -339,6 +353,10 @@ int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
 	    /* thread not found */
 	    HALFAIL_RC(EINVAL, "thread '%s' not found", thread_name);
 	}
+	if (thread->n_workers && hal_data->threads_running) {
+	    HALFAIL_RC(EBUSY, "thread '%s' runs in parallel, "
+		       "stop threads first", thread_name);
+	}
 	/* ok, we have thread and function, does thread use funct? */
 	hal_list_t *list_root = &(thread->funct_list);
 	hal_list_t *list_entry = dlist_next(list_root);
@@ -350,8 +368,14 @@ int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
 	    }
 	    hal_funct_entry_t *funct_entry = (hal_funct_entry_t *) list_entry;
 	    if (SHMPTR(funct_entry->funct_ptr) == funct) {
+		hal_list_t *prev = dlist_prev(list_entry);
 		/* this funct entry points to our funct, unlink */
 		dlist_remove_entry(list_entry);
+		/* make the thread stop calling it */
+		if (hal_thread_publish(thread)) {
+		    dlist_add_after(list_entry, prev);
+		    return _halerrno;
+		}
 		/* and delete it */
 		free_funct_entry_struct(funct_entry);
 		/* done */
@@ -410,6 +434,23 @@ void free_funct_entry_struct(hal_funct_entry_t * funct_entry)
 
 #ifdef RTAPI
 
+// the parallel schedule of a thread calls a funct about to
+// go away - drop it. The thread falls back to serial execution until
+// threads are restarted, which rebuilds the schedule. A cycle in
+// progress completes on the retired schedule.
+static void drop_schedule(hal_thread_t *thread, hal_funct_t *funct)
+{
+    if (thread->sched_ptr == 0)
+	return;
+    if (hal_data->threads_running) {
+	HALWARN("funct '%s' removed from parallel thread '%s' "
+		"while running - stopping threads",
+		ho_name(funct), ho_name(thread));
+	hal_data->threads_running = 0;
+    }
+    hal_sched_replace(thread, NULL);
+}
+
 static int thread_cb(hal_object_ptr o, foreach_args_t *args)
 {
     hal_thread_t *thread = o.thread;
@@ -419,21 +460,32 @@ static int thread_cb(hal_object_ptr o, foreach_args_t *args)
     hal_list_t *list_root = &(thread->funct_list);
     hal_list_t *list_entry = dlist_next(list_root);
 
+    int removed = 0;
+
     /* run thru funct_entry list */
     while (list_entry != list_root) {
 	/* point to funct entry */
 	hal_funct_entry_t *funct_entry = (hal_funct_entry_t *) list_entry;
 	/* test it */
 	if (SHMPTR(funct_entry->funct_ptr) == funct) {
+	    drop_schedule(thread, funct);
 	    /* this funct entry points to our funct, unlink */
 	    list_entry = dlist_remove_entry(list_entry);
 	    /* and delete it */
 	    free_funct_entry_struct(funct_entry);
+	    removed++;
 	} else {
 	    /* no match, try the next one */
 	    list_entry = dlist_next(list_entry);
 	}
     }
+    if (removed && hal_thread_publish(thread)) {
+	// the funct's code is about to go away, and the thread can't
+	// be given a table without it - leave it with no functs at all
+	HALERR("thread '%s': dispatch table update failed, "
+	       "thread runs no functs", ho_name(thread));
+	rtapi_store_u32(&thread->dispatch_ptr, 0);
+    }
     return 0;
 }
 
@@ -10,6 +10,12 @@
 #include <stdlib.h>		/* malloc()/free() */
 #include <assert.h>
 #endif
+#if !defined(BUILD_SYS_KBUILD)
+#include <limits.h>		/* INT_MAX */
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 int halg_group_new(const int use_hal_mutex,const char *name, int arg1, int arg2)
 {
@@ -178,8 +184,56 @@ int halg_member_delete(const int use_hal_mutex,const char *group, const char *me
     return 0;
 }
 
+#ifdef RTAPI
+
+void hal_watch_notify(void)
+{
+#if !defined(BUILD_SYS_KBUILD)
+    // without a waiter or a change this is just two loads
+    __u32 slots = __atomic_load_n(&hal_data->watch_notify, __ATOMIC_ACQUIRE);
+    if (likely(slots == 0))
+	return;
+    if (!(__atomic_load_n(&hal_data->watch_dirty, __ATOMIC_ACQUIRE) & slots))
+	return;
+
+    // the first thread to get here does the wakeup
+    if (__atomic_exchange_n(&hal_data->watch_notify, 0, __ATOMIC_ACQ_REL) == 0)
+	return;
+    __atomic_add_fetch(&hal_data->watch_seq, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &hal_data->watch_seq, FUTEX_WAKE, INT_MAX,
+	    NULL, NULL, 0);
+#endif
+}
+
+#endif // RTAPI
+
 #ifdef ULAPI
 
+int hal_watch_wait(__u32 slots, int timeout_ms)
+{
+    if (!hal_data->watch_wakeup)
+	return -ENOTSUP;
+
+    // arm, then look: a change after the look bumps the sequence,
+    // and the wait returns right away
+    __u32 seq = __atomic_load_n(&hal_data->watch_seq, __ATOMIC_ACQUIRE);
+    __atomic_fetch_or(&hal_data->watch_notify, slots, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&hal_data->watch_dirty, __ATOMIC_SEQ_CST) & slots)
+	return 1;
+
+    struct timespec ts = {
+	.tv_sec = timeout_ms / 1000,
+	.tv_nsec = (timeout_ms % 1000) * 1000000L,
+    };
+    if (syscall(SYS_futex, &hal_data->watch_seq, FUTEX_WAIT, seq,
+		timeout_ms < 0 ? NULL : &ts, NULL, 0) < 0) {
+	if (errno == ETIMEDOUT)
+	    return 0;
+	// EAGAIN: woken before we slept, EINTR: caller rechecks
+    }
+    return 1;
+}
+
 static int cgroup_init_members_cb(hal_object_ptr o, foreach_args_t *args)
 {
     hal_member_t *member = o.member;
@@ -208,6 +262,71 @@ static int cgroup_size_cb(hal_object_ptr o, foreach_args_t *args)
     return 0;
 }
 
+static inline bool cgroup_monitored(const hal_compiled_group_t *cg, int i)
+{
+    return (cg->member[i]->userarg1 & MEMBER_MONITOR_CHANGE) ||
+	(cg->group->userarg2 & GROUP_MONITOR_ALL_MEMBERS);
+}
+
+// claim a watch slot, so monitored signals flag the group when they
+// change - see hal_sig_written(). Without a free slot, the group is
+// scanned on every match.
+static void cgroup_watch(hal_compiled_group_t *tc)
+{
+    __u32 slots = __atomic_load_n(&hal_data->watch_slots, __ATOMIC_RELAXED);
+    __u32 bit;
+    int i, m = 0;
+
+    do {
+	if (slots == ~0U) {
+	    HALDBG("group '%s': no watch slot left, scanning on every match",
+		   ho_name(tc->group));
+	    tc->watch_slot = -1;
+	    break;
+	}
+	tc->watch_slot = __builtin_ctz(~slots);
+	bit = 1U << tc->watch_slot;
+    } while (!__atomic_compare_exchange_n(&hal_data->watch_slots, &slots,
+					  slots | bit, false,
+					  __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    for (i = 0; i < tc->n_members; i++) {
+	if (!cgroup_monitored(tc, i))
+	    continue;
+	hal_sig_t *sig = SHMPTR(tc->member[i]->sig_ptr);
+
+	// unknown: compare the value on the first match
+	tc->generation[m++] = sig->generation - 1;
+
+	if (tc->watch_slot < 0)
+	    continue;
+	__atomic_fetch_or(&sig->watchers, bit, __ATOMIC_SEQ_CST);
+	if (sig->legacy_writers)
+	    __atomic_fetch_or(&hal_data->watch_legacy, bit, __ATOMIC_SEQ_CST);
+    }
+    if (tc->watch_slot >= 0)
+	__atomic_fetch_or(&hal_data->watch_dirty, bit, __ATOMIC_SEQ_CST);
+}
+
+static void cgroup_unwatch(hal_compiled_group_t *tc)
+{
+    int i;
+
+    if (tc->watch_slot < 0)
+	return;
+    __u32 bit = 1U << tc->watch_slot;
+    for (i = 0; i < tc->n_members; i++) {
+	if (!cgroup_monitored(tc, i))
+	    continue;
+	hal_sig_t *sig = SHMPTR(tc->member[i]->sig_ptr);
+	__atomic_fetch_and(&sig->watchers, ~bit, __ATOMIC_SEQ_CST);
+    }
+    __atomic_fetch_and(&hal_data->watch_dirty, ~bit, __ATOMIC_SEQ_CST);
+    __atomic_fetch_and(&hal_data->watch_legacy, ~bit, __ATOMIC_SEQ_CST);
+    __atomic_fetch_and(&hal_data->watch_slots, ~bit, __ATOMIC_SEQ_CST);
+    tc->watch_slot = -1;
+}
+
 // group generic change detection & reporting support
 int halpr_group_compile(const char *name, hal_compiled_group_t **cgroup)
 {
@@ -270,15 +389,22 @@ int halpr_group_compile(const char *name, hal_compiled_group_t **cgroup)
 	     malloc(RTAPI_BITMAP_BYTES(tc->n_members))) == NULL)
 	    NOMEM("allocating change bitmap");
 	RTAPI_ZERO_BITMAP(tc->changed, tc->n_members);
+	if ((tc->generation =
+	     malloc(sizeof(__u32) * tc->n_monitored)) == NULL)
+	    NOMEM("allocating generations");
     } else {
 	// nothing to track
 	tc->n_monitored = 0;
 	tc->tracking = NULL;
 	tc->changed = NULL;
+	tc->generation = NULL;
     }
 
     tc->magic = CGROUP_MAGIC;
     tc->group = grp;
+    tc->watch_slot = -1;
+    if (tc->generation)
+	cgroup_watch(tc);
     ho_incref(grp);
     tc->user_data = NULL;
     tc->user_flags = 0;
@@ -308,11 +434,37 @@ int hal_cgroup_match(hal_compiled_group_t *cg)
     // report.
     if (monitor) {
 	RTAPI_ZERO_BITMAP(cg->changed, cg->n_members);
+
+	// skip the walk unless a monitored signal changed since the
+	// last match - or may have, if written through a legacy pin
+	if (cg->watch_slot >= 0) {
+	    __u32 bit = 1U << cg->watch_slot;
+	    if (!(__atomic_load_n(&hal_data->watch_legacy,
+				  __ATOMIC_ACQUIRE) & bit) &&
+		!(__atomic_fetch_and(&hal_data->watch_dirty, ~bit,
+				     __ATOMIC_ACQUIRE) & bit))
+		return 0;
+	}
+
 	for (i = 0; i < cg->n_members; i++) {
-	    if (!((cg->member[i]->userarg1 &  MEMBER_MONITOR_CHANGE) ||
-		  (cg->group->userarg2 &  GROUP_MONITOR_ALL_MEMBERS)))
+	    if (!cgroup_monitored(cg, i))
 		continue;
 	    ho.any = SHMPTR(cg->member[i]->sig_ptr);
+
+	    // an unchanged generation means an unchanged value
+	    if (ho.sig->legacy_writers == 0) {
+		__u32 gen = __atomic_load_n(&ho.sig->generation,
+					    __ATOMIC_ACQUIRE);
+		if (gen == cg->generation[m]) {
+		    m++;
+		    continue;
+		}
+		cg->generation[m] = gen;
+	    } else {
+		// compare the value again once the legacy writer is gone
+		cg->generation[m] = ho.sig->generation - 1;
+	    }
+
 	    switch (sig_type(ho.sig)) {
 	    case HAL_BIT:
 		halbit = _get_bit_sig(ho.sig);
@@ -378,6 +530,7 @@ int hal_cgroup_report(hal_compiled_group_t *cg,
 	!(cg->group->userarg2 & GROUP_REPORT_CHANGED_MEMBERS);
 
     for (i = 0; i < cg->n_members; i++) {
+	cg->mbr_index = i; // lets report_cb tell the member's position
 	if (reportall || RTAPI_BIT_TEST(cg->changed, i))
 	    if ((retval = report_cb(REPORT_SIGNAL, cg,
 				    SHMPTR(cg->member[i]->sig_ptr),
@@ -391,8 +544,11 @@ int hal_cgroup_free(hal_compiled_group_t *cgroup)
 {
     if (cgroup == NULL)
 	HALFAIL_RC(ENOENT, "null cgroup");
+    cgroup_unwatch(cgroup);
     if (cgroup->tracking)
 	free(cgroup->tracking);
+    if (cgroup->generation)
+	free(cgroup->generation);
     if (cgroup->changed)
 	free(cgroup->changed);
     if (cgroup->member)
@@ -27,16 +27,19 @@ typedef struct hal_member {
 } hal_member_t;
 
 #define CGROUP_MAGIC  0xbeef7411
+#define HAL_WATCH_SLOTS 32       // bits in hal_data->watch_dirty
 typedef struct hal_compiled_group {
     int magic;
     hal_group_t *group;
     int n_members;
-    int mbr_index;               // iterator state
+    int mbr_index;               // iterator state; in a report: index of the member
     int mon_index;               // iterator state
     hal_member_t  **member;      // all members (nesting resolved)
     unsigned long *changed;      // bitmap
     int n_monitored;             // count of pins to monitor for change
     hal_data_u    *tracking;     // tracking values of monitored pins
+    __u32         *generation;   // signal generations at last match, per monitored pin
+    int watch_slot;              // bit in hal_data->watch_dirty, -1 if none
     unsigned long user_flags;    // uninterpreted by HAL code
     void *user_data;             // uninterpreted by HAL code
 } hal_compiled_group_t;
@@ -100,6 +103,28 @@ static inline int hal_cgroup_timer(hal_compiled_group_t *cgroup)
 extern int halpr_group_compile(const char *name, hal_compiled_group_t **cgroup);
 extern int hal_cgroup_match(hal_compiled_group_t *cgroup);
 
+// change notification:
+// with a userland RT flavor, HAL threads call hal_watch_notify() after
+// each cycle. It wakes a waiter in hal_watch_wait() once a signal
+// watched by one of the slots the waiter asked for has changed, so a
+// reporting process need not poll compiled groups on a timer.
+//
+// a group is covered iff it got a watch slot and none of its monitored
+// signals has a legacy writer - see hal_cgroup_evented().
+extern void hal_watch_notify(void);
+
+// wait for a change in slots, or timeout_ms to pass (forever if < 0).
+// returns 1 if a change is pending, 0 on timeout, and
+// -ENOTSUP if RT threads don't do wakeups.
+extern int hal_watch_wait(__u32 slots, int timeout_ms);
+
+static inline bool hal_cgroup_evented(const hal_compiled_group_t *cgroup)
+{
+    return hal_data->watch_wakeup && (cgroup->watch_slot >= 0) &&
+	!(__atomic_load_n(&hal_data->watch_legacy, __ATOMIC_ACQUIRE) &
+	  (1U << cgroup->watch_slot));
+}
+
 // given a cgroup which returned a non-zero value from hal_cgroup_match(),
 // generate a report.
 // the report callback is called for the following phases:
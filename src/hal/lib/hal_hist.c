@@ -0,0 +1,70 @@
+// HAL funct/thread latency histograms - see hal_hist.h
+
+#include "config.h"
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "rtapi_string.h"
+#include "rtapi_math64.h"
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* HAL private decls */
+#include "hal_hist.h"
+
+void hal_hist_clear(hal_hist_t *h)
+{
+    memset(h->count, 0, sizeof(h->count));
+    h->samples = 0;
+}
+
+// halve all counts, preserving the shape of the distribution
+void hal_hist_decay(hal_hist_t *h)
+{
+    int i;
+    hal_u32_t n = 0;
+
+    for (i = 0; i < HAL_HIST_BUCKETS; i++) {
+	h->count[i] >>= 1;
+	n += h->count[i];
+    }
+    h->samples = n;
+}
+
+hal_u32_t hal_hist_bucket_low(const int bucket)
+{
+    if (bucket < HAL_HIST_SUBBUCKETS)
+	return bucket;
+    int msb = (bucket >> HAL_HIST_SUBBITS) + HAL_HIST_SUBBITS - 1;
+    return (HAL_HIST_SUBBUCKETS + (bucket & HAL_HIST_SUBMASK))
+	<< (msb - HAL_HIST_SUBBITS);
+}
+
+hal_u32_t hal_hist_bucket_high(const int bucket)
+{
+    if (bucket >= HAL_HIST_BUCKETS - 1)
+	return 0x7fffffff; // overflow bucket - off scale
+    return hal_hist_bucket_low(bucket + 1) - 1;
+}
+
+hal_u32_t hal_hist_percentile(const hal_hist_t *h, const int per10k)
+{
+    hal_u32_t snap[HAL_HIST_BUCKETS];
+    unsigned long long total = 0, target, sum = 0;
+    int i;
+
+    // the RT side may be updating counts while we look, so work off
+    // a copy and derive the total from it rather than h->samples
+    for (i = 0; i < HAL_HIST_BUCKETS; i++) {
+	snap[i] = h->count[i];
+	total += snap[i];
+    }
+    if (total == 0)
+	return 0;
+
+    target = rtapi_div_u64(total * per10k + 9999, 10000);
+    if (target == 0)
+	target = 1;
+    for (i = 0; i < HAL_HIST_BUCKETS; i++) {
+	sum += snap[i];
+	if (sum >= target)
+	    return hal_hist_bucket_high(i);
+    }
+    return hal_hist_bucket_high(HAL_HIST_BUCKETS - 1);
+}
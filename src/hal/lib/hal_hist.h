@@ -0,0 +1,96 @@
+#ifndef HAL_HIST_H
+#define HAL_HIST_H
+
+// fixed-bucket, log-scaled latency histograms for HAL functs and threads
+//
+// a histogram lives inside the funct/thread descriptor in HAL shm,
+// so it is visible from any process mapping the HAL segment.
+//
+// the owning RT thread is the only writer of the bucket counts.
+// userland never modifies counts - a reset is requested by bumping
+// reset_req, and honored by the RT side at the next sample, which
+// keeps the whole scheme lock free.
+//
+// bucket layout: values 0..3ns map 1:1 to buckets 0..3; thereafter
+// each power-of-two octave is split into 2^HAL_HIST_SUBBITS buckets
+// (quarter-octave resolution, i.e. at most 25% relative error).
+// the last bucket catches everything above ~25ms.
+
+#include "rtapi.h"
+#include "hal_types.h"
+
+RTAPI_BEGIN_DECLS
+
+#define HAL_HIST_SUBBITS       2
+#define HAL_HIST_SUBBUCKETS    (1 << HAL_HIST_SUBBITS)
+#define HAL_HIST_SUBMASK       (HAL_HIST_SUBBUCKETS - 1)
+#define HAL_HIST_BUCKETS       96
+
+// halve all counts when a window gets this many samples, so the
+// histogram never saturates on long-running threads
+#define HAL_HIST_MAXSAMPLES    0x80000000U
+
+// thread percentile pins are recomputed every this many cycles
+#define HAL_HIST_REFRESH_MASK  0xff
+
+// percentiles are given in parts per 10000
+#define HAL_HIST_P50           5000
+#define HAL_HIST_P99           9900
+#define HAL_HIST_P999          9990
+
+typedef struct hal_hist {
+    hal_u32_t count[HAL_HIST_BUCKETS];
+    hal_u32_t samples;         // samples in current window
+    hal_u32_t reset_req;       // bumped by userland to request a reset
+    hal_u32_t reset_ack;       // RT side copy of reset_req once honored
+    hal_u32_t windows;         // number of completed windows (resets)
+} hal_hist_t;
+
+// map a duration in nsec onto its bucket index
+static inline int hal_hist_bucket(const hal_s32_t ns)
+{
+    hal_u32_t v = (ns < 0) ? 0 : ns;
+    if (v < HAL_HIST_SUBBUCKETS)
+	return v;
+    int msb = 31 - __builtin_clz(v);
+    int b = ((msb - HAL_HIST_SUBBITS + 1) << HAL_HIST_SUBBITS) +
+	((v >> (msb - HAL_HIST_SUBBITS)) & HAL_HIST_SUBMASK);
+    return (b < HAL_HIST_BUCKETS) ? b : HAL_HIST_BUCKETS - 1;
+}
+
+void hal_hist_clear(hal_hist_t *h);
+void hal_hist_decay(hal_hist_t *h);
+
+// record a sample. RT side only - must be called by the owning thread.
+static inline void hal_hist_sample(hal_hist_t *h, const hal_s32_t ns)
+{
+    if (unlikely(h->reset_ack != h->reset_req)) {
+	hal_hist_clear(h);
+	h->reset_ack = h->reset_req;
+	h->windows++;
+    }
+    if (unlikely(h->samples >= HAL_HIST_MAXSAMPLES))
+	hal_hist_decay(h);
+    h->count[hal_hist_bucket(ns)]++;
+    h->samples++;
+}
+
+// request a reset of the histogram window. callable from userland.
+static inline void hal_hist_reset(hal_hist_t *h)
+{
+    h->reset_req++;
+}
+
+// smallest and largest value (nsec) falling into a bucket
+hal_u32_t hal_hist_bucket_low(const int bucket);
+hal_u32_t hal_hist_bucket_high(const int bucket);
+
+// return the upper bound (nsec) of the bucket containing the given
+// percentile, in parts per 10000. returns 0 for an empty histogram.
+// safe to call concurrently with the RT writer: the result is
+// computed from a single pass over the counts.
+hal_u32_t hal_hist_percentile(const hal_hist_t *h, const int per10k);
+
+RTAPI_END_DECLS
+
+#endif // HAL_HIST_H
@@ -59,6 +59,70 @@ void hal_proc_clean(void);
 int hal_proc_init(void);
 
 void free_thread_struct(hal_thread_t * thread);
+
+// (re)build the dispatch table of a thread from its funct list, and
+// publish it. Called with the HAL mutex held.
+int hal_thread_publish(hal_thread_t *thread);
+
+// republish the dispatch tables of all threads calling a funct,
+// e.g. after its barriers changed. Called with the HAL mutex held.
+int hal_funct_republish(hal_funct_t *funct);
+
+// fill in a call record from a funct entry.
+void hal_funct_call_init(hal_funct_call_t *call,
+			 const hal_funct_entry_t *funct_entry);
+
+#ifdef RTAPI
+// call a funct as described by a call record, honoring barriers, and
+// update its execution time pins and histogram.
+// fa->start_time must be the invocation time of this funct.
+// returns the end time, to be used as start time of the next funct.
+static inline long long int call_funct(const hal_funct_call_t *call,
+				       hal_funct_args_t *fa)
+{
+    long long int end_time;
+    hal_s32_t delta;
+
+    fa->funct = SHMPTR(call->funct_ptr);
+
+    if (call->rmb) {
+	rtapi_smp_rmb();
+    }
+
+    /* call the function */
+    switch (call->type) {
+    case FS_LEGACY_THREADFUNC:
+	call->funct.l(call->arg, fa->thread->period);
+	break;
+    case FS_XTHREADFUNC:
+	call->funct.x(call->arg, fa);
+	break;
+    default:
+	// bad - a mistyped funct
+	;
+    }
+    // capture execution time of this funct
+    end_time = rtapi_get_time();
+
+    /* update execution time data */
+    delta = end_time - fa->start_time;
+    set_s32_pin(fa->funct->f_runtime, delta);
+    hal_hist_sample(&fa->funct->hist, delta);
+    if ( delta > get_s32_pin(fa->funct->f_maxtime)) {
+	set_s32_pin(fa->funct->f_maxtime, delta);
+#ifdef ENABLE_TMAX_INC
+	set_bit_pin(fa->funct->f_maxtime_increased, 1);
+    } else {
+	set_bit_pin(fa->funct->f_maxtime_increased, 0);
+#endif
+    }
+
+    if (call->wmb) {
+	rtapi_smp_wmb();
+    }
+    return end_time;
+}
+#endif
 extern int lib_module_id;
 extern int lib_mem_id;
 
@@ -151,6 +151,10 @@ void report_heapstatus(const char *tag,  struct rtapi_heap *h)
 	HALDBG("%s heap status\n", tag);
 	HALDBG("  arena=%zu totail_avail=%zu fragments=%zu largest=%zu\n",
 	       hs.arena_size, hs.total_avail, hs.fragments, hs.largest);
+	// share of free memory not usable for the largest possible request
+	HALDBG("  fragmentation=%zu%%\n",
+	       hs.total_avail ?
+	       100 - hs.largest*100/hs.total_avail : 0);
 	HALDBG("  requested=%zu allocated=%zu freed=%zu waste=%zu%%\n",
 	       hs.requested, hs.allocated, hs.freed,
 	       hs.allocated ?
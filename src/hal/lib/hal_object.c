@@ -164,41 +164,169 @@ void *halg_create_objectfv(const bool use_hal_mutex,
 }
 
 
-// iterator callback for halg_add_object()
-// determines insertion point
-static int find_previous(hal_object_ptr o, foreach_args_t *args)
+// hashed index of HAL objects
+//
+// every object added by halg_add_object() is entered into two
+// hash tables: by type and name, and by id (ids are unique across
+// types). The bucket arrays are allocated from the HAL heap, and the
+// chains are linked through the object headers by shm offset, so the
+// index works in any mapping of HAL shm. An empty bucket or end of
+// chain is offset 0, which is hal_data itself.
+//
+// the tables double in size once there are more objects than
+// buckets. If that fails, chains just get longer - and without any
+// table at all, lookups fall back to walking the object list.
+//
+// all index operations require the HAL mutex.
+
+#define HAL_INDEX_MIN_SIZE 1024  // initial number of buckets, power of two
+
+// FNV-1a over the name, seeded with the object type
+static inline __u32 name_hash(const int type, const char *name)
 {
-    hal_object_ptr new = (hal_object_ptr) args->user_ptr1;
-
-    // compare the name of the current object to the name of
-    // the object to be inserted:
-    int ret = strcmp(hh_get_name(new.hdr), hh_get_name(o.hdr));
-    if (ret < 0) {
-	// advance point of insertion:
-	args->user_ptr2 = (void *)&o.hdr->list;
-	return 1; // stop iteration
+    __u32 h = 2166136261U ^ (__u32) type;
+
+    while (*name) {
+	h ^= (unsigned char) *name++;
+	h *= 16777619U;
+    }
+    return h;
+}
+
+// ids are handed out sequentially, which spreads them evenly as-is
+static inline __u32 id_hash(const int id)
+{
+    return (__u32) id;
+}
+
+static inline shmoff_t *name_bucket(const int type, const char *name)
+{
+    shmoff_t *buckets = SHMPTR(hal_data->name_index);
+    return &buckets[name_hash(type, name) & (hal_data->index_size - 1)];
+}
+
+static inline shmoff_t *id_bucket(const int id)
+{
+    shmoff_t *buckets = SHMPTR(hal_data->id_index);
+    return &buckets[id_hash(id) & (hal_data->index_size - 1)];
+}
+
+static void index_link(halhdr_t *hh)
+{
+    shmoff_t *b = name_bucket(hh_get_object_type(hh), hh_get_name(hh));
+    hh->_name_next = *b;
+    *b = SHMOFF(hh);
+
+    b = id_bucket(hh_get_id(hh));
+    hh->_id_next = *b;
+    *b = SHMOFF(hh);
+}
+
+// (re)build the index at a given size from the valid objects
+static int index_rebuild(const unsigned size)
+{
+    shmoff_t *names = shmalloc_desc(size * sizeof(shmoff_t));
+    shmoff_t *ids = shmalloc_desc(size * sizeof(shmoff_t));
+    halhdr_t *hh;
+
+    if ((names == NULL) || (ids == NULL)) {
+	if (names)
+	    shmfree_desc(names);
+	if (ids)
+	    shmfree_desc(ids);
+	return -ENOMEM;
+    }
+    if (hal_data->index_size) {
+	shmfree_desc(SHMPTR(hal_data->name_index));
+	shmfree_desc(SHMPTR(hal_data->id_index));
+    }
+    hal_data->name_index = SHMOFF(names);
+    hal_data->id_index = SHMOFF(ids);
+    hal_data->index_size = size;
+    hal_data->index_count = 0;
+
+    dlist_for_each_entry(hh, OBJECTLIST, list) {
+	if (!hh_is_valid(hh))
+	    continue;
+	index_link(hh);
+	hal_data->index_count++;
+    }
+    return 0;
+}
+
+static void index_insert(halhdr_t *hh)
+{
+    unsigned size = hal_data->index_size;
+
+    // grow before linking: the rebuild picks up hh from the object list
+    if (size == 0) {
+	if (index_rebuild(HAL_INDEX_MIN_SIZE) == 0)
+	    return;
+    } else if (hal_data->index_count >= size) {
+	if (index_rebuild(size * 2) == 0)
+	    return;
+	HALDBG("could not grow object index beyond %u buckets", size);
     }
-    return 0; // continue iteration
+    if (hal_data->index_size == 0)
+	return;
+    index_link(hh);
+    hal_data->index_count++;
+}
+
+// unlink hh from a chain starting at *link
+static bool index_unlink(shmoff_t *link, halhdr_t *hh, const bool by_name)
+{
+    shmoff_t off = SHMOFF(hh);
+
+    while (*link) {
+	halhdr_t *cur = SHMPTR(*link);
+	if (*link == off) {
+	    *link = by_name ? cur->_name_next : cur->_id_next;
+	    return true;
+	}
+	link = by_name ? &cur->_name_next : &cur->_id_next;
+    }
+    return false;
+}
+
+static void index_remove(halhdr_t *hh)
+{
+    if (hal_data->index_size == 0)
+	return;
+    // objects which failed to initialize may never have been added
+    if (index_unlink(name_bucket(hh_get_object_type(hh), hh_get_name(hh)),
+		     hh, true))
+	hal_data->index_count--;
+    index_unlink(id_bucket(hh_get_id(hh)), hh, false);
+    hh->_name_next = hh->_id_next = 0;
 }
 
 void halg_add_object(const bool use_hal_mutex,
 		     hal_object_ptr o)
 {
-    // args.user_ptr2 is the potential point of insertion
-    // for the new object within the object list.
-    // start at head, and iterate over objects of the same type.
-    foreach_args_t args =  {
-	// visit objects of the same type as the one to be inserted:
-	.type = hh_get_object_type(o.hdr),
-	// object to be inserted
-	.user_ptr1 = o.any,
-	// current head
-	.user_ptr2 = OBJECTLIST,
-    };
-    halg_foreach(0, &args, find_previous);
-    // insert new object after the new insertion point.
-    // if nothing found, insert after head.
-    dlist_add_before(&o.hdr->list, args.user_ptr2);
+    const unsigned type = hh_get_object_type(o.hdr);
+    const char *name = hh_get_name(o.hdr);
+    hal_list_t *pos, *next = OBJECTLIST;
+
+    // the object goes just before the first object of the same type
+    // whose name sorts after the new one, or at the tail if there is
+    // none. objects tend to be created in name order, so search from
+    // the end, and stop at the first object of the same type whose
+    // name does not sort after the new one.
+    for (pos = dlist_prev(OBJECTLIST);
+	 pos != OBJECTLIST;
+	 pos = dlist_prev(pos)) {
+	halhdr_t *hh = (halhdr_t *) pos;  // list is the first member
+	if (!hh_is_valid(hh) || (hh_get_object_type(hh) != type))
+	    continue;
+	if (strcmp(hh_get_name(hh), name) <= 0)
+	    break;
+	next = pos;
+    }
+    // before the head is the tail
+    dlist_add_before(&o.hdr->list, next);
+
+    index_insert(o.hdr);
 
     // make sure all values visible everywhere
     rtapi_smp_mb();
@@ -216,6 +344,9 @@ int halg_free_object(const bool use_hal_mutex,
 		   hh_get_refcnt(o.hdr));
     }
 
+    // lookups by name and id must not find it any more
+    index_remove(o.hdr);
+
     // zap the header, including valid bit
     // marks object for garbage collection by halg_sweep()
     hh_clear_hdr(o.hdr);
@@ -428,6 +559,10 @@ int halg_object_setbarriers(const int use_hal_mutex,
 	// if setting barriers on signal, propagate to pins:
 	if (hh_get_object_type(o.hdr) == HAL_SIGNAL)
 	    halg_signal_propagate_barriers(0, o.sig);
+
+	// funct barriers are cached in the thread dispatch tables:
+	if (hh_get_object_type(o.hdr) == HAL_FUNCT)
+	    return hal_funct_republish(o.funct);
     }
     return 0;
 }
@@ -436,12 +571,29 @@ hal_object_ptr halg_find_object_by_name(const int use_hal_mutex,
 					const int type,
 					const char *name)
 {
-    foreach_args_t args =  {
-	.type = type,
-	.name = (char *)name,
-    };
-    if (halg_foreach(use_hal_mutex, &args, yield_match))
-	return (hal_object_ptr) args.user_ptr1;
+    // without a type, names are not unique - walk the list
+    if ((type == 0) || (hal_data->index_size == 0)) {
+	foreach_args_t args =  {
+	    .type = type,
+	    .name = (char *)name,
+	};
+	if (halg_foreach(use_hal_mutex, &args, yield_match))
+	    return (hal_object_ptr) args.user_ptr1;
+	return HO_NULL;
+    }
+    {
+	WITH_HAL_MUTEX_IF(use_hal_mutex);
+	shmoff_t off = *name_bucket(type, name);
+
+	while (off) {
+	    halhdr_t *hh = SHMPTR(off);
+	    if (hh_is_valid(hh) &&
+		(hh_get_object_type(hh) == type) &&
+		!strcmp(hh_get_name(hh), name))
+		return (hal_object_ptr) hh;
+	    off = hh->_name_next;
+	}
+    }
     return HO_NULL;
 }
 
@@ -449,11 +601,27 @@ hal_object_ptr halg_find_object_by_id(const int use_hal_mutex,
 				      const int type,
 				      const int id)
 {
-    foreach_args_t args =  {
-	.type = type,
-	.id = id
-    };
-    if (halg_foreach(use_hal_mutex, &args, yield_match) == 1)
-	return (hal_object_ptr) args.user_ptr1;
+    if (hal_data->index_size == 0) {
+	foreach_args_t args =  {
+	    .type = type,
+	    .id = id
+	};
+	if (halg_foreach(use_hal_mutex, &args, yield_match) == 1)
+	    return (hal_object_ptr) args.user_ptr1;
+	return HO_NULL;
+    }
+    {
+	WITH_HAL_MUTEX_IF(use_hal_mutex);
+	shmoff_t off = *id_bucket(id);
+
+	while (off) {
+	    halhdr_t *hh = SHMPTR(off);
+	    if (hh_is_valid(hh) &&
+		(hh_get_id(hh) == id) &&
+		((type == 0) || (hh_get_object_type(hh) == type)))
+		return (hal_object_ptr) hh;
+	    off = hh->_id_next;
+	}
+    }
     return HO_NULL;
 }
@@ -52,6 +52,10 @@ typedef struct halhdr {
                                        // operating on this object
     __u32    _wmb    : 1;              // issue a writer barrier after
                                        // operating on this object
+
+    // chaining in the hashed object index, see hal_object.c
+    shmoff_t _name_next;               // next object in name bucket
+    shmoff_t _id_next;                 // next object in id bucket
 } halhdr_t;
 
 #define OBJECTLIST (&hal_data->halobjects)  // head of all named HAL objects
@@ -161,10 +165,13 @@ static inline void *halg_create_objectf(const bool use_hal_mutex,
 
 // adds a HAL object into the object list with partial ordering:
 // all objects of the same type will be kept sorted by name.
+// also enters the object into the hashed index used by
+// halg_find_object_by_name() and halg_find_object_by_id().
 void halg_add_object(const bool use_hal_mutex,  hal_object_ptr o);
 
 // free a HAL object
-// invalidates the object, and marks it for deletion by halg_sweep().
+// invalidates the object, removes it from the index,
+// and marks it for deletion by halg_sweep().
 // returns -EBUSY if reference count not zero.
 int halg_free_object(const bool use_hal_mutex, hal_object_ptr o);
 
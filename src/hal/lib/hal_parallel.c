@@ -0,0 +1,350 @@
+// HAL parallel thread execution
+//
+// a thread created with worker CPUs runs its functs as a dependency
+// graph rather than strictly in list order:
+//
+// - each funct entry is attributed the signals it reads and writes,
+//   derived from the linkage of the pins owned by the funct's owner.
+//   For legacy components, where all pins of all instances are owned
+//   by the component, pins are attributed by name prefix
+//   ('pid.3.do-pid-calcs' touches 'pid.3.*'). If no pin matches the
+//   prefix ('motion-controller' has no dot), all pins of the component
+//   are attributed to the funct.
+//
+// - two entries conflict if one writes a signal the other reads or
+//   writes, or if they share an owner and instance data (same arg,
+//   or arg == NULL where instances can't be told apart).
+//
+// - each entry is assigned level = 1 + max(level of conflicting
+//   earlier entries), so the relative order of dependent functs in the
+//   thread's funct list is preserved.
+//
+// - entries of a level are distributed over the lanes (lane 0 is the
+//   thread itself, lanes 1..n its workers), balanced by the median
+//   runtime of each funct as recorded in its histogram.
+//
+// At runtime, a lane runs its slots in level order; before starting a
+// slot of level L it spins until the completion counter of level L-1
+// shows all of that level done for the current cycle. Levels complete
+// in order, so the thread joins by waiting for the last level.
+//
+// schedules are immutable once published, and are rebuilt by
+// hal_start_threads(), which also picks up the runtime statistics of
+// the previous run. A cycle may still be in progress then, so a
+// replaced schedule is retired, not freed: the thread runs the cycle
+// on the schedule it published in thread->cycle_sched, and a worker
+// holds that schedule as its hazard while it runs its lane. The
+// retired schedule is freed once the thread has passed a quiescent
+// point and no worker holds it.
+
+#include "config.h"
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "rtapi_atomics.h"
+#include "rtapi_string.h"
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* HAL private decls */
+#include "hal_internal.h"
+
+// signals touched by a funct entry
+typedef struct {
+    int sig;                    // shm offset of hal_sig_t
+    int writes;
+} touch_t;
+
+typedef struct {
+    hal_funct_entry_t *fe;
+    hal_funct_t *funct;
+    int first_touch;            // range into touches[]
+    int n_touch;
+    int level;
+    int lane;
+    int assigned;
+    hal_u32_t weight;
+} node_t;
+
+typedef struct {
+    touch_t *touches;           // NULL while counting
+    int n_touches;
+    int n_matched;              // pins matching prefix, linked or not
+    const char *prefix;         // name prefix filter for legacy comps
+    size_t prefix_len;
+} collect_t;
+
+static int collect_pin(hal_object_ptr o, foreach_args_t *args)
+{
+    collect_t *c = args->user_ptr1;
+    hal_sig_t *sig = signal_of(o.pin);
+
+    if (c->prefix && strncmp(ho_name(o.pin), c->prefix, c->prefix_len))
+	return 0;
+    c->n_matched++;
+    if (sig == NULL)
+	return 0; // unlinked pins are private
+    if (c->touches) {
+	c->touches[c->n_touches].sig = SHMOFF(sig);
+	c->touches[c->n_touches].writes = (pin_dir(o.pin) != HAL_IN);
+    }
+    c->n_touches++;
+    return 0;
+}
+
+// attribute pins to a funct, appending to c->touches if non-NULL.
+// returns the number of pins attributed.
+static int collect_funct(hal_funct_t *funct, collect_t *c)
+{
+    char prefix[HAL_MAX_NAME_LEN + 2];
+    int start = c->n_touches;
+    foreach_args_t args =  {
+	.type = HAL_PIN,
+	.owner_id = ho_owner_id(funct),
+	.user_ptr1 = c,
+    };
+
+    c->prefix = NULL;
+    if (halpr_find_inst_by_id(ho_owner_id(funct)) == NULL) {
+	// legacy comp: try '<funct>.' first, then '<dirname(funct)>.',
+	// then all pins of the comp
+	rtapi_snprintf(prefix, sizeof(prefix), "%s.", ho_name(funct));
+	c->prefix = prefix;
+	c->prefix_len = strlen(prefix);
+	c->n_matched = 0;
+	halg_foreach(0, &args, collect_pin);
+	if (c->n_matched)
+	    return c->n_touches - start;
+
+	char *dot = strrchr(prefix, '.');
+	*dot = '\0';
+	dot = strrchr(prefix, '.');
+	if (dot) {
+	    dot[1] = '\0';
+	    c->prefix_len = strlen(prefix);
+	    c->n_matched = 0;
+	    halg_foreach(0, &args, collect_pin);
+	    if (c->n_matched)
+		return c->n_touches - start;
+	}
+	c->prefix = NULL;
+    }
+    halg_foreach(0, &args, collect_pin);
+    return c->n_touches - start;
+}
+
+static bool conflicts(const node_t *a, const node_t *b, const touch_t *t)
+{
+    int i, j;
+
+    if (ho_owner_id(a->funct) == ho_owner_id(b->funct) &&
+	((a->fe->arg == b->fe->arg) ||
+	 (a->fe->arg == NULL) || (b->fe->arg == NULL)))
+	return true;
+
+    for (i = a->first_touch; i < a->first_touch + a->n_touch; i++)
+	for (j = b->first_touch; j < b->first_touch + b->n_touch; j++)
+	    if ((t[i].sig == t[j].sig) && (t[i].writes || t[j].writes))
+		return true;
+    return false;
+}
+
+int hal_thread_schedule(hal_thread_t *thread)
+{
+    hal_list_t *list_root = &thread->funct_list;
+    hal_list_t *le;
+    node_t *node;
+    collect_t c = { 0 };
+    int i, j, n = 0, n_levels = 0, n_lanes = thread->n_workers + 1;
+
+    if (thread->n_workers == 0)
+	return 0;
+
+    for (le = dlist_next(list_root); le != list_root; le = dlist_next(le))
+	n++;
+
+    // count, then collect pin attributions
+    for (le = dlist_next(list_root); le != list_root; le = dlist_next(le))
+	collect_funct(SHMPTR(((hal_funct_entry_t *)le)->funct_ptr), &c);
+
+    node = shmalloc_desc(sizeof(node_t) * (n ? n : 1));
+    touch_t *touches = shmalloc_desc(sizeof(touch_t) *
+				     (c.n_touches ? c.n_touches : 1));
+    if ((node == NULL) || (touches == NULL)) {
+	if (node) shmfree_desc(node);
+	if (touches) shmfree_desc(touches);
+	return _halerrno;
+    }
+    c.touches = touches;
+    c.n_touches = 0;
+
+    for (i = 0, le = dlist_next(list_root);
+	 le != list_root;
+	 i++, le = dlist_next(le)) {
+	node[i].fe = (hal_funct_entry_t *)le;
+	node[i].funct = SHMPTR(node[i].fe->funct_ptr);
+	node[i].first_touch = c.n_touches;
+	node[i].n_touch = collect_funct(node[i].funct, &c);
+	node[i].weight = hal_hist_percentile(&node[i].funct->hist,
+					     HAL_HIST_P50);
+	if (node[i].weight == 0)
+	    node[i].weight = 1;
+
+	// level: one past the highest conflicting predecessor
+	node[i].level = 0;
+	for (j = 0; j < i; j++) {
+	    if ((node[j].level >= node[i].level) &&
+		conflicts(&node[j], &node[i], touches))
+		node[i].level = node[j].level + 1;
+	}
+	if (node[i].level >= n_levels)
+	    n_levels = node[i].level + 1;
+    }
+
+    // balance each level across lanes: heaviest first onto the
+    // least loaded lane
+    for (int level = 0; level < n_levels; level++) {
+	hal_u32_t load[HAL_MAX_LANES] = { 0 };
+	for (;;) {
+	    int pick = -1;
+	    for (i = 0; i < n; i++)
+		if ((node[i].level == level) && !node[i].assigned &&
+		    ((pick < 0) || (node[i].weight > node[pick].weight)))
+		    pick = i;
+	    if (pick < 0)
+		break;
+	    int best = 0;
+	    for (j = 1; j < n_lanes; j++)
+		if (load[j] < load[best])
+		    best = j;
+	    load[best] += node[pick].weight;
+	    node[pick].lane = best;
+	    node[pick].assigned = 1;
+	}
+    }
+
+    size_t size = sizeof(hal_sched_t) +
+	n * sizeof(hal_sched_slot_t) +
+	2 * n_levels * sizeof(hal_u32_t);
+    hal_sched_t *sched = shmalloc_desc_aligned(size, RTAPI_CACHELINE);
+    if (sched == NULL) {
+	shmfree_desc(node);
+	shmfree_desc(touches);
+	return _halerrno;
+    }
+    memset(sched, 0, size);
+    sched->n_levels = n_levels;
+    sched->n_slots = n;
+    sched->n_lanes = n_lanes;
+
+    // slots sorted by lane, then level, then list order
+    hal_sched_slot_t *slot = sched_slots(sched);
+    hal_u32_t *level_size = sched_level_size(sched);
+    int k = 0;
+    for (int lane = 0; lane < n_lanes; lane++) {
+	sched->lane_start[lane] = k;
+	for (int level = 0; level < n_levels; level++) {
+	    for (i = 0; i < n; i++) {
+		if ((node[i].level != level) || (node[i].lane != lane))
+		    continue;
+		node[i].fe->lane = lane;
+		hal_funct_call_init(&slot[k].call, node[i].fe);
+		slot[k].level = level;
+		level_size[level]++;
+		k++;
+	    }
+	}
+    }
+    sched->lane_start[n_lanes] = k;
+
+    // publish, and retire the previous schedule
+    hal_sched_replace(thread, n ? sched : NULL);
+    if (n == 0)
+	shmfree_desc(sched);
+
+    HALDBG("thread '%s': %d functs in %d levels on %d lanes",
+	   ho_name(thread), n, n_levels, n_lanes);
+
+    shmfree_desc(node);
+    shmfree_desc(touches);
+    return 0;
+}
+
+// free retired schedules neither the thread nor a worker can be using
+static void reclaim_sched(hal_thread_t *thread)
+{
+    hal_u32_t qs = rtapi_load_u32(&thread->qs);
+    int *prev = &thread->sched_retired_ptr;
+
+    while (*prev) {
+	hal_sched_t *s = SHMPTR(*prev);
+	bool busy = (s->retired_qs == qs);
+
+	for (int i = 0; i < thread->n_workers; i++)
+	    if (rtapi_load_u32(&thread->worker[i].hazard) == (hal_u32_t) *prev)
+		busy = true;
+	if (busy) {
+	    prev = &s->next;
+	} else {
+	    *prev = s->next;
+	    shmfree_desc(s);
+	}
+    }
+}
+
+void hal_sched_replace(hal_thread_t *thread, hal_sched_t *sched)
+{
+    hal_u32_t old = thread->sched_ptr;
+
+    rtapi_store_u32(&thread->sched_ptr, sched ? SHMOFF(sched) : 0);
+
+    // the store must be visible before qs and the hazards are
+    // sampled, or a reader which still picked up the old schedule
+    // could be missed
+    rtapi_smp_mb();
+    if (old) {
+	hal_sched_t *os = SHMPTR(old);
+	os->retired_qs = rtapi_load_u32(&thread->qs);
+	os->next = thread->sched_retired_ptr;
+	thread->sched_retired_ptr = old;
+    }
+    reclaim_sched(thread);
+}
+
+void hal_sched_free(hal_thread_t *thread)
+{
+    if (thread->sched_ptr) {
+	shmfree_desc(SHMPTR(thread->sched_ptr));
+	thread->sched_ptr = 0;
+    }
+    thread->cycle_sched = 0;
+    while (thread->sched_retired_ptr) {
+	hal_sched_t *s = SHMPTR(thread->sched_retired_ptr);
+	thread->sched_retired_ptr = s->next;
+	shmfree_desc(s);
+    }
+}
+
+#ifdef RTAPI
+void hal_sched_run_lane(hal_thread_t *thread,
+			hal_sched_t *sched,
+			const int lane,
+			const hal_u32_t cycle,
+			hal_funct_args_t *fa)
+{
+    hal_sched_slot_t *slot = sched_slots(sched);
+    hal_u32_t *level_size = sched_level_size(sched);
+    hal_u32_t *level_done = sched_level_done(sched);
+    int i;
+
+    for (i = sched->lane_start[lane]; i < sched->lane_start[lane + 1]; i++) {
+	int level = slot[i].level;
+
+	// wait for the previous level to complete in this cycle
+	if (level > 0) {
+	    hal_u32_t target = cycle * level_size[level - 1];
+	    while (rtapi_load_u32(&level_done[level - 1]) != target)
+		;
+	}
+	fa->start_time = rtapi_get_time();
+	call_funct(&slot[i].call, fa);
+	rtapi_add_u32(&level_done[level], 1);
+    }
+}
+#endif
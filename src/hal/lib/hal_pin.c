@@ -330,6 +330,9 @@ void unlink_pin(hal_pin_t * pin)
 	if (pin->dir == HAL_IO) {
 	    sig->bidirs--;
 	}
+	if (hh_get_legacy(&pin->hdr) && (pin->dir != HAL_IN)) {
+	    sig->legacy_writers--;
+	}
 	/* mark pin as unlinked */
 	pin_set_unlinked(pin);
 
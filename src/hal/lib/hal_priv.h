@@ -181,6 +181,7 @@ typedef union {
 
 #include "hal_list.h"    // needs SHMPTR/SHMOFF
 #include "hal_object.h"  // needs hal_list_t
+#include "hal_hist.h"    // funct/thread latency histograms
 
 /***********************************************************************
 *            PRIVATE HAL DATA STRUCTURES AND DECLARATIONS              *
@@ -236,6 +237,19 @@ typedef struct {
     size_t rt_alignment_loss;
     size_t hal_malloced; // mostly by comps doing hal_malloc()
 
+    // hashed index of named HAL objects, see hal_object.c
+    shmoff_t name_index;        // bucket array by type and name, 0 if none
+    shmoff_t id_index;          // bucket array by id
+    unsigned index_size;        // number of buckets, a power of two
+    unsigned index_count;       // number of objects indexed
+
+    // signal change tracking for compiled groups, see hal_group.c
+    __u32 watch_slots;          // allocated watch slots, bit per slot
+    __u32 watch_dirty;          // slots with a signal changed since last match
+    __u32 watch_legacy;         // slots with a signal written by a legacy pin
+    __u32 watch_notify;         // slots a waiter wants to be woken for
+    __u32 watch_seq;            // futex word, bumped on each wakeup
+    int watch_wakeup;           // RT threads do wakeups, see hal_watch_notify()
 
     // HAL heap for shmalloc_desc()
     struct rtapi_heap heap;
@@ -341,6 +355,13 @@ typedef struct hal_sig {
     int readers;		/* number of input pins linked */
     int writers;		/* number of output pins linked */
     int bidirs;			/* number of I/O pins linked */
+
+    // change tracking: the accessors bump generation when they change
+    // the value. Legacy pins write through a raw pointer, so while any
+    // legacy writer is linked the generation can't be relied upon.
+    __u32 generation;		// value change count
+    __u32 watchers;		// watch slots of compiled groups with this member
+    int legacy_writers;		// legacy output and I/O pins linked
 } hal_sig_t;
 
 
@@ -576,6 +597,7 @@ typedef struct hal_funct {
     s32_pin_ptr f_runtime;	// (pin) duration of last run, in nsec
     s32_pin_ptr f_maxtime;	// duration of longest run, in nsec
     bit_pin_ptr f_maxtime_increased;	// on last call, maxtime increased
+    hal_hist_t hist;            // distribution of runtimes, see hal_hist.h
     int uses_fp;		/* floating point flag */
     int reentrant;		/* non-zero if function is re-entrant */
     int users;			/* number of threads using function */
@@ -586,12 +608,101 @@ typedef struct hal_funct_entry {
     __u8 rmb;                   // issue a read barrier before calling this funct
     __u8 wmb;                   // issue a write barrier after calling this funct
     __u8 type;
-    __u8 spare;
+    __u8 lane;                  // parallel threads: lane assigned by scheduler
     void *arg;			/* argument for function */
     hal_funct_u funct;          // ptr to function code
     int funct_ptr;		/* pointer to function */
 } hal_funct_entry_t;
 
+// a funct entry flattened for execution: everything the RT loop
+// needs to invoke a funct, without chasing the funct list or the
+// funct descriptor. The descriptor is only touched afterwards, to
+// record execution time - its time pins may be linked, so their
+// data location can't be cached here.
+typedef struct hal_funct_call {
+    hal_funct_u funct;          // ptr to function code
+    void *arg;			/* argument for function */
+    int funct_ptr;		/* descriptor, for execution time stats */
+    __u8 type;
+    __u8 rmb;                   // funct entry or funct read barrier
+    __u8 wmb;                   // funct entry or funct write barrier
+} hal_funct_call_t;
+
+// the immutable, contiguous dispatch table of a thread, a copy of its
+// funct list. Replaced as a whole on any change of the funct list
+// (see hal_thread_publish()), so the RT loop picks up either the old
+// or the new table at cycle start, and never waits on a configuration
+// change. A replaced table is retired, and freed once the thread has
+// passed a quiescent point (thread->qs moved on).
+typedef struct hal_dispatch {
+    int n_calls;
+    int next;                   // retired list link
+    hal_u32_t retired_qs;       // thread->qs at time of retirement
+    hal_funct_call_t call[0] __attribute__((aligned(RTAPI_CACHELINE)));
+} hal_dispatch_t;
+
+// parallel threads
+//
+// a thread may be given a set of worker CPUs. The functs on such a
+// thread are partitioned into dependency levels derived from their
+// pin/signal linkage (see hal_parallel.c); functs within a level are
+// independent and are distributed across 'lanes' - lane 0 is the
+// thread itself, lanes 1..n are worker tasks bound to the worker CPUs.
+// A funct of level L starts only once all functs of level L-1 are done.
+//
+// the worker CPU set is passed in the upper bits of
+// hal_threadargs_t.flags, so it travels through the existing
+// newthread RPC to rtapi_app unchanged.
+
+#define HAL_WORKER_SHIFT     8
+#define HAL_WORKER_MAXCPU    23
+#define HAL_MAX_WORKERS      7
+#define HAL_MAX_LANES        (HAL_MAX_WORKERS + 1)
+#define HAL_WORKER_CPU(cpu)  (1U << ((cpu) + HAL_WORKER_SHIFT))
+#define HAL_WORKER_CPUS(f)   (((unsigned)(f)) >> HAL_WORKER_SHIFT)
+#define HAL_THREAD_FLAGS(f)  (((unsigned)(f)) & (HAL_WORKER_CPU(0) - 1))
+
+typedef struct hal_sched_slot {
+    hal_funct_call_t call;
+    int level;                  // dependency level
+} hal_sched_slot_t;
+
+// an immutable schedule, rebuilt by hal_thread_schedule(). A replaced
+// schedule is retired like a dispatch table, and freed once the thread
+// has passed a quiescent point and no worker holds it as its hazard.
+// followed in memory by:
+//   hal_sched_slot_t slot[n_slots]     - sorted by lane, then level
+//   hal_u32_t        level_size[n_levels]
+//   hal_u32_t        level_done[n_levels] - RT completion counters
+typedef struct hal_sched {
+    int n_levels;
+    int n_slots;
+    int n_lanes;
+    int lane_start[HAL_MAX_LANES + 1]; // lane n: [lane_start[n], lane_start[n+1])
+    hal_u32_t cycles;           // cycles run on this schedule
+    int next;                   // retired list link
+    hal_u32_t retired_qs;       // thread->qs at time of retirement
+    char data[0] __attribute__((aligned(8)));
+} hal_sched_t;
+
+static inline hal_sched_slot_t *sched_slots(hal_sched_t *s)
+{ return (hal_sched_slot_t *) s->data; }
+static inline hal_u32_t *sched_level_size(hal_sched_t *s)
+{ return (hal_u32_t *) (sched_slots(s) + s->n_slots); }
+static inline hal_u32_t *sched_level_done(hal_sched_t *s)
+{ return sched_level_size(s) + s->n_levels; }
+
+typedef struct hal_worker {
+    hal_thread_t *thread;       // owning thread, valid in RT context only
+    int lane;
+    int cpu_id;
+    int task_id;
+    hal_u32_t generation;       // last thread generation serviced
+    hal_u32_t hazard;           // schedule in use by the worker, or 0
+    hal_u32_t last_sched;       // schedule and cycle last run, so a
+    hal_u32_t last_cycle;       // cycle is never run twice
+} hal_worker_t;
+
 // argument struct for hal_create_xthread()
 typedef struct {
     const char *name;
@@ -613,16 +724,50 @@ typedef struct hal_thread {
     s32_pin_ptr runtime;         // owned by hal_lib during thread lifetime
     s32_pin_ptr maxtime;
     s32_pin_ptr curr_period;    // actual period measured at cycle start
+    s32_pin_ptr p50;            // runtime percentiles from hist, refreshed
+    s32_pin_ptr p99;            // every HAL_HIST_REFRESH_MASK+1 cycles
+    s32_pin_ptr p999;
+    hal_hist_t hist;            // distribution of thread runtimes
     hal_float_t mean;           // online jitter (really variance) calculation
     hal_float_t m2;
     hal_u32_t  cycles;
     hal_list_t funct_list;	/* list of functions to run */
+    hal_u32_t dispatch_ptr;     // shm offset of current hal_dispatch_t, or 0
+    int retired_ptr;            // retired dispatch tables not yet freed
+    hal_u32_t qs;               // bumped by thread_task after each cycle
     hal_list_t thread;          // list of threads in ascending priority
                                 // root: hal_data.threads
     int cpu_id;                 /* cpu to bind on, or -1 */
     rtapi_thread_flags_t flags;             // eg Posix, nowait
+
+    // parallel execution, see hal_parallel.c
+    int n_workers;              // 0: plain serial thread
+    hal_worker_t worker[HAL_MAX_WORKERS];
+    hal_u32_t sched_ptr;        // shm offset of current hal_sched_t, or 0
+    hal_u32_t cycle_sched;      // schedule of the cycle in progress, or 0
+    int sched_retired_ptr;      // retired schedules not yet freed
+    hal_u32_t generation;       // bumped at each cycle start
+    hal_u32_t cycle_seq;        // odd while the functs run, see hal_snapshot.h
 } hal_thread_t;
 
+// (re)build the parallel schedule of a thread. Called with the HAL
+// mutex held, and only while threads are stopped.
+int hal_thread_schedule(hal_thread_t *thread);
+
+// make sched (or none, if NULL) the thread's schedule, retiring the
+// previous one. Called with the HAL mutex held.
+void hal_sched_replace(hal_thread_t *thread, hal_sched_t *sched);
+
+// free all schedules of a thread whose tasks are gone
+void hal_sched_free(hal_thread_t *thread);
+
+// run the slots of one lane of a schedule for the current cycle.
+void hal_sched_run_lane(hal_thread_t *thread,
+			hal_sched_t *sched,
+			const int lane,
+			const hal_u32_t cycle,
+			hal_funct_args_t *fa);
+
 
 // public accessors for hal_funct_args_t argument
 static inline long long int fa_start_time(const hal_funct_args_t *fa)
@@ -699,7 +844,7 @@ typedef struct hal_vtable {
    meaningfull error messages in case of a mismatch.
 */
 #include "rtapi_shmkeys.h"
-#define HAL_VER   13	/* version code */
+#define HAL_VER   21	/* version code */
 
 
 /***********************************************************************
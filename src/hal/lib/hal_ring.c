@@ -12,6 +12,10 @@ static char *ringtypes[] = {
     "record",
     "multi",
     "stream",
+    "invalid",
+    "mpmc",
+    "invalid",
+    "invalid",
     "any",
 };
 /***********************************************************************
@@ -56,6 +60,9 @@ hal_ring_t *halg_ring_newfv(const int use_hal_mutex,
 	    case RINGTYPE_STREAM:
 		newfmt = "stream-%d";
 		break;
+	    case RINGTYPE_MPMC:
+		newfmt = "mpmc-%d";
+		break;
 	    default:
 		HALFAIL(EINVAL, "invalid ring type: 0x%x", mode & RINGTYPE_MASK);
 		goto FAIL;
@@ -320,6 +327,7 @@ hal_plug_t *halg_plug_new(const int use_hal_mutex,
     PCHECK_LOCK(HAL_LOCK_LOAD);
     {
 	WITH_HAL_MUTEX_IF(use_hal_mutex);
+	hal_plug_t *plug = NULL;
 
 	// make sure the owner exists, and obtain descriptor
 	hal_object_ptr owner;
@@ -350,8 +358,9 @@ hal_plug_t *halg_plug_new(const int use_hal_mutex,
 	if (ring == NULL)
 	    goto FAIL;
 
-	// construct plug name as '<ring>.<plug owner>.[read|write]'
-	char *tag = (args->type == PLUG_WRITER) ? "write" : "read";
+	// construct plug name as '<ring>.<plug owner>.[read|write|tap]'
+	char *tag = (args->type == PLUG_WRITER) ? "write" :
+	    (args->type == PLUG_TAP) ? "tap" : "read";
 	char buf[HAL_MAX_NAME_LEN];
 	char *plugname = fmt_args(buf, sizeof(buf), "%s.%s.%s",
 				  hh_get_name(&ring->hdr),
@@ -380,7 +389,34 @@ hal_plug_t *halg_plug_new(const int use_hal_mutex,
 	    goto FAIL;
 	}
 
-	hal_plug_t *plug = NULL;
+	// taps need record boundaries, and a free cursor
+	int tap = -1, i;
+	if (args->type == PLUG_TAP) {
+	    if ((ring_is != RINGTYPE_RECORD) && (ring_is != RINGTYPE_MULTIPART)) {
+		HALFAIL(EINVAL, "ring '%s': taps need a record or multi ring, ring is '%s'",
+			ho_name(ring), ringtypes[ring_is]);
+		goto FAIL;
+	    }
+	    for (i = 0; i < HAL_MAX_TAPS; i++)
+		if (!(ring->tap_mask & RTAPI_BIT(i))) {
+		    tap = i;
+		    break;
+		}
+	    if (tap < 0) {
+		HALFAIL(ENOSPC, "ring '%s': all %d taps in use",
+			ho_name(ring), HAL_MAX_TAPS);
+		goto FAIL;
+	    }
+	}
+	// a reader would move the head past regular taps
+	if (args->type == PLUG_READER) {
+	    for (i = 0; i < HAL_MAX_TAPS; i++)
+		if ((ring->tap_mask & RTAPI_BIT(i)) && !ring->tap[i].lossy) {
+		    HALFAIL(EBUSY, "ring '%s' is read by taps", ho_name(ring));
+		    goto FAIL;
+		}
+	}
+
 	// allocate plug descriptor
 	if ((plug = halg_create_objectf(0,
 					sizeof(hal_plug_t),
@@ -404,10 +440,32 @@ hal_plug_t *halg_plug_new(const int use_hal_mutex,
 	    goto FAIL;
 	}
 	// mark usage in ringheder
-	if (args->type == PLUG_WRITER)
+	if (args->type == PLUG_WRITER) {
 	    plug->rb.header->writer = ho_id(plug);
-	else
+	} else if (args->type == PLUG_TAP) {
+	    if (!args->lossy && plug->rb.header->reader) {
+		HALFAIL(EBUSY, "ring '%s' has a reader (id %d), use a lossy tap",
+			ho_name(ring), plug->rb.header->reader);
+		halg_ring_detach(0, &plug->rb);
+		goto FAIL;
+	    }
+	    hal_tap_t *tp = &ring->tap[tap];
+	    plug->ring_ptr = SHMOFF(ring);
+	    plug->tap = tap;
+
+	    // position the tap at the oldest record, with head updates
+	    // by other taps held off
+	    while (!rtapi_cas_u32(&ring->tap_lock, 0, 1))
+		;
+	    tp->lossy = args->lossy;
+	    tp->lapped = 0;
+	    _tap_resync(plug, tp);
+	    rtapi_smp_wmb();
+	    rtapi_store_u32(&ring->tap_mask, ring->tap_mask | RTAPI_BIT(tap));
+	    rtapi_store_u32(&ring->tap_lock, 0);
+	} else {
 	    plug->rb.header->reader = ho_id(plug);
+	}
 
 	// If multi, init the multiframe accessor struct
 	if (plug->rb.header->type == RINGTYPE_MULTIPART) {
@@ -459,6 +517,20 @@ int halg_plug_delete(const int use_hal_mutex,
 	    if (plug->rb.header->reader == self)
 		plug->rb.header->reader = 0;
 
+	    if (plug->role == PLUG_TAP) {
+		hal_ring_t *ring = SHMPTR(plug->ring_ptr);
+
+		while (!rtapi_cas_u32(&ring->tap_lock, 0, 1))
+		    ;
+		rtapi_store_u32(&ring->tap_mask,
+				ring->tap_mask & ~RTAPI_BIT(plug->tap));
+		rtapi_store_u32(&ring->tap_lock, 0);
+
+		// the remaining taps may now let the writer proceed
+		if (!plug_tap(plug)->lossy)
+		    hal_tap_advance(plug);
+	    }
+
 	    // and detach from the ring.
 	    halg_ring_detach(0, &plug->rb);
 	}
@@ -10,6 +10,17 @@
 
 RTAPI_BEGIN_DECLS
 
+// a tap's read cursor. Kept in the ring descriptor, so all taps
+// of a ring can see each other's progress.
+#define HAL_MAX_TAPS 8
+
+typedef struct hal_tap {
+    hal_u64_t generation;        // records consumed through this tap
+    hal_u32_t offset;            // read position in the ring
+    hal_u32_t lossy;             // never holds up the writer
+    hal_u32_t lapped;            // times overrun by the writer (lossy taps)
+} hal_tap_t;
+
 // the HAL ring descriptor
 //
 // formally HAL ring objects are top-level and do not depend on any other object
@@ -26,6 +37,9 @@ typedef struct hal_ring {
     unsigned flags;
     int handle;                  // unique ID
     __u8 encodings;              // bitmap of hal_ring_encodings_t
+    hal_u32_t tap_mask;          // tap[] entries in use
+    hal_u32_t tap_lock;          // serializes ring head updates by taps
+    hal_tap_t tap[HAL_MAX_TAPS];
 } hal_ring_t;
 
 // a plug is a read or write hookup to a HAL ring.
@@ -40,13 +54,27 @@ typedef struct hal_ring {
 // a comp or an instance (but not limited to those; a thread could own a plug as well)
 // a plug will be deleted on destruction of the owning object (e comp, ring, thread)
 //
+// a tap plug ('<HAL ring name>.tap') is a reader with its own
+// cursor, so several consumers can read a single record or multipart
+// ring and the writer writes each record once:
+//
+// - regular taps hold up the writer: the ring head is never advanced
+//   past the slowest regular tap, so no tap misses a record. A ring
+//   with regular taps cannot have a PLUG_READER, and vice versa.
+//   Taps release records lazily, only once the ring is more than half
+//   full, so the other half serves as history for lossy taps.
+// - lossy taps (plug_args.lossy) never hold up the writer. A lossy
+//   tap which was overrun reports EINVAL once, and continues with the
+//   oldest record still in the ring. Lossy taps need a PLUG_READER or
+//   a regular tap to drain the ring.
+//
 // represents a HAL plug object
 // plug roles
 
 typedef enum {
     PLUG_READER  = 1,
     PLUG_WRITER  = 2,
-    // PLUG_TAP  = 3,
+    PLUG_TAP     = 3,
 } hal_plugtype_t;
 
 typedef struct hal_plug {
@@ -55,7 +83,9 @@ typedef struct hal_plug {
     msgbuffer_t mb;                // per-process attach object, only if multiframe
     unsigned flags;                // as from plug_args.flags
     int ring_id;                   // object ID of the attached HAL ring
-    __u32 role : 2;                // PLUG_READER/PLUG_WRITER
+    int ring_ptr;                  // shm offset of the hal_ring_t (taps)
+    int tap;                       // index into hal_ring_t.tap[] (taps)
+    __u32 role : 2;                // PLUG_READER/PLUG_WRITER/PLUG_TAP
 } hal_plug_t;
 
 // plug accessors
@@ -68,6 +98,204 @@ static inline msgbuffer_t *plug_mb(hal_plug_t *plug) {
 static inline unsigned plug_role(const hal_plug_t *plug) {
     return plug->role;
 }
+static inline hal_tap_t *plug_tap(const hal_plug_t *plug) {
+    hal_ring_t *ring = (hal_ring_t *) SHMPTR(plug->ring_ptr);
+    return &ring->tap[plug->tap];
+}
+
+// tap operations - usable from RT.
+
+// bytes in use in a record ring
+static inline ringsize_t _tap_ring_used(const ringheader_t *h)
+{
+    const ringtrailer_t *t = _trailer_from_header(h);
+    return (rtapi_load_u32(&t->tail) - rtapi_load_u32(&h->head) + h->size)
+	% h->size;
+}
+
+// release records until the ring is half full, but not past the
+// slowest regular tap. Never waits: if another tap is at it, our
+// progress is picked up on its next call.
+static inline void hal_tap_advance(hal_plug_t *plug)
+{
+    hal_ring_t *ring = (hal_ring_t *) SHMPTR(plug->ring_ptr);
+    ringheader_t *h = plug->rb.header;
+    hal_u64_t target = ~0ULL;
+    hal_u32_t mask;
+    int i;
+
+    if (!rtapi_cas_u32(&ring->tap_lock, 0, 1))
+	return;
+    mask = rtapi_load_u32(&ring->tap_mask);
+    for (i = 0; i < HAL_MAX_TAPS; i++) {
+	if (!(mask & RTAPI_BIT(i)) || ring->tap[i].lossy)
+	    continue;
+	hal_u64_t g = rtapi_load_u64(&ring->tap[i].generation);
+	if (g < target)
+	    target = g;
+    }
+    if (target != ~0ULL)
+	while ((_tap_ring_used(h) > h->size / 2) &&
+	       (rtapi_load_u64((hal_u64_t *)&h->generation) < target) &&
+	       (record_shift(&plug->rb) == 0));
+    rtapi_store_u32(&ring->tap_lock, 0);
+}
+
+// point a tap at the oldest record in the ring
+static inline void _tap_resync(hal_plug_t *plug, hal_tap_t *tap)
+{
+    ringheader_t *h = plug->rb.header;
+    hal_u64_t g;
+    ringsize_t off;
+
+    do {
+	g = rtapi_load_u64((hal_u64_t *)&h->generation);
+	off = rtapi_load_u32(&h->head);
+    } while (rtapi_load_u64((hal_u64_t *)&h->generation) != g);
+    tap->offset = off;
+    rtapi_store_u64(&tap->generation, g);
+}
+
+static inline int _tap_lapped(const hal_plug_t *plug, const hal_tap_t *tap)
+{
+    return tap->lossy &&
+	(rtapi_load_u64((hal_u64_t *)&plug->rb.header->generation) >
+	 tap->generation);
+}
+
+/* hal_tap_read():
+ *
+ * non-copying read of the next record at a tap's cursor, a 'peek'
+ * like record_read(). Consume the record with hal_tap_shift().
+ *
+ * return 0 with data and size set
+ * return EAGAIN if there is nothing new for this tap
+ * return EINVAL if a lossy tap was overrun; it is repositioned to the
+ * oldest record in the ring.
+ */
+static inline int hal_tap_read(hal_plug_t *plug,
+			       const void **data,
+			       ringsize_t *size)
+{
+    hal_tap_t *tap = plug_tap(plug);
+    int retval;
+
+    if (_tap_lapped(plug, tap)) {
+	_tap_resync(plug, tap);
+	tap->lapped++;
+	return EINVAL;
+    }
+    retval = _ring_read_at(&plug->rb, tap->offset, data, size);
+    if ((retval == EAGAIN) && !tap->lossy)
+	hal_tap_advance(plug); // pick up progress of other taps
+    return retval;
+}
+
+/* hal_tap_shift():
+ *
+ * consume the record returned by hal_tap_read().
+ *
+ * return 0 on success
+ * return EAGAIN if nothing to consume
+ * return EINVAL if a lossy tap was overrun while reading - the data
+ * returned by hal_tap_read() may have been overwritten, so as with
+ * ring iterators, copy it out and check the result of hal_tap_shift()
+ * before using it.
+ */
+static inline int hal_tap_shift(hal_plug_t *plug)
+{
+    hal_tap_t *tap = plug_tap(plug);
+    rrecsize_t off;
+
+    if (_tap_lapped(plug, tap)) {
+	_tap_resync(plug, tap);
+	tap->lapped++;
+	return EINVAL;
+    }
+    off = _ring_shift_offset(&plug->rb, tap->offset);
+    if (off < 0)
+	return EAGAIN;
+    tap->offset = off;
+
+    // reading the record must be complete before the head can
+    // move past it
+    rtapi_smp_mb();
+    rtapi_store_u64(&tap->generation, tap->generation + 1);
+    if (!tap->lossy)
+	hal_tap_advance(plug);
+    return 0;
+}
+
+// type-independent copying access through a plug, useful with plugs
+// created as RINGTYPE_ANY. Record and MPMC rings transfer one record
+// per call, stream rings transfer all or nothing of 'size' bytes.
+// Multipart rings need the msgbuffer_t API and return EINVAL.
+//
+// plug_write: return 0, EAGAIN if no space, ERANGE if 'size' can
+// never fit.
+static inline int plug_write(hal_plug_t *plug, const void *data,
+			     const ringsize_t size)
+{
+    ringbuffer_t *rb = &plug->rb;
+
+    switch (rb->header->type) {
+    case RINGTYPE_RECORD:
+	return record_write(rb, (void *) data, size);
+    case RINGTYPE_MPMC:
+	return mpmc_write(rb, data, size);
+    case RINGTYPE_STREAM:
+	if (size >= rb->header->size)
+	    return ERANGE;
+	if (stream_write_space(rb->header) < size)
+	    return EAGAIN;
+	stream_write(rb, (const char *) data, size);
+	return 0;
+    default:
+	return EINVAL;
+    }
+}
+
+// plug_read: 'data' holds *size bytes; on success *size is set to the
+// number of bytes read. return 0, EAGAIN if empty, ERANGE if a record
+// was larger than *size (it is consumed, truncated). Tap plugs read
+// at their own cursor, and may return EINVAL as hal_tap_shift().
+static inline int plug_read(hal_plug_t *plug, void *data,
+			    ringsize_t *size)
+{
+    ringbuffer_t *rb = &plug->rb;
+    const void *ptr;
+    ringsize_t sz;
+    int retval;
+
+    if (plug->role == PLUG_TAP) {
+	if ((retval = hal_tap_read(plug, &ptr, &sz)))
+	    return retval;
+	memcpy(data, ptr, (sz > *size) ? *size : sz);
+	if ((retval = hal_tap_shift(plug)))
+	    return retval; // lossy tap overrun during the copy
+	retval = (sz > *size) ? ERANGE : 0;
+	*size = sz;
+	return retval;
+    }
+    switch (rb->header->type) {
+    case RINGTYPE_RECORD:
+	if ((retval = record_read(rb, &ptr, &sz)))
+	    return retval;
+	retval = (sz > *size) ? ERANGE : 0;
+	memcpy(data, ptr, retval ? *size : sz);
+	record_shift(rb);
+	*size = sz;
+	return retval;
+    case RINGTYPE_MPMC:
+	return mpmc_read(rb, data, size);
+    case RINGTYPE_STREAM:
+	if ((*size = stream_read(rb, (char *) data, *size)) == 0)
+	    return EAGAIN;
+	return 0;
+    default:
+	return EINVAL;
+    }
+}
 
 // argument struct passed to halg_plug_new()
 typedef struct plug_args {
@@ -78,6 +306,7 @@ typedef struct plug_args {
     char *owner_name;    // matches owner either by name or object ID
     int   owner_id;
     mt_encoding_set_t understands; // this plug is willing to accept
+    int lossy;           // PLUG_TAP only: never hold up the writer
 } plug_args_t;
 
 hal_plug_t *halg_plug_new(const int use_hal_mutex,
@@ -104,12 +333,17 @@ int halg_plug_delete(const int use_hal_mutex,
 // #define RINGTYPE_RECORD    0
 // #define RINGTYPE_MULTIPART RTAPI_BIT(0)
 // #define RINGTYPE_STREAM    RTAPI_BIT(1)
+// #define RINGTYPE_MPMC      RTAPI_BIT(2)
 
 // mode flags passed in by ring_new
 // exposed in ringheader_t.{use_rmutex, use_wmutex, alloc_halmem}
-// USE_RMUTEX       RTAPI_BIT(2)
-// USE_WMUTEX       RTAPI_BIT(3)
-// ALLOC_HALMEM     RTAPI_BIT(4)
+// USE_RMUTEX       RTAPI_BIT(3)
+// USE_WMUTEX       RTAPI_BIT(4)
+// ALLOC_HALMEM     RTAPI_BIT(5)
+
+// for RINGTYPE_MPMC, size is rounded up to a power-of-two number of
+// slots. The slot size defaults to 64 bytes and may be set by or'ing
+// in MPMC_SLOTSIZE(log2 of slot size).
 
 // spsize > 0 will allocate a shm scratchpad buffer
 // accessible through ringbuffer_t.scratchpad/ringheader_t.scratchpad
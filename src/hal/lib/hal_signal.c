@@ -62,6 +62,9 @@ int halg_signal_new(const int use_hal_mutex,
 	new->readers = 0;
 	new->writers = 0;
 	new->bidirs = 0;
+	new->generation = 0;
+	new->watchers = 0;
+	new->legacy_writers = 0;
 
 	// propagate the news
 	rtapi_smp_mb();
@@ -322,6 +325,15 @@ int halg_link(const int use_hal_mutex,
 	if (pin->dir == HAL_IO) {
 	    sig->bidirs++;
 	}
+	if (hh_get_legacy(&pin->hdr) && (pin->dir != HAL_IN)) {
+	    // writes through the raw pointer go unnoticed by the
+	    // generation, watching groups need to compare values.
+	    // The slot stays flagged until the group is freed.
+	    sig->legacy_writers++;
+	    if (sig->watchers)
+		__atomic_fetch_or(&hal_data->watch_legacy, sig->watchers,
+				  __ATOMIC_RELEASE);
+	}
 	/* and update the pin */
 	set_signal(pin, sig);
 
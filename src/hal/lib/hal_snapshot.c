@@ -0,0 +1,164 @@
+// consistent userland snapshots of pins and signals - see hal_snapshot.h
+
+#include "config.h"
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "rtapi_atomics.h"
+#include "hal.h"		/* HAL public API decls */
+#include "hal_priv.h"		/* HAL private decls */
+#include "hal_internal.h"
+#include "hal_snapshot.h"
+
+#include <stdlib.h>		/* calloc()/free() */
+#include <sched.h>		/* sched_yield() */
+#include <time.h>
+
+static int add_thread(hal_object_ptr o, foreach_args_t *args)
+{
+    hal_snapshot_t *snap = args->user_ptr1;
+
+    if (snap->thread)
+	snap->thread[snap->n_threads] = o.thread;
+    snap->n_threads++;
+    return 0;
+}
+
+static hal_snapshot_t *snapshot_new(const char *thread,
+				    const int n, const char **names)
+{
+    hal_snapshot_t *snap;
+    int i;
+
+    if ((snap = calloc(sizeof(hal_snapshot_t), 1)) == NULL) {
+	_halerrno = -ENOMEM;
+	return NULL;
+    }
+    if (thread) {
+	hal_thread_t *t = halpr_find_thread_by_name(thread);
+	if (t == NULL) {
+	    hal_snapshot_free(snap);
+	    HALFAIL_NULL(ENOENT, "thread '%s' not found", thread);
+	}
+	snap->thread = calloc(sizeof(hal_thread_t *), 1);
+	if (snap->thread)
+	    snap->thread[snap->n_threads++] = t;
+    } else {
+	// count, then collect
+	foreach_args_t args =  {
+	    .type = HAL_THREAD,
+	    .user_ptr1 = snap,
+	};
+	halg_foreach(0, &args, add_thread);
+	if (snap->n_threads == 0) {
+	    // nothing would keep the values of one cycle together
+	    hal_snapshot_free(snap);
+	    HALFAIL_NULL(ENOENT, "no threads to follow");
+	}
+	snap->thread = calloc(sizeof(hal_thread_t *), snap->n_threads + 1);
+	snap->n_threads = 0;
+	if (snap->thread)
+	    halg_foreach(0, &args, add_thread);
+    }
+
+    snap->n = n;
+    snap->seq = calloc(sizeof(hal_u32_t), snap->n_threads + 1);
+    snap->pin = calloc(sizeof(hal_pin_t *), n + 1);
+    snap->sig = calloc(sizeof(hal_sig_t *), n + 1);
+    snap->type = calloc(sizeof(hal_type_t), n + 1);
+    snap->value = calloc(sizeof(hal_data_u), n + 1);
+    if (!snap->thread || !snap->seq || !snap->pin || !snap->sig ||
+	!snap->type || !snap->value) {
+	hal_snapshot_free(snap);
+	_halerrno = -ENOMEM;
+	return NULL;
+    }
+
+    for (i = 0; i < n; i++) {
+	hal_pin_t *pin = halpr_find_pin_by_name(names[i]);
+	hal_sig_t *sig;
+
+	if (pin) {
+	    snap->pin[i] = pin;
+	    snap->type[i] = pin_type(pin);
+	    continue;
+	}
+	if ((sig = halpr_find_sig_by_name(names[i])) != NULL) {
+	    snap->sig[i] = sig;
+	    snap->type[i] = sig->type;
+	    continue;
+	}
+	hal_snapshot_free(snap);
+	HALFAIL_NULL(ENOENT, "no pin or signal '%s'", names[i]);
+    }
+    return snap;
+}
+
+hal_snapshot_t *halg_snapshot_new(const int use_hal_mutex,
+				  const char *thread,
+				  const int n, const char **names)
+{
+    PCHECK_HALDATA();
+    if (n < 0 || (n && names == NULL))
+	HALFAIL_NULL(EINVAL, "invalid list of names");
+    {
+	WITH_HAL_MUTEX_IF(use_hal_mutex);
+	return snapshot_new(thread, n, names);
+    }
+}
+
+static long long now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+int hal_snapshot_read(hal_snapshot_t *snap, const int timeout_us)
+{
+    long long deadline = 0;
+    int i;
+
+    while (1) {
+	// wait for a cycle boundary in all threads
+	for (i = 0; i < snap->n_threads; i++) {
+	    snap->seq[i] = rtapi_load_u32(&snap->thread[i]->cycle_seq);
+	    if (snap->seq[i] & 1)
+		break;
+	}
+	if (i == snap->n_threads) {
+	    rtapi_smp_rmb();
+	    for (i = 0; i < snap->n; i++) {
+		const hal_data_u *v = snap->pin[i] ?
+		    pin_value(snap->pin[i]) : sig_value(snap->sig[i]);
+		snap->value[i] = *v;
+	    }
+	    rtapi_smp_rmb();
+	    for (i = 0; i < snap->n_threads; i++)
+		if (rtapi_load_u32(&snap->thread[i]->cycle_seq) !=
+		    snap->seq[i])
+		    break;
+	    if (i == snap->n_threads)
+		return 0;
+	}
+
+	// a cycle is in progress
+	snap->retries++;
+	if (deadline == 0)
+	    deadline = now_us() + timeout_us;
+	else if (now_us() > deadline)
+	    return -EAGAIN;
+	sched_yield();
+    }
+}
+
+void hal_snapshot_free(hal_snapshot_t *snap)
+{
+    if (snap == NULL)
+	return;
+    free(snap->thread);
+    free(snap->seq);
+    free(snap->pin);
+    free(snap->sig);
+    free(snap->type);
+    free(snap->value);
+    free(snap);
+}
@@ -0,0 +1,63 @@
+#ifndef HAL_SNAPSHOT_H
+#define HAL_SNAPSHOT_H
+
+// consistent userland snapshots of several pins and signals
+//
+// reading pins one by one while a thread runs its functs gives values
+// from different cycles. Each HAL thread publishes a sequence count,
+// cycle_seq, which thread_task() makes odd before running the functs
+// and even again when they are done. A snapshot copies its values
+// while cycle_seq of its threads is even, and retries if it changed
+// meanwhile - so the copy is taken at one cycle boundary of each
+// thread, and the writers never wait.
+//
+// the threads a snapshot follows are those which write its pins: give
+// the thread name, or NULL to follow all threads. A reader which waits
+// out a cycle in progress spins for at most the thread's runtime.
+//
+// a snapshot refers to the HAL objects it was made from. Like a
+// compiled group, it must be freed and made anew if those objects
+// are deleted; relinking pins is fine.
+
+#include "rtapi.h"
+#include "hal.h"
+#include "hal_priv.h"
+
+RTAPI_BEGIN_DECLS
+
+typedef struct hal_snapshot {
+    int n_threads;
+    hal_thread_t **thread;
+    hal_u32_t *seq;             // cycle_seq of each thread at the last read
+    int n;                      // number of pins and signals
+    hal_pin_t **pin;            // for each: the pin, or NULL
+    hal_sig_t **sig;            // and the signal if it's not a pin
+    hal_type_t *type;
+    hal_data_u *value;          // the values at the last read
+    unsigned long retries;      // reads which saw a cycle in progress
+} hal_snapshot_t;
+
+// make a snapshot of the named pins or signals, following the named
+// thread, or all threads if thread is NULL. Returns NULL and sets
+// _halerrno if an object isn't found, or if thread is NULL and there
+// are no threads.
+hal_snapshot_t *halg_snapshot_new(const int use_hal_mutex,
+				  const char *thread,
+				  const int n, const char **names);
+
+// copy the values. Returns 0, or -EAGAIN if no cycle boundary was
+// seen within timeout_us.
+int hal_snapshot_read(hal_snapshot_t *snap, const int timeout_us);
+
+void hal_snapshot_free(hal_snapshot_t *snap);
+
+// the cycle count of thread i at the last read
+static inline hal_u32_t hal_snapshot_cycle(const hal_snapshot_t *snap,
+					   const int i)
+{
+    return snap->seq[i] >> 1;
+}
+
+RTAPI_END_DECLS
+
+#endif // HAL_SNAPSHOT_H
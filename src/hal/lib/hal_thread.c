@@ -6,19 +6,22 @@
 #include "hal.h"		/* HAL public API decls */
 #include "hal_priv.h"		/* HAL private decls */
 #include "hal_internal.h"
+#include "hal_group.h"		/* hal_watch_notify() */
 
 #ifdef RTAPI
 
 /** 'thread_task()' is a function that is invoked as a realtime task.
     It implements a thread, by running down the thread's function list
     and calling each function in turn.
+    If the thread has workers and a parallel schedule, it instead runs
+    lane 0 of the schedule, and waits for the workers to complete
+    theirs - see hal_parallel.c.
 */
 static void thread_task(void *arg)
 {
     hal_thread_t *thread = arg;
-    hal_funct_entry_t *funct_root, *funct_entry;
     long long int end_time;
-    hal_s32_t delta, act_period;
+    hal_s32_t act_period;
 
     thread->cycles = 0;
     thread->mean = 0.0;
@@ -35,10 +38,6 @@ static void thread_task(void *arg)
     while (1) {
 	if (hal_data->threads_running > 0) {
 
-	    /* point at first function on function list */
-	    funct_root = (hal_funct_entry_t *) & (thread->funct_list);
-	    funct_entry = SHMPTR(funct_root->links.next);
-
 	    // the thread release point
 	    fa.start_time = rtapi_get_time();
 
@@ -47,62 +46,81 @@ static void thread_task(void *arg)
 	    set_s32_pin(thread->curr_period, act_period);
 
 	    fa.last_start_time = fa.thread_start_time = fa.start_time;
-
-	    /* run thru function list */
-	    while (funct_entry != funct_root) {
-		/* point to function structure */
-		fa.funct = SHMPTR(funct_entry->funct_ptr);
-
-		// issue a read barrier if set in funct_entry or
-		// funct object header
-		if (funct_entry->rmb || ho_rmb(fa.funct)) {
-		    rtapi_smp_rmb();
-		}
-
-		/* call the function */
-		switch (funct_entry->type) {
-		case FS_LEGACY_THREADFUNC:
-		    funct_entry->funct.l(funct_entry->arg, thread->period);
-		    break;
-		case FS_XTHREADFUNC:
-		    funct_entry->funct.x(funct_entry->arg, &fa);
-		    break;
-		default:
-		    // bad - a mistyped funct
+	    end_time = fa.start_time;
+
+	    // open the cycle: snapshot readers retry until it closes
+	    rtapi_store_u32(&thread->cycle_seq, thread->cycle_seq + 1);
+	    rtapi_smp_wmb();
+
+	    hal_u32_t sp = rtapi_load_u32(&thread->sched_ptr);
+	    if (sp) {
+		hal_sched_t *sched = SHMPTR(sp);
+		hal_u32_t cycle = sched->cycles + 1;
+
+		// release the workers onto the schedule of this cycle
+		rtapi_store_u32(&thread->cycle_sched, sp);
+		rtapi_store_u32(&sched->cycles, cycle);
+		rtapi_smp_wmb();
+		rtapi_store_u32(&thread->generation, thread->generation + 1);
+
+		hal_sched_run_lane(thread, sched, 0, cycle, &fa);
+
+		// join: levels complete in order, so the last one
+		// being done implies all are
+		int last = sched->n_levels - 1;
+		hal_u32_t *done = sched_level_done(sched);
+		hal_u32_t target = cycle * sched_level_size(sched)[last];
+		while (rtapi_load_u32(&done[last]) != target)
 		    ;
-		}
-		// capture execution time of this funct
+		rtapi_store_u32(&thread->cycle_sched, 0);
 		end_time = rtapi_get_time();
-
-		/* update execution time data */
-		delta = end_time - fa.start_time;
-		set_s32_pin(fa.funct->f_runtime, delta);
-		if ( delta > get_s32_pin(fa.funct->f_maxtime)) {
-		    set_s32_pin(fa.funct->f_maxtime, delta);
-#ifdef ENABLE_TMAX_INC
-		    set_bit_pin(fa.funct->f_maxtime_increased, 1);
-		} else {
-		    set_bit_pin(fa.funct->f_maxtime_increased, 0);
-#endif
+	    } else {
+		hal_u32_t dp = rtapi_load_u32(&thread->dispatch_ptr);
+
+		if (dp) {
+		    hal_dispatch_t *disp = SHMPTR(dp);
+		    hal_funct_call_t *call = disp->call;
+		    hal_funct_call_t *end = call + disp->n_calls;
+
+		    /* run thru dispatch table */
+		    for (; call < end; call++) {
+			end_time = call_funct(call, &fa);
+			/* prepare to measure time for next funct */
+			fa.start_time = end_time;
+		    }
 		}
+	    }
+	    // close the cycle
+	    rtapi_smp_wmb();
+	    rtapi_store_u32(&thread->cycle_seq, thread->cycle_seq + 1);
 
-		// issue a write barrier if set in funct_entry or
-		// funct object header
-		if (funct_entry->wmb || ho_wmb(fa.funct)) {
-		    rtapi_smp_wmb();
-		}
+	    // done with the dispatch table of this cycle: all its
+	    // loads must be complete before qs moves on
+	    rtapi_smp_mb();
+	    rtapi_store_u32(&thread->qs, thread->qs + 1);
+
+	    // wake a reporter waiting for signal changes
+	    if (hal_data->watch_wakeup)
+		hal_watch_notify();
 
-		/* point to next next entry in list */
-		funct_entry = SHMPTR(funct_entry->links.next);
-		/* prepare to measure time for next funct */
-		fa.start_time = end_time;
-	    }
 	    // update thread execution time in this period
 	    hal_s32_t rt = (end_time - fa.thread_start_time);
 	    set_s32_pin(thread->runtime, rt);
 	    if (rt > get_s32_pin(thread->maxtime)) {
 		set_s32_pin(thread->maxtime, rt);
 	    }
+	    hal_hist_sample(&thread->hist, rt);
+
+	    // the percentile scan is O(HAL_HIST_BUCKETS), so
+	    // only refresh the pins every so often
+	    if ((thread->cycles & HAL_HIST_REFRESH_MASK) == 0) {
+		set_s32_pin(thread->p50,
+			    hal_hist_percentile(&thread->hist, HAL_HIST_P50));
+		set_s32_pin(thread->p99,
+			    hal_hist_percentile(&thread->hist, HAL_HIST_P99));
+		set_s32_pin(thread->p999,
+			    hal_hist_percentile(&thread->hist, HAL_HIST_P999));
+	    }
 	} else {
 	    // threads_running flag false:
 
@@ -117,6 +135,9 @@ static void thread_task(void *arg)
 	    // support actual period measurement (get the starting value right)
 	    fa.last_start_time = rtapi_get_time();
 
+	    rtapi_smp_mb();
+	    rtapi_store_u32(&thread->qs, thread->qs + 1);
+
             // If a nowait thread is idle, this becomes a tight loop that
             // effectively spinlocks a single core processor. Allow the thread
             // to sleep and give other threads some cpu time.
@@ -137,6 +158,101 @@ static void thread_task(void *arg)
     }
 }
 
+// a worker services one lane of its thread's parallel schedule.
+// while threads run it busy-polls the thread generation, so workers
+// should be bound to isolated CPUs. A cycle released by the thread is
+// always serviced, even if threads were stopped or the schedule
+// replaced meanwhile, so the thread never waits on a sleeping worker
+// for long: the worker runs the schedule of the cycle, which stays
+// valid while the worker holds it as its hazard.
+static void worker_task(void *arg)
+{
+    hal_worker_t *w = arg;
+    hal_thread_t *thread = w->thread;
+
+    hal_funct_args_t fa = {
+	.thread = thread,
+	.argc = 0,
+	.argv = NULL,
+    };
+    w->generation = rtapi_load_u32(&thread->generation);
+
+    while (1) {
+	hal_u32_t gen = rtapi_load_u32(&thread->generation);
+	if (gen != w->generation) {
+	    w->generation = gen;
+	    rtapi_smp_rmb();
+
+	    // hazard: announce the schedule, then check the thread
+	    // still runs a cycle on it - else it may be freed already
+	    hal_u32_t sp = rtapi_load_u32(&thread->cycle_sched);
+	    rtapi_store_u32(&w->hazard, sp);
+	    rtapi_smp_mb();
+	    if (sp && (rtapi_load_u32(&thread->cycle_sched) == sp)) {
+		hal_sched_t *sched = SHMPTR(sp);
+		hal_u32_t cycle = rtapi_load_u32(&sched->cycles);
+
+		if ((sp != w->last_sched) || (cycle != w->last_cycle)) {
+		    w->last_sched = sp;
+		    w->last_cycle = cycle;
+		    fa.thread_start_time = rtapi_get_time();
+		    hal_sched_run_lane(thread, sched, w->lane, cycle, &fa);
+		}
+	    }
+	    rtapi_smp_mb();
+	    rtapi_store_u32(&w->hazard, 0);
+	    continue;
+	}
+	if (hal_data->threads_running == 0)
+	    rtapi_wait(thread->flags & ~TF_NOWAIT);
+    }
+}
+
+static int create_workers(hal_thread_t *thread, unsigned cpus)
+{
+    int i, cpu, retval;
+    char name[HAL_MAX_NAME_LEN + 1];
+
+    for (cpu = 0; cpu <= HAL_WORKER_MAXCPU; cpu++) {
+	if (!(cpus & (1U << cpu)))
+	    continue;
+	i = thread->n_workers;
+	hal_worker_t *w = &thread->worker[i];
+	w->thread = thread;
+	w->lane = i + 1;
+	w->cpu_id = cpu;
+	rtapi_snprintf(name, sizeof(name), "%s.w%d", ho_name(thread), i + 1);
+
+	rtapi_task_args_t rargs = {
+	    .taskcode = worker_task,
+	    .arg = w,
+	    .prio = thread->priority,
+	    .owner = lib_module_id,
+	    .stacksize = global_data->hal_thread_stack_size,
+	    .uses_fp = thread->uses_fp,
+	    .cpu_id = cpu,
+	    .name = name,
+	    .flags = thread->flags,
+	};
+	retval = rtapi_task_new(&rargs);
+	if (retval < 0) {
+	    HALFAIL_RC(EINVAL, "could not create worker %d for thread %s",
+		       i + 1, ho_name(thread));
+	}
+	w->task_id = retval;
+	thread->n_workers++;
+
+	retval = rtapi_task_start(w->task_id, thread->period);
+	if (retval < 0) {
+	    HALFAIL_RC(EINVAL, "could not start worker %d for thread %s: %d",
+		       i + 1, ho_name(thread), retval);
+	}
+	HALDBG("thread %s: worker %d on cpu %d task %d",
+	       ho_name(thread), i + 1, cpu, w->task_id);
+    }
+    return 0;
+}
+
 // HAL threads - public API
 
 int hal_create_xthread(const hal_threadargs_t *args)
@@ -159,6 +275,21 @@ int hal_create_xthread(const hal_threadargs_t *args)
 	HALFAIL_RC(EINVAL,"create_thread called "
 		   "with period of zero");
     }
+    unsigned workers = HAL_WORKER_CPUS(args->flags);
+    if (workers) {
+	if (__builtin_popcount(workers) > HAL_MAX_WORKERS) {
+	    HALFAIL_RC(EINVAL, "thread %s: at most %d workers supported",
+		       args->name, HAL_MAX_WORKERS);
+	}
+	if (args->cpu_id < 0) {
+	    HALFAIL_RC(EINVAL, "thread %s: workers require the thread "
+		       "to be bound with cpu=", args->name);
+	}
+	if (workers & (1U << args->cpu_id)) {
+	    HALFAIL_RC(EINVAL, "thread %s: worker cpu %d is the thread's cpu",
+		       args->name, args->cpu_id);
+	}
+    }
     {
 	WITH_HAL_MUTEX();
 
@@ -171,12 +302,15 @@ int hal_create_xthread(const hal_threadargs_t *args)
 				       HAL_THREAD, 0, args->name)) == NULL)
 	    return _halerrno;
 
+	new->task_id = -1;
 	dlist_init_entry(&(new->funct_list));
+	memset(&new->hist, 0, sizeof(new->hist));
 
 	/* initialize the structure */
 	new->uses_fp = args->uses_fp;
 	new->cpu_id = args->cpu_id;
-	new->flags = args->flags;
+	new->flags = HAL_THREAD_FLAGS(args->flags);
+	new->cycle_seq = 0;
 
 	/* have to create and start a task to run the thread */
 	if (dlist_empty(&hal_data->threads)) {
@@ -188,13 +322,15 @@ int hal_create_xthread(const hal_threadargs_t *args)
 		/* not running, start it */
 		curr_period = rtapi_clock_set_period(args->period_nsec);
 		if (curr_period < 0) {
-		    HALFAIL_RC(EINVAL, "clock_set_period returned %ld",
-				    curr_period);
+		    HALFAIL(EINVAL, "clock_set_period returned %ld",
+			    curr_period);
+		    goto FAIL;
 		}
 	    }
 	    /* make sure period <= desired period (allow 1% roundoff error) */
 	    if (curr_period > (args->period_nsec + (args->period_nsec / 100))) {
-		HALFAIL_RC(EINVAL, "clock period too long: %ld", curr_period);
+		HALFAIL(EINVAL, "clock period too long: %ld", curr_period);
+		goto FAIL;
 	    }
 	    if(hal_data->exact_base_period) {
 		hal_data->base_period = args->period_nsec;
@@ -215,15 +351,17 @@ int hal_create_xthread(const hal_threadargs_t *args)
 	    prev_priority = tptr->priority;
 	}
 	if ( args->period_nsec < hal_data->base_period) {
-	    HALFAIL_RC(EINVAL, "new thread period %ld is less than clock period %ld",
-		   args->period_nsec, hal_data->base_period);
+	    HALFAIL(EINVAL, "new thread period %ld is less than clock period %ld",
+		    args->period_nsec, hal_data->base_period);
+	    goto FAIL;
 	}
 	/* make period an integer multiple of the timer period */
 	n = (args->period_nsec + hal_data->base_period / 2) / hal_data->base_period;
 	new->period = hal_data->base_period * n;
 	if ( new->period < prev_period ) {
-	    HALFAIL_RC(EINVAL, "new thread period %ld is less than existing thread period %ld",
-		   args->period_nsec, prev_period);
+	    HALFAIL(EINVAL, "new thread period %ld is less than existing thread period %ld",
+		    args->period_nsec, prev_period);
+	    goto FAIL;
 	}
 	/* make priority one lower than previous */
 	new->priority = rtapi_prio_next_lower(prev_priority);
@@ -243,7 +381,8 @@ int hal_create_xthread(const hal_threadargs_t *args)
 	};
 	retval = rtapi_task_new(&rargs);
 	if (retval < 0) {
-	    HALFAIL_RC(EINVAL, "could not create task for thread %s", args->name);
+	    HALFAIL(EINVAL, "could not create task for thread %s", args->name);
+	    goto FAIL;
 	}
 	new->task_id = retval;
 	new->runtime._sp = hal_off_safe(halg_pin_newf(0, HAL_S32, HAL_OUT,
@@ -255,14 +394,31 @@ int hal_create_xthread(const hal_threadargs_t *args)
 	new->curr_period._sp = hal_off_safe(halg_pin_newf(0, HAL_S32, HAL_OUT, NULL,
 							 lib_module_id,
 							 "%s.curr-period", args->name));
+	new->p50._sp = hal_off_safe(halg_pin_newf(0, HAL_S32, HAL_OUT, NULL,
+						  lib_module_id,
+						  "%s.p50", args->name));
+	new->p99._sp = hal_off_safe(halg_pin_newf(0, HAL_S32, HAL_OUT, NULL,
+						  lib_module_id,
+						  "%s.p99", args->name));
+	new->p999._sp = hal_off_safe(halg_pin_newf(0, HAL_S32, HAL_OUT, NULL,
+						   lib_module_id,
+						   "%s.p999", args->name));
+	if (!new->runtime._sp || !new->maxtime._sp || !new->curr_period._sp ||
+	    !new->p50._sp || !new->p99._sp || !new->p999._sp)
+	    goto FAIL; // _halerrno set in halg_pin_newf
 
 	// expose nominal period for a start
 	set_s32_pin(new->curr_period, new->period);
 
+	// workers first, so a thread never runs without its lanes
+	if (workers && create_workers(new, workers))
+	    goto FAIL; // _halerrno set in create_workers
+
 	/* start task */
 	retval = rtapi_task_start(new->task_id, new->period);
 	if (retval < 0) {
-	    HALFAIL_RC(EINVAL, "could not start task for thread %s: %d", args->name, retval);
+	    HALFAIL(EINVAL, "could not start task for thread %s: %d", args->name, retval);
+	    goto FAIL;
 	}
 	/* insert new structure at head of list */
 	dlist_add_before(&new->thread, &hal_data->threads);
@@ -270,12 +426,30 @@ int hal_create_xthread(const hal_threadargs_t *args)
 	// make it visible
 	halg_add_object(false, (hal_object_ptr)new);
 
-    } // exit block protected by scoped lock
-
+	HALDBG("thread %s id %d created prio=%d",
+	       args->name, new->task_id, new->priority);
+	return 0;
 
-    HALDBG("thread %s id %d created prio=%d",
-	   args->name, new->task_id, new->priority);
-    return 0;
+    FAIL:
+	// undo what was set up so far: tasks, pins and descriptor
+	for (n = 0; n < new->n_workers; n++) {
+	    rtapi_task_pause(new->worker[n].task_id);
+	    rtapi_task_delete(new->worker[n].task_id);
+	}
+	if (new->task_id >= 0) {
+	    rtapi_task_pause(new->task_id);
+	    rtapi_task_delete(new->task_id);
+	}
+	shmoff_t pins[] = { new->runtime._sp, new->maxtime._sp,
+			    new->curr_period._sp, new->p50._sp,
+			    new->p99._sp, new->p999._sp };
+	for (n = 0; n < (int)(sizeof(pins) / sizeof(pins[0])); n++) {
+	    if (pins[n])
+		free_pin_struct(hal_ptr(pins[n]));
+	}
+	halg_free_object(false, (hal_object_ptr)new);
+	return _halerrno;
+    } // exit block protected by scoped lock
 }
 
 // HAL threads - legacy API
@@ -296,6 +470,9 @@ static int delete_thread_cb(hal_object_ptr o, foreach_args_t *args)
     free_pin_struct(hal_ptr(o.thread->runtime._sp));
     free_pin_struct(hal_ptr(o.thread->maxtime._sp));
     free_pin_struct(hal_ptr(o.thread->curr_period._sp));
+    free_pin_struct(hal_ptr(o.thread->p50._sp));
+    free_pin_struct(hal_ptr(o.thread->p99._sp));
+    free_pin_struct(hal_ptr(o.thread->p999._sp));
     free_thread_struct(o.thread);
     return 0;
 }
@@ -338,11 +515,28 @@ int hal_exit_threads(void)
 #endif /* RTAPI */
 
 
+static int schedule_thread_cb(hal_object_ptr o, foreach_args_t *args)
+{
+    if (o.thread->n_workers == 0)
+	return 0;
+    return hal_thread_schedule(o.thread);
+}
+
 int hal_start_threads(void)
 {
     CHECK_HALDATA();
     CHECK_LOCK(HAL_LOCK_RUN);
 
+    if (hal_data->threads_running == 0) {
+	WITH_HAL_MUTEX();
+
+	// threads are stopped: safe to (re)build parallel schedules
+	foreach_args_t args =  {
+	    .type = HAL_THREAD,
+	};
+	if (halg_foreach(0, &args, schedule_thread_cb) < 0)
+	    return _halerrno;
+    }
     HALDBG("starting threads");
     hal_data->threads_running = 1;
     return 0;
@@ -358,6 +552,106 @@ int hal_stop_threads(void)
     return 0;
 }
 
+void hal_funct_call_init(hal_funct_call_t *call,
+			 const hal_funct_entry_t *funct_entry)
+{
+    hal_funct_t *funct = SHMPTR(funct_entry->funct_ptr);
+
+    call->funct = funct_entry->funct;
+    call->arg = funct_entry->arg;
+    call->funct_ptr = funct_entry->funct_ptr;
+    call->type = funct_entry->type;
+    call->rmb = funct_entry->rmb || ho_rmb(funct);
+    call->wmb = funct_entry->wmb || ho_wmb(funct);
+}
+
+// free retired dispatch tables the thread can't be using anymore
+static void reclaim_dispatch(hal_thread_t *thread)
+{
+    hal_u32_t qs = rtapi_load_u32(&thread->qs);
+    int *prev = &thread->retired_ptr;
+
+    while (*prev) {
+	hal_dispatch_t *d = SHMPTR(*prev);
+	if (d->retired_qs != qs) {
+	    *prev = d->next;
+	    shmfree_desc(d);
+	} else {
+	    prev = &d->next;
+	}
+    }
+}
+
+int hal_thread_publish(hal_thread_t *thread)
+{
+    hal_list_t *list_root = &thread->funct_list;
+    hal_list_t *le;
+    int n = 0;
+
+    for (le = dlist_next(list_root); le != list_root; le = dlist_next(le))
+	n++;
+
+    hal_dispatch_t *disp =
+	shmalloc_desc_aligned(sizeof(hal_dispatch_t) +
+			      n * sizeof(hal_funct_call_t),
+			      RTAPI_CACHELINE);
+    if (disp == NULL)
+	NOMEM("dispatch table for thread '%s'", ho_name(thread));
+
+    disp->n_calls = n;
+    disp->next = 0;
+    disp->retired_qs = 0;
+    n = 0;
+    for (le = dlist_next(list_root); le != list_root; le = dlist_next(le))
+	hal_funct_call_init(&disp->call[n++], (hal_funct_entry_t *)le);
+
+    // the RT loop sees either the old or the new table from here on
+    hal_u32_t old = thread->dispatch_ptr;
+    rtapi_store_u32(&thread->dispatch_ptr, SHMOFF(disp));
+
+    // the store must be visible before qs is sampled: a thread which
+    // picked up the old table moves qs on only after it is done with it
+    rtapi_smp_mb();
+    if (old) {
+	hal_dispatch_t *od = SHMPTR(old);
+	od->retired_qs = rtapi_load_u32(&thread->qs);
+	od->next = thread->retired_ptr;
+	thread->retired_ptr = old;
+    }
+    reclaim_dispatch(thread);
+
+    HALDBG("thread '%s': published dispatch table with %d functs",
+	   ho_name(thread), n);
+    return 0;
+}
+
+static int republish_cb(hal_object_ptr o, foreach_args_t *args)
+{
+    hal_funct_t *funct = args->user_ptr1;
+    hal_list_t *list_root = &o.thread->funct_list;
+    hal_list_t *le;
+
+    for (le = dlist_next(list_root); le != list_root; le = dlist_next(le)) {
+	if (SHMPTR(((hal_funct_entry_t *)le)->funct_ptr) == funct)
+	    return hal_thread_publish(o.thread);
+    }
+    return 0;
+}
+
+int hal_funct_republish(hal_funct_t *funct)
+{
+    if (funct->users == 0)
+	return 0;
+
+    foreach_args_t args =  {
+	.type = HAL_THREAD,
+	.user_ptr1 = funct,
+    };
+    if (halg_foreach(0, &args, republish_cb) < 0)
+	return _halerrno;
+    return 0;
+}
+
 #ifdef RTAPI
 
 void free_thread_struct(hal_thread_t * thread)
@@ -372,6 +666,25 @@ void free_thread_struct(hal_thread_t * thread)
     rtapi_task_pause(thread->task_id);
     rtapi_task_delete(thread->task_id);
 
+    /* and its workers, if any */
+    for (int i = 0; i < thread->n_workers; i++) {
+	rtapi_task_pause(thread->worker[i].task_id);
+	rtapi_task_delete(thread->worker[i].task_id);
+    }
+    thread->n_workers = 0;
+    hal_sched_free(thread);
+
+    /* tasks are gone, so the dispatch tables can go too */
+    if (thread->dispatch_ptr) {
+	shmfree_desc(SHMPTR(thread->dispatch_ptr));
+	thread->dispatch_ptr = 0;
+    }
+    while (thread->retired_ptr) {
+	hal_dispatch_t *d = SHMPTR(thread->retired_ptr);
+	thread->retired_ptr = d->next;
+	shmfree_desc(d);
+    }
+
     /* clear the function entry list */
     list_root = &(thread->funct_list);
     list_entry = dlist_next(list_root);
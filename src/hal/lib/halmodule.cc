@@ -25,6 +25,7 @@ using namespace std;
 #include "rtapi.h"
 #include "hal.h"
 #include "hal_priv.h"
+#include "hal_snapshot.h"
 
 #if PY_VERSION_HEX < 0x02050000 && !defined(PY_SSIZE_T_MIN)
 typedef int Py_ssize_t;
@@ -937,6 +938,76 @@ PyObject *set_p(PyObject *self, PyObject *args) {
     return PyBool_FromLong(retval != 0);
 }
 
+#define SNAPSHOT_TIMEOUT_US 100000
+
+// values of several pins and signals at one cycle boundary of thread,
+// or of all threads if thread is None
+PyObject *snapshot(PyObject *self, PyObject *args) {
+    char *thread;
+    PyObject *seq;
+    hal_snapshot_t *snap;
+    int i, n, retval;
+
+    if(!PyArg_ParseTuple(args, "zO", &thread, &seq)) return NULL;
+    if(!SHMPTR(0)) {
+	PyErr_Format(PyExc_RuntimeError,
+		"Cannot call before creating component");
+	return NULL;
+    }
+    seq = PySequence_Fast(seq, "names must be a sequence");
+    if(!seq) return NULL;
+    n = PySequence_Fast_GET_SIZE(seq);
+
+    const char **names = new const char *[n + 1];
+    for(i = 0; i < n; i++) {
+	names[i] = PyString_AsString(PySequence_Fast_GET_ITEM(seq, i));
+	if(!names[i]) {
+	    delete [] names;
+	    Py_DECREF(seq);
+	    return NULL;
+	}
+    }
+    snap = halg_snapshot_new(1, thread, n, names);
+    delete [] names;
+    Py_DECREF(seq);
+    if(!snap) {
+	PyErr_Format(PyExc_RuntimeError, "%s", hal_lasterror());
+	return NULL;
+    }
+
+    retval = hal_snapshot_read(snap, SNAPSHOT_TIMEOUT_US);
+    if(retval < 0) {
+	hal_snapshot_free(snap);
+	PyErr_Format(PyExc_RuntimeError,
+		"no cycle boundary within %d us", SNAPSHOT_TIMEOUT_US);
+	return NULL;
+    }
+
+    PyObject *result = PyTuple_New(n);
+    for(i = 0; result && i < n; i++) {
+	PyObject *v = NULL;
+	switch(snap->type[i]) {
+	    case HAL_BIT: v = PyBool_FromLong(snap->value[i]._b); break;
+	    case HAL_U32: v = PyLong_FromUnsignedLong(snap->value[i]._u); break;
+	    case HAL_S32: v = PyInt_FromLong(snap->value[i]._s); break;
+	    case HAL_U64: v = PyLong_FromUnsignedLongLong(snap->value[i]._lu); break;
+	    case HAL_S64: v = PyLong_FromLongLong(snap->value[i]._ls); break;
+	    case HAL_FLOAT: v = PyFloat_FromDouble(snap->value[i]._f); break;
+	    default:
+		PyErr_Format(pyhal_error_type, "Invalid item type %d",
+			     snap->type[i]);
+	}
+	if(!v) {
+	    Py_DECREF(result);
+	    result = NULL;
+	    break;
+	}
+	PyTuple_SET_ITEM(result, i, v);
+    }
+    hal_snapshot_free(snap);
+    return result;
+}
+
 struct shmobject {
     PyObject_HEAD
     halobject *comp;
@@ -1104,6 +1175,8 @@ PyMethodDef module_methods[] = {
 	"connect pin to signal"},
     {"set_p", set_p, METH_VARARGS,
 	"set pin value"},
+    {"snapshot", snapshot, METH_VARARGS,
+	"get the values of pins and signals at one thread cycle boundary"},
     {NULL},
 };
 
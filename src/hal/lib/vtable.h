@@ -10,6 +10,8 @@ typedef enum {
     VTKINEMATICS_VERSION1 = 1000,
 
     VTTP_VERSION1 = 2000,
+    VTTP_VERSION2 = 2001,  // adds tpSetPlanVel
+    VTTP_VERSION3 = 2002,  // adds tpAddSpline
 } vtable_t;
 
 #endif // _VTABLE_H
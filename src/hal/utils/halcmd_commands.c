@@ -47,6 +47,7 @@
 #include "hal_ring.h"	        /* ringbuffer declarations */
 #include "hal_group.h"	        /* group/member declarations */
 #include "hal_rcomp.h"	        /* remote component declarations */
+#include "hal_snapshot.h"	/* consistent multi-pin reads */
 #include "halcmd_commands.h"
 #include "halcmd_rtapiapp.h"
 #include "rtapi_hexdump.h"
@@ -83,6 +84,7 @@ static void print_script_sig_info(int type, char **patterns);
 static void print_param_info(int type, char **patterns);
 static void print_funct_info(char **patterns);
 static void print_thread_info(char **patterns);
+static void print_hist_info(char **patterns);
 static void print_group_info(char **patterns);
 static void print_ring_info(char **patterns);
 static void print_comp_names(char **patterns);
@@ -885,6 +887,8 @@ int do_sets_cmd(char *name, char *value)
     type = sig->type;
     d_ptr = sig_value(sig);
     retval = set_common(type, d_ptr, value);
+    if (retval == 0)
+	hal_sig_written(sig);
     rtapi_mutex_give(&(hal_data->mutex));
     if (retval == 0) {
 	/* print success message */
@@ -942,6 +946,39 @@ int do_gets_cmd(char *name)
     return 0;
 }
 
+// longest wait for a thread to finish a cycle
+#define SNAPSHOT_TIMEOUT_US 100000
+
+int do_snapshot_cmd(char *thread, char *names[])
+{
+    hal_snapshot_t *snap;
+    int i, n, retval;
+
+    for (n = 0; names[n] && *names[n]; n++)
+	;
+    if (n == 0) {
+	halcmd_error("no pins or signals given\n");
+	return -EINVAL;
+    }
+    snap = halg_snapshot_new(1, strcmp(thread, "all") ? thread : NULL,
+			     n, (const char **) names);
+    if (snap == NULL) {
+	halcmd_error("%s\n", hal_lasterror());
+	return _halerrno;
+    }
+    retval = hal_snapshot_read(snap, SNAPSHOT_TIMEOUT_US);
+    if (retval < 0) {
+	halcmd_error("no cycle boundary seen within %dus\n",
+		     SNAPSHOT_TIMEOUT_US);
+    } else {
+	for (i = 0; i < n; i++)
+	    halcmd_output("%-30s %s\n", names[i],
+			  data_value2((int) snap->type[i], &snap->value[i]));
+    }
+    hal_snapshot_free(snap);
+    return retval;
+}
+
 static int get_type(char ***patterns) {
     char *typestr = 0;
     if(!(*patterns)) return -1;
@@ -1068,6 +1105,8 @@ int do_show_cmd(char *type, char **patterns)
 	print_funct_info(patterns);
     } else if (strcmp(type, "thread") == 0) {
 	print_thread_info(patterns);
+    } else if (strcmp(type, "hist") == 0) {
+	print_hist_info(patterns);
     } else if (strcmp(type, "group") == 0) {
 	print_group_info(patterns);
     } else if (strcmp(type, "ring") == 0) {
@@ -1628,9 +1667,11 @@ int do_sweep_cmd(char *flags)
     int hflags, gflags;
     if (log) {
 	hflags = rtapi_heap_setflags(&hal_data->heap,
+				    hal_data->heap.flags|
 				    RTAPIHEAP_TRACE_MALLOC|
 				    RTAPIHEAP_TRACE_FREE);
 	gflags = rtapi_heap_setflags(&global_data->heap,
+				     global_data->heap.flags|
 				     RTAPIHEAP_TRACE_MALLOC|
 				     RTAPIHEAP_TRACE_FREE);
     }
@@ -2553,9 +2594,12 @@ static int print_thread_entry(hal_object_ptr o, foreach_args_t *args)
 	// note that the scriptmode format string has no \n
 	// TODO FIXME add thread runtime and max runtime to this print
 	    char flags[100];
-	    snprintf(flags, sizeof(flags),"%s%s",
-		     tptr->flags & TF_NONRT ? "posix ":"",
-		     tptr->flags & TF_NOWAIT ? "nowait":"");
+	    int fl = snprintf(flags, sizeof(flags),"%s%s",
+			      tptr->flags & TF_NONRT ? "posix ":"",
+			      tptr->flags & TF_NOWAIT ? "nowait":"");
+	    for (int i = 0; i < tptr->n_workers; i++)
+		fl += snprintf(flags + fl, sizeof(flags) - fl, "%s%d",
+			       i ? "," : " workers=", tptr->worker[i].cpu_id);
 	halcmd_output(((scriptmode == 0) ?
 		       "%11ld  %-3s %-2d   %-40s  %8u, %8u %3ld%% %3ld%%  +/-%5.2f%% %s\n" :
 		       "%ld %s %d %s %u %u %3ld%% %3ld%% %.2f"),
@@ -2581,8 +2625,12 @@ static int print_thread_entry(hal_object_ptr o, foreach_args_t *args)
 	    /* scriptmode only uses one line per thread, which contains:
 	       thread period, FP flag, name, then all functs separated by spaces  */
 	    if (scriptmode == 0) {
-		halcmd_output("                   %2d %s\n", n,
-			      ho_name(funct));
+		if (tptr->sched_ptr)
+		    halcmd_output("                   %2d %-40s lane %d\n", n,
+				  ho_name(funct), fentry->lane);
+		else
+		    halcmd_output("                   %2d %s\n", n,
+				  ho_name(funct));
 	    } else {
 		halcmd_output(" %s", ho_name(funct));
 	    }
@@ -2617,6 +2665,94 @@ static void print_thread_info(char **patterns)
     halcmd_output("\n");
 }
 
+static void print_hist_line(const char *name, const hal_hist_t *h)
+{
+    hal_u32_t samples = h->samples;
+    int i, top = 0;
+
+    for (i = 0; i < HAL_HIST_BUCKETS; i++)
+	if (h->count[i])
+	    top = i;
+    halcmd_output(((scriptmode == 0) ?
+		   "%-40s %10u %5u %9u %9u %9u %9u\n" :
+		   "%s %u %u %u %u %u %u\n"),
+		  name, samples, h->windows,
+		  hal_hist_percentile(h, HAL_HIST_P50),
+		  hal_hist_percentile(h, HAL_HIST_P99),
+		  hal_hist_percentile(h, HAL_HIST_P999),
+		  samples ? hal_hist_bucket_high(top) : 0);
+}
+
+static int print_hist_entry(hal_object_ptr o, foreach_args_t *args)
+{
+    if (!match(args->user_ptr1, hh_get_name(o.hdr)))
+	return 0;
+
+    switch (hh_get_object_type(o.hdr)) {
+    case HAL_THREAD:
+	print_hist_line(ho_name(o.thread), &o.thread->hist);
+	break;
+    case HAL_FUNCT:
+	// userland functs are not timed
+	if (o.funct->type != FS_USERLAND)
+	    print_hist_line(ho_name(o.funct), &o.funct->hist);
+	break;
+    default: ;
+    }
+    return 0;
+}
+
+// runtime percentiles of threads and functs.
+// values are upper bucket bounds in nsec (quarter-octave resolution).
+static void print_hist_info(char **patterns)
+{
+    if (scriptmode == 0) {
+	halcmd_output("Runtime histograms (nsec):\n");
+	halcmd_output("%-40s %10s %5s %9s %9s %9s %9s\n",
+		      "Name", "Samples", "Reset", "p50", "p99", "p99.9", "Max");
+    }
+    foreach_args_t args =  {
+	.type = HAL_THREAD,
+	.user_ptr1 = patterns
+    };
+    halg_foreach(true, &args, print_hist_entry);
+    args.type = HAL_FUNCT;
+    halg_foreach(true, &args, print_hist_entry);
+    halcmd_output("\n");
+}
+
+static int reset_hist_entry(hal_object_ptr o, foreach_args_t *args)
+{
+    if (!match(args->user_ptr1, hh_get_name(o.hdr)))
+	return 0;
+    switch (hh_get_object_type(o.hdr)) {
+    case HAL_THREAD:
+	hal_hist_reset(&o.thread->hist);
+	break;
+    case HAL_FUNCT:
+	hal_hist_reset(&o.funct->hist);
+	break;
+    default:
+	return 0;
+    }
+    args->user_arg1++;
+    return 0;
+}
+
+int do_histreset_cmd(char **patterns)
+{
+    foreach_args_t args =  {
+	.type = HAL_THREAD,
+	.user_ptr1 = patterns
+    };
+    halg_foreach(true, &args, reset_hist_entry);
+    args.type = HAL_FUNCT;
+    halg_foreach(true, &args, reset_hist_entry);
+    halcmd_info("%d histogram%s reset\n", args.user_arg1,
+		args.user_arg1 == 1 ? "" : "s");
+    return 0;
+}
+
 static void print_comp_names(char **patterns)
 {
     foreach_args_t args =  {
@@ -3283,11 +3419,20 @@ static int print_plug_entry(hal_object_ptr o, foreach_args_t *args)
 {
 
     if (o.plug->ring_id == args->user_arg1) {
-	halcmd_output("                                             %s %s id=%d owner=%d\n",
-		      o.plug->role == PLUG_WRITER ? "<==" : "==>",
+	halcmd_output("                                             %s %s id=%d owner=%d",
+		      o.plug->role == PLUG_WRITER ? "<==" :
+		      o.plug->role == PLUG_TAP ? "-->" : "==>",
 		      ho_name(o.plug),
 		      ho_id(o.plug),
 		      ho_owner_id(o.plug));
+	if (o.plug->role == PLUG_TAP) {
+	    hal_tap_t *tap = plug_tap(o.plug);
+	    halcmd_output(" tap=%d read=%llu", o.plug->tap,
+			  (unsigned long long) tap->generation);
+	    if (tap->lossy)
+		halcmd_output(" lossy lapped=%u", tap->lapped);
+	}
+	halcmd_output("\n");
     }
     return 0;
 }
@@ -3314,6 +3459,7 @@ static int print_ring_entry(hal_object_ptr o, foreach_args_t *args)
 	case RINGTYPE_RECORD:    rtype = "record"; break;
 	case RINGTYPE_MULTIPART: rtype = "multi"; break;
 	case RINGTYPE_STREAM:    rtype = "stream"; break;
+	case RINGTYPE_MPMC:      rtype = "mpmc"; break;
 	}
 	halcmd_output("%-5d %-40.40s %-10u %-6.6s %d/%d %d/%d %-3d",
 		      ho_id(rptr),
@@ -3331,6 +3477,10 @@ static int print_ring_entry(hal_object_ptr o, foreach_args_t *args)
 	if (rh->type == RINGTYPE_STREAM)
 	    halcmd_output(" free:%u ",
 			  stream_write_space(rh));
+	else if (rh->type == RINGTYPE_MPMC)
+	    halcmd_output(" slots:%u/%u recmax:%u ",
+			  mpmc_write_space(rh), rh->size_mask + 1,
+			  mpmc_max_size(rh));
 	else
 	    halcmd_output(" recmax:%u ",
 			  record_write_space(rh));
@@ -3379,6 +3529,7 @@ int do_newring_cmd(char *ring, char *ring_size, char **opt)
 
 
 #define SCRATCHPAD "scratchpad="
+#define SLOTSIZE "slot="
 #define ENCODINGS "encodings="
 #define PAIRED "paired="
 #define ZMQTYPE "zmq="
@@ -3406,6 +3557,25 @@ int do_newring_cmd(char *ring, char *ring_size, char **opt)
 	    mode |=  RINGTYPE_STREAM;
 	} else if  (!strcasecmp(s,"multi")) {
 	    mode |=  RINGTYPE_MULTIPART;
+	} else if  (!strcasecmp(s,"mpmc")) {
+	    mode |=  RINGTYPE_MPMC;
+	} else if (!strncasecmp(s, SLOTSIZE, strlen(SLOTSIZE))) {
+	    unsigned long slot = strtoul(strchr(s,'=') + 1, &cp, 0);
+	    if ((*cp != '\0') && (!isspace(*cp))) {
+		halcmd_error("string '%s' invalid for slot size\n", s);
+		return(-EINVAL);
+	    }
+	    int bits = 0;
+	    while ((1UL << bits) < slot)
+		bits++;
+	    if ((bits < MPMC_MIN_SLOTBITS) ||
+		(bits > (MPMC_SLOT_MASK >> MPMC_SLOT_SHIFT))) {
+		halcmd_error("slot size out of bounds (%d..%lu)\n",
+			     1 << MPMC_MIN_SLOTBITS,
+			     1UL << (MPMC_SLOT_MASK >> MPMC_SLOT_SHIFT));
+		return(-EINVAL);
+	    }
+	    mode = (mode & ~MPMC_SLOT_MASK) | MPMC_SLOTSIZE(bits);
 	} else if (!strncasecmp(s, SCRATCHPAD, strlen(SCRATCHPAD))) {
 	    spsize = strtol(strchr(s,'=') + 1, &cp, 0);
 	    if ((*cp != '\0') && (!isspace(*cp))) {
@@ -3420,7 +3590,7 @@ int do_newring_cmd(char *ring, char *ring_size, char **opt)
 
 	} else {
 	    halcmd_error("newring: invalid option '%s' (use one or several of: record stream multi"
-			 " rtapi hal rmutex wmutex scratchpad=<size>)\n",s);
+			 " mpmc rtapi hal rmutex wmutex scratchpad=<size> slot=<size>)\n",s);
 	    return -EINVAL;
 	}
     }
@@ -3544,6 +3714,12 @@ static int ringdump(const char *name, ringbuffer_t *rb, void *arg)
 	}
 	break;
 
+    case RINGTYPE_MPMC:
+	// slots can't be inspected without claiming them
+	halcmd_output("%s: mpmc ring, %u of %u slots used, slot size %u\n",
+		      name, mpmc_count(rh), rh->size_mask + 1, rh->slot_size);
+	break;
+
     case RINGTYPE_STREAM:
 	size = stream_read_space(rh);
 	halcmd_output("%s: stream ring, %u bytes unread\n", name, size);
@@ -3676,6 +3852,23 @@ static int ringwrite(const char *name, ringbuffer_t *rb, void *arg)
 	    default: ; // success
 	    }
 	    break;
+	case RINGTYPE_MPMC:
+	    if (have_flag) {
+		halcmd_error("flag %d has no meaning for mpmc ring '%s'\n",
+			     flags, name);
+		break;
+	    }
+	    retval = mpmc_write(rb, data, wsize);
+	    switch (retval) {
+	    case EAGAIN:
+		halcmd_error("%s: no free slot for %zu bytes\n",name, wsize);
+		break;
+	    case ERANGE:
+		halcmd_error("%s: write size %zu exceeds slot size \n",name, wsize);
+		break;
+	    default: ; // success
+	    }
+	    break;
 	case RINGTYPE_STREAM:
 	    if (have_flag) {
 		halcmd_error("flag %d has no meaning for stream ring '%s'\n",
@@ -3694,6 +3887,7 @@ static int ringwrite(const char *name, ringbuffer_t *rb, void *arg)
 	msg_write_flush(&mrb);
 	break;
     case RINGTYPE_RECORD:
+    case RINGTYPE_MPMC:
 	break;
     case RINGTYPE_STREAM:;
     }
@@ -3723,6 +3917,16 @@ static int ringflush(const char *name, ringbuffer_t *rb, void *arg)
 	n = stream_flush(rb);
 	halcmd_output("%s: %zu bytes flushed\n", name, n);
 	break;
+    case RINGTYPE_MPMC:
+	{
+	    mpmcticket_t tk;
+	    const void *data;
+	    ringsize_t size;
+	    for (n = 0; mpmc_read_begin(rb, &tk, &data, &size) == 0; n++)
+		mpmc_read_end(rb, &tk);
+	    halcmd_output("%s: %zu records flushed\n", name, n);
+	}
+	break;
     }
     return 0;
 }
@@ -4416,6 +4620,23 @@ int do_newthread_cmd(char *name, char *args[])
 	    flags |= TF_NOWAIT;
 	    continue;
 	}
+	if (strncmp(s, "workers=", 8) == 0) {
+	    // comma separated list of worker cpus
+	    char *cp = s + 8;
+	    while (*cp) {
+		char *ep;
+		long wcpu = strtol(cp, &ep, 0);
+		if ((ep == cp) || (wcpu < 0) || (wcpu > HAL_WORKER_MAXCPU) ||
+		    ((*ep != ',') && (*ep != '\0'))) {
+		    halcmd_error("invalid worker cpu list '%s' "
+				 "(cpus 0..%d)\n", s, HAL_WORKER_MAXCPU);
+		    return -EINVAL;
+		}
+		flags |= HAL_WORKER_CPU(wcpu);
+		cp = (*ep == ',') ? ep + 1 : ep;
+	    }
+	    continue;
+	}
 	char *cp = s;
 	per = strtol(s, &cp, 0);
 	if ((*cp != '\0') && (!isspace(*cp))) {
@@ -4553,6 +4774,11 @@ int do_help_cmd(char *command)
     } else if (strcmp(command, "gets") == 0) {
 	printf("gets signame\n");
 	printf("  Gets the value of signal 'signame'.\n");
+    } else if (strcmp(command, "snapshot") == 0) {
+	printf("snapshot threadname name [name ...]\n");
+	printf("  Prints the values of the named pins and signals as\n");
+	printf("  they were at one cycle boundary of thread 'threadname',\n");
+	printf("  or of all threads if 'threadname' is 'all'.\n");
     } else if (strcmp(command, "stype") == 0) {
 	printf("stype signame\n");
 	printf("  Gets the type of signal 'signame'\n");
@@ -4575,6 +4801,13 @@ int do_help_cmd(char *command)
 	printf("  'all' with no pattern.  If 'pattern' is specified\n");
 	printf("  it prints only those items whose names match the\n");
 	printf("  pattern, which may be a 'shell glob'.\n");
+	printf("  'hist' prints runtime percentiles of threads and functs.\n");
+    } else if (strcmp(command, "histreset") == 0) {
+	printf("histreset [pattern]\n");
+	printf("  Starts a new runtime histogram window for all threads\n");
+	printf("  and functs whose names match 'pattern', or all of them\n");
+	printf("  if no pattern is given. The RT side clears the counts at\n");
+	printf("  the next invocation. See 'show hist'.\n");
     } else if (strcmp(command, "list") == 0) {
 	printf("list type [pattern]\n");
 	printf("  Prints the names of HAL items of the specified type.\n");
@@ -4659,6 +4892,7 @@ static void print_help_commands(void)
     printf("  unlinkp             Unlink pin\n");
     printf("  newsig, delsig      Create/delete a signal\n");
     printf("  getp, gets          Get the value of a pin, parameter or signal\n");
+    printf("  snapshot            Get the values of pins and signals at once\n");
     printf("  ptype, stype        Get the type of a pin, parameter or signal\n");
     printf("  setp, sets          Set the value of a pin, parameter or signal\n");
     printf("  addf, delf          Add/remove function to/from a thread\n");
@@ -4668,6 +4902,7 @@ static void print_help_commands(void)
     printf("  status              Display status information\n");
     printf("  save                Print config as commands\n");
     printf("  start, stop         Start/stop realtime threads\n");
+    printf("  histreset           Reset thread/funct runtime histograms\n");
     printf("  alias, unalias      Add or remove pin or parameter name aliases\n");
     printf("  echo, unecho        Echo commands from stdin to stderr\n");
     printf("  quit, exit          Exit from halcmd\n");
@@ -124,6 +124,9 @@ extern bool inst_name_exists(const int use_halmutex, char *name);
 extern int do_shutdown_cmd(void);
 // HAL object garbage collector
 extern int do_sweep_cmd(char *flags);
+extern int do_histreset_cmd(char **patterns);
+// consistent values of several pins and signals
+extern int do_snapshot_cmd(char *thread, char *names[]);
 // ping the RTAPI stack
 extern int do_ping_cmd(void);
 // create a new named RT thread
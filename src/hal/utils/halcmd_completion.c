@@ -59,7 +59,8 @@ static const char *command_table[] = {
     "newring","delring","ringdump","ringwrite","ringflush",
     "newcomp","newpin","ready","waitbound", "waitunbound", "waitexists",
     "log","shutdown","ping","newthread","delthread",
-    "sleep","vtable","autoload","newinst", "delinst",
+    "sleep","vtable","autoload","newinst", "delinst", "histreset",
+    "snapshot",
     NULL,
 };
 
@@ -70,7 +71,7 @@ static const char *nonRT_command_table[] = {
 
 static const char *show_table[] = {
     "all", "comp", "pin", "sig", "param", "funct", "thread", "group", "member",
-    "ring", "eps","vtable","inst",
+    "ring", "eps","vtable","inst", "hist",
     NULL,
 };
 
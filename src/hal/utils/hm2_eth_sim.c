@@ -0,0 +1,259 @@
+/********************************************************************
+* Description: hm2_eth_sim.c
+*   A simulated Mesa 7i92 for the hm2_eth driver: answers LBP16 over
+*   UDP on the loopback interface, so hm2_eth round trips (and its
+*   pipeline=1 mode) can be measured without a board.
+*
+*   The register file is a hm2_test style test pattern: an IDROM with
+*   an IOPort (2 x 17 pins) and a watchdog. Writes are stored, so GPIO
+*   outputs read back as inputs; nothing else is simulated.
+*
+*   Usage:
+*     hm2_eth_sim [-d delay_us] [-p port] &
+*     halcmd loadrt hostmot2
+*     halcmd loadrt hm2_eth board_ip=127.0.0.1 [pipeline=1]
+*   then compare the hm2_7i92.0.read funct's time/tmax.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// from lbp16.h
+#define LBP16_UDP_PORT 27181
+#define LBP16_WRITE 0x8000
+#define LBP16_ADDR 0x4000
+#define LBP16_INFO_ACC 0x2000
+#define LBP16_SPACE(cmd) (((cmd) >> 10) & 7)
+#define LBP16_WIDTH(cmd) (1 << (((cmd) >> 8) & 3))
+#define LBP16_ADDR_AUTO_INC 0x0080
+#define LBP16_COUNT(cmd) ((cmd) & 0x7F)
+#define LBP16_SPACE_HM2 0
+#define LBP16_SPACE_ETH_EEPROM 2
+#define LBP16_SPACE_BOARD_INFO 7
+
+// from hostmot2.h
+#define HM2_ADDR_IOCOOKIE 0x0100
+#define HM2_IOCOOKIE 0x55AACAFE
+#define HM2_ADDR_CONFIGNAME 0x0104
+#define HM2_ADDR_IDROM_OFFSET 0x010C
+#define HM2_GTAG_WATCHDOG 2
+#define HM2_GTAG_IOPORT 3
+
+#define IDROM 0x400
+#define PORTS 2
+#define PORT_WIDTH 17
+
+static uint8_t space[8][64 * 1024];
+static volatile int done;
+static long packets, reads, writes;
+
+static void set8(int s, uint16_t addr, uint8_t val) {
+    space[s][addr] = val;
+}
+
+static void set32(int s, uint16_t addr, uint32_t val) {
+    memcpy(&space[s][addr], &val, 4);
+}
+
+static void setstr(int s, uint16_t addr, const char *str, int len) {
+    memset(&space[s][addr], 0, len);
+    memcpy(&space[s][addr], str, strlen(str) < (size_t)len ? strlen(str) : (size_t)len);
+}
+
+// module descriptor i, as hm2_read_module_descriptors() parses it
+static void set_md(int i, int gtag, int version, int instances,
+                   uint16_t base, int registers, uint32_t multiple) {
+    uint16_t addr = IDROM + 0x40 + i * 12;
+    // clock tag 1 (ClockLow), register stride 0, instance stride 0
+    set32(LBP16_SPACE_HM2, addr, gtag | version << 8 | 1 << 16 | instances << 24);
+    set32(LBP16_SPACE_HM2, addr + 4, base | registers << 16);
+    set32(LBP16_SPACE_HM2, addr + 8, multiple);
+}
+
+static void init_board(void) {
+    int i;
+
+    setstr(LBP16_SPACE_BOARD_INFO, 0, "7I92", 16);
+    for (i = 0; i < 6; i++)     // mac address, read by fetch_hwaddr()
+        set8(LBP16_SPACE_ETH_EEPROM, 2 + i, 0x10 + i);
+
+    set32(LBP16_SPACE_HM2, HM2_ADDR_IOCOOKIE, HM2_IOCOOKIE);
+    setstr(LBP16_SPACE_HM2, HM2_ADDR_CONFIGNAME, "HOSTMOT2", 8);
+    set32(LBP16_SPACE_HM2, HM2_ADDR_IDROM_OFFSET, IDROM);
+
+    set32(LBP16_SPACE_HM2, IDROM + 0x00, 3);            // IDROM type
+    set32(LBP16_SPACE_HM2, IDROM + 0x04, 0x40);         // offset to MDs
+    set32(LBP16_SPACE_HM2, IDROM + 0x08, 0x200);        // offset to PDs
+    setstr(LBP16_SPACE_HM2, IDROM + 0x0c, "MESA7I92", 8);
+    set32(LBP16_SPACE_HM2, IDROM + 0x14, 9);            // FPGA size
+    set32(LBP16_SPACE_HM2, IDROM + 0x18, 144);          // FPGA pins
+    set32(LBP16_SPACE_HM2, IDROM + 0x1c, PORTS);
+    set32(LBP16_SPACE_HM2, IDROM + 0x20, PORTS * PORT_WIDTH);
+    set32(LBP16_SPACE_HM2, IDROM + 0x24, PORT_WIDTH);
+    set32(LBP16_SPACE_HM2, IDROM + 0x28, 100000000);    // ClockLow
+    set32(LBP16_SPACE_HM2, IDROM + 0x2c, 200000000);    // ClockHigh
+    set32(LBP16_SPACE_HM2, IDROM + 0x30, 4);            // InstanceStride0
+    set32(LBP16_SPACE_HM2, IDROM + 0x34, 0x40);         // InstanceStride1
+    set32(LBP16_SPACE_HM2, IDROM + 0x38, 0x100);        // RegisterStride0
+    set32(LBP16_SPACE_HM2, IDROM + 0x3c, 4);            // RegisterStride1
+
+    set_md(0, HM2_GTAG_WATCHDOG, 0, 1, 0x0c00, 3, 0);
+    set_md(1, HM2_GTAG_IOPORT, 0, PORTS, 0x1000, 5, 0x1f);
+    // the MD after the last has GTag 0
+
+    for (i = 0; i < PORTS * PORT_WIDTH; i++)
+        set8(LBP16_SPACE_HM2, IDROM + 0x200 + i * 4 + 3, HM2_GTAG_IOPORT);
+}
+
+// run the LBP16 commands in a request, appending read data to reply.
+// Returns the size of the reply, or -1 if the request is malformed.
+static int handle(const uint8_t *req, int len, uint8_t *reply, int reply_size) {
+    int pos = 0, out = 0;
+
+    while (pos + 2 <= len) {
+        uint16_t cmd = req[pos] | req[pos + 1] << 8;
+        uint16_t addr = 0;
+        int width = LBP16_WIDTH(cmd), count = LBP16_COUNT(cmd);
+        int s = LBP16_SPACE(cmd), i;
+        pos += 2;
+
+        if (cmd & LBP16_ADDR) {
+            if (pos + 2 > len) return -1;
+            addr = req[pos] | req[pos + 1] << 8;
+            pos += 2;
+        }
+        for (i = 0; i < count; i++) {
+            uint16_t a = (cmd & LBP16_ADDR_AUTO_INC) ? addr + i * width : addr;
+            if (cmd & LBP16_WRITE) {
+                if (pos + width > len) return -1;
+                if (!(cmd & LBP16_INFO_ACC))
+                    memcpy(&space[s][a], &req[pos], width);
+                pos += width;
+            } else {
+                if (out + width > reply_size) return -1;
+                if (cmd & LBP16_INFO_ACC)
+                    memset(&reply[out], 0, width);
+                else
+                    memcpy(&reply[out], &space[s][a], width);
+                out += width;
+            }
+        }
+        if (cmd & LBP16_WRITE) writes++;
+        else reads++;
+    }
+    return out;
+}
+
+static void quit(int sig) {
+    done = 1;
+}
+
+static void usage(void) {
+    printf("Usage:  hm2_eth_sim [options]\n"
+           "-p <port>\n"
+           "    UDP port on 127.0.0.1 (default %d)\n"
+           "-d <us>\n"
+           "    delay each reply, as a board and the wire would (default 0)\n",
+           LBP16_UDP_PORT);
+}
+
+int main(int argc, char *argv[]) {
+    int opt, port = LBP16_UDP_PORT, delay_us = 0;
+    struct sockaddr_in addr, peer;
+    socklen_t peerlen;
+    uint8_t req[1500], reply[64 * 1024];
+    struct sigaction sa;
+
+    while ((opt = getopt(argc, argv, "hp:d:")) != -1) {
+        switch (opt) {
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'd':
+            delay_us = atoi(optarg);
+            break;
+        default:
+            usage();
+            exit(1);
+        }
+    }
+    if (port < 1 || port > 65535 || delay_us < 0) {
+        usage();
+        exit(1);
+    }
+
+    int fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0) {
+        perror("socket");
+        return 1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        perror("bind");
+        return 1;
+    }
+
+    // let SIGINT/SIGTERM interrupt recvfrom()
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = quit;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    init_board();
+    fprintf(stderr, "hm2_eth_sim: 7i92 at 127.0.0.1:%d, reply delay %dus\n",
+            port, delay_us);
+
+    while (!done) {
+        peerlen = sizeof(peer);
+        int len = recvfrom(fd, req, sizeof(req), 0,
+                           (struct sockaddr *) &peer, &peerlen);
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            perror("recvfrom");
+            break;
+        }
+        packets++;
+
+        struct timespec due;
+        clock_gettime(CLOCK_MONOTONIC, &due);
+        int n = handle(req, len, reply, sizeof(reply));
+        if (n < 0) {
+            fprintf(stderr, "hm2_eth_sim: malformed request of %d bytes\n", len);
+            continue;
+        }
+        if (n == 0)
+            continue;           // writes get no reply
+
+        if (delay_us) {
+            due.tv_nsec += delay_us * 1000L;
+            due.tv_sec += due.tv_nsec / 1000000000L;
+            due.tv_nsec %= 1000000000L;
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL) == EINTR && !done)
+                ;
+        }
+        if (sendto(fd, reply, n, 0, (struct sockaddr *) &peer, peerlen) < 0)
+            perror("sendto");
+    }
+
+    fprintf(stderr, "hm2_eth_sim: %ld packets, %ld read and %ld write commands\n",
+            packets, reads, writes);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,237 @@
+// deltabench: compare group update encodings as haltalk sends them -
+// MT_HALGROUP_INCREMENTAL_UPDATE (repeated Signal) versus
+// MT_HALGROUP_DELTA_UPDATE (SignalDelta) - for size and encode/decode time
+// per update, over a range of changed member fractions.
+//
+// runs without HAL: member values live in a local array.
+// exits nonzero if a decoded update doesn't match what was encoded.
+//
+// License: GPL Version 2 or later
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "halpb.hh"
+
+static int n_members = 500;
+static int iterations = 10000;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static hal_type_t member_type(int i)
+{
+    static const hal_type_t types[] = { HAL_FLOAT, HAL_BIT, HAL_S32, HAL_U32 };
+    return types[i % 4];
+}
+
+static void u2pbsig(hal_type_t type, const hal_data_u *vp, machinetalk::Signal *s)
+{
+    switch (type) {
+    case HAL_BIT:
+	s->set_halbit(get_bit_value(vp));
+	break;
+    case HAL_FLOAT:
+	s->set_halfloat(get_float_value(vp));
+	break;
+    case HAL_S32:
+	s->set_hals32(get_s32_value(vp));
+	break;
+    case HAL_U32:
+	s->set_halu32(get_u32_value(vp));
+	break;
+    default:
+	break;
+    }
+}
+
+// change every stride'th member, starting at offset
+static void mutate(hal_data_u *v, int stride, int offset, int round)
+{
+    for (int i = offset % stride; i < n_members; i += stride) {
+	switch (member_type(i)) {
+	case HAL_BIT:
+	    set_bit_value(&v[i], !get_bit_value(&v[i]));
+	    break;
+	case HAL_FLOAT:
+	    set_float_value(&v[i], get_float_value(&v[i]) + 0.001 * round);
+	    break;
+	case HAL_S32:
+	    set_s32_value(&v[i], get_s32_value(&v[i]) - round);
+	    break;
+	default:
+	    set_u32_value(&v[i], get_u32_value(&v[i]) + round);
+	    break;
+	}
+    }
+}
+
+static bool same(hal_type_t type, const hal_data_u *a, const hal_data_u *b)
+{
+    switch (type) {
+    case HAL_BIT:
+	return get_bit_value(a) == get_bit_value(b);
+    case HAL_FLOAT:
+	return get_float_value(a) == get_float_value(b);
+    case HAL_S32:
+	return get_s32_value(a) == get_s32_value(b);
+    default:
+	return get_u32_value(a) == get_u32_value(b);
+    }
+}
+
+static int run(int stride)
+{
+    hal_data_u *v = new hal_data_u[n_members]();
+    hal_data_u *pbview = new hal_data_u[n_members]();
+    hal_data_u *dview = new hal_data_u[n_members]();
+    machinetalk::Container tx, rx;
+    std::string buf;
+    double t_pb = 0, t_delta = 0, t_pbdec = 0, t_ddec = 0;
+    size_t b_pb = 0, b_delta = 0;
+    int errors = 0;
+
+    for (int r = 0; r < iterations; r++) {
+	int offset = r;
+	mutate(v, stride, offset, r + 1);
+
+	// repeated Signal, as group_report_cb() does
+	double t0 = now_ns();
+	tx.set_type(machinetalk::MT_HALGROUP_INCREMENTAL_UPDATE);
+	tx.set_serial(r);
+	for (int i = offset % stride; i < n_members; i += stride) {
+	    machinetalk::Signal *signal = tx.add_signal();
+	    signal->set_handle(1000 + i);
+	    u2pbsig(member_type(i), &v[i], signal);
+	}
+	tx.SerializeToString(&buf);
+	tx.Clear();
+	t_pb += now_ns() - t0;
+	b_pb += buf.size();
+
+	t0 = now_ns();
+	rx.ParseFromString(buf);
+	for (int j = 0; j < rx.signal_size(); j++) {
+	    const machinetalk::Signal &s = rx.signal(j);
+	    int i = s.handle() - 1000;
+	    switch (member_type(i)) {
+	    case HAL_BIT: set_bit_value(&pbview[i], s.halbit()); break;
+	    case HAL_FLOAT: set_float_value(&pbview[i], s.halfloat()); break;
+	    case HAL_S32: set_s32_value(&pbview[i], s.hals32()); break;
+	    default: set_u32_value(&pbview[i], s.halu32()); break;
+	    }
+	}
+	t_pbdec += now_ns() - t0;
+
+	// SignalDelta
+	t0 = now_ns();
+	tx.set_type(machinetalk::MT_HALGROUP_DELTA_UPDATE);
+	tx.set_serial(r);
+	machinetalk::SignalDelta *delta = tx.mutable_delta();
+	pb_delta_begin(delta, n_members);
+	for (int i = offset % stride; i < n_members; i += stride) {
+	    pb_delta_mark(delta, i);
+	    hal_u2delta(member_type(i), &v[i], delta->mutable_values());
+	}
+	pb_delta_end(delta);
+	tx.SerializeToString(&buf);
+	tx.Clear();
+	t_delta += now_ns() - t0;
+	b_delta += buf.size();
+
+	t0 = now_ns();
+	rx.ParseFromString(buf);
+	const machinetalk::SignalDelta &rd = rx.delta();
+	const std::string &values = rd.values();
+	size_t pos = 0;
+	if (rd.has_changed()) {
+	    const std::string &changed = rd.changed();
+	    for (size_t b = 0; b < changed.size(); b++) {
+		unsigned bits = (unsigned char) changed[b];
+		while (bits) {
+		    int i = b * 8 + __builtin_ctz(bits);
+		    bits &= bits - 1;
+		    if (hal_delta2u(member_type(i), values, &pos, &dview[i]))
+			errors++;
+		}
+	    }
+	} else {
+	    for (int j = 0; j < rd.index_size(); j++) {
+		int i = rd.index(j);
+		if (hal_delta2u(member_type(i), values, &pos, &dview[i]))
+		    errors++;
+	    }
+	}
+	t_ddec += now_ns() - t0;
+
+	for (int i = 0; i < n_members; i++)
+	    if (!same(member_type(i), &v[i], &pbview[i]) ||
+		!same(member_type(i), &v[i], &dview[i]))
+		errors++;
+    }
+
+    int changed = (n_members + stride - 1) / stride;
+    printf("%5d/%-5d %10.1f %10.1f %9.0f %9.0f %9.0f %9.0f\n",
+	   changed, n_members,
+	   (double) b_pb / iterations, (double) b_delta / iterations,
+	   t_pb / iterations, t_delta / iterations,
+	   t_pbdec / iterations, t_ddec / iterations);
+
+    delete[] v;
+    delete[] pbview;
+    delete[] dview;
+    return errors;
+}
+
+static void usage(void)
+{
+    printf("Usage:  deltabench [options]\n"
+	   "-n <members>\n"
+	   "    number of group members (default 500)\n"
+	   "-i <iterations>\n"
+	   "    updates per changed fraction (default 10000)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int opt, errors = 0;
+
+    while ((opt = getopt(argc, argv, "hn:i:")) != -1) {
+	switch (opt) {
+	case 'n':
+	    n_members = atoi(optarg);
+	    break;
+	case 'i':
+	    iterations = atoi(optarg);
+	    break;
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if ((n_members < 1) || (iterations < 1)) {
+	usage();
+	exit(1);
+    }
+
+    printf("bytes and ns per update\n");
+    printf("%-11s %10s %10s %9s %9s %9s %9s\n", "changed",
+	   "B signal", "B delta", "enc sig", "enc dlt",
+	   "dec sig", "dec dlt");
+    static const int strides[] = { 100, 20, 4, 1 };
+    for (size_t i = 0; i < sizeof(strides)/sizeof(strides[0]); i++)
+	errors += run(strides[i]);
+
+    if (errors) {
+	fprintf(stderr, "deltabench: %d mismatches\n", errors);
+	return 1;
+    }
+    return 0;
+}
@@ -32,6 +32,9 @@
 #include <uuid/uuid.h>
 #include <czmq.h>
 
+#include <pthread.h>
+#include <sys/eventfd.h>
+
 #include <string>
 #include <unordered_map>
 
@@ -44,6 +47,7 @@
 #include <hal_priv.h>
 #include <hal_group.h>
 #include <hal_rcomp.h>
+#include <hal_capture.h>
 #include <inifile.h>
 #include <syslog_async.h>
 
@@ -70,8 +74,12 @@ typedef struct {
     int serial; // must be unique per active group
     unsigned flags;
     htself_t *self;
-    int timer_id; // > -1: scan timer active - subscribers present
+    bool subscribed;
+    int timer_id; // > -1: scan timer active - subscribers, no change events
     int msec;
+    bool evented; // subscribers, reported on change events
+    int defer_id; // > -1: report deferred to msec after the last one
+    long long last_report; // mS, monotonic
 } group_t;
 
 typedef struct {
@@ -83,6 +91,17 @@ typedef struct {
     int msec;
 } rcomp_t;
 
+// the change event thread: waits in hal_watch_wait() on behalf of
+// the reactor, and signals event_fd on a change
+typedef struct htwatch {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    __u32 slots;  // watch slots to wait for, 0 while the reactor works
+    bool stop;
+    int event_fd;
+} htwatch_t;
+
 typedef struct htbridge {
     int state;
     void *z_bridge_status;
@@ -90,6 +109,16 @@ typedef struct htbridge {
     int timer_id;
 } htbridge_t;
 
+// a capture session read by haltalk while it has subscribers
+typedef struct {
+    std::string name;
+    capture_shm_t *shm;
+    int shm_id;
+    htself_t *self;
+    int timer_id;
+    int msec;
+} session_t;
+
 // groups indexed by group name
 typedef std::unordered_map<std::string, group_t *> groupmap_t;
 typedef groupmap_t::iterator groupmap_iterator;
@@ -98,15 +127,20 @@ typedef groupmap_t::iterator groupmap_iterator;
 typedef std::unordered_map<std::string, rcomp_t *> compmap_t;
 typedef compmap_t::iterator compmap_iterator;
 
+// capture sessions indexed by instance name
+typedef std::unordered_map<std::string, session_t *> capturemap_t;
+typedef capturemap_t::iterator capturemap_iterator;
+
 // HAL items indexed by handle
 typedef std::unordered_map<int, hal_object_ptr> itemmap_t;
 typedef itemmap_t::iterator itemmap_iterator;
 
-#define NSVCS  3
+#define NSVCS  4
 enum {
     SVC_HALGROUP=0,
     SVC_HALRCOMP,
     SVC_HALRCMD,
+    SVC_HALCAPTURE,
 };
 
 typedef struct htconf {
@@ -127,6 +161,8 @@ typedef struct htconf {
     int default_rcomp_timer; // msec
     int keepalive_timer; // msec; disabled if zero
     bool trap_signals;
+    bool group_delta; // send MT_HALGROUP_DELTA_UPDATE
+    int default_capture_timer; // msec
 } htconf_t;
 
 typedef struct htself {
@@ -146,9 +182,11 @@ typedef struct htself {
 
     groupmap_t groups;
     compmap_t  rcomps;
+    capturemap_t captures;
     itemmap_t  items;
 
     htbridge_t *bridge;
+    htwatch_t *watch; // NULL if RT threads don't do change events
 } htself_t;
 
 
@@ -158,6 +196,10 @@ int release_groups(htself_t *self);
 int handle_group_timer(zloop_t *loop, int timer_id, void *arg);
 int handle_group_input(zloop_t *loop, zsock_t *socket, void *arg);
 int ping_groups(htself_t *self);
+int watch_start(htself_t *self);
+int watch_stop(htself_t *self);
+int handle_group_watch(zloop_t *loop, zmq_pollitem_t *poller, void *arg);
+int handle_watch_recheck(zloop_t *loop, int timer_id, void *arg);
 
 // haltalk_rcomp.cc:
 int scan_comps(htself_t *self);
@@ -169,6 +211,11 @@ int ping_comps(htself_t *self);
 // haltalk_command.cc:
 int handle_command_input(zloop_t *loop, zsock_t *socket, void *arg);
 
+// haltalk_capture.cc:
+int handle_capture_input(zloop_t *loop, zsock_t *socket, void *arg);
+int handle_capture_timer(zloop_t *loop, int timer_id, void *arg);
+int release_captures(htself_t *self);
+
 // haltalk_introspect.cc:
 int process_describe(htself_t *self, zmsg_t *from,  void *socket);
 int describe_group(htself_t *self, const char *group, const std::string &from,  void *socket);
@@ -0,0 +1,166 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// the halcapture service: publishes the finished captures of capture
+// sessions (see hal/components/capture.c). The topic is the session
+// name. While a session has subscribers, haltalk is its reader: it
+// polls for finished captures, publishes and releases them. Without
+// subscribers, captures wait in the session's slots.
+
+#include "haltalk.hh"
+#include "halpb.hh"
+#include "pbutil.hh"
+
+static int
+publish_capture(session_t *s, capture_slot_t *slot)
+{
+    htself_t *self = s->self;
+    capture_shm_t *shm = s->shm;
+    char name[HAL_MAX_NAME_LEN + 1];
+
+    self->tx.set_type(machinetalk::MT_HALCAPTURE_DATA);
+    machinetalk::Capture *c = self->tx.add_capture();
+    c->set_name(s->name);
+    c->set_seq(slot->seq);
+    c->set_trigger(slot->trigger);
+    c->set_timestamp(slot->timestamp);
+    c->set_pre_trigger(slot->pre);
+    c->set_period(slot->period);
+    c->set_records(slot->count);
+
+    for (unsigned n = 0; n < shm->n_chan; n++) {
+	machinetalk::CaptureChannel *ch = c->add_channel();
+	if (halg_capture_channel_name(1, s->name.c_str(), n,
+				      name, sizeof(name)) == 0)
+	    ch->set_name(name);
+	ch->set_type((machinetalk::ValueType) shm->type[n]);
+    }
+
+    std::string *values = c->mutable_values();
+    for (unsigned i = 0; i < slot->count; i++) {
+	hal_data_u *rec = capture_record(shm, slot, i);
+	for (unsigned n = 0; n < shm->n_chan; n++)
+	    hal_u2delta((hal_type_t) shm->type[n], &rec[n], values);
+    }
+    return send_pbcontainer(s->name, self->tx,
+			    self->mksock[SVC_HALCAPTURE].socket);
+}
+
+int
+handle_capture_timer(zloop_t *loop, int timer_id, void *arg)
+{
+    session_t *s = (session_t *) arg;
+    capture_slot_t *slot;
+
+    while ((slot = capture_next(s->shm)) != NULL) {
+	if (publish_capture(s, slot))
+	    rtapi_print_msg(RTAPI_MSG_ERR, "%s: %s: publishing capture %u failed",
+			    s->self->cfg->progname, s->name.c_str(), slot->seq);
+	capture_release(s->shm);
+    }
+    return 0;
+}
+
+// attach to the session on the first subscribe
+static session_t *
+capture_subscribe(htself_t *self, const char *topic)
+{
+    if (self->captures.count(topic))
+	return self->captures[topic];
+
+    int shm_id;
+    capture_shm_t *shm = halg_capture_attach(1, topic, self->comp_id, &shm_id);
+    if (shm == NULL)
+	return NULL;
+
+    session_t *s = new session_t();
+    s->name = topic;
+    s->shm = shm;
+    s->shm_id = shm_id;
+    s->self = self;
+    s->msec = self->cfg->default_capture_timer;
+    s->timer_id = zloop_timer(self->netopts.z_loop, s->msec, 0,
+			      handle_capture_timer, (void *) s);
+    assert(s->timer_id > -1);
+    self->captures[topic] = s;
+    rtapi_print_msg(RTAPI_MSG_DBG,
+		    "%s: reading capture session %s, tid=%d, %d mS, %d channels",
+		    self->cfg->progname, topic, s->timer_id, s->msec, shm->n_chan);
+    return s;
+}
+
+static void
+capture_detach(htself_t *self, session_t *s)
+{
+    zloop_timer_end(self->netopts.z_loop, s->timer_id);
+    hal_capture_detach(s->shm_id, self->comp_id);
+    delete s;
+}
+
+// handle message input on the XPUB channel:
+//    subscribe events (\001<topic>), for every subscribe
+//    unsubscribe events (\000<topic>), for the last unsubscribe
+int
+handle_capture_input(zloop_t *loop, zsock_t *socket, void *arg)
+{
+    htself_t *self = (htself_t *) arg;
+    zmsg_t *msg = zmsg_recv(socket);
+
+    if (zmsg_size(msg) == 1) {
+	zframe_t *f = zmsg_first(msg);
+	char *data = (char *) zframe_data(f);
+	std::string topic(data + 1, zframe_size(f) - 1);
+
+	switch (*data) {
+
+	case '\001':
+	    if (capture_subscribe(self, topic.c_str()) == NULL) {
+		rtapi_print_msg(RTAPI_MSG_ERR, "%s: subscribe - no capture session '%s'",
+				self->cfg->progname, topic.c_str());
+
+		// publish an error message on this topic
+		self->tx.set_type(machinetalk::MT_HALCAPTURE_ERROR);
+		note_printf(self->tx, "capture session '%s' does not exist",
+			    topic.c_str());
+		int retval = send_pbcontainer(topic, self->tx, socket);
+		assert(retval == 0);
+	    }
+	    break;
+
+	case '\000':
+	    // last subscriber went away - leave captures to other readers
+	    if (self->captures.count(topic)) {
+		capture_detach(self, self->captures[topic]);
+		self->captures.erase(topic);
+		rtapi_print_msg(RTAPI_MSG_DBG, "%s: capture session %s released",
+				self->cfg->progname, topic.c_str());
+	    }
+	    break;
+	}
+    }
+    zmsg_destroy(&msg);
+    return 0;
+}
+
+int
+release_captures(htself_t *self)
+{
+    for (capturemap_iterator c = self->captures.begin();
+	 c != self->captures.end(); c++)
+	capture_detach(self, c->second);
+    self->captures.clear();
+    return 0;
+}
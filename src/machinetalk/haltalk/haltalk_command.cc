@@ -602,6 +602,7 @@ process_set(htself_t *self, bool halrcomp, zmsg_t *from, void *socket)
             note_printf(self->tx, "bad pin type %d name=%s",p.type(), ho_name(o.pin));
             continue;
         }
+        hal_pin_written(o.pin);
         } else {
         // record handle lookup failure
         note_printf(self->tx, "no such handle: %d",handle);
@@ -673,6 +674,7 @@ process_set(htself_t *self, bool halrcomp, zmsg_t *from, void *socket)
                 s.type(), ho_name(o.sig));
             continue;
         }
+        hal_sig_written(o.sig);
         } else {
         // record handle lookup failure
         note_printf(self->tx, "no such handle: %d",handle);
@@ -878,6 +880,7 @@ apply_initial_values(htself_t *self, const machinetalk::Component *pbcomp)
         note_printf(self->tx, "bad pin type %d/%d name=%s", p.type(), hp->type, pname);
         continue;
         }
+        hal_pin_written(hp);
         rtapi_print_msg(RTAPI_MSG_DBG,
                 "%s: comp %s: applied inital value of %s",
                 self->cfg->progname, pbcomp->name().c_str(), pname);
@@ -23,6 +23,14 @@
 static int group_report_cb(int phase, hal_compiled_group_t *cgroup,
 			   hal_sig_t *sig, void *cb_data);
 static int scan_group_cb(hal_object_ptr o, foreach_args_t *args);
+static void group_start(htself_t *self, group_t *g, const char *name);
+static void group_stop(htself_t *self, group_t *g, const char *name);
+static void watch_arm(htself_t *self);
+static void describe_group_index(group_t *g, machinetalk::SignalDelta *delta);
+
+// the watch thread returns from hal_watch_wait() this often to
+// notice a stop request
+#define WATCH_TIMEOUT 200 // mS
 
 
 // monitor group subscribe events:
@@ -64,18 +72,12 @@ handle_group_input(zloop_t *loop, zsock_t *socket, void *arg)
 		self->tx.set_uuid(self->netopts.proc_uuid, sizeof(self->netopts.proc_uuid));
 		self->tx.set_serial(g->serial++);
 		describe_parameters(self);
+		if (self->cfg->group_delta)
+		    describe_group_index(g, self->tx.mutable_delta());
 		describe_group(self, gi->first.c_str(), gi->first.c_str(), socket);
 
 		// if first subscriber: activate scanning
-		if (g->timer_id < 0) { // not scanning
-		    g->timer_id = zloop_timer(loop, g->msec,
-					      0, handle_group_timer, (void *)g);
-		    assert(g->timer_id > -1);
-		    rtapi_print_msg(RTAPI_MSG_DBG,
-				    "%s: start scanning group %s, tid=%d, %d mS, %d members, %d monitored",
-				    self->cfg->progname, topic, g->timer_id, g->msec,
-				    g->cg->n_members, g->cg->n_monitored);
-		}
+		group_start(self, g, gi->first.c_str());
 		rtapi_print_msg(RTAPI_MSG_DBG,
 				"%s: wildcard subscribe group='%s' serial=%d",
 				self->cfg->progname,
@@ -90,6 +92,8 @@ handle_group_input(zloop_t *loop, zsock_t *socket, void *arg)
 		self->tx.set_uuid(self->netopts.proc_uuid, sizeof(self->netopts.proc_uuid));
 		self->tx.set_serial(g->serial++);
 		describe_parameters(self);
+		if (self->cfg->group_delta)
+		    describe_group_index(g, self->tx.mutable_delta());
 		describe_group(self, gi->first.c_str(), gi->first.c_str(), socket);
 		rtapi_print_msg(RTAPI_MSG_DBG,
 				"%s: subscribe group='%s' serial=%d",
@@ -97,15 +101,7 @@ handle_group_input(zloop_t *loop, zsock_t *socket, void *arg)
 				gi->first.c_str(), gi->second->serial);
 
 		// if first subscriber: activate scanning
-		if (g->timer_id < 0) { // not scanning
-		    g->timer_id = zloop_timer(loop, g->msec,
-					      0, handle_group_timer, (void *)g);
-		    assert(g->timer_id > -1);
-		    rtapi_print_msg(RTAPI_MSG_DBG,
-				    "%s: start scanning group %s, tid=%d, %d mS, %d members, %d monitored",
-				    self->cfg->progname, topic,
-				    g->timer_id, g->msec, g->cg->n_members, g->cg->n_monitored);
-		}
+		group_start(self, g, topic);
 	    } else {
 		// non-existant topic, complain.
 		self->tx.set_type(machinetalk::MT_STP_NOGROUP);
@@ -126,16 +122,7 @@ handle_group_input(zloop_t *loop, zsock_t *socket, void *arg)
 
     case '\000':   // last unsubscribe
 	if (self->groups.count(topic) > 0) {
-	    group_t *g = self->groups[topic];
-	    // stop the scanning timer
-	    if (g->timer_id > -1) {  // currently scanning
-		rtapi_print_msg(RTAPI_MSG_DBG,
-				"%s: group %s stop scanning, tid=%d",
-				self->cfg->progname, topic, g->timer_id);
-		int retval = zloop_timer_end (loop, g->timer_id);
-		assert(retval == 0);
-		g->timer_id = -1;
-	    }
+	    group_stop(self, self->groups[topic], topic);
 	}
 	break;
 
@@ -157,6 +144,204 @@ handle_group_timer(zloop_t *loop, int timer_id, void *arg)
     return 0;
 }
 
+// change-driven reporting:
+//
+// if the RT threads do change events (see hal_watch_wait()), a
+// subscribed group is not scanned on a timer. A watch thread waits for
+// a change in any of the subscribed groups, and signals the reactor
+// through an eventfd. The group timer then only spaces reports: a group
+// changing again within msec of its last report is reported msec after
+// it, and changes in between are folded into that report.
+//
+// a group with a legacy writer linked to any of its signals cannot be
+// covered by change events, and falls back to scanning; this is
+// rechecked periodically since links may change while subscribed.
+
+static long long now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void group_send(group_t *g)
+{
+    if (hal_cgroup_match(g->cg))
+	hal_cgroup_report(g->cg, group_report_cb, g, 0);
+    g->last_report = now_ms();
+}
+
+static int
+handle_group_deferred(zloop_t *loop, int timer_id, void *arg)
+{
+    group_t *g = (group_t *) arg;
+    g->defer_id = -1; // one-shot timer, gone now
+    group_send(g);
+    watch_arm(g->self);
+    return 0;
+}
+
+static bool group_dirty(const group_t *g)
+{
+    return __atomic_load_n(&hal_data->watch_dirty, __ATOMIC_ACQUIRE) &
+	(1U << g->cg->watch_slot);
+}
+
+int
+handle_group_watch(zloop_t *loop, zmq_pollitem_t *poller, void *arg)
+{
+    htself_t *self = (htself_t *) arg;
+    uint64_t count;
+
+    if (read(self->watch->event_fd, &count, sizeof(count)) < 0)
+	return 0; // EAGAIN: nothing pending
+
+    long long now = now_ms();
+    for (groupmap_iterator gi = self->groups.begin();
+	 gi != self->groups.end(); gi++) {
+	group_t *g = gi->second;
+
+	if (!g->evented || (g->defer_id > -1) || !group_dirty(g))
+	    continue;
+	long long due = g->last_report + g->msec;
+	if (now < due) {
+	    g->defer_id = zloop_timer(loop, due - now, 1,
+				      handle_group_deferred, (void *)g);
+	    assert(g->defer_id > -1);
+	} else {
+	    group_send(g);
+	}
+    }
+    watch_arm(self);
+    return 0;
+}
+
+// fall back to scanning any group which picked up a legacy writer
+int
+handle_watch_recheck(zloop_t *loop, int timer_id, void *arg)
+{
+    htself_t *self = (htself_t *) arg;
+
+    for (groupmap_iterator gi = self->groups.begin();
+	 gi != self->groups.end(); gi++) {
+	group_t *g = gi->second;
+	if (g->evented && !hal_cgroup_evented(g->cg)) {
+	    rtapi_print_msg(RTAPI_MSG_DBG,
+			    "%s: group %s has a legacy writer, scanning",
+			    self->cfg->progname, gi->first.c_str());
+	    group_stop(self, g, gi->first.c_str());
+	    group_start(self, g, gi->first.c_str());
+	}
+    }
+    return 0;
+}
+
+static void *
+watch_thread(void *arg)
+{
+    htwatch_t *w = (htwatch_t *) arg;
+
+    pthread_mutex_lock(&w->lock);
+    while (!w->stop) {
+	if (w->slots == 0) {
+	    // reactor busy with the last change
+	    pthread_cond_wait(&w->cond, &w->lock);
+	    continue;
+	}
+	__u32 slots = w->slots;
+	pthread_mutex_unlock(&w->lock);
+
+	int retval = hal_watch_wait(slots, WATCH_TIMEOUT);
+
+	pthread_mutex_lock(&w->lock);
+	if ((retval > 0) && w->slots) {
+	    uint64_t one = 1;
+	    w->slots = 0;
+	    if (write(w->event_fd, &one, sizeof(one)) < 0)
+		perror("watch_thread: write");
+	}
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+// hand the watch thread the slots of groups waiting for a change
+static void watch_arm(htself_t *self)
+{
+    htwatch_t *w = self->watch;
+    __u32 slots = 0;
+
+    if (w == NULL)
+	return;
+    for (groupmap_iterator gi = self->groups.begin();
+	 gi != self->groups.end(); gi++) {
+	group_t *g = gi->second;
+	if (g->evented && (g->defer_id < 0))
+	    slots |= 1U << g->cg->watch_slot;
+    }
+    pthread_mutex_lock(&w->lock);
+    w->slots = slots;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+
+    // a wait already in progress may lack new slots: have a change
+    // in any of them end it, too
+    if (slots)
+	__atomic_fetch_or(&hal_data->watch_notify, slots, __ATOMIC_SEQ_CST);
+}
+
+int watch_start(htself_t *self)
+{
+    if (!hal_data->watch_wakeup) {
+	rtapi_print_msg(RTAPI_MSG_DBG,
+			"%s: no change events from RT threads, scanning groups",
+			self->cfg->progname);
+	return 0;
+    }
+    htwatch_t *w = new htwatch_t();
+    w->slots = 0;
+    w->stop = false;
+    w->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (w->event_fd < 0) {
+	perror("eventfd");
+	delete w;
+	return -1;
+    }
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+    int retval = pthread_create(&w->thread, NULL, watch_thread, w);
+    if (retval) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+			"%s: pthread_create(): %s - scanning groups",
+			self->cfg->progname, strerror(retval));
+	close(w->event_fd);
+	delete w;
+	return 0;
+    }
+    self->watch = w;
+    return 0;
+}
+
+int watch_stop(htself_t *self)
+{
+    htwatch_t *w = self->watch;
+
+    if (w == NULL)
+	return 0;
+    pthread_mutex_lock(&w->lock);
+    w->stop = true;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    close(w->event_fd);
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->lock);
+    delete w;
+    self->watch = NULL;
+    return 0;
+}
+
 // walk HAL groups, and compile any which are not in self->groups yet
 // idempotent - will add new groups as found
 int
@@ -182,6 +367,59 @@ scan_groups(htself_t *self)
 
 // ----- end of public functions ----
 
+// first subscriber: report on change events if possible, else scan
+static void group_start(htself_t *self, group_t *g, const char *name)
+{
+    zloop_t *loop = self->netopts.z_loop;
+
+    if (g->subscribed)
+	return;
+    g->subscribed = true;
+
+    if ((self->watch != NULL) && hal_cgroup_evented(g->cg)) {
+	g->evented = true;
+	g->last_report = now_ms();
+	rtapi_print_msg(RTAPI_MSG_DBG,
+			"%s: reporting group %s on change, slot %d, %d mS spacing, %d members, %d monitored",
+			self->cfg->progname, name, g->cg->watch_slot, g->msec,
+			g->cg->n_members, g->cg->n_monitored);
+	watch_arm(self);
+	return;
+    }
+    g->timer_id = zloop_timer(loop, g->msec,
+			      0, handle_group_timer, (void *)g);
+    assert(g->timer_id > -1);
+    rtapi_print_msg(RTAPI_MSG_DBG,
+		    "%s: start scanning group %s, tid=%d, %d mS, %d members, %d monitored",
+		    self->cfg->progname, name, g->timer_id, g->msec,
+		    g->cg->n_members, g->cg->n_monitored);
+}
+
+// last unsubscribe
+static void group_stop(htself_t *self, group_t *g, const char *name)
+{
+    zloop_t *loop = self->netopts.z_loop;
+
+    g->subscribed = false;
+    if (g->timer_id > -1) {  // currently scanning
+	rtapi_print_msg(RTAPI_MSG_DBG,
+			"%s: group %s stop scanning, tid=%d",
+			self->cfg->progname, name, g->timer_id);
+	int retval = zloop_timer_end (loop, g->timer_id);
+	assert(retval == 0);
+	g->timer_id = -1;
+    }
+    if (g->defer_id > -1) {
+	int retval = zloop_timer_end (loop, g->defer_id);
+	assert(retval == 0);
+	g->defer_id = -1;
+    }
+    if (g->evented) {
+	g->evented = false;
+	watch_arm(self);
+    }
+}
+
 // static int
 // add_sig_to_items(int level, hal_group_t **groups,
 // 		 hal_member_t *member, void *cb_data)
@@ -247,7 +485,11 @@ scan_group_cb(hal_object_ptr o, foreach_args_t *args)
     grp->serial = 0;
     grp->self = self;
     grp->flags = 0;
+    grp->subscribed = false;
     grp->timer_id = -1; // not yet scanning
+    grp->evented = false;
+    grp->defer_id = -1;
+    grp->last_report = 0;
     grp->msec =  hal_cgroup_timer(cgroup);
     if (grp->msec == 0)
 	grp->msec = self->cfg->default_group_timer;
@@ -287,15 +529,29 @@ group_report_cb(int phase, hal_compiled_group_t *cgroup,
     switch (phase) {
 
     case REPORT_BEGIN:	// report initialisation
-	self->tx.set_type(machinetalk::MT_HALGROUP_INCREMENTAL_UPDATE);
+	self->tx.set_type(self->cfg->group_delta ?
+			  machinetalk::MT_HALGROUP_DELTA_UPDATE :
+			  machinetalk::MT_HALGROUP_INCREMENTAL_UPDATE);
 	// the serial enables detection of lost updates
 	// for a client to recover from a lost update:
 	// unsubscribe + re-subscribe which will cause
 	// a full state dump to be sent
 	self->tx.set_serial(grp->serial++);
+	if (self->cfg->group_delta) {
+	    // tx.Clear() keeps the buffers, so this doesn't allocate
+	    // once warmed up
+	    pb_delta_begin(self->tx.mutable_delta(), cgroup->n_members);
+	}
 	break;
 
     case REPORT_SIGNAL: // per-reported-signal action
+	if (self->cfg->group_delta) {
+	    machinetalk::SignalDelta *delta = self->tx.mutable_delta();
+	    pb_delta_mark(delta, cgroup->mbr_index);
+	    retval = hal_sig2delta(sig, delta->mutable_values());
+	    assert(retval == 0);
+	    break;
+	}
 	signal = self->tx.add_signal();
 	signal->set_handle(ho_id(sig));
 	retval = hal_sig2pb(sig, signal);
@@ -303,6 +559,8 @@ group_report_cb(int phase, hal_compiled_group_t *cgroup,
 	break;
 
     case REPORT_END: // finalize & send
+	if (self->cfg->group_delta)
+	    pb_delta_end(self->tx.mutable_delta());
 	retval = send_pbcontainer(ho_name(cgroup->group), self->tx,
 				  self->mksock[SVC_HALGROUP].socket);
 	assert(retval == 0);
@@ -328,6 +586,19 @@ group_report_cb(int phase, hal_compiled_group_t *cgroup,
     return 0;
 }
 
+// the index map of a group for delta updates: the group's signals as
+// hal_cgroup_report() walks them
+static void describe_group_index(group_t *g, machinetalk::SignalDelta *delta)
+{
+    hal_compiled_group_t *cg = g->cg;
+
+    for (int i = 0; i < cg->n_members; i++) {
+	hal_sig_t *sig = (hal_sig_t *) SHMPTR(cg->member[i]->sig_ptr);
+	delta->add_handle(ho_id(sig));
+	delta->add_type((machinetalk::ValueType) sig->type);
+    }
+}
+
 // send a keepalive to all group subscribers
 int ping_groups(htself_t *self)
 {
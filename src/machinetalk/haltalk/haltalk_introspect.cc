@@ -100,6 +100,8 @@ int describe_parameters(htself_t *self)
     pp->set_keepalive_timer(self->cfg->keepalive_timer);
     pp->set_group_timer(self->cfg->default_group_timer);
     pp->set_rcomp_timer(self->cfg->default_rcomp_timer);
+    if (self->cfg->group_delta)
+	pp->set_group_delta(true);
     return 0;
 }
 
@@ -54,6 +54,8 @@ static htconf_t conf = {
     100,  // odefault_rcomp_timer
     2000, // keepalive
     true, // trap_signals
+    false, // group_delta
+    100,  // default_capture_timer
 };
 
 
@@ -103,9 +105,15 @@ mainloop( htself_t *self)
     zloop_reader(loop, self->mksock[SVC_HALGROUP].socket, handle_group_input, self);
     zloop_reader(loop, self->mksock[SVC_HALRCOMP].socket, handle_rcomp_input, self);
     zloop_reader(loop, self->mksock[SVC_HALRCMD].socket, handle_command_input, self);
+    zloop_reader(loop, self->mksock[SVC_HALCAPTURE].socket, handle_capture_input, self);
     if (self->cfg->keepalive_timer)
 	zloop_timer(loop, self->cfg->keepalive_timer, 0,
 		    handle_keepalive_timer, (void *) self);
+    if (self->watch) {
+	zmq_pollitem_t watch_poller = { 0, self->watch->event_fd, ZMQ_POLLIN };
+	zloop_poller(loop, &watch_poller, handle_group_watch, self);
+	zloop_timer(loop, 1000, 0, handle_watch_recheck, (void *) self);
+    }
     do {
 	retval = zloop_start(loop);
     } while  (!(retval || self->interrupted));
@@ -213,6 +221,22 @@ zmq_init(htself_t *self)
     rtapi_print_msg(RTAPI_MSG_DBG, "%s: talking HALComand on '%s'",
 		    conf.progname, ms->announced_uri);
 
+
+    ms = &self->mksock[SVC_HALCAPTURE];
+    ms->dnssd_subtype = HALCAPTURE_DNSSD_SUBTYPE;
+    ms->tag = "halcapture";
+    ms->socket = zsock_new (ZMQ_XPUB);
+    assert(ms->socket);
+    zsock_set_linger(ms->socket, 0);
+    zsock_set_xpub_verbose(ms->socket, 1);
+    if (mk_bindsocket(np, ms))
+	return -1;
+    assert(ms->port > -1);
+    if (mk_announce(np, ms, "HAL Capture service", NULL))
+	return -1;
+    rtapi_print_msg(RTAPI_MSG_DBG, "%s: talking HALCapture on '%s'",
+		    conf.progname, ms->announced_uri);
+
     usleep(200 *1000); // avoid slow joiner syndrome
     return 0;
 }
@@ -264,6 +288,7 @@ static int
 hal_cleanup(htself_t *self)
 {
     int retval;
+    release_captures(self);
     retval = release_comps(self);
     retval = release_groups(self);
 
@@ -284,6 +309,8 @@ read_machinekit_ini(htself_t *s)
 	       "MACHINEKIT", &s->mksock[SVC_HALRCOMP].port);
     iniFindInt(s->netopts.mkinifp, "COMMAND_PORT",
 	       "MACHINEKIT", &s->mksock[SVC_HALRCMD].port);
+    iniFindInt(s->netopts.mkinifp, "CAPTURE_STATUS_PORT",
+	       "MACHINEKIT", &s->mksock[SVC_HALCAPTURE].port);
     return 0;
 }
 
@@ -313,6 +340,7 @@ read_config(htself_t *self)
 	iniFindInt(inifp, "GROUPTIMER", conf->section, &conf->default_group_timer);
 	iniFindInt(inifp, "RCOMPTIMER", conf->section, &conf->default_rcomp_timer);
 	iniFindInt(inifp, "KEEPALIVETIMER", conf->section, &conf->keepalive_timer);
+	iniFindInt(inifp, "CAPTURETIMER", conf->section, &conf->default_capture_timer);
 	if (!conf->debug)
 	    iniFindInt(inifp, "DEBUG", conf->section, &conf->debug);
     }
@@ -341,11 +369,15 @@ usage(void)
 	   "    set the RTAPI message level.\n"
 	   "-t or --timer <msec>\n"
 	   "    set the default group scan timer (100mS).\n"
+	   "-P or --ptimer <msec>\n"
+	   "    set the capture session poll timer (100mS).\n"
+	   "-D or --delta\n"
+	   "    send group updates delta-encoded (MT_HALGROUP_DELTA_UPDATE).\n"
 	   "-d or --debug\n"
 	   "    Turn on event debugging messages.\n");
 }
 
-static const char *option_string = "hI:S:d:t:T:R:sK:G";
+static const char *option_string = "hI:S:d:t:T:P:R:sK:GD";
 static struct option long_options[] = {
     {"help", no_argument, 0, 'h'},
     {"ini", required_argument, 0, 'I'},     // default: getenv(INI_FILE_NAME)
@@ -353,10 +385,12 @@ static struct option long_options[] = {
     {"debug", required_argument, 0, 'd'},
     {"gtimer", required_argument, 0, 't'},
     {"ctimer", required_argument, 0, 'T'},
+    {"ptimer", required_argument, 0, 'P'},
     {"keepalive", required_argument, 0, 'K'},
     {"svcuuid", required_argument, 0, 'R'},
     {"stderr",  no_argument,        0, 's'},
     {"nosighdlr",   no_argument,    0, 'G'},
+    {"delta",   no_argument,        0, 'D'},
     {0,0,0,0}
 };
 
@@ -391,6 +425,9 @@ int main (int argc, char *argv[])
 	case 'T':
 	    conf.default_rcomp_timer = atoi(optarg);
 	    break;
+	case 'P':
+	    conf.default_capture_timer = atoi(optarg);
+	    break;
 	case 'K':
 	    conf.keepalive_timer = atoi(optarg);
 	    break;
@@ -414,6 +451,9 @@ int main (int argc, char *argv[])
 	case 'G':
 	    conf.trap_signals = false;
 	    break;
+	case 'D':
+	    conf.group_delta = true;
+	    break;
 	case 's':
 	    logopt |= LOG_PERROR;
 	    break;
@@ -458,8 +498,12 @@ int main (int argc, char *argv[])
     if (retval) exit(retval);
 #endif
 
+    retval = watch_start(&self);
+    if (retval) exit(retval);
+
     mainloop(&self);
 
+    watch_stop(&self);
     ht_zeroconf_withdraw(&self);
     // probably should run zloop here until deregister complete
 
@@ -467,6 +511,7 @@ int main (int argc, char *argv[])
     zsock_destroy(&self.mksock[SVC_HALGROUP].socket);
     zsock_destroy(&self.mksock[SVC_HALRCOMP].socket);
     zsock_destroy(&self.mksock[SVC_HALRCMD].socket);
+    zsock_destroy(&self.mksock[SVC_HALCAPTURE].socket);
 
     hal_cleanup(&self);
 
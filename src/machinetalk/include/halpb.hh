@@ -145,4 +145,122 @@ static inline int hal_pbsig2u(const machinetalk::Signal *s, hal_data_u *vp)
     return 0;
 }
 
+// SignalDelta encoding - see object.proto
+
+// start a delta update of a group with n_members
+static inline void pb_delta_begin(machinetalk::SignalDelta *delta, int n_members)
+{
+    delta->mutable_changed()->assign((n_members + 7) / 8, '\0');
+    delta->clear_index();
+    delta->mutable_values()->clear();
+}
+
+// note member i as reported; its value goes to values next
+static inline void pb_delta_mark(machinetalk::SignalDelta *delta, int i)
+{
+    (*delta->mutable_changed())[i / 8] |= 1 << (i % 8);
+    delta->add_index(i);
+}
+
+// keep the shorter of bitmap and index list
+static inline void pb_delta_end(machinetalk::SignalDelta *delta)
+{
+    size_t isize = 0;
+    for (int j = 0; j < delta->index_size(); j++) {
+	__u32 i = delta->index(j);
+	isize += (i < (1 << 7)) ? 1 : (i < (1 << 14)) ? 2 : 3;
+    }
+    if (isize < delta->changed().size())
+	delta->clear_changed();
+    else
+	delta->clear_index();
+}
+
+// append a value to a SignalDelta.values blob
+static inline int hal_u2delta(hal_type_t type, const hal_data_u *vp,
+			      std::string *values)
+{
+    __u64 v;
+    int n;
+    switch (type) {
+    default:
+	return -1;
+    case HAL_BIT:
+	v = get_bit_value(vp);
+	n = 1;
+	break;
+    case HAL_FLOAT:
+	{
+	    double d = get_float_value(vp);
+	    memcpy(&v, &d, sizeof(v));
+	    n = 8;
+	}
+	break;
+    case HAL_S32:
+	v = (__u32) get_s32_value(vp);
+	n = 4;
+	break;
+    case HAL_U32:
+	v = get_u32_value(vp);
+	n = 4;
+	break;
+    }
+    for (int i = 0; i < n; i++)
+	values->push_back((char)(v >> (8 * i)));
+    return 0;
+}
+
+static inline int hal_sig2delta(hal_sig_t *sp, std::string *values)
+{
+    return hal_u2delta(sp->type, sig_value(sp), values);
+}
+
+// decode a value at *pos from a SignalDelta.values blob, advancing *pos.
+// returns -1 if the type is unknown or the blob too short.
+static inline int hal_delta2u(hal_type_t type, const std::string &values,
+			      size_t *pos, hal_data_u *vp)
+{
+    size_t n;
+    switch (type) {
+    default:
+	return -1;
+    case HAL_BIT:
+	n = 1;
+	break;
+    case HAL_FLOAT:
+	n = 8;
+	break;
+    case HAL_S32:
+    case HAL_U32:
+	n = 4;
+	break;
+    }
+    if (*pos + n > values.size())
+	return -1;
+    __u64 v = 0;
+    for (size_t i = 0; i < n; i++)
+	v |= (__u64)(unsigned char) values[*pos + i] << (8 * i);
+    *pos += n;
+
+    switch (type) {
+    case HAL_BIT:
+	set_bit_value(vp, v != 0);
+	break;
+    case HAL_FLOAT:
+	{
+	    double d;
+	    memcpy(&d, &v, sizeof(d));
+	    set_float_value(vp, d);
+	}
+	break;
+    case HAL_S32:
+	set_s32_value(vp, (__s32)(__u32) v);
+	break;
+    default:
+	set_u32_value(vp, (__u32) v);
+	break;
+    }
+    return 0;
+}
+
 
@@ -13,6 +13,7 @@
 #define HALGROUP_DNSSD_SUBTYPE        "_halgroup._sub."
 #define HALRCOMP_DNSSD_SUBTYPE        "_halrcomp._sub."
 #define HALRCMD_DNSSD_SUBTYPE         "_halrcmd._sub."
+#define HALCAPTURE_DNSSD_SUBTYPE      "_halcapture._sub."
 #define CONFIG_DNSSD_SUBTYPE          "_config._sub."
 #define RTAPI_DNSSD_SUBTYPE           "_rtapi._sub."
 #define LOG_DNSSD_SUBTYPE             "_log._sub."
@@ -19,5 +19,8 @@
 #define DESERIALIZE_TO_RT  128  // send as nanopb struct if decoded as such
 #define SERIALIZE_FROM_RT  256  // encode from nanopb struct
 
+// treating messages received from RT:
+#define ZEROCOPY_FROM_RT   512  // send frames referencing ring storage
+
 extern int comp_id;
 extern const char *progname;
@@ -48,6 +48,121 @@ send_subscribe(void *socket, const char *topic)
     return zframe_send (&f, socket, 0);
 }
 
+// ZEROCOPY_FROM_RT support
+//
+// zmq calls this once done with a frame sent from ring storage,
+// possibly from one of its I/O threads.
+static void
+zc_release(void *data, void *hint)
+{
+    rtapi_add_u32((hal_u32_t *) hint, -1);
+}
+
+// consume records whose frames were all released, in ring order.
+// returns the number of records still in flight.
+static unsigned
+zc_reclaim(rtproxy_t *self)
+{
+    while ((self->zc_tail != self->zc_head) &&
+	   (rtapi_load_u32(&self->zc_refs[self->zc_tail % ZC_SLOTS]) == 0)) {
+	record_shift(&self->from_rt_ring);
+	self->zc_tail++;
+    }
+    return self->zc_head - self->zc_tail;
+}
+
+// send the next message from RT, with frames referencing ring storage
+// rather than copied into zmq frames. Nanopb-encoded frames still
+// need serializing, and are copied.
+// return 0 if a message was sent, EAGAIN if none available,
+// ENOBUFS if too many messages are in flight.
+static int
+zc_send_from_rt(rtproxy_t *self)
+{
+    ringbuffer_t *ring = &self->from_rt_ring;
+    void *socket = zsock_resolve(self->proxy_response);
+    const void *record;
+    ringsize_t rsize, off = 0;
+
+    if (zc_reclaim(self) == ZC_SLOTS) {
+	self->zc_stall++;
+	return ENOBUFS;
+    }
+    if (_ring_read_at(ring, self->zc_offset, &record, &rsize))
+	return EAGAIN;
+
+    // hold a reference until all frames are handed to zmq
+    hal_u32_t *refs = &self->zc_refs[self->zc_head % ZC_SLOTS];
+    rtapi_store_u32(refs, 1);
+
+    while (off < rsize) {
+	const frameheader_t *frame =
+	    (const frameheader_t *) ((const char *) record + off);
+	off += sizeof(*frame) + frame->size;
+
+	mflag_t flags;
+	flags.u = frame->flags;
+	zmq_msg_t m;
+	bool copied = false;
+
+	if (self->flags &  TRACE_FROM_RT)
+	    rtapi_print_hex_dump(RTAPI_MSG_ERR, RTAPI_DUMP_PREFIX_OFFSET,
+				 16,1, frame->data,
+				 (frame->size > 16) ? 16: frame->size, 1, NULL,
+				 "%s->%s size=%d t=%d c=%d: ", self->from_rt_name,
+				 self->name, frame->size,
+				 flags.f.frametype, flags.f.npbtype);
+
+	if ((flags.f.frametype == MF_NPB_CSTRUCT) &&
+	    (flags.f.npbtype == NPB_CONTAINER)) {
+	    pb_ostream_t ostream = pb_ostream_from_buffer((uint8_t *)self->buffer,
+							  FROMRT_SIZE);
+	    if (pb_encode(&ostream, pb_Container_fields, frame->data)) {
+		zmq_msg_init_size(&m, ostream.bytes_written);
+		memcpy(zmq_msg_data(&m), self->buffer, ostream.bytes_written);
+		copied = true;
+	    } else {
+		rtapi_print_msg(RTAPI_MSG_ERR,
+				"%s: from_rt encoding failed %s written=%zu\n",
+				progname, PB_GET_ERROR(&ostream),
+				ostream.bytes_written);
+		// send as-is
+	    }
+	}
+	if (!copied) {
+	    rtapi_add_u32(refs, 1);
+	    zmq_msg_init_data(&m, (void *) frame->data, frame->size,
+			      zc_release, refs);
+	}
+	if (zmq_msg_send(&m, socket, (off < rsize) ? ZMQ_SNDMORE : 0) < 0) {
+	    // closing releases the frame
+	    zmq_msg_close(&m);
+	    self->rb_rxfail++;
+	} else
+	    self->frx++;
+    }
+    self->zc_offset = _ring_shift_offset(ring, self->zc_offset);
+    self->zc_head++;
+    rtapi_add_u32(refs, -1);
+    self->mfrx++;
+    zc_reclaim(self);
+    return 0;
+}
+
+// send whatever RT has answered so far. A response not there yet, or
+// held back because all slots are in flight, stays in the ring and is
+// retried from the command poll.
+// returns the number of responses still owed.
+static unsigned
+zc_flush(rtproxy_t *self)
+{
+    while (zc_send_from_rt(self) == 0) {
+	if (self->zc_pending)
+	    self->zc_pending--;
+    }
+    return self->zc_pending;
+}
+
 void
 rtproxy_thread(void *arg, void *pipe)
 {
@@ -88,6 +203,8 @@ rtproxy_thread(void *arg, void *pipe)
 	    return;
 	}
 	self->from_rt_ring.header->reader = comp_id;
+	self->zc_offset = self->from_rt_ring.header->head;
+	self->zc_head = self->zc_tail = 0;
     }
     self->buffer = zmalloc(FROMRT_SIZE);
     assert(self->buffer);
@@ -115,7 +232,18 @@ rtproxy_thread(void *arg, void *pipe)
 
 	while (1) {
 	    self->state = WAIT_FOR_COMMAND;
-	    void *cmdsocket = zpoller_wait (cmdpoller, -1);
+	    void *cmdsocket = zpoller_wait (cmdpoller,
+					    self->zc_pending ? self->current_delay : -1);
+	    if ((cmdsocket == NULL) && zpoller_expired (cmdpoller)) {
+		// ZEROCOPY_FROM_RT: retry responses still owed
+		self->zc_retry++;
+		if (zc_flush(self)) {
+		    // exponential backoff
+		    self->current_delay <<= 1;
+		    self->current_delay = MIN(self->current_delay, self->max_delay);
+		}
+		continue;
+	    }
 	    if (cmdsocket == NULL) // terminated
 		goto DONE;
 	    zmsg_t *to_rt = zmsg_recv(cmdsocket);
@@ -227,6 +355,13 @@ rtproxy_thread(void *arg, void *pipe)
 	    self->state = WAIT_FOR_RT_RESPONSE;
 	    self->current_delay = self->min_delay;
 
+	    if (self->flags & ZEROCOPY_FROM_RT) {
+		self->zc_pending++;
+		zpoller_wait (delay, self->current_delay);
+		zc_flush(self);
+		continue;
+	    }
+
 	    zmsg_t *from_rt = zmsg_new();
 	    msg_read_abort(&self->from_rt_mframe);
 	    i = 0;
@@ -303,6 +438,24 @@ rtproxy_thread(void *arg, void *pipe)
 	zpoller_destroy(&cmdpoller);
 	zpoller_destroy(&delay);
     }
+    if (self->from_rt_name) {
+	// frames still in flight refer to ring storage
+	for (int i = 0; (i < 100) && zc_reclaim(self); i++)
+	    zclock_sleep(10);
+	if (zc_reclaim(self))
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+			    "%s: %s: %u messages not released by zmq\n",
+			    progname, self->name, self->zc_head - self->zc_tail);
+	if (self->zc_pending || self->rb_rxfail)
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+			    "%s: %s: %u responses from RT not sent, "
+			    "%u frames failed to send\n",
+			    progname, self->name, self->zc_pending,
+			    self->rb_rxfail);
+	rtapi_print_msg(RTAPI_MSG_DBG,
+			"%s: %s: %u zero-copy retries, %u deferred for slots\n",
+			progname, self->name, self->zc_retry, self->zc_stall);
+    }
     if (self->buffer)
 	free(self->buffer);
 
@@ -28,6 +28,15 @@ typedef struct {
     void *buffer;
 #define FROMRT_SIZE 4096          // fail miserably if larger
 
+    // ZEROCOPY_FROM_RT: records are read ahead of the ring head, and
+    // consumed in ring order once zmq released all their frames.
+    // records in flight occupy slots [zc_tail, zc_head).
+#define ZC_SLOTS 64               // max records in flight
+    ringsize_t zc_offset;         // private read offset
+    unsigned zc_head, zc_tail;
+    hal_u32_t zc_refs[ZC_SLOTS];  // frames in flight per record
+    unsigned zc_pending;          // responses owed, retried from the poll
+
     const char *to_rt_name;
     const char *from_rt_name;
     bool decode_out, encode_in;  // pb_encode()/pb_decode() before/after RT I/O
@@ -38,6 +47,8 @@ typedef struct {
     unsigned mftx, ftx;    // frame + multiframe send counts
     unsigned mfrx, frx;    // frame + multiframe receive counts
     unsigned rb_txfail, rb_rxfail; // ringbuffer ops failures
+    unsigned zc_stall;     // ZEROCOPY_FROM_RT: reads deferred, slots full
+    unsigned zc_retry;     // ZEROCOPY_FROM_RT: polls for late responses
 
 } rtproxy_t;
 
@@ -17,6 +17,7 @@
 
 #define MODE_RECORD 0
 #define MODE_STREAM 1
+#define MODE_MPMC   2
 
 volatile int go, done, rdone = 0;
 static int comp_id;		/* component ID */
@@ -49,7 +50,7 @@ typedef struct {
 volatile int *ep;
 
 
-static char *option_string = "p:c:r:t:dhmRSs:ve:";
+static char *option_string = "p:c:r:t:dhmRSMs:ve:b:";
 static struct option long_options[] = {
     {"num-producers", no_argument, 0, 'p'},
     {"num-consumers", no_argument, 0, 'c'},
@@ -59,10 +60,12 @@ static struct option long_options[] = {
     {"verbose", no_argument, 0, 'v'},
     {"size", required_argument, 0, 's'},
     {"extra", required_argument, 0, 'e'},
+    {"batch", required_argument, 0, 'b'},
     {"help", no_argument, 0, 'h'},
     {"use-mutex", no_argument, 0, 'm'},
     {"use-rtapi-shm", no_argument, 0, 'R'},
     {"stream-mode", no_argument, 0, 'S'},
+    {"mpmc-mode", no_argument, 0, 'M'},
     {0,0,0,0}
 };
 
@@ -78,6 +81,7 @@ struct conf {
     int mode;
     int size;
     int extra;
+    int batch;
 } conf = {
     .verbose = 0,
     .debug = 0,
@@ -90,20 +94,33 @@ struct conf {
     .mode = 0, // default record mode
     .size = 16384,
     .extra = 0,
+    .batch = 0, // default single record operations
 };
 
 
 void usage(int argc, char **argv) {
     printf("Usage:  %s [options]\n", argv[0]);
-    printf("This is a userspace HAL program, typically loaded using the halcmd \"loadusr\" command:\n"
-	   "    loadusr halreport [options]\n"
+    printf("Ringbuffer throughput benchmark, run with realtime started.\n"
 	   "Options are:\n"
-	   "-I or --ini <inifile>\n"
-	   "    Use <inifile> (default: take ini filename from environment variable INI_FILE_NAME)\n"
-	   "-S or --section <section-name> (default 8)\n"
-	   "    Read parameters from <section_name> (default 'VFS11')\n"
+	   "-p or --num-producers <n>, -c or --num-consumers <n>\n"
+	   "    number of writer and reader threads (default 1 each)\n"
+	   "-t or --runtime <seconds> (default 10)\n"
+	   "-s or --size <bytes>\n"
+	   "    ring size (default 16384)\n"
+	   "-e or --extra <bytes>\n"
+	   "    payload bytes added to each record (default 0)\n"
+	   "-b or --batch <n>\n"
+	   "    use batched record operations, up to n records per batch\n"
+	   "    (default 0: single record operations)\n"
+	   "-S or --stream-mode\n"
+	   "    use a stream ring\n"
+	   "-M or --mpmc-mode\n"
+	   "    use a lock-free MPMC ring; compare against a record ring\n"
+	   "    with the same -p/-c to see the cost of the r/w mutexes\n"
 	   "-r or --rtapi-msg-level <level>\n"
 	   "    set the RTAPI message level.\n"
+	   "-v or --verbose\n"
+	   "    print progress messages.\n"
 	   "-d or --debug\n"
 	   "    Turn on event debugging messages.\n");
 }
@@ -123,14 +140,26 @@ void *timer(void *arg)
     return 0;
 }
 
+static void fail(const char *what)
+{
+    fprintf(stderr, "ringbench: %s failed\n", what);
+    exit(1);
+}
+
 void *producer(void *arg)
 {
     prodinfo_t *p = arg;
-    value_t v;
+    size_t vsize = sizeof(value_t) + conf.extra;
+    value_t *v;
     int retval;
 
-    v.tid = p->id;
-    v.val = p->ctr;
+    v = calloc(1, vsize);
+    if (v == NULL) {
+	fprintf(stderr, "producer %d: out of memory\n", p->id);
+	return NULL;
+    }
+    v->tid = p->id;
+    v->val = p->ctr;
 
     if (conf.verbose)
 	printf("producer %d start\n",p->id);
@@ -147,41 +176,75 @@ void *producer(void *arg)
 	    continue;
 	}
 	if (conf.mode == MODE_STREAM) {
-	    if (stream_write(p->r, (const char *)&v, sizeof(v)) != sizeof(v)) {
+	    if (stream_write(p->r, (const char *)v, vsize) != vsize) {
 		p->wfail++;
 	    } else {
 		if (conf.verbose)
-		    printf("producer %d write %d\n",p->id,v.val);
+		    printf("producer %d write %d\n",p->id,v->val);
 		p->ctr++;
-		v.val = p->ctr;
+		v->val = p->ctr;
 	    }
 	    if (p->r->header->use_wmutex)
 		rtapi_mutex_give(&p->r->header->wmutex);
 	    p->ctr++;
+	} else if (conf.mode == MODE_MPMC) {
+	    if (mpmc_write(p->r, v, vsize))
+		p->wfail++;
+	    else {
+		p->ctr++;
+		v->val = p->ctr;
+	    }
+	} else if (conf.batch) {
+	    ringbatch_t b;
+	    int i;
+
+	    record_batch_write_begin(p->r, &b);
+	    for (i = 0; i < conf.batch; i++) {
+		if (record_batch_write(&b, v, vsize))
+		    break;
+		v->val++;
+	    }
+	    if (record_batch_write_end(&b) == 0)
+		p->wfail++;
+	    p->ctr += i;
+	    if (p->r->header->use_wmutex)
+		rtapi_mutex_give(&p->r->header->wmutex);
 	} else {
 
-	    retval = record_write(p->r, &v, sizeof(v));
+	    retval = record_write(p->r, v, vsize);
 	    if (retval)
 		p->wfail++;
 	    else {
 		if (conf.verbose)
-		    printf("producer %d write %d\n",p->id,v.val);
+		    printf("producer %d write %d\n",p->id,v->val);
 		p->ctr++;
-		v.val = p->ctr;
+		v->val = p->ctr;
 	    }
 	    if (p->r->header->use_wmutex)
 		rtapi_mutex_give(&p->r->header->wmutex);
 
 	}
     }
+    free(v);
     return 0;
 }
 
+static void consume(consinfo_t *c, const value_t *vp, ringsize_t size)
+{
+    assert(size == sizeof(value_t) + conf.extra);
+    int expected = __sync_fetch_and_add (&ep[vp->tid],1);
+    // with several MPMC consumers, records of one producer may
+    // complete out of order - only the per-producer count is checked
+    if ((conf.mode != MODE_MPMC) || (conf.n_consumers == 1))
+	assert(vp->val == expected);
+    c->rcnt++;
+}
+
 void *consumer(void *arg)
 {
     consinfo_t *c = arg;
     const value_t *vp;
-    ringsize_t size;
+    rrecsize_t size;
 
     if (conf.verbose)
 	printf("consumer %d start\n",c->id);
@@ -198,6 +261,40 @@ void *consumer(void *arg)
 	    continue;
 	}
 	if (conf.mode == MODE_STREAM) {
+	} else if (conf.mode == MODE_MPMC) {
+	    mpmcticket_t tk;
+	    const void *data;
+	    ringsize_t rsize;
+	    int last = rdone; // sample before the read, producers are done
+
+	    if (mpmc_read_begin(c->r, &tk, &data, &rsize)) {
+		if (last)
+		    break;
+		c->rfail++;
+	    } else {
+		consume(c, data, rsize);
+		mpmc_read_end(c->r, &tk);
+	    }
+	} else if (conf.batch) {
+	    ringbatch_t b;
+	    const void *data;
+	    ringsize_t rsize;
+	    int i;
+
+	    record_batch_read_begin(c->r, &b);
+	    for (i = 0; i < conf.batch; i++) {
+		if (record_batch_read(&b, &data, &rsize))
+		    break;
+		consume(c, data, rsize);
+	    }
+	    record_batch_read_end(&b);
+	    if (c->r->header->use_rmutex)
+		rtapi_mutex_give(&c->r->header->rmutex);
+	    if (i == 0) {
+		if (rdone)
+		    break;
+		c->rfail++;
+	    }
 	} else {
 	    size = record_next_size(c->r);
 	    if (size < 0) {
@@ -208,11 +305,9 @@ void *consumer(void *arg)
 		}
 		c->rfail++;
 	    } else {
-		assert(size == sizeof(value_t));
 		vp = record_next(c->r);
-		assert(vp->val == __sync_fetch_and_add (&ep[vp->tid],1));
+		consume(c, vp, size);
 		record_shift(c->r);
-		c->rcnt++;
 	    }
 	    if (c->r->header->use_rmutex)
 		rtapi_mutex_give(&c->r->header->rmutex);
@@ -228,6 +323,7 @@ int main(int argc, char **argv)
     int retval;
     pthread_t t;
     int opt,i;
+    int flags;
     ringbuffer_t rb;
     prodinfo_t *pi;
     consinfo_t *ci;
@@ -254,6 +350,9 @@ int main(int argc, char **argv)
 	case 'e':
 	    conf.extra = atoi(optarg);
 	    break;
+	case 'b':
+	    conf.batch = atoi(optarg);
+	    break;
 	case 'p':
 	    conf.n_producers = atoi(optarg);
 	    break;
@@ -269,6 +368,9 @@ int main(int argc, char **argv)
 	case 'S':
 	    conf.mode = MODE_STREAM;
 	    break;
+	case 'M':
+	    conf.mode = MODE_MPMC;
+	    break;
 	case 'h':
 	default:
 	    usage(argc, argv);
@@ -284,11 +386,31 @@ int main(int argc, char **argv)
 			"ringbench: ERROR: hal_init() failed: %d\n", comp_id);
 	return -1;
     }
-    assert((ci = calloc(sizeof(consinfo_t),conf.n_consumers)) != NULL);
-    assert((pi = calloc(sizeof(prodinfo_t),conf.n_producers)) != NULL);
-    assert((ep = calloc(sizeof(int),conf.n_producers)) != NULL);
+    ci = calloc(sizeof(consinfo_t),conf.n_consumers);
+    pi = calloc(sizeof(prodinfo_t),conf.n_producers);
+    ep = calloc(sizeof(int),conf.n_producers);
+    if ((ci == NULL) || (pi == NULL) || (ep == NULL)) {
+	rtapi_print_msg(RTAPI_MSG_ERR, "ringbench: out of memory\n");
+	hal_exit(comp_id);
+	return -1;
+    }
 
-    if ((retval = hal_ring_newf( conf.size, 0, conf.mode, ringname))) {
+    switch (conf.mode) {
+    case MODE_STREAM:
+	flags = RINGTYPE_STREAM;
+	break;
+    case MODE_MPMC:
+	// smallest slot holding a value_t plus extra
+	flags = RINGTYPE_MPMC;
+	for (i = MPMC_MIN_SLOTBITS;
+	     (1 << i) < sizeof(mpmc_slot_t) + sizeof(value_t) + conf.extra;
+	     i++);
+	flags |= MPMC_SLOTSIZE(i);
+	break;
+    default:
+	flags = RINGTYPE_RECORD;
+    }
+    if ((retval = hal_ring_newf( conf.size, 0, flags, ringname))) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 			"ringbench: failed to create new ring %s: %d\n",
 			ringname, retval);
@@ -301,21 +423,26 @@ int main(int argc, char **argv)
 
     hal_ready(comp_id);
 
-    rb.header->use_wmutex = (conf.n_producers > 1);
-    rb.header->use_rmutex = (conf.n_consumers > 1);
+    // MPMC rings need no mutexes
+    rb.header->use_wmutex = (conf.n_producers > 1) && (conf.mode != MODE_MPMC);
+    rb.header->use_rmutex = (conf.n_consumers > 1) && (conf.mode != MODE_MPMC);
 
     for(i = 0; i < conf.n_producers; i++) {
 	pi[i].id = i;
 	pi[i].r = &rb;
-	assert(!pthread_create(&pi[i].self, NULL, producer, (void *) &pi[i]));
+	if (pthread_create(&pi[i].self, NULL, producer, (void *) &pi[i]))
+	    fail("pthread_create(producer)");
     }
     for(i = 0; i < conf.n_consumers; i++) {
 	ci[i].id = i;
 	ci[i].r = &rb;
-	assert(!pthread_create(&ci[i].self, NULL, consumer, (void *) &ci[i]));
+	if (pthread_create(&ci[i].self, NULL, consumer, (void *) &ci[i]))
+	    fail("pthread_create(consumer)");
     }
-    assert(!pthread_create(&t, NULL, timer, (void *) &conf.runtime));
-    assert(!pthread_join(t, NULL));
+    if (pthread_create(&t, NULL, timer, (void *) &conf.runtime))
+	fail("pthread_create(timer)");
+    if (pthread_join(t, NULL))
+	fail("pthread_join(timer)");
     if (conf.verbose)
 	printf("timer joined\n");
 
@@ -323,7 +450,8 @@ int main(int argc, char **argv)
     stx = 0;
     swlock = 0;
     for(i = 0; i < conf.n_producers; i++) {
-	assert(!pthread_join(pi[i].self, NULL));
+	if (pthread_join(pi[i].self, NULL))
+	    fail("pthread_join(producer)");
 	if (conf.verbose)
 	    printf("producer %d joined wfail=%d ctr=%d\n",pi[i].id,pi[i].wfail,pi[i].ctr);
 	swfail += pi[i].wfail;
@@ -335,7 +463,8 @@ int main(int argc, char **argv)
     srx = 0;
     srlock = 0;
     for(i = 0; i < conf.n_consumers; i++) {
-	assert(!pthread_join(ci[i].self, NULL));
+	if (pthread_join(ci[i].self, NULL))
+	    fail("pthread_join(consumer)");
 	srfail += ci[i].rfail;
 	srx += ci[i].rcnt;
 	srlock += ci[i].rlocked;
@@ -349,6 +478,15 @@ int main(int argc, char **argv)
     printf("tx=%d rx=%d txfail=%d rxfail=%d wlock=%d rlock=%d\n",stx,srx,swfail,srfail,swlock,srlock);
     printf("dt=%fs, nsecs per msg: %g\n", elapsedTime/1000.0, (elapsedTime)*1e6/(srx));
 
+    // one line per run, for tabulating over record and batch sizes
+    printf("mode=%s p=%d c=%d recsize=%zu batch=%d msgs/s=%.0f MB/s=%.2f\n",
+	   (conf.mode == MODE_MPMC) ? "mpmc" :
+	   (conf.mode == MODE_STREAM) ? "stream" : "record",
+	   conf.n_producers, conf.n_consumers,
+	   sizeof(value_t) + conf.extra, conf.batch,
+	   srx * 1000.0 / elapsedTime,
+	   srx * (sizeof(value_t) + conf.extra) / (elapsedTime * 1000.0));
+
     for(i = 0; i < conf.n_producers; i++) {
 	if (pi[i].ctr != ep[i])
 	    printf("p %d: ctr=%d ep=%d\n",i,pi[i].ctr,ep[i]);
@@ -100,20 +100,30 @@ typedef enum {
     RINGTYPE_RECORD = 0,
     RINGTYPE_MULTIPART = RTAPI_BIT(0),
     RINGTYPE_STREAM = RTAPI_BIT(1),
-    RINGTYPE_ANY  = (RTAPI_BIT(0)|RTAPI_BIT(1)),
-    RINGTYPE_MASK = (RTAPI_BIT(0)|RTAPI_BIT(1))
+    RINGTYPE_MPMC = RTAPI_BIT(2),  // multi-producer/multi-consumer slots
+    RINGTYPE_ANY  = (RTAPI_BIT(0)|RTAPI_BIT(1)|RTAPI_BIT(2)),
+    RINGTYPE_MASK = (RTAPI_BIT(0)|RTAPI_BIT(1)|RTAPI_BIT(2))
 } ring_type_t;
 
 // mode flags passed in by ring_new
 // exposed in ringheader_t.mode
 typedef enum {
-    USE_RMUTEX = RTAPI_BIT(2),
-    USE_WMUTEX = RTAPI_BIT(3),
-    ALLOC_HALMEM = RTAPI_BIT(4),
+    USE_RMUTEX = RTAPI_BIT(3),
+    USE_WMUTEX = RTAPI_BIT(4),
+    ALLOC_HALMEM = RTAPI_BIT(5),
 } ring_mode_flags_t;
 
+// MPMC rings: the slot size is passed in the mode flags as a power
+// of two, e.g. MPMC_SLOTSIZE(7) for 128 byte slots. A zero value
+// selects MPMC_DEFAULT_SLOTBITS.
+#define MPMC_SLOT_SHIFT       8
+#define MPMC_SLOT_MASK        (0x1f << MPMC_SLOT_SHIFT)
+#define MPMC_SLOTSIZE(bits)   (((bits) << MPMC_SLOT_SHIFT) & MPMC_SLOT_MASK)
+#define MPMC_DEFAULT_SLOTBITS 6   // 64 bytes
+#define MPMC_MIN_SLOTBITS     3   // must hold the slot header
+
 typedef struct {
-    __u8    type       : 2;  // RINGTYPE_*
+    __u8    type       : 3;  // RINGTYPE_*
     __u8    use_rmutex : 1;  // hint to using code - use ringheader_t.rmutex
     __u8    use_wmutex : 1;  // hint to using code - use ringheader_t.wmutex
 
@@ -124,7 +134,7 @@ typedef struct {
     // ringbuffer code per se.
     __u8    alloc_halmem : 1;
 
-    __u32   userflags : 27;  // not interpreted by ringbuffer code
+    __u32   userflags : 26;  // not interpreted by ringbuffer code
     // offset 4:
     __s32   refcount;        // number of referencing entities (modules, threads..)
     // offset 8:
@@ -136,14 +146,14 @@ typedef struct {
     // offset 32:
     ringsize_t trailer_size;   // sizeof(ringtrailer_t) + scratchpad size
     // offset 36:
-    ringsize_t size_mask;      // stream mode only
+    ringsize_t size_mask;      // stream mode: size - 1, mpmc: slots - 1
     // offset 40:
     // this is the size of the actual ring buffer. There might be
     // padding between the ring storage and the ringtrailer_t due to the alignment
     // of the trailer (64) so the tail pointer is cache-aligned.
     ringsize_t size;           // common to stream and record mode
-    // offset 44 - 4 bytes left:
-    __u32 __unused1;
+    // offset 44:
+    ringsize_t slot_size;      // mpmc mode only
     // offset 48:
     __u64   generation;
     // offset 56:
@@ -211,6 +221,17 @@ static unsigned inline next_power_of_two(unsigned v) {
     return v;
 }
 
+// size of a slot in an MPMC ring as requested by the mode flags
+static inline ringsize_t mpmc_slot_size(const int flags)
+{
+    int bits = (flags & MPMC_SLOT_MASK) >> MPMC_SLOT_SHIFT;
+    if (bits == 0)
+	bits = MPMC_DEFAULT_SLOTBITS;
+    if (bits < MPMC_MIN_SLOTBITS)
+	bits = MPMC_MIN_SLOTBITS;
+    return 1U << bits;
+}
+
 // always cache-align the ring storage so ringtrailer_t lies on a
 // cacheline boundary
 static inline ringsize_t ring_storage_alloc(const int flags,
@@ -219,6 +240,13 @@ static inline ringsize_t ring_storage_alloc(const int flags,
     if  ((flags & RINGTYPE_MASK) == RINGTYPE_STREAM) {
 	// stream mode buffers need to be a power of two sized
 	return RTAPI_CACHE_ALIGN(next_power_of_two(size));
+    } else if ((flags & RINGTYPE_MASK) == RINGTYPE_MPMC) {
+	// a power of two number of slots, at least two
+	ringsize_t ssize = mpmc_slot_size(flags);
+	ringsize_t n = next_power_of_two((size + ssize - 1) / ssize);
+	if (n < 2)
+	    n = 2;
+	return RTAPI_CACHE_ALIGN(n * ssize);
     } else {
 	// default to /* RINGTYPE_RECORD */
 	// round up buffer size to closest upper alignment boundary
@@ -258,6 +286,47 @@ static inline ringsize_t ring_scratchpad_size(const ringbuffer_t *ring)
     return ring->header->trailer_size - (ringsize_t) sizeof(ringtrailer_t);
 }
 
+// memory layout of MPMC rings:
+//
+// a power-of-two array of fixed-size slots, each starting with
+// a sequence number followed by the record size and data.
+// producers claim slots by advancing the tail, consumers by advancing
+// the head - both free-running counters, masked by size_mask to
+// obtain the slot index. The slot sequence number tells the state of
+// a slot relative to a position pos mapping onto it:
+//
+//   seq == pos                   free, may be claimed by a producer
+//   seq == pos + 1               filled, may be claimed by a consumer
+//   seq == pos + size_mask + 1   free for the next lap
+//
+// see http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+typedef struct {
+    ringsize_t seq;
+    rrecsize_t size;
+    __u8 data[0];
+} mpmc_slot_t;
+
+static inline mpmc_slot_t *_mpmc_slot(const ringheader_t *h,
+				      const ringsize_t pos)
+{
+    return (mpmc_slot_t *) (h->buf + (pos & h->size_mask) * h->slot_size);
+}
+
+// usable payload size of an MPMC slot
+static inline ringsize_t mpmc_max_size(const ringheader_t *h)
+{
+    return h->slot_size - sizeof(mpmc_slot_t);
+}
+
+static inline void mpmc_init_slots(ringheader_t *h)
+{
+    ringsize_t i;
+    for (i = 0; i <= h->size_mask; i++) {
+	_mpmc_slot(h, i)->seq = i;
+	_mpmc_slot(h, i)->size = 0;
+    }
+}
+
 // initialize a ringbuffer header and storage as already allocated
 // with a size of ring_memsize(flags, size, sp_size)
 // this will not clear the storage allocated.
@@ -286,9 +355,17 @@ static inline void ringheader_init(ringheader_t *ringheader,
     ringheader->type = (flags & RINGTYPE_MASK);
 
     // mode-dependent initialisation
-    if (flags &  RINGTYPE_STREAM) {
+    switch (ringheader->type) {
+    case RINGTYPE_STREAM:
 	ringheader->size_mask = ringheader->size -1;
-    } else {
+	break;
+    case RINGTYPE_MPMC:
+	ringheader->slot_size = mpmc_slot_size(flags);
+	ringheader->size_mask = ringheader->size / ringheader->slot_size - 1;
+	ringheader->generation = 0;
+	mpmc_init_slots(ringheader);
+	break;
+    default:
 	ringheader->generation = 0;
     }
     ringheader->refcount = 1;
@@ -593,7 +670,7 @@ static inline rrecsize_t _ring_shift_offset(const ringbuffer_t *ring,
     ringheader_t *h = ring->header;
     ringtrailer_t *t = ring->trailer;
 
-    if (h->head == rtapi_load_u32(&t->tail))
+    if (offset == rtapi_load_u32(&t->tail))
 	return -1;
 
     // ensure that previous reads (copies out of the ring buffer) are always completed 
@@ -671,6 +748,244 @@ static inline void record_flush(ringbuffer_t *ring)
 			   rtapi_load_u32(&t->tail)));
 }
 
+/* batched record operations
+ *
+ * the single-record operations above publish each record with a
+ * barrier and an index update shared with the other side. When moving
+ * many small records, that cost dominates. The batch operations below
+ * work on a private copy of the index: records are staged against a
+ * snapshot of the other side's index, and the whole batch is made
+ * visible with a single barrier and index update.
+ *
+ * write side:
+ *
+ * ringbatch_t b;
+ * record_batch_write_begin(ring, &b);
+ * while (have_data && (record_batch_write(&b, data, size) == 0))
+ *     ;
+ * record_batch_write_end(&b);   // publish all staged records at once
+ *
+ * read side:
+ *
+ * ringbatch_t b;
+ * const void *data;
+ * ringsize_t size;
+ *
+ * record_batch_read_begin(ring, &b);
+ * while (record_batch_read(&b, &data, &size) == 0)
+ *     process(data, size);
+ * record_batch_read_end(&b);    // consume all records read at once
+ *
+ * staged writes are not visible to the reader, and records read are
+ * not released to the writer, before the respective *_end() call.
+ * Dropping a ringbatch_t without calling *_end() abandons the batch.
+ * record rings only; the single reader/single writer rule applies.
+ */
+typedef struct {
+    ringbuffer_t *ring;
+    ringsize_t pos;      // private head (read) or tail (write) index
+    ringsize_t limit;    // snapshot of the other side's index
+    int count;           // records staged or read so far
+} ringbatch_t;
+
+static inline void record_batch_write_begin(ringbuffer_t *ring,
+					    ringbatch_t *b)
+{
+    b->ring = ring;
+    b->pos = ring->trailer->tail;
+    b->limit = rtapi_load_u32(&ring->header->head);
+    b->count = 0;
+}
+
+/* record_batch_reserve()
+ *
+ * zero-copy variant of record_batch_write(): stage a record of exactly
+ * 'sz' bytes, and set 'data' to where its contents must be written
+ * before record_batch_write_end().
+ *
+ * return 0 on success
+ * return EAGAIN if there is currently insufficient space
+ * return ERANGE if the record size exceeds the ringbuffer size.
+ */
+static inline int record_batch_reserve(ringbatch_t *b,
+				       void **data,
+				       const ringsize_t sz)
+{
+    ringbuffer_t *ring = b->ring;
+    ringsize_t size = ring->header->size;
+    ringsize_t a = size_aligned(sz + sizeof(rrecsize_t));
+    ringsize_t free, off;
+    int retry = 1;
+
+    if (a > size)
+	return ERANGE;
+    do {
+	// same space computation as record_write_begin(), but against
+	// the private tail and the head snapshot
+	free = (size + b->limit - b->pos - 1) % size + 1;
+	if (free > a) {
+	    if (b->pos + a <= size)
+		break;
+	    if (b->limit > a)
+		break;
+	}
+	// the reader might have moved on since the snapshot
+	if (!retry)
+	    return EAGAIN;
+	b->limit = rtapi_load_u32(&ring->header->head);
+    } while (retry--);
+
+    off = b->pos;
+    if (off + a > size) {
+	// wrap: mark the end of data, not yet visible to the reader
+	*_size_at(ring, off) = -1;
+	off = 0;
+    }
+    *_size_at(ring, off) = sz;
+    *data = _size_at(ring, off) + 1;
+    b->pos = (off + a) % size;
+    b->count++;
+    return 0;
+}
+
+/* record_batch_write()
+ *
+ * copying variant: stage a copy of 'sz' bytes at 'data'.
+ * return values as for record_batch_reserve().
+ */
+static inline int record_batch_write(ringbatch_t *b,
+				     const void *data,
+				     const ringsize_t sz)
+{
+    void *ptr;
+    int r = record_batch_reserve(b, &ptr, sz);
+    if (r) return r;
+    memcpy(ptr, data, sz);
+    return 0;
+}
+
+/* record_batch_write_end()
+ *
+ * publish all records staged in the batch.
+ * returns the number of records published.
+ */
+static inline int record_batch_write_end(ringbatch_t *b)
+{
+    if (b->count) {
+	// make the records visible before the tail update
+	rtapi_smp_wmb();
+	rtapi_store_u32(&b->ring->trailer->tail, b->pos);
+    }
+    return b->count;
+}
+
+static inline void record_batch_read_begin(ringbuffer_t *ring,
+					   ringbatch_t *b)
+{
+    b->ring = ring;
+    b->pos = ring->header->head;
+    b->limit = rtapi_load_u32(&ring->trailer->tail);
+    b->count = 0;
+
+    // serialize with respect to the tail snapshot, once for the batch
+    rtapi_smp_rmb();
+}
+
+/* record_batch_read()
+ *
+ * non-copying read of the next record in the batch.
+ * return 0 and set data/size on success.
+ * return EAGAIN if the batch is exhausted - records written after
+ * record_batch_read_begin() are not seen.
+ *
+ * data stays valid until record_batch_read_end().
+ */
+static inline int record_batch_read(ringbatch_t *b,
+				    const void **data,
+				    ringsize_t *size)
+{
+    rrecsize_t *sz;
+
+    if (b->pos == b->limit)
+	return EAGAIN;
+    sz = _size_at(b->ring, b->pos);
+    if (*sz < 0) {
+	// wrap mark - continue at start of ring
+	b->pos = 0;
+	if (b->pos == b->limit)
+	    return EAGAIN;
+	sz = _size_at(b->ring, 0);
+    }
+    *size = (ringsize_t)*sz;
+    *data = sz + 1;
+    b->pos = (b->pos + size_aligned(*sz + sizeof(rrecsize_t))) %
+	b->ring->header->size;
+    b->count++;
+    return 0;
+}
+
+/* record_batch_peek()
+ *
+ * vectored read: fill in up to 'n' ringvec_t's from the batch.
+ * returns the number of records filled in.
+ */
+static inline int record_batch_peek(ringbatch_t *b,
+				    ringvec_t *vec,
+				    const int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+	if (record_batch_read(b, &vec[i].rv_base, &vec[i].rv_len))
+	    break;
+	vec[i].rv_flags = 0;
+    }
+    return i;
+}
+
+/* record_batch_read_end()
+ *
+ * consume all records read in the batch.
+ * returns the number of records consumed.
+ */
+static inline int record_batch_read_end(ringbatch_t *b)
+{
+    ringheader_t *h = b->ring->header;
+    __u64 g;
+
+    if (b->count == 0)
+	return 0;
+
+    // complete reads out of the ring before releasing the space
+    rtapi_smp_mb();
+
+    // iterators see one generation per record, as with record_shift()
+    do {
+	g = rtapi_load_u64((uint64_t *)&h->generation);
+    } while (!rtapi_cas_u64((uint64_t *)&h->generation, g, g + b->count));
+    rtapi_store_u32(&h->head, b->pos);
+    return b->count;
+}
+
+/* record_writev()
+ *
+ * write up to 'n' records from a vector in one batch.
+ * returns the number of records written.
+ */
+static inline int record_writev(ringbuffer_t *ring,
+				const ringvec_t *vec,
+				const int n)
+{
+    ringbatch_t b;
+    int i;
+
+    record_batch_write_begin(ring, &b);
+    for (i = 0; i < n; i++)
+	if (record_batch_write(&b, vec[i].rv_base, vec[i].rv_len))
+	    break;
+    return record_batch_write_end(&b);
+}
+
 /* rings by default behave like queues:
  * - record_write() to add
  * - record_read()/record_shift() to remove.
@@ -754,6 +1069,11 @@ static inline int ring_ismultipart(const ringbuffer_t *ring)
     return (ring->header->type == RINGTYPE_MULTIPART);
 }
 
+static inline int ring_ismpmc(const ringbuffer_t *ring)
+{
+    return (ring->header->type == RINGTYPE_MPMC);
+}
+
 
 static inline int ring_use_wmutex(const ringbuffer_t *ring)
 {
@@ -1144,4 +1464,210 @@ static inline void stream_write_advance(ringbuffer_t *ring,
     rtapi_store_u32(&t->tail, (t->tail + cnt) & h->size_mask);
 }
 
+//  MODE_MPMC ring operations
+//
+// any number of producers and consumers may operate on an MPMC ring
+// concurrently without the rmutex/wmutex, from RT as well as userland.
+// an operation claims a slot with a single CAS on the tail (producers)
+// or head (consumers) and never waits: if the ring is full or empty,
+// EAGAIN is returned at once.
+//
+// records are limited to mpmc_max_size() bytes, and are delivered
+// in the order their slots were claimed. A producer preempted between
+// mpmc_write_begin() and mpmc_write_end() makes the ring appear empty
+// to consumers from its slot on until it commits; a preempted consumer
+// likewise makes the ring appear full to producers once they have
+// lapped it. Neither affects other operations in flight.
+//
+// multipart/multiframe messages are not supported on MPMC rings.
+
+typedef struct {
+    mpmc_slot_t *slot;
+    ringsize_t   pos;
+} mpmcticket_t;
+
+/* mpmc_write_begin():
+ *
+ * claim a slot for a zero-copy write of up to sz bytes, and return
+ * a pointer to its payload in 'data'.
+ *
+ * return 0 if a slot was claimed
+ * return EAGAIN if the ring is currently full
+ * return ERANGE if sz exceeds the slot payload size
+ *
+ * The write must be committed with mpmc_write_end() passing the
+ * same ticket - a claimed slot cannot be given back.
+ */
+static inline int mpmc_write_begin(ringbuffer_t *ring,
+				   mpmcticket_t *tk,
+				   void **data,
+				   const ringsize_t sz)
+{
+    ringheader_t *h = ring->header;
+    ringtrailer_t *t = ring->trailer;
+    mpmc_slot_t *slot;
+    ringsize_t pos, seq;
+
+    if (sz > mpmc_max_size(h))
+	return ERANGE;
+
+    pos = rtapi_load_u32(&t->tail);
+    for (;;) {
+	slot = _mpmc_slot(h, pos);
+	seq = rtapi_load_u32(&slot->seq);
+	__s32 diff = (__s32) (seq - pos);
+	if (diff == 0) {
+	    if (rtapi_cas_u32(&t->tail, pos, pos + 1))
+		break;
+	} else if (diff < 0) {
+	    // slot still holds a record of the previous lap
+	    return EAGAIN;
+	}
+	// lost a race to another producer, retry at the current tail
+	pos = rtapi_load_u32(&t->tail);
+    }
+    // the consumer's reads of the previous lap must be complete
+    // before we overwrite the slot
+    rtapi_smp_mb();
+    tk->slot = slot;
+    tk->pos = pos;
+    *data = slot->data;
+    return 0;
+}
+
+/* mpmc_write_end():
+ *
+ * commit a write started by mpmc_write_begin(). sz must be less or
+ * equal to the size requested in mpmc_write_begin().
+ */
+static inline int mpmc_write_end(ringbuffer_t *ring,
+				 const mpmcticket_t *tk,
+				 const ringsize_t sz)
+{
+    tk->slot->size = sz;
+    rtapi_smp_wmb();
+    rtapi_store_u32(&tk->slot->seq, tk->pos + 1);
+    return 0;
+}
+
+// copying variant: return 0, EAGAIN or ERANGE as mpmc_write_begin()
+static inline int mpmc_write(ringbuffer_t *ring,
+			     const void *data,
+			     const ringsize_t sz)
+{
+    mpmcticket_t tk;
+    void *ptr;
+    int retval;
+
+    if ((retval = mpmc_write_begin(ring, &tk, &ptr, sz)))
+	return retval;
+    memcpy(ptr, data, sz);
+    return mpmc_write_end(ring, &tk, sz);
+}
+
+/* mpmc_read_begin():
+ *
+ * claim the oldest record for a zero-copy read. 'data' and 'sz'
+ * are set to the record's payload and size.
+ *
+ * return 0 if a record was claimed
+ * return EAGAIN if the ring is currently empty
+ *
+ * The slot is released to producers by mpmc_read_end() passing
+ * the same ticket.
+ */
+static inline int mpmc_read_begin(ringbuffer_t *ring,
+				  mpmcticket_t *tk,
+				  const void **data,
+				  ringsize_t *sz)
+{
+    ringheader_t *h = ring->header;
+    mpmc_slot_t *slot;
+    ringsize_t pos, seq;
+
+    pos = rtapi_load_u32(&h->head);
+    for (;;) {
+	slot = _mpmc_slot(h, pos);
+	seq = rtapi_load_u32(&slot->seq);
+	__s32 diff = (__s32) (seq - (pos + 1));
+	if (diff == 0) {
+	    if (rtapi_cas_u32(&h->head, pos, pos + 1))
+		break;
+	} else if (diff < 0) {
+	    // slot not yet written in this lap
+	    return EAGAIN;
+	}
+	pos = rtapi_load_u32(&h->head);
+    }
+    // don't read the payload before the sequence number
+    rtapi_smp_rmb();
+    tk->slot = slot;
+    tk->pos = pos;
+    *data = slot->data;
+    *sz = slot->size;
+    return 0;
+}
+
+// release a slot claimed by mpmc_read_begin()
+static inline int mpmc_read_end(ringbuffer_t *ring,
+				const mpmcticket_t *tk)
+{
+    ringheader_t *h = ring->header;
+
+    // complete reading the payload before handing the slot back
+    rtapi_smp_mb();
+    rtapi_store_u32(&tk->slot->seq, tk->pos + h->size_mask + 1);
+    return 0;
+}
+
+/* mpmc_read():
+ *
+ * copy the oldest record into 'data', which holds *sz bytes.
+ * on return *sz is set to the record size.
+ *
+ * return 0 on success
+ * return EAGAIN if the ring is currently empty
+ * return ERANGE if the record did not fit and was truncated; the
+ * record is consumed regardless. Passing a buffer of mpmc_max_size()
+ * bytes never truncates.
+ */
+static inline int mpmc_read(ringbuffer_t *ring,
+			    void *data,
+			    ringsize_t *sz)
+{
+    mpmcticket_t tk;
+    const void *ptr;
+    ringsize_t rsz;
+    int retval;
+
+    if ((retval = mpmc_read_begin(ring, &tk, &ptr, &rsz)))
+	return retval;
+    retval = (rsz > *sz) ? ERANGE : 0;
+    memcpy(data, ptr, retval ? *sz : rsz);
+    mpmc_read_end(ring, &tk);
+    *sz = rsz;
+    return retval;
+}
+
+// number of records currently committed or in flight. This is a
+// snapshot, and may be outdated by the time it is returned.
+static inline ringsize_t mpmc_count(const ringheader_t *h)
+{
+    const ringtrailer_t *t = _trailer_from_header(h);
+    ringsize_t head = rtapi_load_u32(&h->head);
+    __s32 n = (__s32) (rtapi_load_u32(&t->tail) - head);
+
+    if (n < 0)
+	return 0;
+    if ((ringsize_t) n > h->size_mask + 1)
+	return h->size_mask + 1;
+    return n;
+}
+
+// number of free slots - a snapshot as for mpmc_count()
+static inline ringsize_t mpmc_write_space(const ringheader_t *h)
+{
+    return h->size_mask + 1 - mpmc_count(h);
+}
+
 #endif // RING_H
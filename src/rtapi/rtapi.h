@@ -498,6 +498,8 @@ typedef struct {
     int pid;                 // if User RT or ULAPI; 0 for kernel
     int level;               // as passed in to rtapi_print_msg()
     char tag[TAGSIZE];       // eg program or module name
+    int encoding;            // MSG_ASCII or MSG_BINARY, see rtapi_msgfmt.h
+    long long timestamp;     // CLOCK_REALTIME in ns when logged, or 0
     char buf[0];             // actual message
 } rtapi_msgheader_t;
 
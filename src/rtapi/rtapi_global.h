@@ -132,7 +132,7 @@ typedef struct {
 
 extern global_data_t *global_data;
 
-#define GLOBAL_LAYOUT_VERSION 44   // bump on layout changes of global_data_t
+#define GLOBAL_LAYOUT_VERSION 46   // bump on layout changes of global_data_t
 
 // use global_data->magic to reflect rtapi_msgd state
 #define GLOBAL_INITIALIZING  0x0eadbeefU
@@ -30,6 +30,11 @@
 #include <unistd.h>
 #endif
 
+// two allocators are available behind the rtapi_heap API:
+//
+// TLSF, the default - see the section below.
+//
+// first fit, if RTAPIHEAP_FIRSTFIT is set before memory is added.
 // this is straight from the malloc code in:
 // K&R The C Programming Language, Edition 2, pages 185-189
 // adapted to use offsets relative to the heap descriptor
@@ -63,6 +68,266 @@ heap_print(struct rtapi_heap *h, int level, const char *fmt, ...)
     va_end(ap);
 }
 
+static rtapi_malloc_hdr_t *kr_malloc(struct rtapi_heap *h, size_t nunits);
+static void kr_free(struct rtapi_heap *h, rtapi_malloc_hdr_t *bp);
+
+// TLSF - Two-Level Segregated Fit, as described in
+// M. Masmano, I. Ripoll, A. Crespo, J. Real: "TLSF: a New Dynamic Memory
+// Allocator for Real-Time Systems", ECRTS 2004.
+//
+// free blocks are kept on segregated lists by size class. Two levels of
+// bitmaps record which lists are non-empty, so finding a list with
+// blocks large enough for a request is a bit scan, and malloc and free
+// are O(1) regardless of heap size and fragmentation.
+//
+// blocks are physically contiguous: a header followed by the body, sizes
+// in header units. Each region added ends in a used sentinel block.
+// Here the header's s.next refers to the physically preceding block, so
+// free can coalesce with both neighbours. A free block's first body unit
+// holds its free list links.
+
+#define TLSF_MIN_UNITS 2		// header + free list links
+#define TLSF_MAX_UNITS ((1 << 24) - 1)	// rtapi_malloc_tag_t.size
+
+typedef struct {
+    __u32 next_free;
+    __u32 prev_free;
+} tlsf_links_t;
+
+static inline tlsf_links_t *tlsf_links(rtapi_malloc_hdr_t *b)
+{
+    return (tlsf_links_t *)(b + 1);
+}
+
+static inline rtapi_malloc_hdr_t *tlsf_next_phys(rtapi_malloc_hdr_t *b)
+{
+    return b + b->s.tag.size;
+}
+
+static inline int tlsf_fls(__u32 x)
+{
+    return 31 - __builtin_clz(x);
+}
+
+static inline int tlsf_ffs(__u32 x)
+{
+    return __builtin_ctz(x);
+}
+
+// list indices for a block of units
+static void tlsf_mapping(size_t units, int *fl, int *sl)
+{
+    if (units < RTAPI_HEAP_SL_COUNT) {
+	*fl = 0;
+	*sl = units;
+    } else {
+	int msb = tlsf_fls(units);
+	*fl = msb - RTAPI_HEAP_SL_LOG2 + 1;
+	*sl = (units >> (msb - RTAPI_HEAP_SL_LOG2)) ^ RTAPI_HEAP_SL_COUNT;
+    }
+}
+
+static void tlsf_insert(struct rtapi_heap *h, rtapi_malloc_hdr_t *b)
+{
+    int fl, sl;
+    tlsf_mapping(b->s.tag.size, &fl, &sl);
+
+    tlsf_links_t *l = tlsf_links(b);
+    __u32 head = h->free_lists[fl][sl];
+    l->next_free = head;
+    l->prev_free = 0;
+    if (head)
+	tlsf_links(heap_ptr(h, head))->prev_free = heap_off(h, b);
+    h->free_lists[fl][sl] = heap_off(h, b);
+    h->fl_bitmap |= 1U << fl;
+    h->sl_bitmap[fl] |= 1U << sl;
+
+    b->s.tag.attr |= ATTR_FREE;
+    tlsf_next_phys(b)->s.tag.attr |= ATTR_PREV_FREE;
+}
+
+static void tlsf_remove(struct rtapi_heap *h, rtapi_malloc_hdr_t *b)
+{
+    int fl, sl;
+    tlsf_mapping(b->s.tag.size, &fl, &sl);
+
+    tlsf_links_t *l = tlsf_links(b);
+    if (l->next_free)
+	tlsf_links(heap_ptr(h, l->next_free))->prev_free = l->prev_free;
+    if (l->prev_free) {
+	tlsf_links(heap_ptr(h, l->prev_free))->next_free = l->next_free;
+    } else {
+	h->free_lists[fl][sl] = l->next_free;
+	if (l->next_free == 0) {
+	    h->sl_bitmap[fl] &= ~(1U << sl);
+	    if (h->sl_bitmap[fl] == 0)
+		h->fl_bitmap &= ~(1U << fl);
+	}
+    }
+
+    b->s.tag.attr &= ~ATTR_FREE;
+    tlsf_next_phys(b)->s.tag.attr &= ~ATTR_PREV_FREE;
+}
+
+// a free block of at least units, or NULL
+static rtapi_malloc_hdr_t *tlsf_find(struct rtapi_heap *h, size_t units)
+{
+    int fl, sl;
+
+    // round up to the next list so any block found there fits
+    if (units >= RTAPI_HEAP_SL_COUNT)
+	units += (1U << (tlsf_fls(units) - RTAPI_HEAP_SL_LOG2)) - 1;
+    if (units > TLSF_MAX_UNITS)
+	return NULL;
+    tlsf_mapping(units, &fl, &sl);
+
+    __u32 sl_map = h->sl_bitmap[fl] & (~0U << sl);
+    if (sl_map == 0) {
+	__u32 fl_map = h->fl_bitmap & (~0U << (fl + 1));
+	if (fl_map == 0)
+	    return NULL;
+	fl = tlsf_ffs(fl_map);
+	sl_map = h->sl_bitmap[fl];
+    }
+    sl = tlsf_ffs(sl_map);
+    return heap_ptr(h, h->free_lists[fl][sl]);
+}
+
+// split off the part of b past units as a used block, which is returned
+static rtapi_malloc_hdr_t *tlsf_split(struct rtapi_heap *h,
+				      rtapi_malloc_hdr_t *b, size_t units)
+{
+    rtapi_malloc_hdr_t *rest = b + units;
+
+    rest->s.tag.size = b->s.tag.size - units;
+    rest->s.tag.attr = 0;
+    rest->s.next = heap_off(h, b);
+    tlsf_next_phys(rest)->s.next = heap_off(h, rest);
+    b->s.tag.size = units;
+    return rest;
+}
+
+static rtapi_malloc_hdr_t *tlsf_malloc(struct rtapi_heap *h, size_t nunits)
+{
+    if (nunits < TLSF_MIN_UNITS)
+	nunits = TLSF_MIN_UNITS;
+    if (nunits > TLSF_MAX_UNITS)
+	return NULL;
+
+    rtapi_malloc_hdr_t *b = tlsf_find(h, nunits);
+    if (b == NULL)
+	return NULL;
+    tlsf_remove(h, b);
+    if (b->s.tag.size - nunits >= TLSF_MIN_UNITS)
+	tlsf_insert(h, tlsf_split(h, b, nunits));
+    return b;
+}
+
+static void tlsf_free(struct rtapi_heap *h, rtapi_malloc_hdr_t *b)
+{
+    // coalesce with free neighbours, unless the result can't be tagged
+    if (b->s.tag.attr & ATTR_PREV_FREE) {
+	rtapi_malloc_hdr_t *prev = heap_ptr(h, b->s.next);
+	if (prev->s.tag.size + b->s.tag.size <= TLSF_MAX_UNITS) {
+	    tlsf_remove(h, prev);
+	    prev->s.tag.size += b->s.tag.size;
+	    tlsf_next_phys(prev)->s.next = heap_off(h, prev);
+	    b = prev;
+	}
+    }
+    rtapi_malloc_hdr_t *next = tlsf_next_phys(b);
+    if ((next->s.tag.attr & ATTR_FREE) &&
+	(next->s.tag.size + b->s.tag.size <= TLSF_MAX_UNITS)) {
+	tlsf_remove(h, next);
+	b->s.tag.size += next->s.tag.size;
+	tlsf_next_phys(b)->s.next = heap_off(h, b);
+    }
+    tlsf_insert(h, b);
+}
+
+static int tlsf_addmem(struct rtapi_heap *h, void *space, size_t size)
+{
+    rtapi_malloc_hdr_t *b = space;
+    size_t units = size / sizeof(rtapi_malloc_hdr_t);
+
+    if (units < TLSF_MIN_UNITS + 1)
+	return -EINVAL;
+    h->arena_size += size;
+
+    // contiguous with the previous region: its sentinel becomes
+    // the first block, and may coalesce with what precedes it
+    if (h->last_sentinel &&
+	tlsf_next_phys(heap_ptr(h, h->last_sentinel)) == space) {
+	b = heap_ptr(h, h->last_sentinel);
+	units += b->s.tag.size;
+    }
+    units--; // the new sentinel
+
+    // set up as used blocks, and free them into the lists
+    while (units >= TLSF_MIN_UNITS) {
+	size_t n = units;
+	if (n > TLSF_MAX_UNITS)
+	    n = TLSF_MAX_UNITS;
+	if (units - n && units - n < TLSF_MIN_UNITS)
+	    n -= TLSF_MIN_UNITS;
+	b->s.tag.size = n;
+
+	rtapi_malloc_hdr_t *next = b + n;
+	next->s.next = heap_off(h, b);
+	next->s.tag.size = 1;
+	next->s.tag.attr = 0;
+	tlsf_free(h, b);
+
+	b = next;
+	units -= n;
+    }
+    // a remainder too small for a block is absorbed by the sentinel
+    b->s.tag.size = units + 1;
+    h->last_sentinel = heap_off(h, b);
+    return 0;
+}
+
+static size_t tlsf_walk(struct rtapi_heap *h, chunk_t callback, void *user)
+{
+    size_t free = 0;
+    int fl, sl;
+
+    for (fl = 0; fl < RTAPI_HEAP_FL_COUNT; fl++)
+	for (sl = 0; sl < RTAPI_HEAP_SL_COUNT; sl++) {
+	    __u32 off;
+	    for (off = h->free_lists[fl][sl]; off;
+		 off = tlsf_links(heap_ptr(h, off))->next_free) {
+		rtapi_malloc_hdr_t *p = heap_ptr(h, off);
+		if (callback != NULL)
+		    callback(p->s.tag.size * sizeof(rtapi_malloc_hdr_t),
+			     (void *)(p + 1),
+			     user);
+		free += p->s.tag.size;
+	    }
+	}
+    return free;
+}
+
+static void tlsf_status(struct rtapi_heap *h, struct rtapi_heap_stat *hs)
+{
+    int fl, sl;
+
+    for (fl = 0; fl < RTAPI_HEAP_FL_COUNT; fl++)
+	for (sl = 0; sl < RTAPI_HEAP_SL_COUNT; sl++) {
+	    __u32 off;
+	    for (off = h->free_lists[fl][sl]; off;
+		 off = tlsf_links(heap_ptr(h, off))->next_free) {
+		rtapi_malloc_hdr_t *p = heap_ptr(h, off);
+		hs->fragments++;
+		hs->total_avail += p->s.tag.size;
+		if (p->s.tag.size > hs->largest)
+		    hs->largest = p->s.tag.size;
+	    }
+	}
+    hs->total_avail *= sizeof(rtapi_malloc_hdr_t);
+    hs->largest *= sizeof(rtapi_malloc_hdr_t);
+}
+
 static void *_rtapig_malloc(const int lock, struct rtapi_heap *h, size_t nbytes);
 
 void *_rtapi_malloc(struct rtapi_heap *h, size_t nbytes)
@@ -86,6 +351,8 @@ void  *_rtapi_malloc_aligned(struct rtapi_heap *h, size_t nbytes, size_t align)
 	return NULL;
     }
     void *base = _rtapig_malloc(0, h, nbytes + align);
+    if (base == NULL)
+	return NULL;
     void *result = (void *)((rtapi_uintptr_t)(base + align) & - align);
     size_t slack = result - base;
     if (slack < sizeof(rtapi_malloc_tag_t)) {
@@ -107,14 +374,19 @@ void  *_rtapi_malloc_aligned(struct rtapi_heap *h, size_t nbytes, size_t align)
 	rtapi_malloc_hdr_t *this = (rtapi_malloc_hdr_t *) base - 1;
 	rtapi_malloc_hdr_t *new = this + (this->s.tag.size - trim);
 
-	// splice in the new block adjusting sizes
-	new->s.next = this->s.next;
-	new->s.tag.size = trim;
-	new->s.tag.attr = 0;
-	this->s.next = heap_off(h, new);
-	this->s.tag.size -= trim;
-	// and free the overallocated block
-	_rtapi_unlocked_free(h, new + 1);
+	if (h->flags & RTAPIHEAP_FIRSTFIT) {
+	    // splice in the new block adjusting sizes
+	    new->s.next = this->s.next;
+	    new->s.tag.size = trim;
+	    new->s.tag.attr = 0;
+	    this->s.next = heap_off(h, new);
+	    this->s.tag.size -= trim;
+	    // and free the overallocated block
+	    _rtapi_unlocked_free(h, new + 1);
+	} else if (trim >= TLSF_MIN_UNITS) {
+	    tlsf_split(h, this, this->s.tag.size - trim);
+	    _rtapi_unlocked_free(h, new + 1);
+	}
     }
 
     if (!is_aligned(result, align)) { // QA
@@ -130,10 +402,33 @@ static void *_rtapig_malloc(const int lock, struct rtapi_heap *h, size_t nbytes)
 {
     WITH_MUTEX_IF(HEAP_MUTEX(h), lock);
 
-    rtapi_malloc_hdr_t *p, *prevp;
+    rtapi_malloc_hdr_t *p;
     size_t nunits  = (nbytes + sizeof(rtapi_malloc_hdr_t) - 1) /
 	sizeof(rtapi_malloc_hdr_t) + 1;
 
+    if (h->flags & RTAPIHEAP_FIRSTFIT)
+	p = kr_malloc(h, nunits);
+    else
+	p = tlsf_malloc(h, nunits);
+
+    if (p == NULL) {
+	heap_print(h, RTAPI_MSG_INFO, "rtapi_malloc: out of memory"
+		   " (size=%zu arena=%zu)\n", nbytes, h->arena_size);
+	return NULL;
+    }
+    size_t alloced = _rtapi_allocsize(h, p+1);
+    h->requested += nbytes;
+    h->allocated += alloced;
+    if (h->flags & RTAPIHEAP_TRACE_MALLOC)
+	heap_print(h, RTAPI_MSG_INFO, "malloc req=%zu actual=%zu at %p\n",
+		   nbytes, alloced, p);
+    return (void *)(p+1);
+}
+
+static rtapi_malloc_hdr_t *kr_malloc(struct rtapi_heap *h, size_t nunits)
+{
+    rtapi_malloc_hdr_t *p, *prevp;
+
     // heaps are explicitly initialized, see rtapi_heap_init()
     // if ((prevp = h->freep) == NULL) {	// no free list yet
     // 	h->base.s.ptr = h->freep = prevp = &h->base;
@@ -153,17 +448,9 @@ static void *_rtapig_malloc(const int lock, struct rtapi_heap *h, size_t nbytes)
 	    }
 	    p->s.tag.attr = 0;
 	    h->free_p = heap_off(h, prevp);
-	    size_t alloced = _rtapi_allocsize(h, p+1);
-	    h->requested += nbytes;
-	    h->allocated += alloced;
-	    if (h->flags & RTAPIHEAP_TRACE_MALLOC)
-		heap_print(h, RTAPI_MSG_INFO, "malloc req=%zu actual=%zu at %p\n",
-			   nbytes, alloced, p);
-	    return (void *)(p+1);
+	    return p;
 	}
 	if (p == freep)	{	/* wrapped around free list */
-	    heap_print(h, RTAPI_MSG_INFO, "rtapi_malloc: out of memory"
-		       " (size=%zu arena=%zu)\n", nbytes, h->arena_size);
 	    //if ((p = morecore(nunits)) == NULL)
 	    return NULL;	/* none left */
 	}
@@ -172,8 +459,7 @@ static void *_rtapig_malloc(const int lock, struct rtapi_heap *h, size_t nbytes)
 
 static void _rtapi_unlocked_free(struct rtapi_heap *h, void *ap)
 {
-    rtapi_malloc_hdr_t *bp, *p;
-    rtapi_malloc_hdr_t *freep =  heap_ptr(h,h->free_p);
+    rtapi_malloc_hdr_t *bp;
 
     rtapi_malloc_tag_t *rt = (rtapi_malloc_tag_t *) ap - 1;
 
@@ -190,6 +476,25 @@ static void _rtapi_unlocked_free(struct rtapi_heap *h, void *ap)
     }
 
     bp = (rtapi_malloc_hdr_t *)ap - 1;	// point to block header
+
+    if (h->flags & RTAPIHEAP_FIRSTFIT) {
+	h->freed += sizeof(rtapi_malloc_hdr_t) * (bp->s.tag.size - 1);
+	kr_free(h, bp);
+	return;
+    }
+    if (bp->s.tag.attr & ATTR_FREE) {
+	heap_print(h, RTAPI_MSG_ERR, "%s: %p already free\n",
+		   __FUNCTION__, ap);
+	return;
+    }
+    h->freed += sizeof(rtapi_malloc_hdr_t) * (bp->s.tag.size - 1);
+    tlsf_free(h, bp);
+}
+
+static void kr_free(struct rtapi_heap *h, rtapi_malloc_hdr_t *bp)
+{
+    rtapi_malloc_hdr_t *p;
+    rtapi_malloc_hdr_t *freep =  heap_ptr(h,h->free_p);
     size_t alloc = bp->s.tag.size;
 
     for (p = freep;
@@ -206,8 +511,6 @@ static void _rtapi_unlocked_free(struct rtapi_heap *h, void *ap)
 	    break;
 	}
 
-    h->freed += sizeof(rtapi_malloc_hdr_t) * (bp->s.tag.size - 1);
-
     if (bp + bp->s.tag.size == ((rtapi_malloc_hdr_t *)heap_ptr(h,p->s.next))) {
 	// join to upper neighbor
 	size_t ns = ((rtapi_malloc_hdr_t *)heap_ptr(h,p->s.next))->s.tag.size;
@@ -287,6 +590,9 @@ size_t _rtapi_heap_walk_freelist(struct rtapi_heap *h, chunk_t callback, void *u
 {
     WITH_MUTEX(HEAP_MUTEX(h));
 
+    if (!(h->flags & RTAPIHEAP_FIRSTFIT))
+	return tlsf_walk(h, callback, user);
+
     size_t free = 0;
     rtapi_malloc_hdr_t *p, *prevp, *freep = heap_ptr(h,h->free_p);
     prevp = freep;
@@ -309,6 +615,9 @@ int _rtapi_heap_addmem(struct rtapi_heap *h, void *space, size_t size)
 
     if (space < (void*) h) return -EINVAL;
     memset(space, 0, size);
+    if (!(h->flags & RTAPIHEAP_FIRSTFIT))
+	return tlsf_addmem(h, space, size);
+
     rtapi_malloc_hdr_t *arena = space;
     size_t clicks = size / sizeof(rtapi_malloc_hdr_t);
     arena->s.tag.size = clicks;
@@ -331,6 +640,10 @@ int _rtapi_heap_init(struct rtapi_heap *heap, const char *name)
     heap->requested = 0;
     heap->allocated = 0;
     heap->freed = 0;
+    heap->fl_bitmap = 0;
+    memset(heap->sl_bitmap, 0, sizeof(heap->sl_bitmap));
+    memset(heap->free_lists, 0, sizeof(heap->free_lists));
+    heap->last_sentinel = 0;
     if (name) 
 	strncpy(heap->name, name, sizeof(heap->name));
     else {
@@ -346,6 +659,9 @@ int _rtapi_heap_init(struct rtapi_heap *heap, const char *name)
 int  _rtapi_heap_setflags(struct rtapi_heap *heap, int flags)
 {
     int f = heap->flags;
+    // the allocator can't change once the heap holds memory
+    if (heap->arena_size && ((flags ^ f) & RTAPIHEAP_FIRSTFIT))
+	return -EBUSY;
     heap->flags = flags;
     return f;
 }
@@ -363,6 +679,11 @@ size_t _rtapi_heap_status(struct rtapi_heap *h,
     hs->fragments = 0;
     hs->largest = 0;
 
+    if (!(h->flags & RTAPIHEAP_FIRSTFIT)) {
+	tlsf_status(h, hs);
+	return hs->largest;
+    }
+
     rtapi_malloc_hdr_t *p, *prevp, *freep = heap_ptr(h, h->free_p);
     prevp = freep;
     for (p = heap_ptr(h, prevp->s.next); ; prevp = p, p = heap_ptr(h, p->s.next)) {
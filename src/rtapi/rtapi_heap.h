@@ -21,6 +21,9 @@ RTAPI_BEGIN_DECLS
 #define RTAPIHEAP_TRACE_MALLOC RTAPI_BIT(0)
 #define RTAPIHEAP_TRACE_FREE   RTAPI_BIT(1)
 #define RTAPIHEAP_TRIM         RTAPI_BIT(2)  //  free alignment overallocations
+// use the K&R first-fit allocator instead of TLSF
+// takes effect only if set before memory is added to the heap
+#define RTAPIHEAP_FIRSTFIT     RTAPI_BIT(3)
 
 struct rtapi_heap;
 struct rtapi_heap_stat {
@@ -44,6 +47,8 @@ int   _rtapi_heap_init(struct rtapi_heap *h, const char *name);
 // any memory added to the heap must lie above the rtapi_heap structure:
 int _rtapi_heap_addmem(struct rtapi_heap *h, void *space, size_t size);
 
+// returns the previous flags, or -EBUSY on an attempt to change
+// RTAPIHEAP_FIRSTFIT after memory was added
 int    _rtapi_heap_setflags(struct rtapi_heap *heap, int flags);
 size_t _rtapi_heap_status(struct rtapi_heap *h, struct rtapi_heap_stat *hs);
 
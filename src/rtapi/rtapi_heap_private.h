@@ -22,7 +22,17 @@
 #define RTAPI_MALLOC_ALIGN 1    // *8 == alignment boundary
 #endif
 
-#define ATTR_ALIGNED 1
+// rtapi_malloc_tag_t.attr bits
+#define ATTR_ALIGNED   1  // tag of an rtapi_malloc_aligned() region
+#define ATTR_FREE      2  // TLSF: block is free
+#define ATTR_PREV_FREE 4  // TLSF: physically preceding block is free
+
+// TLSF segregated free lists: the first level splits block sizes by
+// powers of two, the second level linearly into RTAPI_HEAP_SL_COUNT
+// ranges. Block sizes are at most 2^24-1 units (rtapi_malloc_tag_t.size)
+#define RTAPI_HEAP_SL_LOG2  4
+#define RTAPI_HEAP_SL_COUNT (1 << RTAPI_HEAP_SL_LOG2)
+#define RTAPI_HEAP_FL_COUNT (24 - RTAPI_HEAP_SL_LOG2 + 1)
 
 
 typedef struct rtapi_malloc_align {
@@ -40,7 +50,9 @@ typedef struct rtapi_malloc_tag {
 
 union rtapi_malloc_header {
     struct hdr {
-	 __u32   next;	// next block if on free list
+	// first fit: next block if on free list
+	// TLSF: physically preceding block, 0 if none
+	 __u32   next;
 	rtapi_malloc_tag_t tag; // size of
     } s;
     rtapi_malloc_align_t align;	// unused - force alignment of blocks
@@ -58,6 +70,12 @@ struct rtapi_heap {
     size_t allocated;
     int freed;
     char name[16];
+
+    // TLSF state, see rtapi_heap.c
+    __u32 fl_bitmap;                     // non-empty first level lists
+    __u32 sl_bitmap[RTAPI_HEAP_FL_COUNT]; // non-empty second level lists
+    __u32 free_lists[RTAPI_HEAP_FL_COUNT][RTAPI_HEAP_SL_COUNT];
+    __u32 last_sentinel;                 // end of most recently added memory
 };
 
 static inline void *heap_ptr(struct rtapi_heap *base, size_t offset) {
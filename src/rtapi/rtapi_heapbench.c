@@ -0,0 +1,132 @@
+// rtapi_heap stress test and benchmark, run by tests/rtapi-heap.0
+//
+// runs the same random malloc/free churn against a TLSF and a first fit
+// heap, verifies the heaps return to their initial state, and reports
+// timings on stderr
+//
+// License: GPL Version 2
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "rtapi.h"
+#include "rtapi_heap.h"
+#include "rtapi_heap_private.h"
+
+#define ARENA_SIZE (4 * 1024 * 1024)
+#define SLOTS      4096
+#define ROUNDS     2000000
+#define MAX_ALLOC  4096
+
+// rtapi_heap logs through the message ring, not available here
+int vs_ringlogfv(const msg_level_t level, const int pid,
+		 const msg_origin_t origin, const char *tag,
+		 const char *format, va_list ap)
+{
+    vfprintf(stderr, format, ap);
+    return 0;
+}
+
+static struct {
+    struct rtapi_heap heap;
+    char arena[ARENA_SIZE];
+} h;
+
+static void *slot[SLOTS];
+static size_t slot_size[SLOTS];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int run(const char *name, int flags)
+{
+    struct rtapi_heap_stat hs;
+    int i, failed = 0;
+    size_t avail;
+    double worst = 0, start;
+
+    _rtapi_heap_init(&h.heap, name);
+    _rtapi_heap_setflags(&h.heap, flags);
+    if (_rtapi_heap_addmem(&h.heap, h.arena, sizeof(h.arena))) {
+	printf("%s: addmem failed\n", name);
+	return 1;
+    }
+    _rtapi_heap_status(&h.heap, &hs);
+    avail = hs.total_avail;
+
+    // the allocator is fixed once the heap holds memory
+    if (_rtapi_heap_setflags(&h.heap, flags ^ RTAPIHEAP_FIRSTFIT) != -EBUSY) {
+	printf("%s: allocator changed on a heap in use\n", name);
+	failed++;
+    }
+
+    memset(slot, 0, sizeof(slot));
+    srand(4711);
+    start = now();
+    for (i = 0; i < ROUNDS; i++) {
+	int n = rand() % SLOTS;
+	double t = now();
+	if (slot[n]) {
+	    // check the block wasn't handed out twice meanwhile
+	    if (((unsigned char *)slot[n])[slot_size[n] - 1] != (n & 0xff))
+		failed++;
+	    _rtapi_free(&h.heap, slot[n]);
+	    slot[n] = NULL;
+	} else {
+	    // mostly small, some large requests
+	    size_t size = 1 + rand() % ((rand() % 8) ? 128 : MAX_ALLOC);
+	    if (rand() % 16 == 0)
+		slot[n] = _rtapi_malloc_aligned(&h.heap, size, 64);
+	    else
+		slot[n] = _rtapi_malloc(&h.heap, size);
+	    if (slot[n]) {
+		slot_size[n] = size;
+		memset(slot[n], n & 0xff, size);
+	    }
+	}
+	t = now() - t;
+	if (t > worst)
+	    worst = t;
+    }
+    double elapsed = now() - start;
+
+    _rtapi_heap_status(&h.heap, &hs);
+    fprintf(stderr, "%-9s %6.1f ns/op, worst %6.1f us, "
+	    "%zu fragments, largest %zu of %zu free\n",
+	    name, elapsed * 1e9 / ROUNDS, worst * 1e6,
+	    hs.fragments, hs.largest, hs.total_avail);
+
+    for (i = 0; i < SLOTS; i++)
+	if (slot[i])
+	    _rtapi_free(&h.heap, slot[i]);
+
+    // everything freed must have coalesced back
+    _rtapi_heap_status(&h.heap, &hs);
+    if (hs.total_avail != avail || hs.fragments != 1) {
+	printf("%s: heap not restored: %zu of %zu free in %zu fragments\n",
+	       name, hs.total_avail, avail, hs.fragments);
+	failed++;
+    }
+    if (failed)
+	printf("%s: %d errors\n", name, failed);
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    int failed = 0;
+
+    failed += run("tlsf", RTAPIHEAP_TRIM);
+    failed += run("firstfit", RTAPIHEAP_TRIM | RTAPIHEAP_FIRSTFIT);
+    if (failed)
+	return 1;
+    printf("all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,227 @@
+/********************************************************************
+* Description: rtapi_msgbench.c
+*   What logging a message costs the RT thread: formatting it and
+*   writing the text to a message ring, as rtapi_print_msg() used to,
+*   against writing a binary record (rtapi_msgfmt.h). Also shows what
+*   formatting the record later costs msgd.
+*
+*   Usage:
+*     rtapi_msgbench [-n iterations]
+*     rtapi_msgbench -c     check binary records format as vsnprintf()
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "rtapi.h"
+#include "ring.h"
+#include "rtapi_msgfmt.h"
+
+#define BUFLEN 256		// as RTPRINTBUFFERLEN in rtapi_support.c
+#define RINGSIZE (64 * 1024)
+
+typedef struct {
+    rtapi_msgheader_t hdr;
+    char buf[BUFLEN];
+} msg_t;
+
+static ringbuffer_t ring;
+static int check, fails;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// the text path: format in the writer
+static int log_text(const char *fmt, ...)
+{
+    msg_t msg;
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(msg.buf, BUFLEN, fmt, ap);
+    va_end(ap);
+    msg.hdr.encoding = MSG_ASCII;
+    if (n >= BUFLEN)
+	n = BUFLEN - 1;
+    record_write(&ring, &msg, sizeof(rtapi_msgheader_t) + n + 1);
+    record_shift(&ring);
+    return n;
+}
+
+// the binary path: leave formatting to the reader
+static int log_binary(const char *fmt, ...)
+{
+    msg_t msg;
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = rtapi_msg_encode(msg.buf, BUFLEN, fmt, ap);
+    va_end(ap);
+    if (n < 0)
+	return n;
+    msg.hdr.encoding = MSG_BINARY;
+    record_write(&ring, &msg, sizeof(rtapi_msgheader_t) + n);
+    record_shift(&ring);
+    return n;
+}
+
+// compare a formatted binary record with vsnprintf()
+static void compare(const char *fmt, ...)
+{
+    char text[BUFLEN], decoded[BUFLEN], payload[BUFLEN];
+    va_list ap, aq;
+    int n, m;
+
+    va_start(ap, fmt);
+    va_copy(aq, ap);
+    vsnprintf(text, sizeof(text), fmt, ap);
+    n = rtapi_msg_encode(payload, sizeof(payload), fmt, aq);
+    va_end(aq);
+    va_end(ap);
+
+    if (n < 0) {
+	printf("%-40.*s formatted by the writer\n",
+	       (int) strcspn(fmt, "\n"), fmt);
+	return;
+    }
+    m = rtapi_msg_decode(decoded, sizeof(decoded), payload, n);
+    if (m < 0 || strcmp(text, decoded)) {
+	printf("*fail* %s: '%s' != '%s'\n", fmt, text, decoded);
+	fails++;
+    } else {
+	printf("%-40.*s ok\n", (int) strcspn(fmt, "\n"), fmt);
+    }
+}
+
+#define HM2_FMT "hm2/%s: Encoder %d: quadrature count error\n"
+#define GENSER_FMT "ERR kI - compute_jfwd (joints: %f %f %f %f %f %f), " \
+    "(iterations=%d)\n"
+#define MIXED_FMT "%s: pin %-12s %08x %5.2f%% %c %p %ld\n"
+
+#define BENCH(name, iterations, call)					\
+    do {								\
+	double t0 = now();						\
+	int i_;								\
+	for (i_ = 0; i_ < (iterations); i_++)				\
+	    call;							\
+	printf("  %-20s %8.1f ns/msg\n", name,				\
+	       (now() - t0) * 1e9 / (iterations));			\
+    } while (0)
+
+static void bench_decode(const char *title, int iterations,
+			 const char *fmt, ...)
+{
+    char payload[BUFLEN], text[1024];
+    va_list ap, aq;
+    int n;
+
+    printf("%s:\n", title);
+
+    va_start(ap, fmt);
+    va_copy(aq, ap);
+    n = rtapi_msg_encode(payload, sizeof(payload), fmt, aq);
+    va_end(aq);
+    va_end(ap);
+    if (n < 0) {
+	printf("  can't be deferred\n");
+	return;
+    }
+    BENCH("decode", iterations,
+	  rtapi_msg_decode(text, sizeof(text), payload, n));
+}
+
+static void usage(void)
+{
+    printf("Usage:  rtapi_msgbench [options]\n"
+	   "-n <iterations>\n"
+	   "    messages per measurement (default 1000000)\n"
+	   "-c\n"
+	   "    check binary records format as vsnprintf() does, and exit\n");
+}
+
+int main(int argc, char **argv)
+{
+    int opt, iterations = 1000000;
+    double j[6] = { 0.1, -12.5, 3.14159, 90.0, -45.25, 1e-6 };
+    ringheader_t *rh;
+
+    while ((opt = getopt(argc, argv, "hcn:")) != -1) {
+	switch (opt) {
+	case 'c':
+	    check = 1;
+	    break;
+	case 'n':
+	    iterations = atoi(optarg);
+	    break;
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (iterations < 1) {
+	usage();
+	exit(1);
+    }
+
+    if (check) {
+	compare(HM2_FMT, "7i92.0", 3);
+	compare(GENSER_FMT, j[0], j[1], j[2], j[3], j[4], j[5], 100);
+	compare(MIXED_FMT, "hal_lib", "motion.in", 0xdeadbeef, 99.5, 'x',
+		(void *) &j, -1L);
+	compare("%hd %hhu %lld %zu %llx %o %#x %+d %i",
+		(short) -5, 300, -1LL << 40, sizeof(j), ~0ULL, 8, 255, 1, -1);
+	compare("%*d|%-*s|%.*f|%*.*e|%.3s|%s", 6, 42, 8, "left", 2, 3.14159,
+		12, 3, 6.02e23, "abcdef", (char *) NULL);
+	compare("%g %G %e %a %.0f %lf %5.1f%%", 1e-5, 1e20, -0.0, 1.0,
+		2.5, 1.0 / 3, 99.95);
+	compare("%Lf", (long double) 1);
+	compare("no conversions\n");
+	printf("%d failures\n", fails);
+	return fails ? 1 : 0;
+    }
+
+    rh = malloc(ring_memsize(0, RINGSIZE, 0));
+    ringheader_init(rh, 0, RINGSIZE, 0);
+    ringbuffer_init(rh, &ring);
+
+    printf("RT side, format + ring write:\n");
+    BENCH("hm2, text", iterations,
+	  log_text(HM2_FMT, "7i92.0", 3));
+    BENCH("hm2, binary", iterations,
+	  log_binary(HM2_FMT, "7i92.0", 3));
+    BENCH("genserkins, text", iterations,
+	  log_text(GENSER_FMT, j[0], j[1], j[2], j[3], j[4], j[5], 100));
+    BENCH("genserkins, binary", iterations,
+	  log_binary(GENSER_FMT, j[0], j[1], j[2], j[3], j[4], j[5], 100));
+    BENCH("mixed, text", iterations,
+	  log_text(MIXED_FMT, "hal_lib", "motion.in", 0xdeadbeef, 99.5, 'x',
+		   (void *) &j, -1L));
+    BENCH("mixed, binary", iterations,
+	  log_binary(MIXED_FMT, "hal_lib", "motion.in", 0xdeadbeef, 99.5, 'x',
+		     (void *) &j, -1L));
+
+    printf("\nmsgd side:\n");
+    bench_decode("hm2", iterations, HM2_FMT, "7i92.0", 3);
+    bench_decode("genserkins", iterations,
+		 GENSER_FMT, j[0], j[1], j[2], j[3], j[4], j[5], 100);
+    bench_decode("mixed", iterations,
+		 MIXED_FMT, "hal_lib", "motion.in", 0xdeadbeef, 99.5, 'x',
+		 (void *) &j, -1L);
+
+    free(rh);
+    return 0;
+}
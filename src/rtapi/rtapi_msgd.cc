@@ -55,6 +55,7 @@
 using namespace std;
 
 #include <rtapi.h>
+#include <rtapi_msgfmt.h>
 #include <shmdrv.h>
 #include <ring.h>
 #include <setup_signals.h>
@@ -73,6 +74,7 @@ using namespace google::protobuf;
 #define SYSLOG_FACILITY LOG_LOCAL1  // where all rtapi/ulapi logging goes
 #endif
 #define GRACE_PERIOD 2000 // ms to wait after rtapi_app exit detected
+#define RTAPI_MSGD_TEXTLEN 1024 // longest message formatted from a binary record
 
 #define STRINGIFY(x) #x
 #define TOSTRING(x) STRINGIFY(x)
@@ -421,8 +423,9 @@ static int init_global_data(global_data_t * data,
 	offsetof(global_data_t, arena);
 
     DPRINTF("global_heap_size=%zu\n", global_heap_size);
-    _rtapi_heap_addmem(&data->heap, data->arena, global_heap_size);
+    // flags first - they select the allocator
     _rtapi_heap_setflags(&data->heap, global_heap_flags);
+    _rtapi_heap_addmem(&data->heap, data->arena, global_heap_size);
 
     // done with heap
     // Allocate the message ring buffer from the global heap:
@@ -629,9 +632,10 @@ static int
 message_poll_cb(zloop_t *loop, int  timer_id, void *args)
 {
     rtapi_msgheader_t *msg;
-    size_t payload_length;
+    size_t payload_length, text_length;
     int retval;
-    char *cp;
+    char *cp, *msg_text;
+    char text[RTAPI_MSGD_TEXTLEN];
     machinetalk::Container container;
     machinetalk::LogMessage *logmsg;
     zframe_t *z_pbframe;
@@ -657,29 +661,49 @@ message_poll_cb(zloop_t *loop, int  timer_id, void *args)
 	n_msgs++;
 	n_bytes += msg_size;
 
+	// RT writers leave formatting to us if they can
+	if (msg->encoding == MSG_BINARY) {
+	    if (rtapi_msg_decode(text, sizeof(text),
+				 msg->buf, payload_length) < 0)
+		snprintf(text, sizeof(text),
+			 "msgd: malformed message record (%zu bytes)",
+			 payload_length);
+	    msg_text = text;
+	    text_length = sizeof(text);
+	} else {
+	    msg_text = msg->buf;
+	    text_length = payload_length;
+	}
+
 	// strip trailing newlines
-	while ((cp = strrchr(msg->buf,'\n')))
+	while ((cp = strrchr(msg_text,'\n')))
 	    *cp = '\0';
 	syslog_async(rtapi2syslog(msg->level), "%s:%d:%s %.*s",
 		     msg->tag, msg->pid, origins[msg->origin],
-		     (int) payload_length, msg->buf);
+		     (int) text_length, msg_text);
 
 
 	if (logpub.socket) {
 	    // publish protobuf-encoded log message
 	    container.set_type(machinetalk::MT_LOG_MESSAGE);
 
-	    struct timespec timestamp;
-	    clock_gettime(CLOCK_REALTIME, &timestamp);
-	    container.set_tv_sec(timestamp.tv_sec);
-	    container.set_tv_nsec(timestamp.tv_nsec);
+	    // when the message was logged, if the writer said
+	    if (msg->timestamp) {
+		container.set_tv_sec(msg->timestamp / 1000000000LL);
+		container.set_tv_nsec(msg->timestamp % 1000000000LL);
+	    } else {
+		struct timespec timestamp;
+		clock_gettime(CLOCK_REALTIME, &timestamp);
+		container.set_tv_sec(timestamp.tv_sec);
+		container.set_tv_nsec(timestamp.tv_nsec);
+	    }
 
 	    logmsg = container.mutable_log_message();
 	    logmsg->set_origin((machinetalk::MsgOrigin)msg->origin);
 	    logmsg->set_pid(msg->pid);
 	    logmsg->set_level((machinetalk::MsgLevel) msg->level);
 	    logmsg->set_tag(msg->tag);
-	    logmsg->set_text(msg->buf, strlen(msg->buf));
+	    logmsg->set_text(msg_text, strlen(msg_text));
 
 	    z_pbframe = zframe_new(NULL, container.ByteSize());
 	    assert(z_pbframe != NULL);
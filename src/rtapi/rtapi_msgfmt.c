@@ -0,0 +1,430 @@
+/********************************************************************
+* Description: rtapi_msgfmt.c
+*   Binary RTAPI message records - see rtapi_msgfmt.h
+*
+*   The encoder runs in RT context: it scans the format once and
+*   copies words, it never formats.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include "config.h"
+#include "rtapi.h"
+#include "rtapi_msgfmt.h"
+
+#ifdef MODULE
+#include <linux/kernel.h>
+#include <linux/string.h>
+#else
+#include <stdio.h>		/* snprintf() */
+#include <string.h>
+#endif
+
+#define WORD 8
+#define PAD(n) (((n) + WORD - 1) & ~(WORD - 1))
+
+// length modifiers
+enum { LEN_NONE, LEN_HH, LEN_H, LEN_L, LEN_LL, LEN_Z, LEN_T, LEN_J, LEN_BIGL };
+
+// argument kinds
+enum { ARG_NONE, ARG_SIGNED, ARG_UNSIGNED, ARG_CHAR, ARG_POINTER,
+       ARG_STRING, ARG_DOUBLE };
+
+typedef struct {
+    const char *end;		// the conversion character
+    const char *length_at;	// where the length modifier starts
+    int star_width, star_prec;
+    int precision;		// explicit precision, -1 if none or '*'
+    int length;
+    int kind;
+} msg_spec_t;
+
+#ifdef MODULE
+static int is_alnum(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+	(c >= 'A' && c <= 'Z');
+}
+#endif
+
+// parse the conversion starting at the '%' at fmt.
+// Returns -1 if it can't be deferred.
+static int parse_spec(const char *fmt, msg_spec_t *s)
+{
+    const char *f = fmt + 1;
+
+    s->star_width = s->star_prec = 0;
+    s->precision = -1;
+    s->length = LEN_NONE;
+
+    while (*f == '-' || *f == '+' || *f == ' ' || *f == '#' ||
+	   *f == '0' || *f == '\'')
+	f++;
+    if (*f == '*') {
+	s->star_width = 1;
+	f++;
+    } else {
+	while (*f >= '0' && *f <= '9')
+	    f++;
+    }
+    if (*f == '.') {
+	f++;
+	if (*f == '*') {
+	    s->star_prec = 1;
+	    f++;
+	} else {
+	    s->precision = 0;
+	    while (*f >= '0' && *f <= '9')
+		s->precision = s->precision * 10 + *f++ - '0';
+	}
+    }
+
+    s->length_at = f;
+    switch (*f) {
+    case 'h':
+	f++;
+	if (*f == 'h') {
+	    s->length = LEN_HH;
+	    f++;
+	} else
+	    s->length = LEN_H;
+	break;
+    case 'l':
+	f++;
+	if (*f == 'l') {
+	    s->length = LEN_LL;
+	    f++;
+	} else
+	    s->length = LEN_L;
+	break;
+    case 'q':
+	s->length = LEN_LL;
+	f++;
+	break;
+    case 'L':
+	s->length = LEN_BIGL;
+	f++;
+	break;
+    case 'z':
+	s->length = LEN_Z;
+	f++;
+	break;
+    case 't':
+	s->length = LEN_T;
+	f++;
+	break;
+    case 'j':
+	s->length = LEN_J;
+	f++;
+	break;
+    }
+    s->end = f;
+
+    switch (*f) {
+    case '%':
+	s->kind = ARG_NONE;
+	return 0;
+    case 'd':
+    case 'i':
+	s->kind = ARG_SIGNED;
+	return s->length == LEN_BIGL ? -1 : 0;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+	s->kind = ARG_UNSIGNED;
+	return s->length == LEN_BIGL ? -1 : 0;
+    case 'c':
+	s->kind = ARG_CHAR;
+	return s->length == LEN_NONE ? 0 : -1;
+    case 's':
+	s->kind = ARG_STRING;
+	return s->length == LEN_NONE ? 0 : -1;
+    case 'p':
+	s->kind = ARG_POINTER;
+#ifdef MODULE
+	// %pI4, %pS and friends print what the pointer points to
+	if (is_alnum(f[1]))
+	    return -1;
+#endif
+	return s->length == LEN_NONE ? 0 : -1;
+#ifndef MODULE
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+	s->kind = ARG_DOUBLE;
+	return (s->length == LEN_NONE || s->length == LEN_L) ? 0 : -1;
+#endif
+    default:
+	// %n, %m, wide characters, the end of the string
+	return -1;
+    }
+}
+
+int rtapi_msg_encode(void *buf, int size, const char *fmt, va_list ap)
+{
+    char *p = buf, *end = p + size;
+    const char *f;
+    msg_spec_t s;
+    int n = strlen(fmt) + 1;
+
+#define PUT(type, value)					\
+    do {							\
+	type v_ = (value);					\
+	if (p + WORD > end)					\
+	    return -1;						\
+	memcpy(p, &v_, sizeof(v_));				\
+	p += WORD;						\
+    } while (0)
+
+    if (PAD(n) > size)
+	return -1;
+    memcpy(p, fmt, n);
+    memset(p + n, 0, PAD(n) - n);
+    p += PAD(n);
+
+    for (f = fmt; *f; f++) {
+	int prec;
+
+	if (*f != '%')
+	    continue;
+	if (parse_spec(f, &s))
+	    return -1;
+	f = s.end;
+
+	prec = s.precision;
+	if (s.star_width)
+	    PUT(long long, va_arg(ap, int));
+	if (s.star_prec) {
+	    prec = va_arg(ap, int);
+	    PUT(long long, prec);
+	}
+
+	switch (s.kind) {
+	case ARG_NONE:
+	    break;
+	case ARG_SIGNED:
+	    switch (s.length) {
+	    case LEN_L:
+		PUT(long long, va_arg(ap, long));
+		break;
+	    case LEN_LL:
+		PUT(long long, va_arg(ap, long long));
+		break;
+	    case LEN_Z:
+		PUT(long long, (long) va_arg(ap, size_t));
+		break;
+	    case LEN_T:
+		PUT(long long, va_arg(ap, ptrdiff_t));
+		break;
+	    case LEN_J:
+		PUT(long long, va_arg(ap, long long));
+		break;
+	    default:		// hh and h are promoted to int
+		PUT(long long, va_arg(ap, int));
+	    }
+	    break;
+	case ARG_UNSIGNED:
+	    switch (s.length) {
+	    case LEN_L:
+		PUT(unsigned long long, va_arg(ap, unsigned long));
+		break;
+	    case LEN_LL:
+	    case LEN_J:
+		PUT(unsigned long long, va_arg(ap, unsigned long long));
+		break;
+	    case LEN_Z:
+		PUT(unsigned long long, va_arg(ap, size_t));
+		break;
+	    case LEN_T:
+		PUT(unsigned long long, (unsigned long) va_arg(ap, ptrdiff_t));
+		break;
+	    default:
+		PUT(unsigned long long, va_arg(ap, unsigned int));
+	    }
+	    break;
+	case ARG_CHAR:
+	    PUT(long long, va_arg(ap, int));
+	    break;
+	case ARG_POINTER:
+	    PUT(unsigned long long, (unsigned long) va_arg(ap, void *));
+	    break;
+#ifndef MODULE
+	case ARG_DOUBLE:
+	    PUT(double, va_arg(ap, double));
+	    break;
+#endif
+	case ARG_STRING: {
+	    const char *str = va_arg(ap, const char *);
+	    int len = 0;
+
+	    if (str == NULL)
+		str = "(null)";
+	    // a precision may bound a string which isn't terminated
+	    while ((prec < 0 || len < prec) && str[len])
+		len++;
+	    PUT(long long, len);
+	    if (p + PAD(len + 1) > end)
+		return -1;
+	    memcpy(p, str, len);
+	    memset(p + len, 0, PAD(len + 1) - len);
+	    p += PAD(len + 1);
+	    break;
+	}
+	}
+    }
+#undef PUT
+    return p - (char *) buf;
+}
+
+#ifndef MODULE
+
+// snprintf() one conversion, as vsnprintf() would: out is the length
+// of the text so far. Returns the new length, or -1.
+static int emit(char *buf, int size, int out, const char *spec,
+		int nstar, const long long *star, int kind, const void *arg)
+{
+    char *b = out < size ? buf + out : NULL;
+    size_t room = out < size ? size - out : 0;
+    long long i;
+    unsigned long long u;
+    double d;
+    int r = -1;
+
+#define EMIT(value)							\
+    switch (nstar) {							\
+    case 0: r = snprintf(b, room, spec, value); break;			\
+    case 1: r = snprintf(b, room, spec, (int) star[0], value); break;	\
+    default: r = snprintf(b, room, spec, (int) star[0], (int) star[1],	\
+			  value);					\
+    }
+
+    switch (kind) {
+    case ARG_SIGNED:
+	memcpy(&i, arg, sizeof(i));
+	EMIT(i);
+	break;
+    case ARG_CHAR:
+	memcpy(&i, arg, sizeof(i));
+	EMIT((int) i);
+	break;
+    case ARG_UNSIGNED:
+	memcpy(&u, arg, sizeof(u));
+	EMIT(u);
+	break;
+    case ARG_POINTER:
+	memcpy(&u, arg, sizeof(u));
+	EMIT((void *) (unsigned long) u);
+	break;
+    case ARG_DOUBLE:
+	memcpy(&d, arg, sizeof(d));
+	EMIT(d);
+	break;
+    case ARG_STRING:
+	EMIT((const char *) arg);
+	break;
+    }
+#undef EMIT
+    return r < 0 ? -1 : out + r;
+}
+
+int rtapi_msg_decode(char *buf, int size, const void *payload, int len)
+{
+    const char *fmt = payload, *p, *end = fmt + len, *f;
+    msg_spec_t s;
+    int out = 0;
+    int n = strnlen(fmt, len);
+
+    if (n == len)
+	return -1;
+    p = fmt + PAD(n + 1);
+
+    for (f = fmt; *f; f++) {
+	char spec[64];
+	long long star[2];
+	int nstar = 0, speclen;
+	const void *arg;
+
+	if (*f != '%') {
+	    if (out < size - 1)
+		buf[out] = *f;
+	    out++;
+	    continue;
+	}
+	if (parse_spec(f, &s))
+	    return -1;
+
+	if (s.kind == ARG_NONE) {
+	    if (out < size - 1)
+		buf[out] = '%';
+	    out++;
+	    f = s.end;
+	    continue;
+	}
+
+	// the conversion up to its length modifier, then one that fits
+	// how the argument was stored
+	speclen = s.length_at - f;
+	if (speclen + 4 > (int) sizeof(spec))
+	    return -1;
+	memcpy(spec, f, speclen);
+	if (s.kind == ARG_SIGNED || s.kind == ARG_UNSIGNED) {
+	    if (s.length == LEN_HH)
+		spec[speclen++] = 'h';
+	    if (s.length == LEN_HH || s.length == LEN_H) {
+		spec[speclen++] = 'h';
+	    } else {
+		spec[speclen++] = 'l';
+		spec[speclen++] = 'l';
+	    }
+	}
+	spec[speclen++] = *s.end;
+	spec[speclen] = 0;
+	f = s.end;
+
+	if (s.star_width) {
+	    if (p + WORD > end)
+		return -1;
+	    memcpy(&star[nstar++], p, WORD);
+	    p += WORD;
+	}
+	if (s.star_prec) {
+	    if (p + WORD > end)
+		return -1;
+	    memcpy(&star[nstar++], p, WORD);
+	    p += WORD;
+	}
+	if (p + WORD > end)
+	    return -1;
+	arg = p;
+	p += WORD;
+	if (s.kind == ARG_STRING) {
+	    long long slen;
+	    memcpy(&slen, arg, sizeof(slen));
+	    if (slen < 0 || slen >= end - p || p[slen])
+		return -1;
+	    arg = p;
+	    p += PAD(slen + 1);
+	}
+	// short integers were stored promoted; %hd and %hhd narrow them
+	if ((s.kind == ARG_SIGNED || s.kind == ARG_UNSIGNED) &&
+	    (s.length == LEN_HH || s.length == LEN_H))
+	    s.kind = ARG_CHAR;
+
+	out = emit(buf, size, out, spec, nstar, star, s.kind, arg);
+	if (out < 0)
+	    return -1;
+    }
+    if (size > 0)
+	buf[out < size ? out : size - 1] = 0;
+    return out;
+}
+
+#endif
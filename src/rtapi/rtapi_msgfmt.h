@@ -0,0 +1,55 @@
+/********************************************************************
+* Description: rtapi_msgfmt.h
+*   Deferred formatting of RTAPI messages.
+*
+*   rtapi_print_msg() used to vsnprintf() a message before writing it
+*   to the message ring; with %f conversions that costs RT code tens
+*   of microseconds. Instead, the format and the raw arguments are
+*   written as a binary record (hdr.encoding == MSG_BINARY), and
+*   rtapi_msgd formats it when it drains the ring.
+*
+*   A format string pointer is no use to msgd - RT modules live in
+*   rtapi_app or the kernel - so the record carries the format text:
+*
+*     format, zero terminated, padded to 8 bytes
+*     one 8 byte word per '*' width or precision and per conversion
+*     for %s, the word is the string length, followed by the string
+*     padded to 8 bytes
+*
+*   Integers are stored sign- or zero-extended to 64 bits, floating
+*   point values as double. Formats with conversions which can't be
+*   deferred (%n, %Lf, kernel %p extensions) are formatted right away
+*   as before.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#ifndef RTAPI_MSGFMT_H
+#define RTAPI_MSGFMT_H
+
+#include "rtapi.h"
+#include <stdarg.h>
+
+RTAPI_BEGIN_DECLS
+
+#define MSG_ASCII  0		// hdr.buf is text
+#define MSG_BINARY 1		// hdr.buf is a rtapi_msg_encode() payload
+
+// encode fmt and its arguments into buf. Returns the size of the
+// payload, or -1 if fmt can't be deferred or the payload would
+// exceed size; ap is consumed either way.
+extern int rtapi_msg_encode(void *buf, int size, const char *fmt,
+			    va_list ap);
+
+#ifndef MODULE
+// format a payload of len bytes made by rtapi_msg_encode() into buf,
+// as vsnprintf() would have. Returns the length of the text, or -1 if
+// the payload is malformed.
+extern int rtapi_msg_decode(char *buf, int size, const void *payload,
+			    int len);
+#endif
+
+RTAPI_END_DECLS
+
+#endif
@@ -48,6 +48,10 @@
 #define STREAMER_SHMEM_KEY 	0x00535430
 #define SAMPLER_SHMEM_KEY	0x00534130
 
+// from hal_capture.h - one segment per capture instance, the
+// instance id goes in the low 16 bits
+#define CAPTURE_SHM_KEY		0x00430000
+
 // from hal/classicladder/arrays.c
 #define CL_SHMEM_KEY 0x004C522b // "CLR+"
 
@@ -31,6 +31,7 @@
 #include "rtapi.h"
 #include "shmdrv.h"
 #include "ring.h"
+#include "rtapi_msgfmt.h"
 #if defined(BUILD_SYS_USER_DSO) || defined(ULAPI)
 #include "syslog_async.h"
 #ifndef SYSLOG_FACILITY
@@ -44,6 +45,7 @@
 
 #include <stdarg.h>		/* va_* */
 #include <linux/kernel.h>	/* kernel's vsnprintf */
+#include <linux/ktime.h>	/* ktime_get_real() */
 
 #define MSG_ORIGIN MSG_KERNEL
 
@@ -52,6 +54,7 @@
 #include <stdio.h>		/* libc's vsnprintf() */
 #include <sys/types.h>
 #include <unistd.h>
+#include <time.h>		/* clock_gettime() */
 
 #ifdef RTAPI
 #define MSG_ORIGIN MSG_RTUSER
@@ -85,6 +88,17 @@ typedef struct {
     char buf[RTPRINTBUFFERLEN];
 } rtapi_msg_t;
 
+static long long msg_timestamp(void)
+{
+#ifdef MODULE
+    return ktime_to_ns(ktime_get_real());
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
 int vs_ringlogfv(const msg_level_t level,
 		 const pid_t pid,
 		 const msg_origin_t origin,
@@ -92,7 +106,7 @@ int vs_ringlogfv(const msg_level_t level,
 		 const char *format,
 		 va_list ap)
 {
-    int n;
+    int n = -1, size;
     rtapi_msg_t msg;
 
     if (get_msg_level() == RTAPI_MSG_NONE)
@@ -104,9 +118,25 @@ int vs_ringlogfv(const msg_level_t level,
     msg.hdr.pid = pid;
     msg.hdr.level = level;
     strncpy(msg.hdr.tag, tag, sizeof(msg.hdr.tag));
+    msg.hdr.timestamp = msg_timestamp();
 
-    // do format outside critical section
-    n = vsnprintf(msg.buf, RTPRINTBUFFERLEN, format, ap);
+    // leave formatting to msgd if the format allows it,
+    // in any case outside the critical section
+    if (rtapi_message_buffer.header != NULL) {
+	va_list aq;
+	va_copy(aq, ap);
+	n = rtapi_msg_encode(msg.buf, RTPRINTBUFFERLEN, format, aq);
+	va_end(aq);
+    }
+    if (n >= 0) {
+	msg.hdr.encoding = MSG_BINARY;
+	size = n;
+    } else {
+	msg.hdr.encoding = MSG_ASCII;
+	n = vsnprintf(msg.buf, RTPRINTBUFFERLEN, format, ap);
+	// as truncated, plus the trailing zero
+	size = (n < RTPRINTBUFFERLEN ? n : RTPRINTBUFFERLEN - 1) + 1;
+    }
 
     if (rtapi_message_buffer.header != NULL) {
 	if (rtapi_message_buffer.header->use_wmutex &&
@@ -116,7 +146,7 @@ int vs_ringlogfv(const msg_level_t level,
 	}
 	// use copying writer to shorten criticial section
 	record_write(&rtapi_message_buffer, (void *) &msg,
-		     sizeof(rtapi_msgheader_t) + n + 1); // trailing zero
+		     sizeof(rtapi_msgheader_t) + size);
 	if (rtapi_message_buffer.header->use_wmutex)
 	    rtapi_mutex_give(&rtapi_message_buffer.header->wmutex);
     } else {
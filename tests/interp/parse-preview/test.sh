@@ -0,0 +1,48 @@
+#!/bin/sh
+exec python2 - <<EOF2
+import gcode
+from rs274.glcanon import GLCanon
+from rs274.interpret import StatMixin
+
+class Stat:
+    tool_table = [(-1,) + (0.0,) * 12 + (0,),
+                  (1, 0.0, 0.0, 0.5) + (0.0,) * 9 + (0,)]
+    angular_units = 1.0
+    linear_units = 1.0
+    axis_mask = 7
+    block_delete = 0
+
+class Canon(GLCanon, StatMixin):
+    def __init__(self):
+        GLCanon.__init__(self, {'dwell': (1, 0, 0), 'm1xx': (0, 1, 0)}, 'XYZ')
+        StatMixin.__init__(self, Stat(), 0)
+
+def close(a, b):
+    if isinstance(a, (tuple, list)):
+        return len(a) == len(b) and all(close(x, y) for x, y in zip(a, b))
+    if isinstance(a, float) or isinstance(b, float):
+        return abs(a - b) < 1e-9
+    return a == b
+
+parsed = Canon()
+result, seq = gcode.parse("test.ngc", parsed, "", "")
+print "parse", result <= gcode.MIN_ERROR
+
+previewed = Canon()
+print "native preview", previewed.native_preview()
+result, seq2, preview = gcode.parse_preview("test.ngc", previewed, "", "",
+    "", previewed.arcdivision)
+previewed.add_preview(preview)
+print "parse_preview", result <= gcode.MIN_ERROR, seq2 == seq
+
+for name in 'traverse', 'feed', 'arcfeed', 'dwells':
+    a, b = getattr(parsed, name), getattr(previewed, name)
+    print name, len(a) > 0, close(a, b) and "same" or "differ"
+print "dwell_time", close(parsed.dwell_time, previewed.dwell_time) and "same" or "differ"
+
+parsed.calc_extents()
+previewed.calc_extents()
+print "extents", close(
+    [parsed.min_extents, parsed.max_extents],
+    [previewed.min_extents, previewed.max_extents]) and "same" or "differ"
+EOF2
@@ -0,0 +1,3 @@
+#!/bin/sh
+# rtapi_heapbench is built by src/rtapi/Submakefile
+exec ../../libexec/rtapi_heapbench
@@ -0,0 +1,2 @@
+#!/bin/sh
+rtapi_msgbench -c
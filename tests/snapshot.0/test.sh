@@ -0,0 +1,39 @@
+#!/bin/sh
+realtime start
+
+halcmd -f <<EOF2
+loadrt abs
+net in abs.0.in
+net out abs.0.out
+sets in -1.5
+EOF2
+
+halcmd snapshot all in 2>/dev/null || echo "snapshot all: no threads"
+
+halcmd -f <<EOF2
+newthread fast 100000 fp
+addf abs.0 fast
+start
+EOF2
+sleep 1
+
+halcmd snapshot fast in abs.0.in abs.0.out out
+halcmd snapshot all in out
+halcmd snapshot fast in nosuch 2>/dev/null || echo "snapshot nosuch: not found"
+halcmd snapshot slow in 2>/dev/null || echo "snapshot slow: not found"
+
+python2 <<EOF2
+import hal
+h = hal.component("snap")
+try:
+    print hal.snapshot("fast", ["in", "abs.0.out", "abs.0.sign"])
+    print hal.snapshot(None, ("out",))
+    try:
+        hal.snapshot("fast", ["nosuch"])
+    except RuntimeError:
+        print "nosuch: RuntimeError"
+finally:
+    h.exit()
+EOF2
+
+realtime stop
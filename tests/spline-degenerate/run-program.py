@@ -0,0 +1,54 @@
+#!/usr/bin/python2
+# runs test.ngc, checks it ends at X6 Y0 and times the G93 spline
+
+import linuxcnc
+import sys
+import time
+
+c = linuxcnc.command()
+s = linuxcnc.stat()
+e = linuxcnc.error_channel()
+
+def wait_for(cond, timeout):
+    end = time.time() + timeout
+    while time.time() < end:
+        s.poll()
+        if cond():
+            return True
+        error = e.poll()
+        if error:
+            print "error:", error[1]
+        time.sleep(0.01)
+    return False
+
+c.state(linuxcnc.STATE_ESTOP_RESET)
+c.state(linuxcnc.STATE_ON)
+c.wait_complete()
+c.mode(linuxcnc.MODE_AUTO)
+c.wait_complete()
+c.program_open("test.ngc")
+c.wait_complete()
+
+c.auto(linuxcnc.AUTO_RUN, 0)
+if not wait_for(lambda: s.interp_state != linuxcnc.INTERP_IDLE, 5):
+    print "program did not start"
+    sys.exit(1)
+# line 5 is the G93 spline
+if not wait_for(lambda: s.motion_line == 5, 60):
+    print "splines stalled at line %d" % s.motion_line
+    sys.exit(1)
+start = time.time()
+if not wait_for(lambda: s.interp_state == linuxcnc.INTERP_IDLE, 60):
+    print "splines stalled at line %d" % s.motion_line
+    sys.exit(1)
+elapsed = time.time() - start
+
+print "end at X%.4f Y%.4f" % (s.position[0], s.position[1])
+if abs(s.position[0] - 6.0) > 0.0001 or abs(s.position[1]) > 0.0001:
+    sys.exit(1)
+
+# G93 F12 is 5 seconds
+print "G93 spline took %.1fs" % elapsed
+if abs(elapsed - 5.0) > 1.0:
+    sys.exit(1)
+open("finished", "w").write("%f\n" % elapsed)
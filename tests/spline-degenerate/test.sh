@@ -0,0 +1,8 @@
+#!/bin/bash
+rm -f finished
+linuxcnc -r spline.ini
+if [ ! -f finished ]; then
+    echo "the splines did not run through"
+    exit 1
+fi
+rm -f finished
@@ -0,0 +1,50 @@
+#!/usr/bin/python2
+# runs test.ngc and writes how long it took to elapsed-<LOOKAHEAD_DEPTH>
+
+import linuxcnc
+import os
+import sys
+import time
+
+c = linuxcnc.command()
+s = linuxcnc.stat()
+e = linuxcnc.error_channel()
+
+def wait_for(cond, timeout):
+    end = time.time() + timeout
+    while time.time() < end:
+        s.poll()
+        if cond():
+            return True
+        error = e.poll()
+        if error:
+            print "error:", error[1]
+        time.sleep(0.01)
+    return False
+
+c.state(linuxcnc.STATE_ESTOP_RESET)
+c.state(linuxcnc.STATE_ON)
+c.wait_complete()
+c.mode(linuxcnc.MODE_AUTO)
+c.wait_complete()
+c.program_open("test.ngc")
+c.wait_complete()
+
+start = time.time()
+c.auto(linuxcnc.AUTO_RUN, 0)
+if not wait_for(lambda: s.interp_state != linuxcnc.INTERP_IDLE, 5):
+    print "program did not start"
+    sys.exit(1)
+if not wait_for(lambda: s.interp_state == linuxcnc.INTERP_IDLE, 120):
+    print "program did not finish"
+    sys.exit(1)
+elapsed = time.time() - start
+
+print "end at X%.4f" % s.position[0]
+if abs(s.position[0] - 10.0) > 0.0001:
+    sys.exit(1)
+
+inifile = linuxcnc.ini(os.environ["INI_FILE_NAME"])
+depth = inifile.find("TASK", "LOOKAHEAD_DEPTH") or "0"
+open("elapsed-%s" % depth.strip(), "w").write("%f\n" % elapsed)
+print "LOOKAHEAD_DEPTH %s: %.2fs" % (depth.strip(), elapsed)
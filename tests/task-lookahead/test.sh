@@ -0,0 +1,26 @@
+#!/bin/bash
+# the same program without and with task look-ahead
+
+rm -f elapsed-0 elapsed-2000
+sed -e 's/^LOOKAHEAD_DEPTH.*/LOOKAHEAD_DEPTH = 0/' lookahead.ini > no-lookahead.ini
+
+linuxcnc -r no-lookahead.ini
+linuxcnc -r lookahead.ini
+rm -f no-lookahead.ini
+
+if [ ! -f elapsed-0 -o ! -f elapsed-2000 ]; then
+    echo "a run did not finish"
+    exit 1
+fi
+
+# the look-ahead has to take at most 70% of the time
+python2 - elapsed-0 elapsed-2000 <<EOF2
+import sys
+off = float(open(sys.argv[1]).read())
+on = float(open(sys.argv[2]).read())
+print "without look-ahead %.2fs, with look-ahead %.2fs" % (off, on)
+sys.exit(0 if on < 0.7 * off else 1)
+EOF2
+exitval=$?
+rm -f elapsed-0 elapsed-2000
+exit $exitval